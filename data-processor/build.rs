@@ -0,0 +1,18 @@
+//! 编译 C 协议/解码核心（data-reader/frame_core.c + data_packet.c）为静态库 libframecore，
+//! 与 data-reader 共用同一份实现。
+
+fn main() {
+    let core = std::path::Path::new("../data-reader");
+    let sources = ["frame_core.c", "data_packet.c"];
+
+    let mut build = cc::Build::new();
+    build.include(core).flag_if_supported("-std=c11").warnings(true);
+    for src in sources {
+        build.file(core.join(src));
+        println!("cargo:rerun-if-changed={}", core.join(src).display());
+    }
+    for header in ["frame_core.h", "data_packet.h"] {
+        println!("cargo:rerun-if-changed={}", core.join(header).display());
+    }
+    build.compile("framecore");
+}
@@ -0,0 +1,217 @@
+//! 触发批次的样本存储。
+//!
+//! 每个批次的全部样本按到达顺序存放在一块连续的 int16 区域中（设备原始精度），
+//! 数据包只记录包头和在该区域中的偏移，不再逐包克隆 `ProcessedData`。
+//! 完成的批次以 `Arc<TriggerBurst>` 在缓存、WebSocket 广播、预览和导出之间共享。
+//! 导出直接写入任意 `io::Write`（文件或 HTTP 分块响应），内部缓冲区大小固定。
+
+use crate::data_processing::{ChannelMetadata, DataMetadata, ProcessedData, ProcessedDataType};
+use serde::ser::{Serialize, SerializeSeq, Serializer};
+use std::io::{self, Write};
+
+/// 一个触发数据包的包头及其样本在批次样本区中的位置
+#[derive(Debug, Clone)]
+pub struct BurstPacket {
+    pub timestamp: u64,
+    pub sequence: u64,
+    pub channel_count: usize,
+    pub sample_rate: f64,
+    pub metadata: DataMetadata,
+    pub data_type: ProcessedDataType,
+    offset: usize,
+    len: usize,
+}
+
+#[derive(Debug, Clone, Default)]
+pub struct BurstSamples {
+    samples: Vec<i16>,
+    packets: Vec<BurstPacket>,
+}
+
+impl BurstSamples {
+    pub fn with_capacity(samples: usize) -> Self {
+        Self { samples: Vec::with_capacity(samples), packets: Vec::new() }
+    }
+
+    /// 追加一个数据包：`samples` 为按通道排列的原始样本，包头取自 `processed`
+    pub fn push(&mut self, processed: &ProcessedData, samples: &[i16]) {
+        let offset = self.samples.len();
+        self.samples.extend_from_slice(samples);
+        self.packets.push(BurstPacket {
+            timestamp: processed.timestamp,
+            sequence: processed.sequence,
+            channel_count: processed.channel_count,
+            sample_rate: processed.sample_rate,
+            metadata: processed.metadata.clone(),
+            data_type: processed.data_type.clone(),
+            offset,
+            len: samples.len(),
+        });
+    }
+
+    pub fn len(&self) -> usize {
+        self.packets.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.packets.is_empty()
+    }
+
+    pub fn total_samples(&self) -> usize {
+        self.samples.len()
+    }
+
+    pub fn packets(&self) -> &[BurstPacket] {
+        &self.packets
+    }
+
+    /// 批次内全部样本，按数据包、通道顺序排列
+    pub fn samples(&self) -> &[i16] {
+        &self.samples
+    }
+
+    pub fn packet_samples(&self, packet: &BurstPacket) -> &[i16] {
+        &self.samples[packet.offset..packet.offset + packet.len]
+    }
+
+    /// 数据包内各通道的样本列
+    pub fn columns<'a>(&'a self, packet: &'a BurstPacket) -> impl Iterator<Item = (&'a ChannelMetadata, &'a [i16])> + 'a {
+        let data = self.packet_samples(packet);
+        let mut offset = 0;
+        packet.metadata.channel_info.iter().map(move |ch| {
+            let end = (offset + ch.sample_count).min(data.len());
+            let column = &data[offset..end];
+            offset = end;
+            (ch, column)
+        })
+    }
+
+    pub fn duration_ms(&self) -> f64 {
+        match (self.packets.first(), self.packets.last()) {
+            (Some(first), Some(last)) if self.packets.len() > 1 => {
+                last.timestamp.saturating_sub(first.timestamp) as f64
+            }
+            _ => 0.0,
+        }
+    }
+
+    // ===================== 导出 =====================
+
+    /// `timestamp_ms,channel_id,sample_index,value` 行，channel_id 为包内通道序号。
+    /// 样本是整数，按原格式输出6位小数。
+    pub fn write_csv<W: Write>(&self, w: &mut W) -> io::Result<()> {
+        w.write_all(b"timestamp_ms,channel_id,sample_index,value\n")?;
+
+        let mut line: Vec<u8> = Vec::with_capacity(64 * 1024);
+        for packet in &self.packets {
+            // 多速率包各通道列长度不同，按 channel_info 切分
+            for (ch, (_, column)) in self.columns(packet).enumerate() {
+                if column.is_empty() {
+                    continue;
+                }
+                // 同一通道的行共享 "timestamp,ch," 前缀
+                let mut prefix = [0u8; 32];
+                let mut n = write_int(&mut prefix, packet.timestamp as i64);
+                prefix[n] = b',';
+                n += 1;
+                n += write_int(&mut prefix[n..], ch as i64);
+                prefix[n] = b',';
+                n += 1;
+                let prefix = &prefix[..n];
+
+                for (idx, &v) in column.iter().enumerate() {
+                    let mut num = [0u8; 20];
+                    line.extend_from_slice(prefix);
+                    let k = write_int(&mut num, idx as i64);
+                    line.extend_from_slice(&num[..k]);
+                    line.push(b',');
+                    let k = write_int(&mut num, v as i64);
+                    line.extend_from_slice(&num[..k]);
+                    line.extend_from_slice(b".000000\n");
+                }
+                if line.len() >= 60 * 1024 {
+                    w.write_all(&line)?;
+                    line.clear();
+                }
+            }
+        }
+        w.write_all(&line)
+    }
+
+    pub fn binary_size(&self) -> usize {
+        12 + self.samples.len() * 4
+    }
+
+    /// [u32 触发时间戳] [u32 触发通道] [u32 样本数] [f32 样本...]，小端
+    pub fn write_binary<W: Write>(&self, trigger_timestamp: u32, trigger_channel: u16, w: &mut W) -> io::Result<()> {
+        let mut header = [0u8; 12];
+        header[0..4].copy_from_slice(&trigger_timestamp.to_le_bytes());
+        header[4..8].copy_from_slice(&(trigger_channel as u32).to_le_bytes());
+        header[8..12].copy_from_slice(&(self.samples.len() as u32).to_le_bytes());
+        w.write_all(&header)?;
+
+        let mut block = [0u8; 16 * 1024];
+        for chunk in self.samples.chunks(block.len() / 4) {
+            for (dst, &v) in block.chunks_exact_mut(4).zip(chunk) {
+                dst.copy_from_slice(&(v as f32).to_le_bytes());
+            }
+            w.write_all(&block[..chunk.len() * 4])?;
+        }
+        Ok(())
+    }
+}
+
+/// 十进制整数写入 buf，返回字节数（buf 至少20字节）
+fn write_int(buf: &mut [u8], v: i64) -> usize {
+    let mut digits = [0u8; 20];
+    let mut n = 0;
+    let mut u = v.unsigned_abs();
+    loop {
+        digits[n] = b'0' + (u % 10) as u8;
+        n += 1;
+        u /= 10;
+        if u == 0 {
+            break;
+        }
+    }
+    let mut k = 0;
+    if v < 0 {
+        buf[0] = b'-';
+        k = 1;
+    }
+    for i in (0..n).rev() {
+        buf[k] = digits[i];
+        k += 1;
+    }
+    k
+}
+
+/// 与原先 `Vec<ProcessedData>` 的 JSON 结构一致：每个数据包一个对象，`data` 为该包样本
+#[derive(serde::Serialize)]
+struct PacketJson<'a> {
+    timestamp: u64,
+    sequence: u64,
+    channel_count: usize,
+    sample_rate: f64,
+    data: &'a [i16],
+    metadata: &'a DataMetadata,
+    data_type: &'a ProcessedDataType,
+}
+
+impl Serialize for BurstSamples {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let mut seq = serializer.serialize_seq(Some(self.packets.len()))?;
+        for p in &self.packets {
+            seq.serialize_element(&PacketJson {
+                timestamp: p.timestamp,
+                sequence: p.sequence,
+                channel_count: p.channel_count,
+                sample_rate: p.sample_rate,
+                data: self.packet_samples(p),
+                metadata: &p.metadata,
+                data_type: &p.data_type,
+            })?;
+        }
+        seq.end()
+    }
+}
@@ -33,12 +33,74 @@ pub struct StorageConfig {
     pub max_files: usize,
 }
 
+#[derive(Clone, Debug, Serialize, Deserialize)]
+pub struct RetentionConfig {
+    /// 是否启动后台保留管理（默认关闭，设置 RETENTION=1 启用）
+    pub enabled: bool,
+    /// 受管理的采集目录（为空时只管理 storage.data_dir）
+    pub dirs: Vec<String>,
+    /// 每个目录的字节预算（0 = 不限）
+    pub max_bytes: u64,
+    /// 超过该时长（按修改时间）的文件直接删除（None = 不限）
+    pub max_age_hours: Option<u64>,
+    /// 文件停止修改多久后压缩成归档
+    pub compact_after_secs: u64,
+    /// 两次整理之间的间隔
+    pub scan_interval_secs: u64,
+    /// 整理线程的读写限速（0 = 不限）
+    pub io_limit_mb_s: u32,
+}
+
+impl Default for RetentionConfig {
+    fn default() -> Self {
+        Self {
+            enabled: false,
+            dirs: Vec::new(),
+            max_bytes: 10 * 1024 * 1024 * 1024,
+            max_age_hours: None,
+            compact_after_secs: 600,
+            scan_interval_secs: 60,
+            io_limit_mb_s: 16,
+        }
+    }
+}
+
+#[derive(Clone, Debug, Default, Serialize, Deserialize)]
+pub struct RealtimeConfig {
+    /// 设备I/O线程绑定的CPU（None = 不绑核）
+    pub io_cpu: Option<usize>,
+    /// 写入线程（数据包处理/缓存/广播）绑定的CPU
+    pub writer_cpu: Option<usize>,
+    /// 两个线程的 SCHED_FIFO 优先级 1-99（None = 普通调度）
+    pub fifo_priority: Option<i32>,
+    /// 启动时 mlockall 锁定内存
+    pub lock_memory: bool,
+}
+
+#[derive(Clone, Debug, Serialize, Deserialize)]
+pub struct EventQueueConfig {
+    /// 设备I/O线程到写入线程的事件队列容量（按批计，一批为一次读取解析出的数据包）
+    pub capacity: usize,
+    /// 队列满时丢弃连续模式数据批（false = 设备I/O线程等待写入线程）；
+    /// 触发数据和控制事件总是等待，不会丢弃
+    pub drop_continuous: bool,
+}
+
+impl Default for EventQueueConfig {
+    fn default() -> Self {
+        Self { capacity: 1024, drop_continuous: true }
+    }
+}
+
 #[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct Config {
     pub device: DeviceConfig,
     pub web_server: WebServerConfig,
     pub websocket: WebSocketConfig,
     pub storage: StorageConfig,
+    pub retention: RetentionConfig,
+    pub realtime: RealtimeConfig,
+    pub event_queue: EventQueueConfig,
 }
 
 impl Default for Config {
@@ -64,6 +126,9 @@ impl Default for Config {
                 default_ext: ".bin".into(),
                 max_files: 200,
             },
+            retention: RetentionConfig::default(),
+            realtime: RealtimeConfig::default(),
+            event_queue: EventQueueConfig::default(),
         }
     }
 }
@@ -76,6 +141,10 @@ impl Config {
     /// - WEB_HOST, WEB_PORT
     /// - WS_HOST, WS_PORT
     /// - DATA_DIR, FILE_PREFIX, FILE_EXT, MAX_FILES
+    /// - RETENTION, RETENTION_DIRS, RETENTION_MAX_MB, RETENTION_MAX_AGE_H,
+    ///   RETENTION_COMPACT_AFTER_S, RETENTION_INTERVAL_S, RETENTION_IO_MBPS
+    /// - RT_IO_CPU, RT_WRITER_CPU, RT_PRIORITY, RT_MLOCK
+    /// - EVENT_QUEUE_CAPACITY, EVENT_QUEUE_DROP
     pub fn load() -> Result<Self> {
         let mut cfg = Self::default();
 
@@ -132,6 +201,65 @@ impl Config {
             }
         }
 
+        // Retention
+        if let Ok(v) = std::env::var("RETENTION") {
+            cfg.retention.enabled = matches!(v.as_str(), "1" | "true" | "yes" | "on");
+        }
+        if let Some(v) = std::env::var_os("RETENTION_DIRS") {
+            // 与 PATH 相同的分隔符（Windows ';'，其他 ':'）
+            cfg.retention.dirs = std::env::split_paths(&v)
+                .filter(|p| !p.as_os_str().is_empty())
+                .map(|p| p.to_string_lossy().into_owned())
+                .collect();
+        }
+        if let Ok(v) = std::env::var("RETENTION_MAX_MB") {
+            if let Ok(mb) = v.parse::<u64>() {
+                cfg.retention.max_bytes = mb * 1024 * 1024;
+            }
+        }
+        if let Ok(v) = std::env::var("RETENTION_MAX_AGE_H") {
+            cfg.retention.max_age_hours = v.parse::<u64>().ok().filter(|h| *h > 0);
+        }
+        if let Ok(v) = std::env::var("RETENTION_COMPACT_AFTER_S") {
+            if let Ok(s) = v.parse::<u64>() {
+                cfg.retention.compact_after_secs = s;
+            }
+        }
+        if let Ok(v) = std::env::var("RETENTION_INTERVAL_S") {
+            if let Ok(s) = v.parse::<u64>() {
+                cfg.retention.scan_interval_secs = s;
+            }
+        }
+        if let Ok(v) = std::env::var("RETENTION_IO_MBPS") {
+            if let Ok(n) = v.parse::<u32>() {
+                cfg.retention.io_limit_mb_s = n;
+            }
+        }
+
+        // Realtime
+        if let Ok(v) = std::env::var("RT_IO_CPU") {
+            cfg.realtime.io_cpu = v.parse::<usize>().ok();
+        }
+        if let Ok(v) = std::env::var("RT_WRITER_CPU") {
+            cfg.realtime.writer_cpu = v.parse::<usize>().ok();
+        }
+        if let Ok(v) = std::env::var("RT_PRIORITY") {
+            cfg.realtime.fifo_priority = v.parse::<i32>().ok().filter(|p| (1..=99).contains(p));
+        }
+        if let Ok(v) = std::env::var("RT_MLOCK") {
+            cfg.realtime.lock_memory = matches!(v.as_str(), "1" | "true" | "yes");
+        }
+
+        // Event queue
+        if let Ok(v) = std::env::var("EVENT_QUEUE_CAPACITY") {
+            if let Ok(n) = v.parse::<usize>() {
+                cfg.event_queue.capacity = n.max(1);
+            }
+        }
+        if let Ok(v) = std::env::var("EVENT_QUEUE_DROP") {
+            cfg.event_queue.drop_continuous = !matches!(v.as_str(), "0" | "false" | "no" | "off");
+        }
+
         Ok(cfg)
     }
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 use anyhow::Result;
 use serde::{Deserialize, Serialize};
 use std::collections::HashMap;
+use std::sync::Arc;
 use tracing::info;
 
+use crate::burst_store::BurstSamples;
 use crate::device_communication::{DataPacket, DataType, TriggerEvent};
+use crate::frame_core;
 
 /// 处理后的数据（供 WebSocket/文件保存使用）
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -61,15 +64,15 @@ pub enum DataQuality {
     Error(String),
 }
 
-/// 触发批次数据结构
-#[derive(Debug, Clone, Serialize, Deserialize)]
+/// 触发批次数据结构（样本集中存放在 data_packets 的样本区中）
+#[derive(Debug, Clone, Serialize)]
 pub struct TriggerBurst {
     pub burst_id: String,
     pub trigger_timestamp: u32,
     pub trigger_channel: u16,
     pub pre_samples: u32,
     pub post_samples: u32,
-    pub data_packets: Vec<ProcessedData>,
+    pub data_packets: BurstSamples,
     pub is_complete: bool,
     pub total_samples: usize,
     pub created_at: i64,
@@ -113,7 +116,7 @@ pub struct DataProcessor {
     
     // 触发批次管理
     current_trigger_burst: Option<TriggerBurst>,
-    completed_trigger_bursts: HashMap<String, TriggerBurst>,
+    completed_trigger_bursts: HashMap<String, Arc<TriggerBurst>>,
     max_cached_bursts: usize,
 }
 
@@ -139,57 +142,46 @@ impl DataProcessor {
 
         // 1) 解析多通道数据（非交错格式）
         let channel_count = packet.enabled_channels.count_ones() as usize;
-        let sample_count = packet.sample_count as usize;
-        
+
         if channel_count == 0 {
             return Err(anyhow::anyhow!("No enabled channels"));
         }
 
-        // 验证数据长度
-        let expected_len = channel_count * sample_count * 2; // int16 = 2 bytes
-        if packet.sensor_data.len() != expected_len {
+        // 验证数据长度（libframecore 已按包头校验过载荷长度）
+        let expected_len: usize = packet.counts.iter().map(|&c| c as usize).sum();
+        if packet.samples.len() != expected_len {
             return Err(anyhow::anyhow!(
-                "Data length mismatch: expected {}, got {}", 
-                expected_len, packet.sensor_data.len()
+                "Data length mismatch: expected {} samples, got {}",
+                expected_len, packet.samples.len()
             ));
         }
 
-        let mut all_samples = Vec::with_capacity(channel_count * sample_count);
-        let mut channel_metadata = Vec::new();
-
-        // 按通道处理数据（非交错格式：CH0所有样本，然后CH1所有样本...）
-        for ch_idx in 0..channel_count {
-            let start_idx = ch_idx * sample_count * 2;
-            let end_idx = start_idx + sample_count * 2;
-            
-            if end_idx <= packet.sensor_data.len() {
-                let ch_data = &packet.sensor_data[start_idx..end_idx];
-                let mut channel_samples = Vec::with_capacity(sample_count);
-                
-                for sample_bytes in ch_data.chunks_exact(2) {
-                    let raw = i16::from_le_bytes([sample_bytes[0], sample_bytes[1]]);
-                    // 直接使用设备提供的值，假设设备已完成单位转换
-                    let value = raw as f64;
-                    channel_samples.push(value);
-                }
-
-                // 计算通道统计信息（用于质量监控，但不修改数据）
-                let (min_val, max_val, sum) = channel_samples.iter().fold(
-                    (f64::INFINITY, f64::NEG_INFINITY, 0.0),
-                    |(min, max, sum), &val| (min.min(val), max.max(val), sum + val)
-                );
-                
-                let channel_id = self.get_channel_id_from_mask(packet.enabled_channels, ch_idx as u8);
-                channel_metadata.push(ChannelMetadata {
-                    channel_id,
-                    sample_count,
-                    min_value: min_val,
-                    max_value: max_val,
-                    avg_value: if sample_count > 0 { sum / sample_count as f64 } else { 0.0 },
-                });
-
-                all_samples.extend(channel_samples);
-            }
+        let mut all_samples = Vec::with_capacity(expected_len);
+        let mut channel_metadata = Vec::with_capacity(channel_count);
+        // 多速率包各通道样本数不同，采样率按样本最多的通道估计
+        let mut max_count = 0usize;
+
+        // 按通道号处理数据（非交错格式：CH0所有样本，然后CH1所有样本...），
+        // 每个通道的列长度取自包头 counts
+        // 统计在 C 核心中对 int16 列计算，随后一次性展宽为 f64
+        let mut offset = 0;
+        for channel_id in (0..16u8).filter(|&bit| packet.enabled_channels & (1 << bit) != 0) {
+            let sample_count = packet.counts[channel_id as usize] as usize;
+            let column = &packet.samples[offset..offset + sample_count];
+            offset += sample_count;
+            max_count = max_count.max(sample_count);
+
+            let stats = frame_core::column_stats(column);
+            channel_metadata.push(ChannelMetadata {
+                channel_id,
+                sample_count,
+                min_value: stats.min as f64,
+                max_value: stats.max as f64,
+                avg_value: if sample_count > 0 { stats.sum as f64 / sample_count as f64 } else { 0.0 },
+            });
+
+            // 直接使用设备提供的值，假设设备已完成单位转换
+            all_samples.extend(column.iter().map(|&v| v as f64));
         }
 
         // 2) 数据完整性评估（不做信号处理）
@@ -233,7 +225,7 @@ impl DataProcessor {
             timestamp: packet.timestamp_ms as u64,
             sequence: self.packet_sequence,
             channel_count,
-            sample_rate: self.estimate_sample_rate(sample_count, channel_count),
+            sample_rate: self.estimate_sample_rate(max_count, channel_count),
             data: all_samples, // 使用原始数据，不进行滤波
             metadata: DataMetadata {
                 packet_count: self.packet_sequence,
@@ -247,8 +239,8 @@ impl DataProcessor {
         // 如果是触发数据，添加到当前批次
         if let DataType::Trigger { .. } = &packet.data_type {
             if let Some(ref mut burst) = self.current_trigger_burst {
-                burst.data_packets.push(processed.clone());
-                burst.total_samples += processed.data.len();
+                burst.data_packets.push(&processed, &packet.samples);
+                burst.total_samples = burst.data_packets.total_samples();
             }
         }
 
@@ -267,7 +259,9 @@ impl DataProcessor {
             trigger_channel: trigger_event.channel,
             pre_samples: trigger_event.pre_samples,
             post_samples: trigger_event.post_samples,
-            data_packets: Vec::new(),
+            // 按预触发+后触发样本数预留（单通道），多通道时由样本区自动扩容
+            data_packets: BurstSamples::with_capacity(
+                (trigger_event.pre_samples as usize + trigger_event.post_samples as usize).min(1 << 24)),
             is_complete: false,
             total_samples: 0,
             created_at: chrono::Utc::now().timestamp_millis(),
@@ -284,16 +278,17 @@ impl DataProcessor {
     }
 
     /// 完成当前触发批次
-    pub fn complete_trigger_burst(&mut self) -> Option<TriggerBurst> {
+    pub fn complete_trigger_burst(&mut self) -> Option<Arc<TriggerBurst>> {
         if let Some(mut burst) = self.current_trigger_burst.take() {
             burst.is_complete = true;
             
             // 计算质量摘要
             self.calculate_quality_summary(&mut burst);
             
-            // 添加到完成列表
+            // 添加到完成列表（与广播共享同一份样本）
+            let burst = Arc::new(burst);
             let burst_id = burst.burst_id.clone();
-            self.completed_trigger_bursts.insert(burst_id, burst.clone());
+            self.completed_trigger_bursts.insert(burst_id, Arc::clone(&burst));
             
             // 限制缓存数量（保留最新的）
             if self.completed_trigger_bursts.len() > self.max_cached_bursts {
@@ -339,9 +334,9 @@ impl DataProcessor {
         summaries
     }
 
-    /// 获取指定触发批次的详细数据
-    pub fn get_trigger_burst(&self, burst_id: &str) -> Option<&TriggerBurst> {
-        self.completed_trigger_bursts.get(burst_id)
+    /// 获取指定触发批次的详细数据（共享引用，可在释放处理器锁之后使用）
+    pub fn get_trigger_burst(&self, burst_id: &str) -> Option<Arc<TriggerBurst>> {
+        self.completed_trigger_bursts.get(burst_id).cloned()
     }
 
     /// 删除指定的触发批次
@@ -349,40 +344,6 @@ impl DataProcessor {
         self.completed_trigger_bursts.remove(burst_id).is_some()
     }
 
-    /// 导出触发批次为保存格式
-    pub fn export_trigger_burst(&self, burst_id: &str, format: &str) -> Result<Vec<u8>> {
-        let burst = self.get_trigger_burst(burst_id)
-            .ok_or_else(|| anyhow::anyhow!("Trigger burst not found: {}", burst_id))?;
-
-        match format {
-            "json" => {
-                let json = serde_json::to_string_pretty(burst)?;
-                Ok(json.into_bytes())
-            }
-            "csv" => {
-                self.export_burst_as_csv(burst)
-            }
-            "binary" => {
-                self.export_burst_as_binary(burst)
-            }
-            _ => Err(anyhow::anyhow!("Unsupported format: {}", format))
-        }
-    }
-
-    /// 从通道掩码获取实际通道ID
-    fn get_channel_id_from_mask(&self, mask: u16, index: u8) -> u8 {
-        let mut current_index = 0;
-        for bit in 0..16 {
-            if (mask & (1 << bit)) != 0 {
-                if current_index == index {
-                    return bit;
-                }
-                current_index += 1;
-            }
-        }
-        index // fallback
-    }
-
     /// 数据完整性评估（替代原来的质量评估）
     /// 专注于数据结构完整性，不假设具体的数值范围
     fn assess_data_integrity(&self, samples: &[f64], channel_info: &[ChannelMetadata]) -> DataQuality {
@@ -430,9 +391,10 @@ impl DataProcessor {
         }
 
         // 检查数据包的时间连续性
-        if burst.data_packets.len() > 1 {
-            let mut prev_timestamp = burst.data_packets[0].timestamp;
-            for packet in &burst.data_packets[1..] {
+        let packets = burst.data_packets.packets();
+        if packets.len() > 1 {
+            let mut prev_timestamp = packets[0].timestamp;
+            for packet in &packets[1..] {
                 let time_diff = packet.timestamp.saturating_sub(prev_timestamp);
                 // 检查时间间隔是否合理（允许一定的抖动）
                 if time_diff > 50 || time_diff == 0 {  // 超过50ms或时间戳重复
@@ -457,114 +419,53 @@ impl DataProcessor {
 
     /// 增强的批次统计计算（可选的分析功能）
     fn calculate_quality_summary(&self, burst: &mut TriggerBurst) {
-        // 计算全局统计信息，但不修改原始数据
-        let mut all_samples = Vec::new();
-        let mut channel_data: HashMap<u8, Vec<f64>> = HashMap::new();
-
-        for packet in &burst.data_packets {
-            all_samples.extend(&packet.data);
-            
-            // 按通道分组数据（简化处理）
-            for (i, &sample) in packet.data.iter().enumerate() {
-                let channel_id = (i % packet.channel_count) as u8;
-                channel_data.entry(channel_id).or_default().push(sample);
+        // 按通道号累积各数据包的列统计，不复制样本
+        let mut channel_acc: HashMap<u8, (usize, i64, u64, i16, i16)> = HashMap::new();
+        for packet in burst.data_packets.packets() {
+            for (ch, column) in burst.data_packets.columns(packet) {
+                if column.is_empty() {
+                    continue;
+                }
+                let st = frame_core::column_stats(column);
+                let acc = channel_acc.entry(ch.channel_id).or_insert((0, 0, 0, i16::MAX, i16::MIN));
+                acc.0 += column.len();
+                acc.1 += st.sum;
+                acc.2 += st.sum_sq;
+                acc.3 = acc.3.min(st.min);
+                acc.4 = acc.4.max(st.max);
             }
         }
 
         // 计算数值范围（不假设单位）
-        if !all_samples.is_empty() {
-            let min_val = all_samples.iter().fold(f64::INFINITY, |a, &b| a.min(b));
-            let max_val = all_samples.iter().fold(f64::NEG_INFINITY, |a, &b| a.max(b));
-            burst.quality_summary.value_range = (min_val, max_val);
+        if !channel_acc.is_empty() {
+            let min_val = channel_acc.values().map(|a| a.3).min().unwrap_or(0);
+            let max_val = channel_acc.values().map(|a| a.4).max().unwrap_or(0);
+            burst.quality_summary.value_range = (min_val as f64, max_val as f64);
         }
 
         // 计算各通道统计信息
-        burst.quality_summary.channel_stats = channel_data.iter()
-            .map(|(&channel_id, samples)| {
-                let sum: f64 = samples.iter().sum();
-                let count = samples.len();
-                let avg = if count > 0 { sum / count as f64 } else { 0.0 };
-                let min_val = samples.iter().fold(f64::INFINITY, |a, &b| a.min(b));
-                let max_val = samples.iter().fold(f64::NEG_INFINITY, |a, &b| a.max(b));
-                
-                // 计算RMS值
-                let sum_squares: f64 = samples.iter().map(|&x| x * x).sum();
-                let rms = if count > 0 { (sum_squares / count as f64).sqrt() } else { 0.0 };
-
+        let mut channel_stats: Vec<ChannelStats> = channel_acc.iter()
+            .map(|(&channel_id, &(count, sum, sum_sq, min, max))| {
+                let n = count.max(1) as f64;
                 ChannelStats {
                     channel_id,
                     sample_count: count,
-                    min_value: min_val,
-                    max_value: max_val,
-                    avg_value: avg,
-                    rms_value: rms,
+                    min_value: min as f64,
+                    max_value: max as f64,
+                    avg_value: sum as f64 / n,
+                    rms_value: (sum_sq as f64 / n).sqrt(),
                 }
             })
             .collect();
+        channel_stats.sort_by_key(|c| c.channel_id);
+        burst.quality_summary.channel_stats = channel_stats;
 
         // 评估整体质量
         burst.quality_summary.overall_quality = self.assess_burst_quality(burst);
     }
 
     pub fn calculate_duration_ms(&self, burst: &TriggerBurst) -> f64 {
-        if burst.data_packets.len() <= 1 {
-            return 0.0;
-        }
-
-        let first_ts = burst.data_packets[0].timestamp;
-        let last_ts = burst.data_packets.last().unwrap().timestamp;
-        (last_ts - first_ts) as f64
-    }
-
-    fn export_burst_as_csv(&self, burst: &TriggerBurst) -> Result<Vec<u8>> {
-        let mut csv_content = String::new();
-        
-        // CSV头部
-        csv_content.push_str("timestamp_ms,channel_id,sample_index,value\n");
-        
-        // 数据行
-        for packet in &burst.data_packets {
-            let samples_per_channel = packet.data.len() / packet.channel_count.max(1);
-            
-            for ch in 0..packet.channel_count {
-                for sample_idx in 0..samples_per_channel {
-                    let data_idx = ch * samples_per_channel + sample_idx;
-                    if data_idx < packet.data.len() {
-                        csv_content.push_str(&format!(
-                            "{},{},{},{:.6}\n",
-                            packet.timestamp,
-                            ch,
-                            sample_idx,
-                            packet.data[data_idx]
-                        ));
-                    }
-                }
-            }
-        }
-        
-        Ok(csv_content.into_bytes())
-    }
-
-    fn export_burst_as_binary(&self, burst: &TriggerBurst) -> Result<Vec<u8>> {
-        // 简单的二进制格式：
-        // [8字节头] [4字节样本数] [样本数据...]
-        let mut binary_data = Vec::new();
-        
-        // 写入头部信息
-        binary_data.extend(&burst.trigger_timestamp.to_le_bytes());
-        binary_data.extend(&(burst.trigger_channel as u32).to_le_bytes());
-        
-        // 写入样本数
-        binary_data.extend(&(burst.total_samples as u32).to_le_bytes());
-        
-        // 写入样本数据（32位浮点数）
-        for packet in &burst.data_packets {
-            for &sample in &packet.data {
-                binary_data.extend(&(sample as f32).to_le_bytes());
-            }
-        }
-        
-        Ok(binary_data)
+        burst.data_packets.duration_ms()
     }
 
     /// 重置触发状态（在模式切换时调用）
@@ -586,6 +487,18 @@ impl DataProcessor {
     }
 }
 
+/// 把批次按格式流式写入 `w`（文件或 HTTP 分块响应），不在内存中组装整个导出。
+/// 调用方应先通过 `get_trigger_burst` 取得共享引用并释放处理器锁。
+pub fn write_burst<W: std::io::Write>(burst: &TriggerBurst, format: &str, w: &mut W) -> Result<()> {
+    match format {
+        "json" => serde_json::to_writer_pretty(w, burst)?,
+        "csv" => burst.data_packets.write_csv(w)?,
+        "binary" => burst.data_packets.write_binary(burst.trigger_timestamp, burst.trigger_channel, w)?,
+        _ => return Err(anyhow::anyhow!("Unsupported format: {}", format)),
+    }
+    Ok(())
+}
+
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct ProcessingStats {
     pub total_packets_processed: u64,
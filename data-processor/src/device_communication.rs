@@ -1,5 +1,4 @@
 use anyhow::{anyhow, Result};
-use bytes::{Buf, BytesMut};
 use serde::{Deserialize, Serialize};
 use std::time::Duration;
 use tokio::io::{AsyncReadExt, AsyncWriteExt};
@@ -8,9 +7,12 @@ use tokio::sync::mpsc;
 use tokio_serial::{SerialPortBuilderExt, SerialStream};
 use tracing::{debug, error, info, warn};
 
-/// 帧常量（如与你设备不同，请同步调整）
-const FRAME_HEAD: [u8; 2] = [0xAA, 0x55];
-const FRAME_TAIL: [u8; 2] = [0x55, 0xAA];
+use crate::config::EventQueueConfig;
+use crate::event_queue::{self, EventReceiver, EventSender};
+use crate::frame_core::{self, FrameStream, PacketInfo};
+
+const CMD_DATA_PACKET: u8 = 0x40;
+const CMD_DATA_PACKET_MULTIRATE: u8 = 0x43;
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct DeviceConfig {
@@ -38,8 +40,8 @@ pub struct RawFrame {
 pub struct DataPacket {
     pub timestamp_ms: u32,
     pub enabled_channels: u16,  // 修正字段名
-    pub sample_count: u16,      // 修正字段名
-    pub sensor_data: Vec<u8>,
+    pub counts: [u16; frame_core::MAX_CHANNELS], // 按通道号的样本数（未启用为0），多速率包各通道可不同
+    pub samples: Vec<i16>,      // 按通道号排列：CH0全部样本，然后CH1...
     pub data_type: DataType,    // 新增：区分数据类型
 }
 
@@ -64,8 +66,8 @@ pub struct TriggerEvent {
 pub enum DeviceEvent {
     Connected(String),
     Disconnected,
-    FrameReceived(RawFrame),
-    DataPacket(DataPacket),
+    FrameReceived(RawFrame),           // 非数据帧；数据包只以 DataBatch 上报
+    DataBatch(Vec<DataPacket>),        // 一次读取解析出的数据包，按到达顺序
     StatusUpdate(DeviceStatus),
     TriggerEvent(TriggerEvent),        // 新增：触发事件
     BufferTransferComplete,            // 新增：缓冲传输完成
@@ -145,136 +147,60 @@ impl Connection {
     }
 }
 
-/// 协议解析器
+/// 解析出的一帧：数据包已由 libframecore 拆成样本列，其余命令保留原始载荷
+pub enum ParsedFrame {
+    Data { sequence: u8, info: PacketInfo, samples: Vec<i16> },
+    Other(RawFrame),
+}
+
+/// 协议解析器：帧同步、长度/帧尾/CRC 校验和数据包拆列都在 C 核心（libframecore）中完成
 pub struct ProtocolParser {
-    buf: BytesMut,
+    stream: FrameStream,
+    crc_errors: u64,
 }
 
 impl ProtocolParser {
-    pub fn new() -> Self {
-        Self { buf: BytesMut::with_capacity(64 * 1024) }
+    pub fn new() -> Result<Self> {
+        Ok(Self {
+            stream: FrameStream::new(64 * 1024)?,
+            crc_errors: 0,
+        })
     }
 
-    pub fn feed_data(&mut self, data: &[u8]) -> Result<Vec<RawFrame>> {
-        self.buf.extend_from_slice(data);
-        self.parse_frames()
+    /// 预先写满接收缓冲区的容量，使其页面在采集开始前就已分配（配合 mlockall）
+    pub fn prefault(&mut self) {
+        self.stream.prefault();
     }
 
-    fn parse_frames(&mut self) -> Result<Vec<RawFrame>> {
+    pub fn feed_data(&mut self, data: &[u8]) -> Result<Vec<ParsedFrame>> {
         let mut frames = Vec::new();
-        // 最小帧：2头 +2长 +1cmd +1seq +2crc +2尾 = 10
-        while self.buf.len() >= 10 {
-            if let Some(frame) = self.try_parse_one()? {
-                frames.push(frame);
-            } else {
-                break;
-            }
-        }
-        Ok(frames)
-    }
-
-    fn try_parse_one(&mut self) -> Result<Option<RawFrame>> {
-        // 定位帧头
-        let start_opt = self.find_frame_start()?;
-        let start = match start_opt {
-            Some(i) => i,
-            None => return Ok(None),
-        };
-        if start > 0 {
-            self.buf.advance(start);
-        }
-        if self.buf.len() < 10 {
-            return Ok(None);
-        }
-        if self.buf[0] != FRAME_HEAD[0] || self.buf[1] != FRAME_HEAD[1] {
-            self.buf.advance(1);
-            return Ok(None);
-        }
-
-        // 长度：内容长度 = [CMD(1)+SEQ(1)+PAYLOAD(N)+CRC(2)]
-        let len = u16::from_le_bytes([self.buf[2], self.buf[3]]) as usize;
-        let total = 4 + len + 2; // 头(2)+长(2)+内容(len)+尾(2)
-        if self.buf.len() < total {
-            return Ok(None);
-        }
-
-        // 验尾
-        let tail = total - 2;
-        if self.buf[tail] != FRAME_TAIL[0] || self.buf[tail + 1] != FRAME_TAIL[1] {
-            self.buf.advance(1);
-            return Ok(None);
-        }
-
-        // 提取字段
-        let cmd = self.buf[4];
-        let seq = self.buf[5];
-        let payload_len = len.saturating_sub(4); // cmd(1)+seq(1)+crc(2)
-        let payload_start = 6;
-        let payload_end = payload_start + payload_len;
-
-        let mut payload = vec![0u8; payload_len];
-        if payload_len > 0 {
-            payload.copy_from_slice(&self.buf[payload_start..payload_end]);
-        }
-
-        // CRC 覆盖 CMD..PAYLOAD
-        let crc_pos = payload_end;
-        let rx_crc = u16::from_le_bytes([self.buf[crc_pos], self.buf[crc_pos + 1]]);
-        let calc_crc = Self::crc16(&self.buf[4..crc_pos]);
-        if rx_crc != calc_crc {
-            warn!("CRC mismatch: rx={:04X} calc={:04X}", rx_crc, calc_crc);
-            self.buf.advance(1);
-            return Ok(None);
-        }
-
-        let frame = RawFrame {
-            command_id: cmd,
-            sequence: seq,
-            payload,
-            _timestamp: std::time::Instant::now(),
-        };
-        self.buf.advance(total);
-        Ok(Some(frame))
-    }
-
-    fn find_frame_start(&self) -> Result<Option<usize>> {
-        if self.buf.len() < 2 { return Ok(None); }
-        for i in 0..self.buf.len().saturating_sub(1) {
-            if self.buf[i] == FRAME_HEAD[0] && self.buf[i + 1] == FRAME_HEAD[1] {
-                return Ok(Some(i));
-            }
-        }
-        Ok(None)
-    }
-
-    fn crc16(data: &[u8]) -> u16 {
-        let mut crc: u16 = 0xFFFF;
-        for &b in data {
-            crc ^= b as u16;
-            for _ in 0..8 {
-                if (crc & 1) != 0 {
-                    crc = (crc >> 1) ^ 0xA001;
-                } else {
-                    crc >>= 1;
+        self.stream.feed(data, |f| {
+            // 数据包直接从解析缓冲区拆列，不再先复制一份载荷
+            if f.cmd == CMD_DATA_PACKET || f.cmd == CMD_DATA_PACKET_MULTIRATE {
+                let mut samples = Vec::new();
+                if let Some(info) = frame_core::decode_columns(f.cmd, f.payload, &mut samples) {
+                    frames.push(ParsedFrame::Data { sequence: f.seq, info, samples });
+                    return;
                 }
             }
+            frames.push(ParsedFrame::Other(RawFrame {
+                command_id: f.cmd,
+                sequence: f.seq,
+                payload: f.payload.to_vec(),
+                _timestamp: std::time::Instant::now(),
+            }));
+        });
+
+        let crc_errors = self.stream.stats().crc_errors;
+        if crc_errors > self.crc_errors {
+            warn!("CRC mismatch: {} frame(s) dropped", crc_errors - self.crc_errors);
+            self.crc_errors = crc_errors;
         }
-        crc
+        Ok(frames)
     }
 
-    pub fn build_frame(command: u8, seq: u8, payload: &[u8]) -> Vec<u8> {
-        // LEN = 1(cmd) + 1(seq) + payload + 2(crc)
-        let len = 1 + 1 + payload.len() + 2;
-        let mut out = Vec::with_capacity(4 + len + 2);
-        out.extend_from_slice(&FRAME_HEAD);
-        out.extend_from_slice(&(len as u16).to_le_bytes());
-        out.push(command);
-        out.push(seq);
-        out.extend_from_slice(payload);
-        let crc = Self::crc16(&out[4..4 + 2 + payload.len()]);
-        out.extend_from_slice(&crc.to_le_bytes());
-        out.extend_from_slice(&FRAME_TAIL);
-        out
+    pub fn build_frame(command: u8, seq: u8, payload: &[u8]) -> Result<Vec<u8>> {
+        frame_core::build_frame(command, seq, payload)
     }
 }
 
@@ -285,8 +211,9 @@ pub struct DeviceManager {
     parser: ProtocolParser,
     status: DeviceStatus,
 
-    // 对外事件
-    event_tx: mpsc::UnboundedSender<DeviceEvent>,
+    // 对外事件（有界队列）；本次读取中尚未入队的数据包
+    events: EventSender,
+    pending: Vec<DataPacket>,
     // 接收控制命令
     command_rx: mpsc::UnboundedReceiver<DeviceCommand>,
 
@@ -298,16 +225,16 @@ pub struct DeviceManager {
 }
 
 impl DeviceManager {
-    pub fn new(config: DeviceConfig)
-        -> (Self, mpsc::UnboundedReceiver<DeviceEvent>, mpsc::UnboundedSender<DeviceCommand>)
+    pub fn new(config: DeviceConfig, queue: &EventQueueConfig)
+        -> Result<(Self, EventReceiver, mpsc::UnboundedSender<DeviceCommand>)>
     {
-        let (event_tx, event_rx) = mpsc::unbounded_channel();
+        let (events, event_rx) = event_queue::channel(queue);
         let (cmd_tx, command_rx) = mpsc::unbounded_channel();
 
         let me = Self {
             config,
             connection: None,
-            parser: ProtocolParser::new(),
+            parser: ProtocolParser::new()?,
             status: DeviceStatus {
                 connected: false,
                 device_id: None,
@@ -315,13 +242,18 @@ impl DeviceManager {
                 mode: None,
                 stream_active: false,
             },
-            event_tx,
+            events,
+            pending: Vec::new(),
             command_rx,
             seq: 0,
             trigger_active: false,
             current_trigger: None,
         };
-        (me, event_rx, cmd_tx)
+        Ok((me, event_rx, cmd_tx))
+    }
+
+    pub fn prefault_buffers(&mut self) {
+        self.parser.prefault();
     }
 
     pub async fn run(&mut self) -> Result<()> {
@@ -335,7 +267,7 @@ impl DeviceManager {
                 match self.try_connect().await {
                     Ok(_) => {
                         self.status.connected = true;
-                        let _ = self.event_tx.send(DeviceEvent::Connected(format!("{:?}", self.config.connection_type)));
+                        self.emit(DeviceEvent::Connected(format!("{:?}", self.config.connection_type))).await;
                         // 初始 PING
                         self.send_command(0x01, &[]).await?;
                     }
@@ -390,7 +322,7 @@ impl DeviceManager {
                                 error!("read error: {}", e);
                                 self.connection = None;
                                 self.status.connected = false;
-                                let _ = self.event_tx.send(DeviceEvent::Disconnected);
+                                self.emit(DeviceEvent::Disconnected).await;
                             }
                         }
                     }
@@ -472,7 +404,7 @@ impl DeviceManager {
     async fn send_command(&mut self, command: u8, payload: &[u8]) -> Result<()> {
         let seq = self.seq;
         self.seq = self.seq.wrapping_add(1);
-        let frame = ProtocolParser::build_frame(command, seq, payload);
+        let frame = ProtocolParser::build_frame(command, seq, payload)?;
         if let Some(conn) = self.connection.as_mut() {
             conn.write(&frame).await?;
             debug!("Sent cmd=0x{:02X} seq={}", command, seq);
@@ -485,11 +417,52 @@ impl DeviceManager {
     async fn process_bytes(&mut self, data: &[u8]) -> Result<()> {
         let frames = self.parser.feed_data(data)?;
         for f in frames {
-            self.handle_frame(f).await?;
+            match f {
+                ParsedFrame::Data { sequence, info, samples } => self.handle_data_packet(sequence, info, samples),
+                ParsedFrame::Other(raw) => self.handle_frame(raw).await?,
+            }
         }
+        self.flush_batch().await;
         Ok(())
     }
 
+    /// 本次读取已解析的数据包作为一批入队
+    async fn flush_batch(&mut self) {
+        if !self.pending.is_empty() {
+            let batch = std::mem::take(&mut self.pending);
+            self.events.send_batch(batch).await;
+        }
+    }
+
+    /// 控制事件入队前先送出之前的数据包，保持与设备帧相同的先后顺序
+    async fn emit(&mut self, event: DeviceEvent) {
+        self.flush_batch().await;
+        self.events.send(event).await;
+    }
+
+    fn handle_data_packet(&mut self, seq: u8, info: PacketInfo, samples: Vec<i16>) {
+        // 确定数据类型 - 关键修改
+        let data_type = match (&self.current_trigger, self.trigger_active) {
+            (Some(trigger), true) => DataType::Trigger {
+                trigger_timestamp: trigger.timestamp,
+                is_complete: false, // 将在 BUFFER_TRANSFER_COMPLETE 时更新
+            },
+            _ => DataType::Continuous,
+        };
+
+        debug!("DATA packet: seq={}, ts={}, channels=0x{:04X}, samples={}, type={:?}",
+            seq, info.timestamp, info.channel_mask, info.total_samples, data_type);
+
+        let pkt = DataPacket {
+            timestamp_ms: info.timestamp,
+            enabled_channels: info.channel_mask,
+            counts: info.counts,
+            samples,
+            data_type,
+        };
+        self.pending.push(pkt);
+    }
+
     async fn handle_frame(&mut self, f: RawFrame) -> Result<()> {
         debug!("frame: cmd=0x{:02X} seq={} len={}", f.command_id, f.sequence, f.payload.len());
         match f.command_id {
@@ -502,7 +475,7 @@ impl DeviceManager {
                     self.status.device_id = Some(id);
                     info!("PONG device_id=0x{:016X}", id);
                 }
-                let _ = self.event_tx.send(DeviceEvent::StatusUpdate(self.status.clone()));
+                self.emit(DeviceEvent::StatusUpdate(self.status.clone())).await;
             }
             0x83 => { // DEVICE_INFO
                 if f.payload.len() >= 3 {
@@ -510,37 +483,10 @@ impl DeviceManager {
                     self.status.firmware_version = Some(fw);
                     info!("DEVICE_INFO fw={}.{}", fw>>8, fw & 0xFF);
                 }
-                let _ = self.event_tx.send(DeviceEvent::StatusUpdate(self.status.clone()));
+                self.emit(DeviceEvent::StatusUpdate(self.status.clone())).await;
             }
-            0x40 => { // DATA_PACKET
-                if f.payload.len() >= 8 {
-                    let ts = u32::from_le_bytes([f.payload[0],f.payload[1],f.payload[2],f.payload[3]]);
-                    let enabled_channels = u16::from_le_bytes([f.payload[4],f.payload[5]]);
-                    let sample_count = u16::from_le_bytes([f.payload[6],f.payload[7]]);
-                    let data = f.payload[8..].to_vec();
-                    
-                    // 确定数据类型 - 关键修改
-                    let data_type = if self.trigger_active && self.current_trigger.is_some() {
-                        DataType::Trigger {
-                            trigger_timestamp: self.current_trigger.as_ref().unwrap().timestamp,
-                            is_complete: false, // 将在 BUFFER_TRANSFER_COMPLETE 时更新
-                        }
-                    } else {
-                        DataType::Continuous
-                    };
-                    
-                    debug!("DATA packet: ts={}, channels=0x{:04X}, samples={}, type={:?}", 
-                        ts, enabled_channels, sample_count, data_type);
-                    
-                    let pkt = DataPacket {
-                        timestamp_ms: ts,
-                        enabled_channels,
-                        sample_count,
-                        sensor_data: data,
-                        data_type,
-                    };
-                    let _ = self.event_tx.send(DeviceEvent::DataPacket(pkt));
-                }
+            CMD_DATA_PACKET | CMD_DATA_PACKET_MULTIRATE => { // 能拆列的已在 handle_data_packet 处理，到这里的长度与包头不符
+                warn!("Invalid DATA packet seq={} len={}", f.sequence, f.payload.len());
             }
             0x41 => { // EVENT_TRIGGERED
                 if f.payload.len() >= 14 {
@@ -561,7 +507,7 @@ impl DeviceManager {
                     
                     // 保存当前触发事件用于后续数据包标识
                     self.current_trigger = Some(trigger_event.clone());
-                    let _ = self.event_tx.send(DeviceEvent::TriggerEvent(trigger_event));
+                    self.emit(DeviceEvent::TriggerEvent(trigger_event)).await;
                 } else {
                     warn!("TRIGGER EVENT with insufficient payload length: {}", f.payload.len());
                 }
@@ -570,7 +516,7 @@ impl DeviceManager {
                 info!("Trigger data transfer complete");
                 
                 // 发送传输完成事件
-                let _ = self.event_tx.send(DeviceEvent::BufferTransferComplete);
+                self.emit(DeviceEvent::BufferTransferComplete).await;
                 
                 // 注意：这里不清除 current_trigger，因为数据处理器需要它来完成批次
                 // self.current_trigger 会在下次触发时重置
@@ -591,7 +537,7 @@ impl DeviceManager {
                         (0x05, 0x00) => "Command not supported".to_string(),
                         _ => format!("Unknown error: type={}, code={}", error_type, error_code),
                     };
-                    let _ = self.event_tx.send(DeviceEvent::Error(error_msg));
+                    self.emit(DeviceEvent::Error(error_msg)).await;
                 }
             }
             0xE0 => { // LOG_MESSAGE
@@ -600,7 +546,7 @@ impl DeviceManager {
                     let msg_len = f.payload[1] as usize;
                     if f.payload.len() >= 2 + msg_len {
                         let message = String::from_utf8_lossy(&f.payload[2..2 + msg_len]).to_string();
-                        let _ = self.event_tx.send(DeviceEvent::LogMessage { level, message });
+                        self.emit(DeviceEvent::LogMessage { level, message }).await;
                     }
                 }
             }
@@ -608,7 +554,7 @@ impl DeviceManager {
                 debug!("Unknown frame 0x{:02X}", f.command_id);
             }
         }
-        let _ = self.event_tx.send(DeviceEvent::FrameReceived(f));
+        self.emit(DeviceEvent::FrameReceived(f)).await;
         Ok(())
     }
 }
\ No newline at end of file
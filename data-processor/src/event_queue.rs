@@ -0,0 +1,183 @@
+//! 设备I/O线程 → 写入线程的有界事件队列。
+//!
+//! 一次读取解析出的数据包合成一批（`DeviceEvent::DataBatch`）按批入队，不再每包一次入队和唤醒；
+//! 队列是 tokio 有界 mpsc，入队/出队走原子操作，不加锁。容量固定，写入线程跟不上时的处理是明确的：
+//!
+//! - 连续模式数据批：`drop_continuous` 为真时直接丢弃并计数，设备读取不受影响；
+//!   否则与下面一样等待。
+//! - 触发数据批和控制事件：等待队列出现空位（反压到设备读取），不会丢弃，
+//!   以免触发批次缺包或状态事件丢失。
+//!
+//! 队列深度、峰值、丢弃和等待次数记录在 `EventQueueStats` 中，由 `/api/control/status` 返回。
+
+use crate::config::EventQueueConfig;
+use crate::device_communication::{DataPacket, DataType, DeviceEvent};
+use serde::{Deserialize, Serialize};
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::time::Instant;
+use tokio::sync::mpsc;
+use tracing::warn;
+
+/// 两次丢弃告警之间至少间隔的丢弃批数
+const DROP_LOG_EVERY: u64 = 1000;
+
+#[derive(Debug, Default)]
+pub struct EventQueueStats {
+    capacity: usize,
+    depth: AtomicUsize,
+    high_water: AtomicUsize,
+    batches: AtomicU64,
+    packets: AtomicU64,
+    dropped_batches: AtomicU64,
+    dropped_packets: AtomicU64,
+    dropped_samples: AtomicU64,
+    blocked_sends: AtomicU64,
+    blocked_us: AtomicU64,
+}
+
+/// 状态接口返回的队列指标快照
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct EventQueueSnapshot {
+    pub capacity: usize,
+    pub depth: usize,
+    pub high_water: usize,
+    pub batches: u64,
+    pub packets: u64,
+    pub dropped_batches: u64,
+    pub dropped_packets: u64,
+    pub dropped_samples: u64,
+    pub blocked_sends: u64,
+    pub blocked_ms: f64,
+}
+
+impl EventQueueStats {
+    pub fn snapshot(&self) -> EventQueueSnapshot {
+        EventQueueSnapshot {
+            capacity: self.capacity,
+            depth: self.depth.load(Ordering::Relaxed),
+            high_water: self.high_water.load(Ordering::Relaxed),
+            batches: self.batches.load(Ordering::Relaxed),
+            packets: self.packets.load(Ordering::Relaxed),
+            dropped_batches: self.dropped_batches.load(Ordering::Relaxed),
+            dropped_packets: self.dropped_packets.load(Ordering::Relaxed),
+            dropped_samples: self.dropped_samples.load(Ordering::Relaxed),
+            blocked_sends: self.blocked_sends.load(Ordering::Relaxed),
+            blocked_ms: self.blocked_us.load(Ordering::Relaxed) as f64 / 1000.0,
+        }
+    }
+
+    /// 入队前先计入深度，避免接收端先出队导致计数下溢
+    fn reserve(&self) {
+        self.depth.fetch_add(1, Ordering::Relaxed);
+    }
+
+    fn unreserve(&self) {
+        self.depth.fetch_sub(1, Ordering::Relaxed);
+    }
+
+    fn enqueued(&self) {
+        self.high_water.fetch_max(self.depth.load(Ordering::Relaxed), Ordering::Relaxed);
+    }
+}
+
+pub fn channel(cfg: &EventQueueConfig) -> (EventSender, EventReceiver) {
+    let capacity = cfg.capacity.max(1);
+    let (tx, rx) = mpsc::channel(capacity);
+    let stats = Arc::new(EventQueueStats { capacity, ..Default::default() });
+    (
+        EventSender { tx, stats: stats.clone(), drop_continuous: cfg.drop_continuous },
+        EventReceiver { rx, stats },
+    )
+}
+
+pub struct EventSender {
+    tx: mpsc::Sender<DeviceEvent>,
+    stats: Arc<EventQueueStats>,
+    drop_continuous: bool,
+}
+
+impl EventSender {
+    /// 控制事件：不丢弃，队列满时等待；接收端已退出时返回 false
+    pub async fn send(&self, event: DeviceEvent) -> bool {
+        self.stats.reserve();
+        let event = match self.tx.try_send(event) {
+            Ok(()) => {
+                self.stats.enqueued();
+                return true;
+            }
+            Err(mpsc::error::TrySendError::Full(event)) => event,
+            Err(mpsc::error::TrySendError::Closed(_)) => {
+                self.stats.unreserve();
+                return false;
+            }
+        };
+        let start = Instant::now();
+        let sent = self.tx.send(event).await.is_ok();
+        if sent {
+            self.stats.enqueued();
+        } else {
+            self.stats.unreserve();
+        }
+        self.stats.blocked_sends.fetch_add(1, Ordering::Relaxed);
+        self.stats.blocked_us.fetch_add(start.elapsed().as_micros() as u64, Ordering::Relaxed);
+        sent
+    }
+
+    /// 一次读取的数据包作为一批入队；队列满时按数据类型丢弃或等待
+    pub async fn send_batch(&self, batch: Vec<DataPacket>) {
+        if batch.is_empty() {
+            return;
+        }
+        let packets = batch.len() as u64;
+        let samples: u64 = batch.iter().map(|p| p.samples.len() as u64).sum();
+        let droppable = self.drop_continuous
+            && batch.iter().all(|p| matches!(p.data_type, DataType::Continuous));
+
+        let sent = if droppable {
+            self.stats.reserve();
+            match self.tx.try_send(DeviceEvent::DataBatch(batch)) {
+                Ok(()) => {
+                    self.stats.enqueued();
+                    true
+                }
+                Err(e) => {
+                    self.stats.unreserve();
+                    if let mpsc::error::TrySendError::Full(_) = e {
+                        let dropped = self.stats.dropped_batches.fetch_add(1, Ordering::Relaxed);
+                        self.stats.dropped_packets.fetch_add(packets, Ordering::Relaxed);
+                        self.stats.dropped_samples.fetch_add(samples, Ordering::Relaxed);
+                        if dropped % DROP_LOG_EVERY == 0 {
+                            warn!("Event queue full ({} batches): dropping continuous data, {} batches dropped so far",
+                                  self.stats.capacity, dropped + 1);
+                        }
+                    }
+                    false
+                }
+            }
+        } else {
+            self.send(DeviceEvent::DataBatch(batch)).await
+        };
+        if sent {
+            self.stats.batches.fetch_add(1, Ordering::Relaxed);
+            self.stats.packets.fetch_add(packets, Ordering::Relaxed);
+        }
+    }
+}
+
+pub struct EventReceiver {
+    rx: mpsc::Receiver<DeviceEvent>,
+    stats: Arc<EventQueueStats>,
+}
+
+impl EventReceiver {
+    pub async fn recv(&mut self) -> Option<DeviceEvent> {
+        let event = self.rx.recv().await?;
+        self.stats.depth.fetch_sub(1, Ordering::Relaxed);
+        Some(event)
+    }
+
+    pub fn stats(&self) -> Arc<EventQueueStats> {
+        self.stats.clone()
+    }
+}
@@ -2,9 +2,11 @@ use anyhow::{anyhow, Result};
 use chrono::Utc;
 use serde::{Deserialize, Serialize};
 use std::fs;
-use std::io::Read;
+use std::io::Write;
 use std::path::{Component, Path, PathBuf};
 
+use crate::retention;
+
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct FileInfo {
     pub filename: String,   // 相对 base 的路径（包含子目录时形如 "dir/name.ext"）
@@ -19,6 +21,13 @@ pub struct ProcessedDataFile {
     pub bytes: Vec<u8>,
 }
 
+/// `open_file` 定位到的下载源
+#[derive(Debug)]
+pub enum FileSource {
+    Plain { path: PathBuf, len: u64 },
+    Archive(PathBuf),
+}
+
 pub struct FileManager {
     base: PathBuf,
 }
@@ -59,13 +68,24 @@ impl FileManager {
         self.list_files_in(None)
     }
 
-    /// 读取相对 base 的文件（支持子目录）
-    pub fn read_file(&self, rel_path: &str) -> Result<Vec<u8>> {
+    /// 定位相对 base 的文件（支持子目录），不读取内容。
+    /// 已被保留管理压缩的文件返回 `<name>.dpa` 归档，由调用方逐块还原
+    pub fn open_file(&self, rel_path: &str) -> Result<FileSource> {
         let full = self.safe_join(&Self::sanitize_rel_path(rel_path)?, false)?;
-        let mut f = fs::File::open(&full)?;
-        let mut buf = Vec::new();
-        f.read_to_end(&mut buf)?;
-        Ok(buf)
+        if !full.exists() {
+            let mut archive = full.as_os_str().to_owned();
+            archive.push(".");
+            archive.push(retention::ARCHIVE_EXT);
+            let archive = PathBuf::from(archive);
+            if archive.is_file() {
+                return Ok(FileSource::Archive(archive));
+            }
+        }
+        let meta = fs::metadata(&full)?;
+        if !meta.is_file() {
+            return Err(anyhow!("not a file: {}", rel_path));
+        }
+        Ok(FileSource::Plain { path: full, len: meta.len() })
     }
 
     /// 保存到 base 根目录（兼容旧接口）
@@ -76,6 +96,17 @@ impl FileManager {
 
     /// 保存到子目录（相对 base）。返回相对路径："dir/filename" 或 "filename"
     pub fn save_at(&self, rel_dir: Option<&str>, data: &ProcessedDataFile) -> Result<String> {
+        let (rel, _) = self.write_at(rel_dir, &data.filename, |file| Ok(file.write_all(&data.bytes)?))?;
+        Ok(rel)
+    }
+
+    /// 在子目录（相对 base）中由 `write` 流式写入文件。先写 `<filename>.part`，
+    /// 成功后改名为目标文件；失败时删除临时文件，不留下截断的内容。
+    /// 返回相对路径（"dir/filename" 或 "filename"）和文件字节数
+    pub fn write_at<F>(&self, rel_dir: Option<&str>, filename: &str, write: F) -> Result<(String, u64)>
+    where
+        F: FnOnce(&mut fs::File) -> Result<()>,
+    {
         // 1) 目录
         let dir_path = if let Some(d) = rel_dir {
             let safe = Self::sanitize_rel_path(d)?;
@@ -86,32 +117,48 @@ impl FileManager {
         fs::create_dir_all(&dir_path)?;
 
         // 2) 文件名
-        let fname_safe = Self::sanitize_rel_path(&data.filename)?;
+        let fname_safe = Self::sanitize_rel_path(filename)?;
         if fname_safe.components().count() != 1 {
             return Err(anyhow!("filename must not contain path separators"));
         }
 
-        // 3) 写入
+        // 3) 写临时文件，完成后改名
         let full_path = dir_path.join(&fname_safe);
-        fs::write(&full_path, &data.bytes)?;
+        let mut part = full_path.as_os_str().to_owned();
+        part.push(".part");
+        let part = PathBuf::from(part);
+        let written = fs::File::create(&part).map_err(anyhow::Error::from).and_then(|mut file| {
+            write(&mut file)?;
+            file.flush()?;
+            Ok(file.metadata()?.len())
+        });
+        let size = match written.and_then(|size| Ok(fs::rename(&part, &full_path).map(|_| size)?)) {
+            Ok(size) => size,
+            Err(e) => {
+                let _ = fs::remove_file(&part);
+                return Err(e);
+            }
+        };
 
         // 4) 返回相对路径
         let rel = if let Some(d) = rel_dir {
             let d_trim = d.trim_matches(|c| c == '/' || c == '\\');
             if d_trim.is_empty() {
-                data.filename.clone()
+                filename.to_string()
             } else {
-                format!("{}/{}", d_trim.replace('\\', "/"), data.filename)
+                format!("{}/{}", d_trim.replace('\\', "/"), filename)
             }
         } else {
-            data.filename.clone()
+            filename.to_string()
         };
-        Ok(rel)
+        Ok((rel, size))
     }
 
-    /// 全局限额清理（仅 base 根目录；如需递归清理可按需扩展）
+    /// 全局限额清理（仅 base 根目录；如需递归清理可按需扩展）。
+    /// 保留管理生成的 `.dpa` 归档不计数也不删除，由保留管理按预算处理
     pub fn cleanup_old_files(&self, max_files: usize) -> Result<()> {
         let mut files = self.list_files()?;
+        files.retain(|fi| !retention::is_archive(Path::new(&fi.filename)));
         if files.len() > max_files {
             files.drain(max_files..).for_each(|fi| {
                 let _ = fs::remove_file(self.base.join(fi.filename));
@@ -161,6 +208,8 @@ impl FileManager {
             "binary".to_string()
         } else if lower.ends_with(".json") {
             "json".to_string()
+        } else if lower.ends_with(".dpa") {
+            "archive".to_string()
         } else {
             "unknown".to_string()
         }
@@ -0,0 +1,288 @@
+//! C 协议/解码核心（`data-reader/frame_core.c`，静态库 `libframecore`）的 FFI 绑定。
+//!
+//! 帧流解析、CRC 校验、组帧和数据包按通道拆列都在 C 侧完成，与 data-reader 共用同一份实现；
+//! 这里只做安全封装，以及 `data-processor frame-bench` 吞吐基准。
+
+use anyhow::{anyhow, Result};
+use std::os::raw::c_int;
+use std::ptr::NonNull;
+use std::time::Instant;
+
+/// 与 frame_core.h 中的 FC_ABI_VERSION 保持一致
+const FC_ABI_VERSION: u32 = 1;
+
+pub const MAX_FRAME_SIZE: usize = 5120;
+pub const FRAME_OVERHEAD: usize = 10;
+pub const MAX_CHANNELS: usize = 16;
+
+// ===================== C ABI =====================
+
+#[repr(C)]
+struct FcStream {
+    _private: [u8; 0],
+}
+
+#[repr(C)]
+struct FcFrame {
+    payload: *const u8,
+    payload_len: u16,
+    cmd: u8,
+    seq: u8,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+#[allow(dead_code)] // 字段与 C 结构体逐一对应，并非都会读取
+pub struct StreamStats {
+    pub bytes_in: u64,
+    pub frames: u64,
+    pub bytes_skipped: u64,
+    pub crc_errors: u64,
+    pub bad_frames: u64,
+}
+
+/// 数据包头：时间戳、通道掩码、各通道样本数
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+#[allow(dead_code)] // 字段与 C 结构体逐一对应，并非都会读取
+pub struct PacketInfo {
+    pub timestamp: u32,
+    pub total_samples: u32,
+    pub channel_mask: u16,
+    pub counts: [u16; MAX_CHANNELS],
+    pub channel_count: u8,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+#[allow(dead_code)] // 字段与 C 结构体逐一对应，并非都会读取
+pub struct ColumnStats {
+    pub sum: i64,
+    pub sum_sq: u64,
+    pub min: i16,
+    pub max: i16,
+}
+
+extern "C" {
+    fn fc_abi_version() -> u32;
+    fn fc_build_frame(cmd: u8, seq: u8, payload: *const u8, payload_len: u16, out: *mut u8, cap: u32) -> i32;
+    fn fc_stream_new(capacity: u32) -> *mut FcStream;
+    fn fc_stream_free(s: *mut FcStream);
+    fn fc_stream_prefault(s: *mut FcStream);
+    fn fc_stream_feed(s: *mut FcStream, data: *const u8, len: u32) -> u32;
+    fn fc_stream_next(s: *mut FcStream, out: *mut FcFrame) -> c_int;
+    fn fc_stream_stats(s: *const FcStream, out: *mut StreamStats);
+    fn fc_decode_columns(cmd: u8, payload: *const u8, payload_len: u16,
+                         info: *mut PacketInfo, columns: *mut i16, capacity: u32) -> c_int;
+    fn fc_column_stats(column: *const i16, count: u32, out: *mut ColumnStats);
+}
+
+// ===================== 安全封装 =====================
+
+/// 一帧的借用视图，载荷指向解析器缓冲区，只在回调内有效
+pub struct FrameView<'a> {
+    pub cmd: u8,
+    pub seq: u8,
+    pub payload: &'a [u8],
+}
+
+/// 接收缓冲区 + 帧解析状态
+pub struct FrameStream {
+    raw: NonNull<FcStream>,
+}
+
+// C 侧状态只通过 &mut self 访问
+unsafe impl Send for FrameStream {}
+
+impl FrameStream {
+    pub fn new(capacity: usize) -> Result<Self> {
+        let version = unsafe { fc_abi_version() };
+        if version != FC_ABI_VERSION {
+            return Err(anyhow!("libframecore ABI {} != expected {}", version, FC_ABI_VERSION));
+        }
+        let raw = unsafe { fc_stream_new(capacity.min(u32::MAX as usize) as u32) };
+        NonNull::new(raw)
+            .map(|raw| Self { raw })
+            .ok_or_else(|| anyhow!("libframecore: out of memory"))
+    }
+
+    pub fn prefault(&mut self) {
+        unsafe { fc_stream_prefault(self.raw.as_ptr()) }
+    }
+
+    /// 送入一段字节，对其中完整且校验通过的每一帧调用一次 `on_frame`
+    pub fn feed(&mut self, mut data: &[u8], mut on_frame: impl FnMut(FrameView<'_>)) {
+        loop {
+            let taken = unsafe {
+                fc_stream_feed(self.raw.as_ptr(), data.as_ptr(), data.len().min(u32::MAX as usize) as u32)
+            } as usize;
+            data = &data[taken..];
+
+            let mut f = FcFrame { payload: std::ptr::null(), payload_len: 0, cmd: 0, seq: 0 };
+            while unsafe { fc_stream_next(self.raw.as_ptr(), &mut f) } == 1 {
+                let payload = if f.payload_len == 0 {
+                    &[][..]
+                } else {
+                    unsafe { std::slice::from_raw_parts(f.payload, f.payload_len as usize) }
+                };
+                on_frame(FrameView { cmd: f.cmd, seq: f.seq, payload });
+            }
+            if data.is_empty() {
+                break;
+            }
+        }
+    }
+
+    pub fn stats(&self) -> StreamStats {
+        let mut st = StreamStats::default();
+        unsafe { fc_stream_stats(self.raw.as_ptr(), &mut st) };
+        st
+    }
+}
+
+impl Drop for FrameStream {
+    fn drop(&mut self) {
+        unsafe { fc_stream_free(self.raw.as_ptr()) }
+    }
+}
+
+pub fn build_frame(cmd: u8, seq: u8, payload: &[u8]) -> Result<Vec<u8>> {
+    let len = u16::try_from(payload.len()).map_err(|_| anyhow!("payload too long: {}", payload.len()))?;
+    let mut out = vec![0u8; payload.len() + FRAME_OVERHEAD];
+    let n = unsafe { fc_build_frame(cmd, seq, payload.as_ptr(), len, out.as_mut_ptr(), out.len() as u32) };
+    if n < 0 {
+        return Err(anyhow!("payload too long: {}", payload.len()));
+    }
+    out.truncate(n as usize);
+    Ok(out)
+}
+
+/// 把 DATA_PACKET / DATA_PACKET_MULTIRATE 载荷拆成按通道号排列的 int16 列，
+/// 追加到 `columns`。命令不是数据包或长度与包头不符时返回 None。
+pub fn decode_columns(cmd: u8, payload: &[u8], columns: &mut Vec<i16>) -> Option<PacketInfo> {
+    let mut info = PacketInfo::default();
+    // 样本数不会超过载荷字节数的一半
+    let start = columns.len();
+    columns.reserve(payload.len() / 2);
+    let capacity = (columns.capacity() - start) as u32;
+    let rc = unsafe {
+        fc_decode_columns(cmd, payload.as_ptr(), payload.len() as u16, &mut info,
+                          columns.as_mut_ptr().add(start), capacity)
+    };
+    if rc != 0 {
+        return None;
+    }
+    unsafe { columns.set_len(start + info.total_samples as usize) };
+    Some(info)
+}
+
+pub fn column_stats(column: &[i16]) -> ColumnStats {
+    let mut st = ColumnStats::default();
+    if !column.is_empty() {
+        unsafe { fc_column_stats(column.as_ptr(), column.len() as u32, &mut st) };
+    }
+    st
+}
+
+// ===================== 吞吐基准 =====================
+
+#[derive(Clone, Copy, Debug)]
+pub struct FrameBenchOptions {
+    pub megabytes: u64,
+    pub channels: u8,
+    pub samples: u16,
+    pub chunk: usize,
+}
+
+impl Default for FrameBenchOptions {
+    fn default() -> Self {
+        // 与设备模拟器默认的数据包相当：2通道、每通道100样本、4KB读取块
+        Self { megabytes: 256, channels: 2, samples: 100, chunk: 4096 }
+    }
+}
+
+/// 解析 `frame-bench` 子命令参数：--mb N --channels N --samples N --chunk N
+pub fn parse_frame_bench_args(args: &[String]) -> Result<FrameBenchOptions> {
+    let mut opts = FrameBenchOptions::default();
+    let mut it = args.iter();
+    while let Some(arg) = it.next() {
+        let mut value = || -> Result<u64> {
+            it.next()
+                .ok_or_else(|| anyhow!("{} needs a value", arg))?
+                .parse::<u64>()
+                .map_err(|e| anyhow!("{}: {}", arg, e))
+        };
+        match arg.as_str() {
+            "--mb" => opts.megabytes = value()?.max(1),
+            "--channels" => opts.channels = value()?.clamp(1, MAX_CHANNELS as u64) as u8,
+            "--samples" => opts.samples = value()?.clamp(1, u16::MAX as u64) as u16,
+            "--chunk" => opts.chunk = value()?.max(1) as usize,
+            other => return Err(anyhow!("unknown frame-bench option '{}'", other)),
+        }
+    }
+    let payload = 8 + opts.channels as usize * opts.samples as usize * 2;
+    if payload + FRAME_OVERHEAD > MAX_FRAME_SIZE {
+        return Err(anyhow!("{} channels x {} samples exceeds the {} byte frame limit",
+                           opts.channels, opts.samples, MAX_FRAME_SIZE));
+    }
+    Ok(opts)
+}
+
+/// 把一段重复的数据帧按读取块大小送入解析器，解析、拆列并统计每列，
+/// 打印字节吞吐和样本吞吐
+pub fn run_frame_bench(opts: FrameBenchOptions) -> Result<()> {
+    let mask: u16 = if opts.channels as usize >= MAX_CHANNELS { u16::MAX } else { (1u16 << opts.channels) - 1 };
+    let mut payload = Vec::with_capacity(8 + opts.channels as usize * opts.samples as usize * 2);
+    payload.extend_from_slice(&0u32.to_le_bytes());
+    payload.extend_from_slice(&mask.to_le_bytes());
+    payload.extend_from_slice(&opts.samples.to_le_bytes());
+    for i in 0..opts.channels as usize * opts.samples as usize {
+        payload.extend_from_slice(&((i as i32 * 37 % 2000 - 1000) as i16).to_le_bytes());
+    }
+
+    // 约1MB的连续帧流，循环送入直到总量达到 --mb
+    let mut stream = Vec::new();
+    let mut seq = 0u8;
+    while stream.len() < 1 << 20 {
+        stream.extend_from_slice(&build_frame(0x40, seq, &payload)?);
+        seq = seq.wrapping_add(1);
+    }
+
+    let mut parser = FrameStream::new(64 * 1024)?;
+    let mut columns: Vec<i16> = Vec::with_capacity(MAX_FRAME_SIZE / 2);
+    let mut samples = 0u64;
+    let mut checksum = 0i64;
+    let target = opts.megabytes << 20;
+    let mut fed = 0u64;
+
+    println!("Frame core benchmark: {} MB, {} ch x {} samples/packet ({} B frames), {} B reads",
+             opts.megabytes, opts.channels, opts.samples, payload.len() + FRAME_OVERHEAD, opts.chunk);
+    let start = Instant::now();
+    while fed < target {
+        for chunk in stream.chunks(opts.chunk) {
+            parser.feed(chunk, |f| {
+                columns.clear();
+                if let Some(info) = decode_columns(f.cmd, f.payload, &mut columns) {
+                    let mut offset = 0;
+                    for &count in info.counts.iter().filter(|&&c| c > 0) {
+                        let st = column_stats(&columns[offset..offset + count as usize]);
+                        checksum = checksum.wrapping_add(st.sum);
+                        offset += count as usize;
+                    }
+                    samples += info.total_samples as u64;
+                }
+            });
+            fed += chunk.len() as u64;
+        }
+    }
+    let secs = start.elapsed().as_secs_f64();
+    let st = parser.stats();
+
+    println!("{:<12} {:>10} {:>10} {:>10} {:>8} {:>8}",
+             "", "MB/s", "Mframe/s", "Msample/s", "crc err", "skipped");
+    println!("{:<12} {:>10.1} {:>10.3} {:>10.1} {:>8} {:>8}",
+             "libframecore", st.bytes_in as f64 / secs / 1048576.0, st.frames as f64 / secs / 1e6,
+             samples as f64 / secs / 1e6, st.crc_errors, st.bytes_skipped + st.bad_frames);
+    std::hint::black_box(checksum);
+    Ok(())
+}
@@ -0,0 +1,81 @@
+//! HTTP 流式响应：导出和下载按固定大小的块以 chunked 方式发送，边生成边发送，
+//! 内存占用只取决于在途块数，与导出/文件大小无关。
+
+use axum::body::Body;
+use bytes::Bytes;
+use futures_util::Stream;
+use std::io::{self, Write};
+use std::path::Path;
+use tokio::sync::mpsc;
+use tokio_util::io::ReaderStream;
+use tracing::warn;
+
+pub const CHUNK_SIZE: usize = 64 * 1024;
+/// 生成端最多领先网络发送的块数
+const CHUNKS_IN_FLIGHT: usize = 4;
+
+/// 把写入切成 CHUNK_SIZE 的块交给响应体；客户端断开后写入返回 BrokenPipe
+pub struct ChunkWriter {
+    buf: Vec<u8>,
+    tx: mpsc::Sender<io::Result<Bytes>>,
+}
+
+impl ChunkWriter {
+    fn send(&mut self) -> io::Result<()> {
+        let chunk = std::mem::replace(&mut self.buf, Vec::with_capacity(CHUNK_SIZE));
+        self.tx
+            .blocking_send(Ok(Bytes::from(chunk)))
+            .map_err(|_| io::Error::new(io::ErrorKind::BrokenPipe, "client disconnected"))
+    }
+}
+
+impl Write for ChunkWriter {
+    fn write(&mut self, data: &[u8]) -> io::Result<usize> {
+        let n = data.len().min(CHUNK_SIZE - self.buf.len());
+        self.buf.extend_from_slice(&data[..n]);
+        if self.buf.len() == CHUNK_SIZE {
+            self.send()?;
+        }
+        Ok(n)
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        if !self.buf.is_empty() {
+            self.send()?;
+        }
+        Ok(())
+    }
+}
+
+/// 在阻塞线程池中运行 `produce`，其写入的内容作为响应体流式发送
+pub fn blocking_body<F>(what: String, produce: F) -> Body
+where
+    F: FnOnce(&mut ChunkWriter) -> anyhow::Result<()> + Send + 'static,
+{
+    let (tx, rx) = mpsc::channel(CHUNKS_IN_FLIGHT);
+    tokio::task::spawn_blocking(move || {
+        let mut w = ChunkWriter { buf: Vec::with_capacity(CHUNK_SIZE), tx };
+        let result = produce(&mut w).and_then(|_| w.flush().map_err(anyhow::Error::from));
+        if let Err(e) = result {
+            let disconnected = e
+                .downcast_ref::<io::Error>()
+                .map_or(false, |io| io.kind() == io::ErrorKind::BrokenPipe);
+            if !disconnected {
+                // 响应头已发出，只能中止连接，避免客户端把截断的内容当成完整文件
+                warn!("Streaming {} failed: {}", what, e);
+                let _ = w.tx.blocking_send(Err(io::Error::new(io::ErrorKind::Other, e.to_string())));
+            }
+        }
+    });
+    Body::from_stream(receiver_stream(rx))
+}
+
+fn receiver_stream(rx: mpsc::Receiver<io::Result<Bytes>>) -> impl Stream<Item = io::Result<Bytes>> {
+    futures_util::stream::unfold(rx, |mut rx| async move { rx.recv().await.map(|item| (item, rx)) })
+}
+
+/// 普通文件按 CHUNK_SIZE 分块读取发送
+pub async fn file_body(path: &Path) -> io::Result<Body> {
+    let file = tokio::fs::File::open(path).await?;
+    Ok(Body::from_stream(ReaderStream::with_capacity(file, CHUNK_SIZE)))
+}
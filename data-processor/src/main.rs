@@ -4,6 +4,13 @@ mod web_server;
 mod websocket;
 mod file_manager;
 mod config;
+mod rt_sched;
+mod retention;
+mod frame_core;
+mod ws_stream;
+mod burst_store;
+mod http_stream;
+mod event_queue;
 
 use anyhow::Result;
 use std::sync::Arc;
@@ -15,6 +22,21 @@ use device_communication::{DeviceManager, DeviceConfig, ConnectionType, DeviceEv
 #[tokio::main]
 async fn main() -> Result<()> {
     tracing_subscriber::fmt::init();
+
+    // 子命令：data-processor jitter-bench [--seconds N] [--interval-us N] [--load N]
+    let args: Vec<String> = std::env::args().collect();
+    if args.get(1).map(String::as_str) == Some("jitter-bench") {
+        let cfg = config::Config::load()?;
+        rt_sched::run_jitter_bench(&cfg.realtime, rt_sched::parse_jitter_args(&args[2..])?)?;
+        return Ok(());
+    }
+
+    // 子命令：data-processor frame-bench [--mb N] [--channels N] [--samples N] [--chunk N]
+    if args.get(1).map(String::as_str) == Some("frame-bench") {
+        frame_core::run_frame_bench(frame_core::parse_frame_bench_args(&args[2..])?)?;
+        return Ok(());
+    }
+
     info!("Starting Integrated Data Processor v2.0 with Enhanced Trigger Support");
 
     // 加载配置
@@ -24,6 +46,9 @@ async fn main() -> Result<()> {
     info!("WebSocket: {}:{}", cfg.websocket.host, cfg.websocket.port);
     info!("HTTP API: {}:{}", cfg.web_server.host, cfg.web_server.port);
 
+    // 实时设置：先锁内存，线程级设置在各专用线程启动时应用
+    rt_sched::apply_process(&cfg.realtime);
+
     // 转换设备配置
     let device_config = DeviceConfig {
         connection_type: match cfg.device.connection_type.as_str() {
@@ -36,7 +61,8 @@ async fn main() -> Result<()> {
     };
 
     // 创建设备管理器
-    let (mut device_manager, mut device_events, device_command_tx) = DeviceManager::new(device_config);
+    let (mut device_manager, mut device_events, device_command_tx) = DeviceManager::new(device_config, &cfg.event_queue)?;
+    let event_queue_stats = device_events.stats();
 
     // 统计数据包数量
     let (pkt_tx, pkt_rx) = watch::channel(0u64);
@@ -56,8 +82,10 @@ async fn main() -> Result<()> {
     // 创建共享的数据处理器
     let data_processor = Arc::new(Mutex::new(DataProcessor::new()));
 
-    // ======= 设备管理任务 =======
-    let device_handle = tokio::spawn(async move {
+    // ======= 设备I/O线程 =======
+    // 设备读取和数据包处理各跑在一个专用线程上（单线程运行时），以便按配置绑核和提升优先级
+    device_manager.prefault_buffers();
+    let device_handle = rt_sched::spawn_pinned("device-io", cfg.realtime.io_thread(), move || async move {
         loop {
             match device_manager.run().await {
                 Ok(_) => {
@@ -69,16 +97,16 @@ async fn main() -> Result<()> {
                 }
             }
         }
-    });
+    })?;
 
-    // ======= 设备事件处理任务 =======
+    // ======= 写入线程：设备事件处理 =======
     let processed_tx_clone = processed_tx.clone();
     let trigger_event_tx_clone = trigger_event_tx.clone();
     let trigger_burst_complete_tx_clone = trigger_burst_complete_tx.clone();
     let pkt_tx_clone = pkt_tx.clone();
     let data_processor_clone = data_processor.clone();
     
-    let event_handle = tokio::spawn(async move {
+    let event_handle = rt_sched::spawn_pinned("packet-writer", cfg.realtime.writer_thread(), move || async move {
         let mut packet_count = 0u64;
         let mut _current_burst_id: Option<String> = None;
         
@@ -112,50 +140,49 @@ async fn main() -> Result<()> {
                     // 广播触发事件到WebSocket客户端
                     let _ = trigger_event_tx_clone.send(trigger_event);
                 }
-                DeviceEvent::DataPacket(packet) => {
+                DeviceEvent::DataBatch(packets) => {
                     // 收到数据包表示设备连接正常
                     let _ = device_status_tx.send(true); // 数据活跃时更新状态
-                    
-                    // 处理数据包
-                    let processed_result = {
-                        let mut processor = data_processor_clone.lock().await;
-                        processor.process_packet(&packet)
-                    };
 
-                    match processed_result {
-                        Ok(processed) => {
-                            packet_count += 1;
-                            let _ = pkt_tx_clone.send(packet_count);
-                            
-                            // 日志记录，区分连续和触发数据
-                            let data_len = processed.data.len();
-                            let data_source = processed.data_type.source.clone();
-                            let trigger_info = processed.data_type.trigger_info.clone();
-                            
-                            // 广播处理后的数据
-                            let _ = processed_tx_clone.send(processed);
-                            
-                            match data_source {
-                                crate::data_processing::DataSource::Continuous => {
-                                    if packet_count % 100 == 0 { // 每100包记录一次，避免日志过多
-                                        info!("Processed continuous data packet #{}, {} samples", 
-                                              packet_count, data_len);
+                    // 整批在一次加锁内处理
+                    let mut processor = data_processor_clone.lock().await;
+                    for packet in &packets {
+                        match processor.process_packet(packet) {
+                            Ok(processed) => {
+                                packet_count += 1;
+
+                                // 日志记录，区分连续和触发数据
+                                let data_len = processed.data.len();
+                                let data_source = processed.data_type.source.clone();
+                                let trigger_info = processed.data_type.trigger_info.clone();
+
+                                // 广播处理后的数据
+                                let _ = processed_tx_clone.send(processed);
+
+                                match data_source {
+                                    crate::data_processing::DataSource::Continuous => {
+                                        if packet_count % 100 == 0 { // 每100包记录一次，避免日志过多
+                                            info!("Processed continuous data packet #{}, {} samples",
+                                                  packet_count, data_len);
+                                        }
                                     }
-                                }
-                                crate::data_processing::DataSource::Trigger => {
-                                    if let Some(ref trigger_info) = trigger_info {
-                                        info!("Processed trigger data packet #{}, sequence in burst: {}, {} samples", 
-                                              packet_count, 
-                                              trigger_info.sequence_in_burst.unwrap_or(0), 
-                                              data_len);
+                                    crate::data_processing::DataSource::Trigger => {
+                                        if let Some(ref trigger_info) = trigger_info {
+                                            info!("Processed trigger data packet #{}, sequence in burst: {}, {} samples",
+                                                  packet_count,
+                                                  trigger_info.sequence_in_burst.unwrap_or(0),
+                                                  data_len);
+                                        }
                                     }
                                 }
                             }
-                        }
-                        Err(e) => {
-                            error!("Failed to process data packet: {}", e);
+                            Err(e) => {
+                                error!("Failed to process data packet: {}", e);
+                            }
                         }
                     }
+                    drop(processor);
+                    let _ = pkt_tx_clone.send(packet_count);
                 }
                 DeviceEvent::BufferTransferComplete => {
                     info!("Trigger data transfer completed");
@@ -211,7 +238,22 @@ async fn main() -> Result<()> {
             }
         }
         warn!("Device event processing loop ended");
-    });
+    })?;
+
+    // ======= 采集目录保留管理（低优先级后台线程）=======
+    let mut retention_stats = None;
+    if cfg.retention.enabled {
+        let dirs = if cfg.retention.dirs.is_empty() {
+            vec![std::path::PathBuf::from(&cfg.storage.data_dir)]
+        } else {
+            cfg.retention.dirs.iter().map(std::path::PathBuf::from).collect()
+        };
+        let manager = retention::RetentionManager::new(cfg.retention.clone(), dirs);
+        match manager.spawn() {
+            Ok(stats) => retention_stats = Some(stats),
+            Err(e) => warn!("Retention manager not started: {}", e),
+        }
+    }
 
     // ======= WebSocket 服务：广播处理后的数据、触发事件和批次完成事件 =======
     let mut ws_server = websocket::WebSocketServer::new(
@@ -235,6 +277,8 @@ async fn main() -> Result<()> {
         ws_clients_rx.clone(),
         data_processor.clone(),
         device_status_rx,
+        event_queue_stats,
+        retention_stats,
     );
     let http_handle = tokio::spawn(async move {
         if let Err(e) = web.run().await {
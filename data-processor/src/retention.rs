@@ -0,0 +1,692 @@
+//! 采集目录保留策略：按目录执行字节预算和保留时长。过了活跃期的分段在后台压缩成
+//! 带索引的归档（`.dpa`），超出预算时按修改时间从最旧的文件开始删除。
+//!
+//! 整理工作跑在一个独立的低优先级系统线程上（Linux：idle I/O 调度类 + nice 19；
+//! Windows：后台处理模式），读写再按 `io_limit_mb_s` 限速，采集路径不受影响。
+//! 每个目录中最新的文件视为正在写入，永远不会被压缩或删除。
+//!
+//! 归档格式（小端）：
+//! ```text
+//! "DPA1" | kind u8 | 0u8 x3 | orig_size u64 | orig_mtime_ms i64 | orig_hash u64 | name_len u16 | name
+//! deflate 块 ...
+//! 索引：每块 first_item u64 | item_count u32 | raw_len u32 | offset u64 | comp_len u32
+//! 尾部：index_offset u64 | block_count u32 | "DPAX"
+//! ```
+//! kind 0 为原始字节（item = 字节偏移）；kind 1 为 data-reader 的 `LEN:n HEX: ..` 帧记录，
+//! 块内每帧存为 u16 长度 + 二进制帧（item = 帧序号），解压时逐字节还原原文本。
+
+use anyhow::{anyhow, Result};
+use serde::{Deserialize, Serialize};
+use std::fs::{self, File};
+use std::io::{BufRead, BufReader, BufWriter, Read, Seek, SeekFrom, Write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant, SystemTime};
+use tracing::{info, warn};
+
+use crate::config::RetentionConfig;
+
+pub const ARCHIVE_EXT: &str = "dpa";
+
+const MAGIC: &[u8; 4] = b"DPA1";
+const FOOTER_MAGIC: &[u8; 4] = b"DPAX";
+const KIND_BYTES: u8 = 0;
+const KIND_FRAMES: u8 = 1;
+/// 每块压缩前的大小上限
+const BLOCK_BYTES: usize = 1 << 20;
+const DEFLATE_LEVEL: u8 = 6;
+const INDEX_ENTRY_BYTES: usize = 28;
+const FOOTER_BYTES: u64 = 16;
+
+// ===================== 统计 =====================
+
+/// 后台整理的累计统计，供状态接口读取
+#[derive(Debug, Default)]
+pub struct RetentionStats {
+    pub passes: AtomicU64,
+    pub archives_written: AtomicU64,
+    pub bytes_compacted: AtomicU64,
+    pub bytes_archived: AtomicU64,
+    pub files_deleted: AtomicU64,
+    pub bytes_deleted: AtomicU64,
+    pub managed_bytes: AtomicU64,
+    pub errors: AtomicU64,
+}
+
+/// 状态接口返回的保留管理统计快照
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct RetentionSnapshot {
+    pub passes: u64,
+    pub archives_written: u64,
+    pub bytes_compacted: u64,
+    pub bytes_archived: u64,
+    pub files_deleted: u64,
+    pub bytes_deleted: u64,
+    pub managed_bytes: u64,
+    pub errors: u64,
+}
+
+impl RetentionStats {
+    pub fn snapshot(&self) -> RetentionSnapshot {
+        RetentionSnapshot {
+            passes: self.passes.load(Ordering::Relaxed),
+            archives_written: self.archives_written.load(Ordering::Relaxed),
+            bytes_compacted: self.bytes_compacted.load(Ordering::Relaxed),
+            bytes_archived: self.bytes_archived.load(Ordering::Relaxed),
+            files_deleted: self.files_deleted.load(Ordering::Relaxed),
+            bytes_deleted: self.bytes_deleted.load(Ordering::Relaxed),
+            managed_bytes: self.managed_bytes.load(Ordering::Relaxed),
+            errors: self.errors.load(Ordering::Relaxed),
+        }
+    }
+}
+
+// ===================== 限速 =====================
+
+/// 简单的字节速率限制：累计量超前于 rate * 已用时间 时睡眠
+struct Throttle {
+    bytes_per_sec: u64,
+    start: Instant,
+    consumed: u64,
+}
+
+impl Throttle {
+    fn new(mb_per_sec: u32) -> Self {
+        Self { bytes_per_sec: mb_per_sec as u64 * 1024 * 1024, start: Instant::now(), consumed: 0 }
+    }
+
+    fn consume(&mut self, bytes: usize) {
+        if self.bytes_per_sec == 0 {
+            return;
+        }
+        self.consumed += bytes as u64;
+        let due = Duration::from_secs_f64(self.consumed as f64 / self.bytes_per_sec as f64);
+        let elapsed = self.start.elapsed();
+        if due > elapsed {
+            std::thread::sleep(due - elapsed);
+        }
+    }
+}
+
+// ===================== 低优先级线程 =====================
+
+#[cfg(target_os = "linux")]
+fn lower_thread_priority() {
+    const IOPRIO_WHO_PROCESS: libc::c_long = 1;
+    const IOPRIO_CLASS_IDLE: libc::c_long = 3;
+    const IOPRIO_CLASS_SHIFT: libc::c_long = 13;
+    unsafe {
+        let tid = libc::gettid();
+        // 两项都只作用于本线程（Linux 上 PRIO_PROCESS/IOPRIO_WHO_PROCESS 接受线程 id）
+        if libc::setpriority(libc::PRIO_PROCESS, tid as libc::id_t, 19) != 0 {
+            warn!("Retention: nice 19 failed: {}", std::io::Error::last_os_error());
+        }
+        let rc = libc::syscall(libc::SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid as libc::c_long,
+                               IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+        if rc != 0 {
+            warn!("Retention: idle I/O priority failed: {}", std::io::Error::last_os_error());
+        }
+    }
+}
+
+#[cfg(windows)]
+fn lower_thread_priority() {
+    use windows_sys::Win32::System::Threading::{GetCurrentThread, SetThreadPriority, THREAD_MODE_BACKGROUND_BEGIN};
+    // 后台处理模式同时降低 CPU、I/O 和内存优先级
+    if unsafe { SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) } == 0 {
+        warn!("Retention: background mode failed: {}", std::io::Error::last_os_error());
+    }
+}
+
+#[cfg(not(any(target_os = "linux", windows)))]
+fn lower_thread_priority() {}
+
+// ===================== 管理器 =====================
+
+struct Entry {
+    path: PathBuf,
+    size: u64,
+    modified: SystemTime,
+}
+
+pub struct RetentionManager {
+    cfg: RetentionConfig,
+    dirs: Vec<PathBuf>,
+    stats: Arc<RetentionStats>,
+}
+
+impl RetentionManager {
+    pub fn new(cfg: RetentionConfig, dirs: Vec<PathBuf>) -> Self {
+        Self { cfg, dirs, stats: Arc::new(RetentionStats::default()) }
+    }
+
+    /// 在独立的低优先级线程中周期性执行整理
+    pub fn spawn(self) -> Result<Arc<RetentionStats>> {
+        let stats = self.stats.clone();
+        std::thread::Builder::new()
+            .name("retention".into())
+            .spawn(move || {
+                lower_thread_priority();
+                info!("Retention: managing {:?} (budget {} MB, max age {}, compact after {} s, io {} MB/s)",
+                      self.dirs,
+                      self.cfg.max_bytes / (1024 * 1024),
+                      self.cfg.max_age_hours.map(|h| format!("{} h", h)).unwrap_or_else(|| "off".into()),
+                      self.cfg.compact_after_secs,
+                      self.cfg.io_limit_mb_s);
+                loop {
+                    self.run_pass();
+                    std::thread::sleep(Duration::from_secs(self.cfg.scan_interval_secs.max(1)));
+                }
+            })?;
+        Ok(stats)
+    }
+
+    /// 对每个目录执行一次：压缩到期分段 -> 按时长删除 -> 按预算删除
+    pub fn run_pass(&self) {
+        let mut managed = 0u64;
+        for dir in &self.dirs {
+            match self.run_dir(dir) {
+                Ok(bytes) => managed += bytes,
+                Err(e) => {
+                    self.stats.errors.fetch_add(1, Ordering::Relaxed);
+                    warn!("Retention: {:?}: {}", dir, e);
+                }
+            }
+        }
+        self.stats.managed_bytes.store(managed, Ordering::Relaxed);
+        self.stats.passes.fetch_add(1, Ordering::Relaxed);
+    }
+
+    fn scan(dir: &Path) -> Result<Vec<Entry>> {
+        let mut out = Vec::new();
+        if !dir.exists() {
+            return Ok(out);
+        }
+        for entry in fs::read_dir(dir)? {
+            let entry = entry?;
+            let meta = entry.metadata()?;
+            if !meta.is_file() {
+                continue;
+            }
+            let path = entry.path();
+            // 上次压缩中断留下的临时归档；目录中其他文件（包括别的 .tmp）不动
+            if is_archive_tmp(&path) {
+                let _ = fs::remove_file(&path);
+                continue;
+            }
+            out.push(Entry { path, size: meta.len(), modified: meta.modified()? });
+        }
+        // 最旧的在前
+        out.sort_by_key(|e| e.modified);
+        Ok(out)
+    }
+
+    fn run_dir(&self, dir: &Path) -> Result<u64> {
+        let now = SystemTime::now();
+        let mut entries = Self::scan(dir)?;
+        // 最新的文件视为正在写入
+        let active = entries.pop();
+
+        // 1) 压缩过了活跃期的分段
+        let compact_after = Duration::from_secs(self.cfg.compact_after_secs);
+        for e in entries.iter_mut() {
+            if is_archive(&e.path) || e.size == 0 {
+                continue;
+            }
+            if now.duration_since(e.modified).unwrap_or_default() < compact_after {
+                continue;
+            }
+            match compact_file(&e.path, self.cfg.io_limit_mb_s) {
+                Ok((archive, archived)) => {
+                    self.stats.archives_written.fetch_add(1, Ordering::Relaxed);
+                    self.stats.bytes_compacted.fetch_add(e.size, Ordering::Relaxed);
+                    self.stats.bytes_archived.fetch_add(archived, Ordering::Relaxed);
+                    info!("Retention: {:?} -> {:?} ({} -> {} bytes)", e.path, archive, e.size, archived);
+                    // 归档沿用原文件的修改时间，删除顺序不变
+                    e.path = archive;
+                    e.size = archived;
+                }
+                Err(err) => {
+                    self.stats.errors.fetch_add(1, Ordering::Relaxed);
+                    warn!("Retention: compact {:?} failed: {}", e.path, err);
+                }
+            }
+        }
+
+        // 2) 保留时长
+        if let Some(hours) = self.cfg.max_age_hours {
+            let max_age = Duration::from_secs(hours * 3600);
+            entries.retain(|e| {
+                if now.duration_since(e.modified).unwrap_or_default() > max_age {
+                    !self.delete(e)
+                } else {
+                    true
+                }
+            });
+        }
+
+        // 3) 字节预算：从最旧的开始删
+        let active_bytes = active.as_ref().map_or(0, |e| e.size);
+        let mut total: u64 = entries.iter().map(|e| e.size).sum::<u64>() + active_bytes;
+        if self.cfg.max_bytes > 0 {
+            for e in &entries {
+                if total <= self.cfg.max_bytes {
+                    break;
+                }
+                if self.delete(e) {
+                    total -= e.size;
+                }
+            }
+            if total > self.cfg.max_bytes {
+                warn!("Retention: {:?} still {} bytes over budget (active file {} bytes)",
+                      dir, total - self.cfg.max_bytes, active_bytes);
+            }
+        }
+        Ok(total)
+    }
+
+    fn delete(&self, e: &Entry) -> bool {
+        match fs::remove_file(&e.path) {
+            Ok(()) => {
+                self.stats.files_deleted.fetch_add(1, Ordering::Relaxed);
+                self.stats.bytes_deleted.fetch_add(e.size, Ordering::Relaxed);
+                info!("Retention: deleted {:?} ({} bytes)", e.path, e.size);
+                true
+            }
+            Err(err) => {
+                self.stats.errors.fetch_add(1, Ordering::Relaxed);
+                warn!("Retention: delete {:?} failed: {}", e.path, err);
+                false
+            }
+        }
+    }
+}
+
+pub fn is_archive(path: &Path) -> bool {
+    path.extension().map_or(false, |e| e == ARCHIVE_EXT)
+}
+
+/// `compact_file` 写入的临时文件：`<name>.dpa.tmp`
+fn is_archive_tmp(path: &Path) -> bool {
+    path.extension().map_or(false, |e| e == "tmp")
+        && path.file_stem().map_or(false, |stem| is_archive(Path::new(stem)))
+}
+
+// ===================== 压缩 =====================
+
+/// FNV-1a 64 位，用于校验还原结果
+#[derive(Clone, Copy)]
+struct Fnv(u64);
+
+impl Fnv {
+    fn new() -> Self {
+        Fnv(0xcbf2_9ce4_8422_2325)
+    }
+
+    fn update(&mut self, data: &[u8]) {
+        for &b in data {
+            self.0 ^= b as u64;
+            self.0 = self.0.wrapping_mul(0x0000_0100_0000_01b3);
+        }
+    }
+}
+
+struct IndexEntry {
+    first_item: u64,
+    item_count: u32,
+    raw_len: u32,
+    offset: u64,
+    comp_len: u32,
+}
+
+/// 写归档的块与索引
+struct ArchiveWriter<W: Write + Seek> {
+    out: W,
+    index: Vec<IndexEntry>,
+    block: Vec<u8>,
+    block_first: u64,
+    block_items: u32,
+}
+
+impl<W: Write + Seek> ArchiveWriter<W> {
+    fn flush_block(&mut self, throttle: &mut Throttle) -> Result<()> {
+        if self.block.is_empty() {
+            return Ok(());
+        }
+        let comp = miniz_oxide::deflate::compress_to_vec(&self.block, DEFLATE_LEVEL);
+        let offset = self.out.stream_position()?;
+        self.out.write_all(&comp)?;
+        throttle.consume(comp.len());
+        self.index.push(IndexEntry {
+            first_item: self.block_first,
+            item_count: self.block_items,
+            raw_len: self.block.len() as u32,
+            offset,
+            comp_len: comp.len() as u32,
+        });
+        self.block_first += self.block_items as u64;
+        self.block_items = 0;
+        self.block.clear();
+        Ok(())
+    }
+
+    fn finish(mut self, throttle: &mut Throttle) -> Result<W> {
+        self.flush_block(throttle)?;
+        let index_offset = self.out.stream_position()?;
+        for e in &self.index {
+            self.out.write_all(&e.first_item.to_le_bytes())?;
+            self.out.write_all(&e.item_count.to_le_bytes())?;
+            self.out.write_all(&e.raw_len.to_le_bytes())?;
+            self.out.write_all(&e.offset.to_le_bytes())?;
+            self.out.write_all(&e.comp_len.to_le_bytes())?;
+        }
+        self.out.write_all(&index_offset.to_le_bytes())?;
+        self.out.write_all(&(self.index.len() as u32).to_le_bytes())?;
+        self.out.write_all(FOOTER_MAGIC)?;
+        Ok(self.out)
+    }
+}
+
+/// 解析一行 `LEN:n HEX: XX XX ..`（不含换行），格式须与 data-reader 输出逐字节一致
+fn parse_frame_line(line: &[u8], frame: &mut Vec<u8>) -> bool {
+    fn nibble(c: u8) -> Option<u8> {
+        match c {
+            b'0'..=b'9' => Some(c - b'0'),
+            b'A'..=b'F' => Some(c - b'A' + 10),
+            _ => None,
+        }
+    }
+
+    let rest = match line.strip_prefix(b"LEN:") {
+        Some(r) => r,
+        None => return false,
+    };
+    let digits = rest.iter().take_while(|c| c.is_ascii_digit()).count();
+    if digits == 0 || (digits > 1 && rest[0] == b'0') {
+        return false;
+    }
+    let len: usize = match std::str::from_utf8(&rest[..digits]).ok().and_then(|s| s.parse().ok()) {
+        Some(n) if n <= u16::MAX as usize => n,
+        _ => return false,
+    };
+    let hex = match rest[digits..].strip_prefix(b" HEX:") {
+        Some(h) => h,
+        None => return false,
+    };
+    if hex.len() != len * 3 {
+        return false;
+    }
+    frame.clear();
+    for chunk in hex.chunks_exact(3) {
+        match (chunk[0], nibble(chunk[1]), nibble(chunk[2])) {
+            (b' ', Some(hi), Some(lo)) => frame.push(hi << 4 | lo),
+            _ => return false,
+        }
+    }
+    true
+}
+
+fn render_frame_line(frame: &[u8], out: &mut Vec<u8>) {
+    const HEX: &[u8; 16] = b"0123456789ABCDEF";
+    out.extend_from_slice(format!("LEN:{} HEX:", frame.len()).as_bytes());
+    for &b in frame {
+        out.extend_from_slice(&[b' ', HEX[(b >> 4) as usize], HEX[(b & 0x0F) as usize]]);
+    }
+    out.push(b'\n');
+}
+
+fn write_header<W: Write>(out: &mut W, kind: u8, size: u64, mtime_ms: i64, hash: u64, name: &str) -> Result<()> {
+    out.write_all(MAGIC)?;
+    out.write_all(&[kind, 0, 0, 0])?;
+    out.write_all(&size.to_le_bytes())?;
+    out.write_all(&mtime_ms.to_le_bytes())?;
+    out.write_all(&hash.to_le_bytes())?;
+    out.write_all(&(name.len() as u16).to_le_bytes())?;
+    out.write_all(name.as_bytes())?;
+    Ok(())
+}
+
+/// 把源文件写成 kind 指定格式的归档；帧格式遇到不符合的行时返回 Ok(None)
+fn write_archive(src: &Path, tmp: &Path, kind: u8, io_limit_mb_s: u32) -> Result<Option<u64>> {
+    let meta = fs::metadata(src)?;
+    let mtime_ms = meta.modified()?
+        .duration_since(SystemTime::UNIX_EPOCH).unwrap_or_default().as_millis() as i64;
+    let name = src.file_name().map(|n| n.to_string_lossy().into_owned()).unwrap_or_default();
+
+    let mut throttle = Throttle::new(io_limit_mb_s);
+    let mut out = BufWriter::new(File::create(tmp)?);
+    // 哈希在读完源文件后回填
+    write_header(&mut out, kind, meta.len(), mtime_ms, 0, &name)?;
+    let mut w = ArchiveWriter { out, index: Vec::new(), block: Vec::new(), block_first: 0, block_items: 0 };
+
+    let mut reader = BufReader::with_capacity(256 * 1024, File::open(src)?);
+    let mut hash = Fnv::new();
+    let mut size = 0u64;
+
+    if kind == KIND_FRAMES {
+        let mut line = Vec::new();
+        let mut frame = Vec::new();
+        loop {
+            line.clear();
+            let n = reader.read_until(b'\n', &mut line)?;
+            if n == 0 {
+                break;
+            }
+            throttle.consume(n);
+            hash.update(&line);
+            size += n as u64;
+            if line.last() != Some(&b'\n') || !parse_frame_line(&line[..n - 1], &mut frame) {
+                return Ok(None);
+            }
+            w.block.extend_from_slice(&(frame.len() as u16).to_le_bytes());
+            w.block.extend_from_slice(&frame);
+            w.block_items += 1;
+            if w.block.len() >= BLOCK_BYTES {
+                w.flush_block(&mut throttle)?;
+            }
+        }
+    } else {
+        let mut buf = vec![0u8; BLOCK_BYTES];
+        loop {
+            let n = reader.read(&mut buf)?;
+            if n == 0 {
+                break;
+            }
+            throttle.consume(n);
+            hash.update(&buf[..n]);
+            size += n as u64;
+            w.block.extend_from_slice(&buf[..n]);
+            w.block_items += n as u32;
+            if w.block.len() >= BLOCK_BYTES {
+                w.flush_block(&mut throttle)?;
+            }
+        }
+    }
+    if size != meta.len() {
+        return Err(anyhow!("{:?} changed while compacting", src));
+    }
+
+    let mut out = w.finish(&mut throttle)?;
+    // 回填哈希：magic(4) + kind/reserved(4) + size(8) + mtime(8)
+    out.seek(SeekFrom::Start(24))?;
+    out.write_all(&hash.0.to_le_bytes())?;
+    let file = out.into_inner().map_err(|e| anyhow!("flush archive: {}", e))?;
+    file.sync_all()?;
+    Ok(Some(file.metadata()?.len()))
+}
+
+/// 压缩一个分段：写临时文件、完整解压校验、改名为 `<name>.dpa`，再删除源文件。
+/// 返回 (归档路径, 归档字节数)。
+pub fn compact_file(src: &Path, io_limit_mb_s: u32) -> Result<(PathBuf, u64)> {
+    let mut archive = src.as_os_str().to_owned();
+    archive.push(".");
+    archive.push(ARCHIVE_EXT);
+    let archive = PathBuf::from(archive);
+    let mut tmp = archive.as_os_str().to_owned();
+    tmp.push(".tmp");
+    let tmp = PathBuf::from(tmp);
+
+    let is_text = src.extension().map_or(false, |e| e.eq_ignore_ascii_case("txt"));
+    let mut written = if is_text { write_archive(src, &tmp, KIND_FRAMES, io_limit_mb_s)? } else { None };
+    if written.is_none() {
+        written = write_archive(src, &tmp, KIND_BYTES, io_limit_mb_s)?;
+    }
+    let written = written.ok_or_else(|| anyhow!("archive not written"))?;
+
+    let check = verify_archive(&tmp);
+    if let Err(e) = check {
+        let _ = fs::remove_file(&tmp);
+        return Err(e);
+    }
+
+    // 归档保留源文件的修改时间，保证按时间删除的顺序
+    let mtime = fs::metadata(src)?.modified()?;
+    File::options().write(true).open(&tmp)?.set_modified(mtime)?;
+    fs::rename(&tmp, &archive)?;
+    fs::remove_file(src)?;
+    Ok((archive, written))
+}
+
+// ===================== 读取 =====================
+
+/// 归档头和索引（原文件名和修改时间只在还原工具里需要，这里不读）
+struct ArchiveInfo {
+    kind: u8,
+    original_size: u64,
+    original_hash: u64,
+    index: Vec<IndexEntry>,
+}
+
+fn read_u16(b: &[u8], at: usize) -> u16 {
+    u16::from_le_bytes([b[at], b[at + 1]])
+}
+
+fn read_u32(b: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes(b[at..at + 4].try_into().unwrap())
+}
+
+fn read_u64(b: &[u8], at: usize) -> u64 {
+    u64::from_le_bytes(b[at..at + 8].try_into().unwrap())
+}
+
+fn read_archive_info(file: &mut File) -> Result<ArchiveInfo> {
+    let mut head = [0u8; 34];
+    file.seek(SeekFrom::Start(0))?;
+    file.read_exact(&mut head)?;
+    if &head[0..4] != MAGIC {
+        return Err(anyhow!("not a .dpa archive"));
+    }
+
+    let mut footer = [0u8; FOOTER_BYTES as usize];
+    file.seek(SeekFrom::End(-(FOOTER_BYTES as i64)))?;
+    file.read_exact(&mut footer)?;
+    if &footer[12..16] != FOOTER_MAGIC {
+        return Err(anyhow!("archive footer missing (truncated?)"));
+    }
+    let index_offset = read_u64(&footer, 0);
+    let blocks = read_u32(&footer, 8) as u64;
+
+    // 分配前先核对尾部给出的块数与文件长度，损坏的归档不能触发超大分配
+    let file_len = file.metadata()?.len();
+    let index_bytes = blocks * INDEX_ENTRY_BYTES as u64;
+    if index_offset.checked_add(index_bytes).and_then(|n| n.checked_add(FOOTER_BYTES)) != Some(file_len) {
+        return Err(anyhow!("archive index does not match file length (corrupt?)"));
+    }
+
+    let mut raw = vec![0u8; index_bytes as usize];
+    file.seek(SeekFrom::Start(index_offset))?;
+    file.read_exact(&mut raw)?;
+    let index: Vec<IndexEntry> = raw
+        .chunks_exact(INDEX_ENTRY_BYTES)
+        .map(|c| IndexEntry {
+            first_item: read_u64(c, 0),
+            item_count: read_u32(c, 8),
+            raw_len: read_u32(c, 12),
+            offset: read_u64(c, 16),
+            comp_len: read_u32(c, 24),
+        })
+        .collect();
+    if index.iter().any(|e| e.offset.checked_add(e.comp_len as u64).map_or(true, |end| end > index_offset)) {
+        return Err(anyhow!("archive block lies outside the data area (corrupt?)"));
+    }
+
+    Ok(ArchiveInfo {
+        kind: head[4],
+        original_size: read_u64(&head, 8),
+        original_hash: read_u64(&head, 24),
+        index,
+    })
+}
+
+/// 解压第 i 块，按原文件格式追加到 out
+fn extract_block(file: &mut File, info: &ArchiveInfo, i: usize, out: &mut Vec<u8>) -> Result<()> {
+    let e = &info.index[i];
+    let mut comp = vec![0u8; e.comp_len as usize];
+    file.seek(SeekFrom::Start(e.offset))?;
+    file.read_exact(&mut comp)?;
+    let raw = miniz_oxide::inflate::decompress_to_vec_with_limit(&comp, e.raw_len as usize)
+        .map_err(|err| anyhow!("block {} inflate failed: {:?}", i, err))?;
+    if raw.len() != e.raw_len as usize {
+        return Err(anyhow!("block {} length mismatch", i));
+    }
+
+    if info.kind == KIND_FRAMES {
+        let mut at = 0usize;
+        for _ in 0..e.item_count {
+            if at + 2 > raw.len() {
+                return Err(anyhow!("block {} frame table truncated", i));
+            }
+            let len = read_u16(&raw, at) as usize;
+            at += 2;
+            let frame = raw.get(at..at + len).ok_or_else(|| anyhow!("block {} frame truncated", i))?;
+            render_frame_line(frame, out);
+            at += len;
+        }
+    } else {
+        out.extend_from_slice(&raw);
+    }
+    Ok(())
+}
+
+/// 还原归档中从 first_item 起的块（帧归档按帧序号，字节归档按偏移），
+/// 只读取覆盖该位置的块及其后 `blocks` 块，逐块写入 `w`。返回写出的字节数。
+/// 同一时刻只在内存中保留一个块。
+pub fn extract_from<W: Write>(path: &Path, first_item: u64, blocks: usize, w: &mut W) -> Result<u64> {
+    let mut file = File::open(path)?;
+    let info = read_archive_info(&mut file)?;
+    let start = info.index.partition_point(|e| e.first_item + e.item_count as u64 <= first_item);
+    let mut buf = Vec::new();
+    let mut written = 0u64;
+    for i in start..start.saturating_add(blocks).min(info.index.len()) {
+        buf.clear();
+        extract_block(&mut file, &info, i, &mut buf)?;
+        w.write_all(&buf)?;
+        written += buf.len() as u64;
+    }
+    Ok(written)
+}
+
+/// 完整还原原文件内容到 `w`
+pub fn extract_to<W: Write>(path: &Path, w: &mut W) -> Result<u64> {
+    extract_from(path, 0, usize::MAX, w)
+}
+
+/// 逐块解压并比对原文件的长度和哈希
+fn verify_archive(path: &Path) -> Result<()> {
+    let mut file = File::open(path)?;
+    let info = read_archive_info(&mut file)?;
+    let mut hash = Fnv::new();
+    let mut size = 0u64;
+    let mut buf = Vec::new();
+    for i in 0..info.index.len() {
+        buf.clear();
+        extract_block(&mut file, &info, i, &mut buf)?;
+        hash.update(&buf);
+        size += buf.len() as u64;
+    }
+    if size != info.original_size || hash.0 != info.original_hash {
+        return Err(anyhow!("archive verification failed ({} of {} bytes restored)", size, info.original_size));
+    }
+    Ok(())
+}
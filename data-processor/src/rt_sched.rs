@@ -0,0 +1,300 @@
+//! 实时调度：为设备I/O线程和写入线程绑核、申请 SCHED_FIFO 优先级、锁定内存，
+//! 以及测量线程唤醒延迟的抖动基准（`data-processor jitter-bench`）。
+//!
+//! 只有 Linux 真正生效；其他平台上各项设置只打印警告，程序照常运行。
+
+use anyhow::{anyhow, Result};
+use std::future::Future;
+use std::time::{Duration, Instant};
+use tokio::sync::oneshot;
+use tracing::{info, warn};
+
+use crate::config::RealtimeConfig;
+
+/// 单个线程的调度设置
+#[derive(Clone, Copy, Debug, Default)]
+pub struct ThreadSched {
+    pub cpu: Option<usize>,
+    pub fifo_priority: Option<i32>,
+}
+
+impl RealtimeConfig {
+    pub fn io_thread(&self) -> ThreadSched {
+        ThreadSched { cpu: self.io_cpu, fifo_priority: self.fifo_priority }
+    }
+
+    pub fn writer_thread(&self) -> ThreadSched {
+        ThreadSched { cpu: self.writer_cpu, fifo_priority: self.fifo_priority }
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.io_cpu.is_some() || self.writer_cpu.is_some() || self.fifo_priority.is_some() || self.lock_memory
+    }
+}
+
+// ===================== 进程级设置 =====================
+
+/// 锁定当前及以后映射的全部内存，避免采集路径上发生缺页换入
+#[cfg(target_os = "linux")]
+pub fn lock_memory() -> Result<()> {
+    let rc = unsafe { libc::mlockall(libc::MCL_CURRENT | libc::MCL_FUTURE) };
+    if rc != 0 {
+        return Err(anyhow!("mlockall failed: {} (需要 CAP_IPC_LOCK 或足够的 RLIMIT_MEMLOCK)",
+                           std::io::Error::last_os_error()));
+    }
+    Ok(())
+}
+
+#[cfg(not(target_os = "linux"))]
+pub fn lock_memory() -> Result<()> {
+    Err(anyhow!("memory locking is only supported on Linux"))
+}
+
+/// 按配置执行进程级设置，失败只告警
+pub fn apply_process(cfg: &RealtimeConfig) {
+    if cfg.lock_memory {
+        match lock_memory() {
+            Ok(()) => info!("Realtime: memory locked (mlockall)"),
+            Err(e) => warn!("Realtime: {}", e),
+        }
+    }
+}
+
+// ===================== 线程级设置 =====================
+
+#[cfg(target_os = "linux")]
+fn set_affinity(cpu: usize) -> Result<()> {
+    unsafe {
+        let mut set: libc::cpu_set_t = std::mem::zeroed();
+        libc::CPU_ZERO(&mut set);
+        libc::CPU_SET(cpu, &mut set);
+        if libc::sched_setaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &set) != 0 {
+            return Err(anyhow!("pin to cpu {} failed: {}", cpu, std::io::Error::last_os_error()));
+        }
+    }
+    Ok(())
+}
+
+#[cfg(target_os = "linux")]
+fn set_fifo(priority: i32) -> Result<()> {
+    let param = libc::sched_param { sched_priority: priority };
+    // pthread_setschedparam 只作用于调用线程（sched_setscheduler(0) 同样，但语义更明确）
+    let rc = unsafe { libc::pthread_setschedparam(libc::pthread_self(), libc::SCHED_FIFO, &param) };
+    if rc != 0 {
+        return Err(anyhow!("SCHED_FIFO priority {} failed: {} (需要 CAP_SYS_NICE 或 RLIMIT_RTPRIO)",
+                           priority, std::io::Error::from_raw_os_error(rc)));
+    }
+    Ok(())
+}
+
+#[cfg(not(target_os = "linux"))]
+fn set_affinity(_cpu: usize) -> Result<()> {
+    Err(anyhow!("CPU pinning is only supported on Linux"))
+}
+
+#[cfg(not(target_os = "linux"))]
+fn set_fifo(_priority: i32) -> Result<()> {
+    Err(anyhow!("SCHED_FIFO is only supported on Linux"))
+}
+
+/// 对调用线程应用绑核和实时优先级，失败只告警
+pub fn apply_current_thread(name: &str, sched: ThreadSched) {
+    if let Some(cpu) = sched.cpu {
+        match set_affinity(cpu) {
+            Ok(()) => info!("Realtime: {} pinned to cpu {}", name, cpu),
+            Err(e) => warn!("Realtime: {}: {}", name, e),
+        }
+    }
+    if let Some(priority) = sched.fifo_priority {
+        match set_fifo(priority) {
+            Ok(()) => info!("Realtime: {} running SCHED_FIFO priority {}", name, priority),
+            Err(e) => warn!("Realtime: {}: {}", name, e),
+        }
+    }
+}
+
+/// 预先触碰线程栈，使其页面在进入采集循环前就已驻留（配合 mlockall）
+#[inline(never)]
+pub fn prefault_stack() {
+    const PREFAULT_STACK_BYTES: usize = 256 * 1024;
+    let mut buf = [0u8; PREFAULT_STACK_BYTES];
+    for i in (0..buf.len()).step_by(4096) {
+        buf[i] = 1;
+    }
+    std::hint::black_box(&buf);
+}
+
+/// 在独立的系统线程中运行一个单线程 tokio 运行时，先应用调度设置再执行 future。
+/// tokio 任务会在工作线程之间迁移，只有专用线程才能可靠地绑核和提升优先级。
+/// 返回的接收端在线程退出时完成。
+pub fn spawn_pinned<F, Fut>(name: &str, sched: ThreadSched, make_future: F) -> Result<oneshot::Receiver<()>>
+where
+    F: FnOnce() -> Fut + Send + 'static,
+    Fut: Future<Output = ()>,
+{
+    let (done_tx, done_rx) = oneshot::channel();
+    let thread_name = name.to_string();
+    std::thread::Builder::new()
+        .name(thread_name.clone())
+        .spawn(move || {
+            apply_current_thread(&thread_name, sched);
+            prefault_stack();
+            match tokio::runtime::Builder::new_current_thread().enable_all().build() {
+                Ok(rt) => rt.block_on(make_future()),
+                Err(e) => warn!("{}: failed to build runtime: {}", thread_name, e),
+            }
+            let _ = done_tx.send(());
+        })?;
+    Ok(done_rx)
+}
+
+// ===================== 抖动基准 =====================
+
+#[derive(Clone, Copy, Debug)]
+pub struct JitterBenchOptions {
+    pub duration: Duration,
+    pub interval: Duration,
+    pub load_threads: usize,
+}
+
+impl Default for JitterBenchOptions {
+    fn default() -> Self {
+        Self {
+            duration: Duration::from_secs(10),
+            interval: Duration::from_micros(1000),
+            load_threads: 0,
+        }
+    }
+}
+
+#[derive(Clone, Debug)]
+pub struct JitterReport {
+    pub label: String,
+    pub wakeups: usize,
+    pub p50_us: f64,
+    pub p90_us: f64,
+    pub p99_us: f64,
+    pub p999_us: f64,
+    pub max_us: f64,
+}
+
+impl JitterReport {
+    fn from_samples(label: &str, mut latencies_ns: Vec<u64>) -> Self {
+        latencies_ns.sort_unstable();
+        let pct = |p: f64| -> f64 {
+            if latencies_ns.is_empty() {
+                return 0.0;
+            }
+            let idx = ((latencies_ns.len() - 1) as f64 * p).round() as usize;
+            latencies_ns[idx] as f64 / 1000.0
+        };
+        Self {
+            label: label.to_string(),
+            wakeups: latencies_ns.len(),
+            p50_us: pct(0.50),
+            p90_us: pct(0.90),
+            p99_us: pct(0.99),
+            p999_us: pct(0.999),
+            max_us: latencies_ns.last().map(|&v| v as f64 / 1000.0).unwrap_or(0.0),
+        }
+    }
+}
+
+/// 周期性睡眠到绝对截止时间，记录实际唤醒相对截止时间的延迟
+fn measure_wakeups(opts: &JitterBenchOptions) -> Vec<u64> {
+    let expected = (opts.duration.as_nanos() / opts.interval.as_nanos().max(1)) as usize;
+    let mut latencies = Vec::with_capacity(expected + 1);
+    let start = Instant::now();
+    let mut deadline = start + opts.interval;
+    while deadline - start <= opts.duration {
+        let now = Instant::now();
+        if deadline > now {
+            std::thread::sleep(deadline - now);
+        }
+        let woke = Instant::now();
+        latencies.push(woke.saturating_duration_since(deadline).as_nanos() as u64);
+        deadline += opts.interval;
+        // 严重超时后不追赶，避免一次长停顿产生一串零延迟样本
+        if deadline < woke {
+            deadline = woke + opts.interval;
+        }
+    }
+    latencies
+}
+
+fn run_pass(label: &str, sched: ThreadSched, opts: JitterBenchOptions) -> Result<JitterReport> {
+    let name = format!("jitter-{}", label);
+    let handle = std::thread::Builder::new().name(name.clone()).spawn(move || {
+        apply_current_thread(&name, sched);
+        prefault_stack();
+        measure_wakeups(&opts)
+    })?;
+    let latencies = handle.join().map_err(|_| anyhow!("jitter thread panicked"))?;
+    Ok(JitterReport::from_samples(label, latencies))
+}
+
+/// 先用默认调度、再用配置中的I/O线程设置各测一遍，打印唤醒延迟分位数
+pub fn run_jitter_bench(cfg: &RealtimeConfig, opts: JitterBenchOptions) -> Result<Vec<JitterReport>> {
+    use std::sync::atomic::{AtomicBool, Ordering};
+    use std::sync::Arc;
+
+    println!("Jitter benchmark: {} s per pass, {} us period, {} load thread(s)",
+             opts.duration.as_secs_f64(), opts.interval.as_micros(), opts.load_threads);
+
+    // 可选的忙循环负载，模拟繁忙主机
+    let stop = Arc::new(AtomicBool::new(false));
+    let mut load = Vec::new();
+    for _ in 0..opts.load_threads {
+        let stop = stop.clone();
+        load.push(std::thread::spawn(move || {
+            let mut x = 0u64;
+            while !stop.load(Ordering::Relaxed) {
+                x = std::hint::black_box(x.wrapping_mul(6364136223846793005).wrapping_add(1));
+            }
+        }));
+    }
+
+    let mut reports = vec![run_pass("default", ThreadSched::default(), opts)?];
+    if cfg.lock_memory {
+        apply_process(cfg);
+    }
+    if cfg.is_enabled() {
+        reports.push(run_pass("realtime", cfg.io_thread(), opts)?);
+    } else {
+        println!("No realtime settings configured (RT_IO_CPU / RT_PRIORITY / RT_MLOCK), skipping second pass");
+    }
+
+    stop.store(true, Ordering::Relaxed);
+    for handle in load {
+        let _ = handle.join();
+    }
+
+    println!("{:<10} {:>9} {:>9} {:>9} {:>9} {:>9} {:>9}",
+             "pass", "wakeups", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+    for r in &reports {
+        println!("{:<10} {:>9} {:>9.1} {:>9.1} {:>9.1} {:>9.1} {:>9.1}",
+                 r.label, r.wakeups, r.p50_us, r.p90_us, r.p99_us, r.p999_us, r.max_us);
+    }
+    Ok(reports)
+}
+
+/// 解析 `jitter-bench` 子命令参数：--seconds N --interval-us N --load N
+pub fn parse_jitter_args(args: &[String]) -> Result<JitterBenchOptions> {
+    let mut opts = JitterBenchOptions::default();
+    let mut it = args.iter();
+    while let Some(arg) = it.next() {
+        let mut value = || -> Result<u64> {
+            it.next()
+                .ok_or_else(|| anyhow!("{} needs a value", arg))?
+                .parse::<u64>()
+                .map_err(|e| anyhow!("{}: {}", arg, e))
+        };
+        match arg.as_str() {
+            "--seconds" => opts.duration = Duration::from_secs(value()?.max(1)),
+            "--interval-us" => opts.interval = Duration::from_micros(value()?.max(50)),
+            "--load" => opts.load_threads = value()? as usize,
+            other => return Err(anyhow!("unknown jitter-bench option '{}'", other)),
+        }
+    }
+    Ok(opts)
+}
@@ -1,12 +1,15 @@
 use crate::config::{Config, StorageConfig};
-use crate::file_manager::{FileManager, FileInfo, ProcessedDataFile};
+use crate::file_manager::{FileManager, FileInfo, FileSource, ProcessedDataFile};
+use crate::http_stream::{blocking_body, file_body, CHUNK_SIZE};
+use crate::retention;
+use crate::event_queue::{EventQueueSnapshot, EventQueueStats};
 use crate::device_communication::{DeviceCommand, ChannelConfig};
-use crate::data_processing::{DataProcessor, TriggerSummary, TriggerBurst};
+use crate::data_processing::{write_burst, DataProcessor, TriggerSummary, TriggerBurst};
 use anyhow::Result;
 use axum::{
     extract::{Path, Query, State},
     http::{header, StatusCode},
-    response::{IntoResponse, Json, Response},
+    response::{Json, Response},
     routing::{get, post, delete},
     Router,
 };
@@ -46,6 +49,9 @@ pub struct SystemStatus {
     pub current_mode: Option<String>,
     pub trigger_support: bool,
     pub trigger_status: Option<TriggerStatus>,
+    pub event_queue: EventQueueSnapshot,
+    /// 后台保留管理未启用时为 null
+    pub retention: Option<retention::RetentionSnapshot>,
 }
 
 #[derive(Debug, Serialize, Deserialize, Clone)]
@@ -68,6 +74,8 @@ pub struct AppState {
     current_mode: Arc<Mutex<Option<String>>>,
     file_manager: Arc<FileManager>,
     data_processor: Arc<Mutex<DataProcessor>>,
+    event_queue: Arc<EventQueueStats>,
+    retention: Option<Arc<retention::RetentionStats>>,
 }
 
 pub struct WebServer {
@@ -82,6 +90,8 @@ impl WebServer {
         clients_rx: watch::Receiver<usize>,
         data_processor: Arc<Mutex<DataProcessor>>,
         device_status_rx: watch::Receiver<bool>,
+        event_queue: Arc<EventQueueStats>,
+        retention: Option<Arc<retention::RetentionStats>>,
     ) -> Self {
         let fm = FileManager::new(&config.storage.data_dir)
             .expect("failed to init data directory");
@@ -97,6 +107,8 @@ impl WebServer {
                 current_mode: Arc::new(Mutex::new(None)),
                 file_manager: Arc::new(fm),
                 data_processor,
+                event_queue,
+                retention,
             },
         }
     }
@@ -131,6 +143,7 @@ impl WebServer {
             .route("/api/trigger/list", get(list_trigger_bursts))
             .route("/api/trigger/preview/:burst_id", get(preview_trigger_burst))
             .route("/api/trigger/save/:burst_id", post(save_trigger_burst))
+            .route("/api/trigger/export/:burst_id", get(export_trigger_burst))
             .route("/api/trigger/delete/:burst_id", delete(delete_trigger_burst))
             // 文件管理API
             .route("/api/files", get(list_files))
@@ -363,15 +376,16 @@ async fn list_trigger_bursts(
 async fn preview_trigger_burst(
     State(st): State<AppState>,
     Path(burst_id): Path<String>
-) -> Result<Json<ApiResponse<TriggerBurst>>, StatusCode> {
-    let processor = st.data_processor.lock().await;
-    
-    match processor.get_trigger_burst(&burst_id) {
+) -> Result<Json<ApiResponse<Arc<TriggerBurst>>>, StatusCode> {
+    // 只在锁内取共享引用，序列化在锁外进行
+    let burst = st.data_processor.lock().await.get_trigger_burst(&burst_id);
+
+    match burst {
         Some(burst) => {
             info!("Previewed trigger burst: {}", burst_id);
             Ok(Json(ApiResponse {
                 success: true,
-                data: Some(burst.clone()),
+                data: Some(burst),
                 error: None,
                 timestamp: chrono::Utc::now().timestamp_millis(),
             }))
@@ -403,25 +417,30 @@ struct SaveTriggerResponse {
     pub burst_info: TriggerSummary,
 }
 
+/// JSON保存格式：批次字段 + metadata
+#[derive(Serialize)]
+struct SavedTriggerBurst<'a> {
+    #[serde(flatten)]
+    burst: &'a TriggerBurst,
+    metadata: serde_json::Value,
+}
+
 /// 保存触发批次数据
 async fn save_trigger_burst(
     State(st): State<AppState>,
     Path(burst_id): Path<String>,
     Json(req): Json<SaveTriggerRequest>
 ) -> Result<Json<ApiResponse<SaveTriggerResponse>>, StatusCode> {
-    // 验证格式
-    let valid_formats = ["json", "csv", "binary"];
-    if !valid_formats.contains(&req.format.as_str()) {
-        return Ok(Json(ApiResponse {
-            success: false,
-            data: None,
-            error: Some(format!("Invalid format. Supported: {:?}", valid_formats)),
-            timestamp: chrono::Utc::now().timestamp_millis(),
-        }));
-    }
+    // 验证格式：不支持的格式在创建文件前拒绝
+    let extension = match req.format.as_str() {
+        "json" => ".json",
+        "csv" => ".csv",
+        "binary" => ".bin",
+        _ => return Err(StatusCode::BAD_REQUEST),
+    };
 
-    // 获取数据
-    let (burst_data, burst_summary) = {
+    // 获取数据：锁内只取共享引用和摘要，导出在锁外进行
+    let (burst, burst_summary) = {
         let processor = st.data_processor.lock().await;
         
         let burst = match processor.get_trigger_burst(&burst_id) {
@@ -445,20 +464,12 @@ async fn save_trigger_burst(
             }));
         }
 
-        let data = match processor.export_trigger_burst(&burst_id, &req.format) {
-            Ok(data) => data,
-            Err(e) => {
-                error!("Failed to export trigger burst {}: {}", burst_id, e);
-                return Err(StatusCode::INTERNAL_SERVER_ERROR);
-            }
-        };
-
         let summary = TriggerSummary {
             burst_id: burst.burst_id.clone(),
             trigger_timestamp: burst.trigger_timestamp,
             trigger_channel: burst.trigger_channel,
             total_samples: burst.total_samples,
-            duration_ms: processor.calculate_duration_ms(burst),
+            duration_ms: processor.calculate_duration_ms(&burst),
             created_at: burst.created_at,
             quality: match burst.quality_summary.overall_quality {
                 crate::data_processing::DataQuality::Good => "Good".to_string(),
@@ -468,17 +479,10 @@ async fn save_trigger_burst(
             can_save: true,
         };
 
-        (data, summary)
+        (burst, summary)
     };
 
     // 生成文件名
-    let extension = match req.format.as_str() {
-        "json" => ".json",
-        "csv" => ".csv",
-        "binary" => ".bin",
-        _ => ".dat",
-    };
-
     let filename = req.filename
         .as_deref()
         .filter(|s| !s.trim().is_empty())
@@ -493,42 +497,45 @@ async fn save_trigger_burst(
                    extension)
         });
 
-    // 创建文件对象
-    let mut file_data = ProcessedDataFile {
-        filename: filename.clone(),
-        bytes: burst_data,
-    };
-
-    // 如果是JSON格式，添加元数据
-    if req.format == "json" {
-        let metadata = serde_json::json!({
-            "saved_at": chrono::Utc::now().to_rfc3339(),
-            "description": req.description,
-            "format": req.format,
-            "burst_summary": burst_summary
-        });
-        
-        // 将元数据插入到JSON的开头
-        if let Ok(mut json_data) = serde_json::from_slice::<serde_json::Value>(&file_data.bytes) {
-            json_data["metadata"] = metadata;
-            file_data.bytes = serde_json::to_string_pretty(&json_data)
-                .unwrap_or_else(|_| String::from_utf8_lossy(&file_data.bytes).to_string())
-                .into_bytes();
-        }
-    }
+    // JSON格式附带保存元数据，直接随批次一起序列化
+    let metadata = serde_json::json!({
+        "saved_at": chrono::Utc::now().to_rfc3339(),
+        "description": req.description,
+        "format": req.format,
+        "burst_summary": burst_summary
+    });
+
+    // 在阻塞线程中边导出边写文件，内存占用与批次大小无关；失败时不留下部分文件
+    let file_manager = Arc::clone(&st.file_manager);
+    let dir = req.dir.clone();
+    let format = req.format.clone();
+    let saved = tokio::task::spawn_blocking(move || -> Result<(String, u64)> {
+        file_manager.write_at(dir.as_deref(), &filename, |file| {
+            let mut w = std::io::BufWriter::with_capacity(CHUNK_SIZE, file);
+            if format == "json" {
+                serde_json::to_writer_pretty(&mut w, &SavedTriggerBurst { burst: &burst, metadata })?;
+            } else {
+                write_burst(&burst, &format, &mut w)?;
+            }
+            w.into_inner().map_err(|e| e.into_error())?;
+            Ok(())
+        })
+    })
+    .await
+    .unwrap_or_else(|e| Err(anyhow::anyhow!("export task failed: {}", e)));
 
     // 保存文件
-    match st.file_manager.save_at(req.dir.as_deref(), &file_data) {
-        Ok(saved_rel_path) => {
+    match saved {
+        Ok((saved_rel_path, size_bytes)) => {
             // 限制文件数量
-            let _ = st.file_manager.cleanup_old_files(st.cfg.storage.max_files);
+            limit_saved_files(&st);
 
             info!("Saved trigger burst {} to {}", burst_id, saved_rel_path);
 
             let response = SaveTriggerResponse {
                 saved_path: saved_rel_path,
                 format: req.format,
-                size_bytes: file_data.bytes.len(),
+                size_bytes: size_bytes as usize,
                 burst_info: burst_summary,
             };
 
@@ -546,6 +553,47 @@ async fn save_trigger_burst(
     }
 }
 
+#[derive(Debug, Deserialize)]
+struct ExportQuery {
+    /// 导出格式：json, csv, binary（默认 csv）
+    format: Option<String>,
+}
+
+/// GET /api/trigger/export/:burst_id?format=csv
+/// 直接从批次样本区流式生成导出内容（chunked 响应），不落盘
+async fn export_trigger_burst(
+    State(st): State<AppState>,
+    Path(burst_id): Path<String>,
+    Query(q): Query<ExportQuery>,
+) -> Result<Response, StatusCode> {
+    let format = q.format.unwrap_or_else(|| "csv".to_string());
+    let (content_type, extension) = match format.as_str() {
+        "json" => ("application/json", "json"),
+        "csv" => ("text/csv", "csv"),
+        "binary" => ("application/octet-stream", "bin"),
+        _ => return Err(StatusCode::BAD_REQUEST),
+    };
+
+    let burst = match st.data_processor.lock().await.get_trigger_burst(&burst_id) {
+        Some(b) if b.is_complete => b,
+        Some(_) => return Err(StatusCode::CONFLICT),
+        None => return Err(StatusCode::NOT_FOUND),
+    };
+
+    let cd = format!("attachment; filename=\"trigger_{}.{}\"", burst.trigger_timestamp, extension);
+    let mut builder = Response::builder()
+        .header(header::CONTENT_TYPE, content_type)
+        .header(header::CONTENT_DISPOSITION, cd);
+    if format == "binary" {
+        // 二进制导出长度已知，不必分块
+        builder = builder.header(header::CONTENT_LENGTH, burst.data_packets.binary_size());
+    }
+
+    info!("Streaming trigger burst {} as {}", burst_id, format);
+    let body = blocking_body(format!("trigger burst {}", burst_id), move |w| write_burst(&burst, &format, w));
+    builder.body(body).map_err(|_| StatusCode::INTERNAL_SERVER_ERROR)
+}
+
 /// 删除缓存的触发批次
 async fn delete_trigger_burst(
     State(st): State<AppState>,
@@ -568,6 +616,16 @@ async fn delete_trigger_burst(
     }
 }
 
+/// 保存后按 `MAX_FILES` 清理根目录；保留管理正在管理数据目录时由它按预算删除，这里不再按数量删
+fn limit_saved_files(st: &AppState) {
+    let data_dir = &st.cfg.storage.data_dir;
+    let retention_owns = st.retention.is_some()
+        && (st.cfg.retention.dirs.is_empty() || st.cfg.retention.dirs.iter().any(|d| d == data_dir));
+    if !retention_owns {
+        let _ = st.file_manager.cleanup_old_files(st.cfg.storage.max_files);
+    }
+}
+
 async fn get_status(State(st): State<AppState>) -> Result<Json<ApiResponse<SystemStatus>>, StatusCode> {
     // 汇总当前状态
     let packets = *st.packets_rx.borrow();
@@ -599,6 +657,8 @@ async fn get_status(State(st): State<AppState>) -> Result<Json<ApiResponse<Syste
         current_mode,
         trigger_support: true,
         trigger_status,
+        event_queue: st.event_queue.snapshot(),
+        retention: st.retention.as_ref().map(|r| r.snapshot()),
     };
 
     Ok(Json(ApiResponse {
@@ -639,28 +699,48 @@ async fn list_files(
 }
 
 /// GET /api/files/:filename   （支持子目录：例如 runs/2025-08-26/wave.bin）
+/// 普通文件按块读取流式发送；已压缩归档的文件逐块解压后以 chunked 方式发送
 async fn download_file(
     State(st): State<AppState>,
     Path(filename): Path<String>,
 ) -> Result<Response, StatusCode> {
-    match st.file_manager.read_file(&filename) {
-        Ok(bytes) => {
-            let cd = format!(
-                "attachment; filename=\"{}\"", 
-                filename.split(|c| c == '/' || c == '\\').last().unwrap_or(&filename)
-            );
-            let headers = [
-                (header::CONTENT_TYPE, "application/octet-stream"),
-                (header::CONTENT_DISPOSITION, cd.as_str()),
-            ];
-            info!("Downloaded file: {} ({} bytes)", filename, bytes.len());
-            Ok((headers, bytes).into_response())
-        }
+    let source = match st.file_manager.open_file(&filename) {
+        Ok(source) => source,
         Err(e) => {
             warn!("download_file failed: {} ({})", filename, e);
-            Err(StatusCode::NOT_FOUND)
+            return Err(StatusCode::NOT_FOUND);
         }
-    }
+    };
+
+    let cd = format!(
+        "attachment; filename=\"{}\"", 
+        filename.split(|c| c == '/' || c == '\\').last().unwrap_or(&filename)
+    );
+    let builder = Response::builder()
+        .header(header::CONTENT_TYPE, "application/octet-stream")
+        .header(header::CONTENT_DISPOSITION, cd);
+
+    let response = match source {
+        FileSource::Plain { path, len } => {
+            let body = match file_body(&path).await {
+                Ok(body) => body,
+                Err(e) => {
+                    warn!("download_file failed: {} ({})", filename, e);
+                    return Err(StatusCode::NOT_FOUND);
+                }
+            };
+            info!("Downloading file: {} ({} bytes)", filename, len);
+            builder.header(header::CONTENT_LENGTH, len).body(body)
+        }
+        FileSource::Archive(path) => {
+            info!("Downloading archived file: {}", filename);
+            let body = blocking_body(format!("archive {}", filename), move |w| {
+                retention::extract_to(&path, w).map(|_| ())
+            });
+            builder.body(body)
+        }
+    };
+    response.map_err(|_| StatusCode::INTERNAL_SERVER_ERROR)
 }
 
 #[derive(Debug, Serialize, Deserialize)]
@@ -704,7 +784,7 @@ async fn save_waveform(
     match st.file_manager.save_at(req.dir.as_deref(), &data) {
         Ok(saved_rel_path) => {
             // 限制 base 根目录下的总文件数（不递归）
-            let _ = st.file_manager.cleanup_old_files(st.cfg.storage.max_files);
+            limit_saved_files(&st);
 
             info!("Saved file: {} ({} bytes)", saved_rel_path, data.bytes.len());
             Ok(Json(ApiResponse {
@@ -766,6 +846,7 @@ async fn api_info() -> Json<serde_json::Value> {
                 "list_bursts": "/api/trigger/list",
                 "preview_burst": "/api/trigger/preview/{burst_id}",
                 "save_burst": "/api/trigger/save/{burst_id}",
+                "export_burst": "/api/trigger/export/{burst_id}?format=csv|json|binary",
                 "delete_burst": "/api/trigger/delete/{burst_id}"
             },
             "configuration": "/api/control/configure",
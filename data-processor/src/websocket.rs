@@ -1,6 +1,7 @@
 use crate::data_processing::{ProcessedData, DataQuality, TriggerBurst};
 use crate::device_communication::TriggerEvent;
 use crate::config::WebSocketConfig;
+use crate::ws_stream::{BinaryStreamEncoder, SampleType, StreamFormat};
 use anyhow::Result;
 use futures_util::{SinkExt, StreamExt};
 use std::collections::HashMap;
@@ -16,7 +17,7 @@ pub struct WebSocketServer {
     clients: Arc<RwLock<HashMap<String, ClientConnection>>>,
     data_receiver: broadcast::Receiver<ProcessedData>,
     trigger_receiver: broadcast::Receiver<TriggerEvent>,
-    trigger_burst_complete_receiver: broadcast::Receiver<TriggerBurst>,
+    trigger_burst_complete_receiver: broadcast::Receiver<Arc<TriggerBurst>>,
     pub client_count_rx: watch::Receiver<usize>,
     client_count_tx: watch::Sender<usize>,
 }
@@ -24,6 +25,7 @@ pub struct WebSocketServer {
 struct ClientConnection {
     sender: mpsc::UnboundedSender<Message>,
     subscriptions: ClientSubscriptions,
+    format: StreamFormat,
 }
 
 #[derive(Debug, Clone, serde::Serialize, serde::Deserialize)]
@@ -52,7 +54,7 @@ impl WebSocketServer {
         config: WebSocketConfig, 
         data_receiver: broadcast::Receiver<ProcessedData>,
         trigger_receiver: broadcast::Receiver<TriggerEvent>,
-        trigger_burst_complete_receiver: broadcast::Receiver<TriggerBurst>,
+        trigger_burst_complete_receiver: broadcast::Receiver<Arc<TriggerBurst>>,
     ) -> Self {
         let clients = Arc::new(RwLock::new(HashMap::new()));
         let (tx, rx) = watch::channel(0usize);
@@ -76,8 +78,9 @@ impl WebSocketServer {
         let clients_clone = Arc::clone(&self.clients);
         let mut data_rx = self.data_receiver.resubscribe();
         tokio::spawn(async move {
+            let mut encoder = BinaryStreamEncoder::new();
             while let Ok(data) = data_rx.recv().await {
-                Self::broadcast_data(&clients_clone, &data).await;
+                Self::broadcast_data(&clients_clone, &data, &mut encoder).await;
             }
         });
 
@@ -133,6 +136,7 @@ impl WebSocketServer {
                 ClientConnection { 
                     sender: tx.clone(),
                     subscriptions: ClientSubscriptions::default(),
+                    format: StreamFormat::default(),
                 },
             );
             let _ = client_count_tx.send(g.len());
@@ -149,7 +153,8 @@ impl WebSocketServer {
                 "data_streaming": true,
                 "trigger_events": true,
                 "trigger_burst_complete": true,
-                "subscription_control": true
+                "subscription_control": true,
+                "binary_stream": crate::ws_stream::VERSION
             }
         });
         if let Ok(t) = serde_json::to_string(&welcome) {
@@ -279,6 +284,39 @@ impl WebSocketServer {
                             }
                         }
                     }
+                    "stream_format" => {
+                        // 切换数据消息格式：{"format":"binary"|"json","sample_type":"int16"|"float32","points_per_second":N}
+                        let mut g = clients.write().await;
+                        if let Some(client) = g.get_mut(client_id) {
+                            if let Some(format) = msg.get("format").and_then(|v| v.as_str()) {
+                                client.format.binary = format == "binary";
+                            }
+                            if let Some(t) = msg.get("sample_type") {
+                                match serde_json::from_value::<SampleType>(t.clone()) {
+                                    Ok(t) => client.format.sample_type = t,
+                                    Err(e) => warn!("Client {} sent invalid sample_type: {}", client_id, e),
+                                }
+                            }
+                            if let Some(pps) = msg.get("points_per_second").and_then(|v| v.as_u64()) {
+                                client.format.points_per_second = pps.min(u32::MAX as u64) as u32;
+                            }
+
+                            info!("Client {} updated stream format: {:?}", client_id, client.format);
+
+                            let response = serde_json::json!({
+                                "type": "stream_format_updated",
+                                "client_id": client_id,
+                                "format": if client.format.binary { "binary" } else { "json" },
+                                "sample_type": client.format.sample_type,
+                                "points_per_second": client.format.points_per_second,
+                                "binary_version": crate::ws_stream::VERSION,
+                                "timestamp": chrono::Utc::now().timestamp_millis()
+                            });
+                            if let Ok(text) = serde_json::to_string(&response) {
+                                let _ = client.sender.send(Message::Text(text));
+                            }
+                        }
+                    }
                     "ping" => {
                         // 处理客户端ping
                         let g = clients.read().await;
@@ -304,46 +342,81 @@ impl WebSocketServer {
     async fn broadcast_data(
         clients: &Arc<RwLock<HashMap<String, ClientConnection>>>,
         data: &ProcessedData,
+        encoder: &mut BinaryStreamEncoder,
     ) {
-        let payload = serde_json::json!({
-            "type": "data",
-            "timestamp": data.timestamp,
-            "sequence": data.sequence,
-            "channel_count": data.channel_count,
-            "sample_rate": data.sample_rate,
-            "data": data.data,
-            "metadata": data.metadata,
-            "data_type": data.data_type
-        });
+        let g = clients.read().await;
+
+        // 筛出订阅了该类数据的客户端，并收集二进制客户端需要的编码组合
+        let mut targets: Vec<(&String, &ClientConnection)> = Vec::with_capacity(g.len());
+        let mut variants: Vec<(SampleType, u32)> = Vec::new();
+        let mut want_json = false;
+        for (id, client) in g.iter() {
+            // 检查客户端是否订阅了数据流
+            if !client.subscriptions.data_stream {
+                continue;
+            }
 
-        if let Ok(text) = serde_json::to_string(&payload) {
-            let g = clients.read().await;
-            let mut drop_ids: Vec<String> = Vec::new();
-            
-            for (id, client) in g.iter() {
-                // 检查客户端是否订阅了数据流
-                if !client.subscriptions.data_stream {
-                    continue;
+            // 检查数据类型过滤
+            let should_send = match &data.data_type.source {
+                crate::data_processing::DataSource::Continuous => {
+                    !client.subscriptions.trigger_only
+                }
+                crate::data_processing::DataSource::Trigger => {
+                    !client.subscriptions.continuous_only
                 }
+            };
+            if !should_send {
+                continue;
+            }
 
-                // 检查数据类型过滤
-                let should_send = match &data.data_type.source {
-                    crate::data_processing::DataSource::Continuous => {
-                        !client.subscriptions.trigger_only
-                    }
-                    crate::data_processing::DataSource::Trigger => {
-                        !client.subscriptions.continuous_only
-                    }
-                };
+            if client.format.binary {
+                let variant = (client.format.sample_type, client.format.bucket(data.sample_rate));
+                if !variants.contains(&variant) {
+                    variants.push(variant);
+                }
+            } else {
+                want_json = true;
+            }
+            targets.push((id, client));
+        }
 
-                if should_send {
-                    if client.sender.send(Message::Text(text.clone())).is_err() {
-                        drop_ids.push(id.clone());
-                    }
+        // 每种格式每个数据包只编码一次
+        let binary = encoder.encode(data, &variants);
+        let text = if want_json {
+            let payload = serde_json::json!({
+                "type": "data",
+                "timestamp": data.timestamp,
+                "sequence": data.sequence,
+                "channel_count": data.channel_count,
+                "sample_rate": data.sample_rate,
+                "data": data.data,
+                "metadata": data.metadata,
+                "data_type": data.data_type
+            });
+            serde_json::to_string(&payload).ok()
+        } else {
+            None
+        };
+
+        let mut drop_ids: Vec<String> = Vec::new();
+        for (id, client) in targets {
+            let msg = if client.format.binary {
+                let variant = (client.format.sample_type, client.format.bucket(data.sample_rate));
+                match binary.get(&variant) {
+                    Some(Some(bytes)) => Message::Binary(bytes.clone()),
+                    _ => continue,
+                }
+            } else {
+                match &text {
+                    Some(text) => Message::Text(text.clone()),
+                    None => continue,
                 }
+            };
+            if client.sender.send(msg).is_err() {
+                drop_ids.push(id.clone());
             }
-            drop(drop_ids);
         }
+        drop(drop_ids);
     }
 
     async fn broadcast_trigger_event(
@@ -431,29 +504,16 @@ impl WebSocketServer {
 
     /// 计算触发批次持续时间
     fn calculate_burst_duration(burst: &TriggerBurst) -> f64 {
-        if burst.data_packets.len() <= 1 {
-            return 0.0;
-        }
-
-        let first_ts = burst.data_packets[0].timestamp;
-        let last_ts = burst.data_packets.last().unwrap().timestamp;
-        (last_ts - first_ts) as f64
+        burst.data_packets.duration_ms()
     }
 
     /// 提取预览样本（前100个样本，用于前端快速预览）
     fn extract_preview_samples(burst: &TriggerBurst) -> Vec<f64> {
-        let mut preview = Vec::new();
         let max_preview_samples = 100;
-        
-        for packet in &burst.data_packets {
-            for &sample in &packet.data {
-                preview.push(sample);
-                if preview.len() >= max_preview_samples {
-                    return preview;
-                }
-            }
-        }
-        
-        preview
+        burst.data_packets.samples()
+            .iter()
+            .take(max_preview_samples)
+            .map(|&v| v as f64)
+            .collect()
     }
 }
\ No newline at end of file
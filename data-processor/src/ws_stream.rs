@@ -0,0 +1,253 @@
+//! WebSocket 二进制数据流格式与按客户端降采样。
+//!
+//! 客户端发送 `{"type":"stream_format","format":"binary",...}` 后，数据消息改为二进制帧
+//! （小端）：
+//!
+//! ```text
+//! 0   u32  magic "DPWS"
+//! 4   u8   版本 = 1
+//! 5   u8   样本类型：1 = int16，2 = float32
+//! 6   u8   标志：bit0 触发数据，bit1 min/max 降采样
+//! 7   u8   通道数 N
+//! 8   u64  sequence
+//! 16  u64  timestamp
+//! 24  f32  原始采样率（Hz）
+//! 28  u32  降采样桶大小（原始样本数/桶，1 = 未降采样）
+//! 32  u32  触发时间戳（bit0 置位时有效）
+//! 36  u32  保留
+//! 40  N × {u8 channel_id, u8 保留, u16 点数}
+//! ..  按通道顺序依次排列的样本数组（planar）
+//! ```
+//!
+//! 降采样时每个桶输出两个点（桶内最小值和最大值，按出现先后排列），跨数据包累积，
+//! 所以目标点率可以低于数据包速率。同一（样本类型, 桶大小）组合每个数据包只编码一次，
+//! 由所有选择该组合的客户端共享。
+
+use crate::data_processing::{DataSource, ProcessedData};
+use std::collections::HashMap;
+
+pub const MAGIC: u32 = u32::from_le_bytes(*b"DPWS");
+pub const VERSION: u8 = 1;
+pub const HEADER_LEN: usize = 40;
+
+const FLAG_TRIGGER: u8 = 0x01;
+const FLAG_MINMAX: u8 = 0x02;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, serde::Serialize, serde::Deserialize)]
+#[serde(rename_all = "lowercase")]
+pub enum SampleType {
+    Int16,
+    Float32,
+}
+
+impl SampleType {
+    fn code(self) -> u8 {
+        match self {
+            SampleType::Int16 => 1,
+            SampleType::Float32 => 2,
+        }
+    }
+
+    fn width(self) -> usize {
+        match self {
+            SampleType::Int16 => 2,
+            SampleType::Float32 => 4,
+        }
+    }
+}
+
+/// 客户端协商的数据流格式
+#[derive(Debug, Clone, Copy, serde::Serialize, serde::Deserialize)]
+pub struct StreamFormat {
+    pub binary: bool,                // false 时仍发送原有 JSON 数据消息
+    pub sample_type: SampleType,
+    pub points_per_second: u32,      // 每通道目标点率，0 = 不降采样
+}
+
+impl Default for StreamFormat {
+    fn default() -> Self {
+        Self { binary: false, sample_type: SampleType::Int16, points_per_second: 0 }
+    }
+}
+
+impl StreamFormat {
+    /// 给定原始采样率下的降采样桶大小；桶不超过2个样本时降采样没有意义，返回1
+    pub fn bucket(&self, sample_rate: f64) -> u32 {
+        if self.points_per_second == 0 || !(sample_rate > 0.0) {
+            return 1;
+        }
+        let bucket = (2.0 * sample_rate / self.points_per_second as f64).ceil();
+        if bucket <= 2.0 { 1 } else { bucket.min(u32::MAX as f64) as u32 }
+    }
+}
+
+/// 一个数据包（或降采样输出）的各通道平面数组，尚未编码
+struct Planar {
+    channels: Vec<(u8, Vec<f64>)>,
+}
+
+#[derive(Clone, Copy)]
+struct Bucket {
+    min: f64,
+    max: f64,
+    min_at: u32,
+    max_at: u32,
+    filled: u32,
+}
+
+const EMPTY_BUCKET: Bucket = Bucket { min: f64::MAX, max: f64::MIN, min_at: 0, max_at: 0, filled: 0 };
+
+/// 某一桶大小的跨包 min/max 累积状态
+struct Decimator {
+    bucket: u32,
+    trigger: bool,
+    partial: HashMap<u8, Bucket>,
+}
+
+impl Decimator {
+    fn new(bucket: u32, trigger: bool) -> Self {
+        Self { bucket, trigger, partial: HashMap::new() }
+    }
+
+    fn feed(&mut self, input: &Planar) -> Planar {
+        let mut channels = Vec::with_capacity(input.channels.len());
+        for (id, samples) in &input.channels {
+            let acc = self.partial.entry(*id).or_insert(EMPTY_BUCKET);
+            let mut out = Vec::with_capacity(samples.len() / self.bucket as usize * 2 + 2);
+            for &v in samples {
+                if v < acc.min {
+                    acc.min = v;
+                    acc.min_at = acc.filled;
+                }
+                if v > acc.max {
+                    acc.max = v;
+                    acc.max_at = acc.filled;
+                }
+                acc.filled += 1;
+                if acc.filled == self.bucket {
+                    if acc.min_at <= acc.max_at {
+                        out.extend_from_slice(&[acc.min, acc.max]);
+                    } else {
+                        out.extend_from_slice(&[acc.max, acc.min]);
+                    }
+                    *acc = EMPTY_BUCKET;
+                }
+            }
+            channels.push((*id, out));
+        }
+        Planar { channels }
+    }
+}
+
+/// 数据广播任务持有的编码器：降采样状态在数据包之间保留
+#[derive(Default)]
+pub struct BinaryStreamEncoder {
+    decimators: HashMap<u32, Decimator>,
+}
+
+impl BinaryStreamEncoder {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// 为本数据包编码客户端请求的全部（样本类型, 桶大小）组合。
+    /// 降采样桶尚未填满时该组合返回 None（本包不发送）。
+    pub fn encode(
+        &mut self,
+        data: &ProcessedData,
+        variants: &[(SampleType, u32)],
+    ) -> HashMap<(SampleType, u32), Option<Vec<u8>>> {
+        let trigger = matches!(data.data_type.source, DataSource::Trigger);
+        let raw = split_channels(data);
+
+        // 不再有客户端使用的桶大小，或数据来源切换时丢弃累积状态
+        self.decimators.retain(|b, d| d.trigger == trigger && variants.iter().any(|&(_, vb)| vb == *b));
+
+        let mut decimated: HashMap<u32, Planar> = HashMap::new();
+        let mut out = HashMap::with_capacity(variants.len());
+        for &(sample_type, bucket) in variants {
+            if out.contains_key(&(sample_type, bucket)) {
+                continue;
+            }
+            let planar = if bucket <= 1 {
+                &raw
+            } else {
+                decimated.entry(bucket).or_insert_with(|| {
+                    self.decimators
+                        .entry(bucket)
+                        .or_insert_with(|| Decimator::new(bucket, trigger))
+                        .feed(&raw)
+                })
+            };
+            let encoded = if planar.channels.iter().all(|(_, s)| s.is_empty()) {
+                None
+            } else {
+                Some(encode_planar(data, planar, sample_type, bucket))
+            };
+            out.insert((sample_type, bucket), encoded);
+        }
+        out
+    }
+}
+
+/// ProcessedData.data 按 channel_info 中各通道样本数依次切分
+fn split_channels(data: &ProcessedData) -> Planar {
+    let mut channels = Vec::with_capacity(data.metadata.channel_info.len());
+    let mut offset = 0;
+    for ch in &data.metadata.channel_info {
+        let end = (offset + ch.sample_count).min(data.data.len());
+        channels.push((ch.channel_id, data.data[offset..end].to_vec()));
+        offset = end;
+    }
+    Planar { channels }
+}
+
+fn encode_planar(data: &ProcessedData, planar: &Planar, sample_type: SampleType, bucket: u32) -> Vec<u8> {
+    let points: usize = planar.channels.iter().map(|(_, s)| s.len()).sum();
+    let mut buf = Vec::with_capacity(HEADER_LEN + planar.channels.len() * 4 + points * sample_type.width());
+
+    let trigger_ts = data.data_type.trigger_info.as_ref().map(|t| t.trigger_timestamp);
+    let mut flags = 0u8;
+    if matches!(data.data_type.source, DataSource::Trigger) {
+        flags |= FLAG_TRIGGER;
+    }
+    if bucket > 1 {
+        flags |= FLAG_MINMAX;
+    }
+
+    buf.extend_from_slice(&MAGIC.to_le_bytes());
+    buf.push(VERSION);
+    buf.push(sample_type.code());
+    buf.push(flags);
+    buf.push(planar.channels.len() as u8);
+    buf.extend_from_slice(&data.sequence.to_le_bytes());
+    buf.extend_from_slice(&data.timestamp.to_le_bytes());
+    buf.extend_from_slice(&(data.sample_rate as f32).to_le_bytes());
+    buf.extend_from_slice(&bucket.to_le_bytes());
+    buf.extend_from_slice(&trigger_ts.unwrap_or(0).to_le_bytes());
+    buf.extend_from_slice(&0u32.to_le_bytes());
+
+    for (id, samples) in &planar.channels {
+        buf.push(*id);
+        buf.push(0);
+        buf.extend_from_slice(&(samples.len().min(u16::MAX as usize) as u16).to_le_bytes());
+    }
+
+    // 样本来自设备的 int16，转回 int16 无损；超出范围时饱和
+    for (_, samples) in &planar.channels {
+        let samples = &samples[..samples.len().min(u16::MAX as usize)];
+        match sample_type {
+            SampleType::Int16 => {
+                for &v in samples {
+                    buf.extend_from_slice(&(v.round() as i16).to_le_bytes());
+                }
+            }
+            SampleType::Float32 => {
+                for &v in samples {
+                    buf.extend_from_slice(&(v as f32).to_le_bytes());
+                }
+            }
+        }
+    }
+    buf
+}
@@ -0,0 +1,96 @@
+// File: data_packet.c
+// Description: Decoding of CMD_DATA_PACKET / CMD_DATA_PACKET_MULTIRATE payloads
+// Version: v2.0
+
+#include "data_packet.h"
+
+#include <string.h>
+
+static uint8_t count_channels(uint16_t mask)
+{
+    uint8_t n = 0;
+    for (; mask; mask &= (uint16_t)(mask - 1)) {
+        n++;
+    }
+    return n;
+}
+
+// Single-rate: timestamp, mask, sample_count, then one block per set mask bit
+static bool decode_single_rate(const uint8_t* payload, uint16_t payloadLen, DataPacket_t* pkt)
+{
+    if (payloadLen < 8) {
+        return false;
+    }
+
+    uint16_t sample_count;
+    memcpy(&pkt->timestamp, payload, 4);
+    memcpy(&pkt->channel_mask, payload + 4, 2);
+    memcpy(&sample_count, payload + 6, 2);
+
+    pkt->channel_count = count_channels(pkt->channel_mask);
+    pkt->total_samples = (uint32_t)pkt->channel_count * sample_count;
+    if (payloadLen != 8 + pkt->total_samples * sizeof(int16_t)) {
+        return false;
+    }
+
+    const int16_t* block = (const int16_t*)(payload + 8);
+    for (uint8_t ch = 0; ch < DATA_PACKET_MAX_CHANNELS; ch++) {
+        if (pkt->channel_mask & (1u << ch)) {
+            pkt->counts[ch] = sample_count;
+            pkt->blocks[ch] = block;
+            block += sample_count;
+        }
+    }
+    return true;
+}
+
+// Multi-rate: timestamp, mask, a uint16 count per set mask bit, then the blocks
+static bool decode_multi_rate(const uint8_t* payload, uint16_t payloadLen, DataPacket_t* pkt)
+{
+    if (payloadLen < 6) {
+        return false;
+    }
+
+    memcpy(&pkt->timestamp, payload, 4);
+    memcpy(&pkt->channel_mask, payload + 4, 2);
+
+    pkt->channel_count = count_channels(pkt->channel_mask);
+    uint32_t header_len = 6 + pkt->channel_count * sizeof(uint16_t);
+    if (pkt->channel_count == 0 || payloadLen < header_len) {
+        return false;
+    }
+
+    uint16_t counts[DATA_PACKET_MAX_CHANNELS];
+    memcpy(counts, payload + 6, pkt->channel_count * sizeof(uint16_t));
+    pkt->total_samples = 0;
+    for (uint8_t i = 0; i < pkt->channel_count; i++) {
+        pkt->total_samples += counts[i];
+    }
+    if (payloadLen != header_len + pkt->total_samples * sizeof(int16_t)) {
+        return false;
+    }
+
+    const int16_t* block = (const int16_t*)(payload + header_len);
+    uint8_t index = 0;
+    for (uint8_t ch = 0; ch < DATA_PACKET_MAX_CHANNELS; ch++) {
+        if (pkt->channel_mask & (1u << ch)) {
+            pkt->counts[ch] = counts[index];
+            pkt->blocks[ch] = block;
+            block += counts[index];
+            index++;
+        }
+    }
+    return true;
+}
+
+bool decode_data_packet(uint8_t cmd, const uint8_t* payload, uint16_t payloadLen, DataPacket_t* pkt)
+{
+    memset(pkt, 0, sizeof(*pkt));
+    if (cmd == CMD_DATA_PACKET) {
+        return decode_single_rate(payload, payloadLen, pkt);
+    }
+    if (cmd == CMD_DATA_PACKET_MULTIRATE) {
+        return decode_multi_rate(payload, payloadLen, pkt);
+    }
+    return false;
+}
@@ -0,0 +1,31 @@
+// File: data_packet.h
+// Description: Decoding of CMD_DATA_PACKET / CMD_DATA_PACKET_MULTIRATE payloads
+// Version: v2.0
+
+#ifndef DATA_PACKET_H
+#define DATA_PACKET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CMD_DATA_PACKET             0x40
+#define CMD_DATA_PACKET_MULTIRATE   0x43
+
+#define DATA_PACKET_MAX_CHANNELS    16      // One bit per channel in channel_mask
+
+// A decoded data packet. Sample blocks point into the payload that was
+// decoded and stay valid only as long as it does.
+typedef struct {
+    uint32_t       timestamp;
+    uint16_t       channel_mask;
+    uint8_t        channel_count;                           // Set bits in channel_mask
+    uint16_t       counts[DATA_PACKET_MAX_CHANNELS];        // Samples per channel id (0 if absent)
+    const int16_t* blocks[DATA_PACKET_MAX_CHANNELS];        // Block per channel id (NULL if absent)
+    uint32_t       total_samples;
+} DataPacket_t;
+
+// Decode either data packet layout into `pkt`. Returns false if the command is
+// not a data packet or the payload length does not match its header.
+bool decode_data_packet(uint8_t cmd, const uint8_t* payload, uint16_t payloadLen, DataPacket_t* pkt);
+
+#endif // DATA_PACKET_H
@@ -0,0 +1,130 @@
+// File: fft.c
+// Description: In-place radix-4/2 complex FFT on split real/imaginary arrays
+//              Decimation in frequency: radix-4 stages from span n down to 4
+//              (8 and a final radix-2 stage when log2(n) is odd). Each radix-4
+//              butterfly equals two radix-2 DIF stages, so output is bit-reversed.
+// Version: v2.0
+
+#include "fft.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FFT_TWO_PI  6.283185307179586
+
+static uint32_t radix4_stages(uint32_t log2n)
+{
+    return log2n / 2;
+}
+
+int fft_plan_init(FftPlan_t* plan, uint32_t n)
+{
+    memset(plan, 0, sizeof(*plan));
+    if (n < 4 || (n & (n - 1)) != 0) {
+        return -1;
+    }
+
+    uint32_t log2n = 0;
+    while ((1u << log2n) < n) {
+        log2n++;
+    }
+
+    // (w1, w2, w3) complex per butterfly index j of every radix-4 stage
+    size_t twCount = 0;
+    uint32_t span = n;
+    for (uint32_t s = 0; s < radix4_stages(log2n); s++, span >>= 2) {
+        twCount += (size_t)(span / 4) * 6;
+    }
+
+    plan->tw = (float*)malloc(twCount * sizeof(float));
+    plan->bitrev = (uint32_t*)malloc(n * sizeof(uint32_t));
+    if (!plan->tw || !plan->bitrev) {
+        fft_plan_free(plan);
+        return -1;
+    }
+    plan->n = n;
+    plan->log2n = log2n;
+
+    float* tw = plan->tw;
+    span = n;
+    for (uint32_t s = 0; s < radix4_stages(log2n); s++, span >>= 2) {
+        for (uint32_t j = 0; j < span / 4; j++) {
+            for (uint32_t m = 1; m <= 3; m++) {
+                double a = -FFT_TWO_PI * (double)(m * j) / (double)span;
+                *tw++ = (float)cos(a);
+                *tw++ = (float)sin(a);
+            }
+        }
+    }
+
+    for (uint32_t k = 0; k < n; k++) {
+        uint32_t r = 0;
+        for (uint32_t b = 0; b < log2n; b++) {
+            r |= ((k >> b) & 1u) << (log2n - 1 - b);
+        }
+        plan->bitrev[k] = r;
+    }
+    return 0;
+}
+
+void fft_plan_free(FftPlan_t* plan)
+{
+    free(plan->tw);
+    free(plan->bitrev);
+    memset(plan, 0, sizeof(*plan));
+}
+
+void fft_forward(const FftPlan_t* plan, float* re, float* im)
+{
+    const uint32_t n = plan->n;
+    const float* tw = plan->tw;
+
+    uint32_t span = n;
+    for (uint32_t s = 0; s < radix4_stages(plan->log2n); s++, span >>= 2) {
+        const uint32_t q = span / 4;
+        for (uint32_t base = 0; base < n; base += span) {
+            float* r0 = re + base;
+            float* i0 = im + base;
+            const float* w = tw;
+            for (uint32_t j = 0; j < q; j++, w += 6) {
+                float x0r = r0[j],         x0i = i0[j];
+                float x1r = r0[j + q],     x1i = i0[j + q];
+                float x2r = r0[j + 2 * q], x2i = i0[j + 2 * q];
+                float x3r = r0[j + 3 * q], x3i = i0[j + 3 * q];
+
+                float a0r = x0r + x2r, a0i = x0i + x2i;
+                float a1r = x0r - x2r, a1i = x0i - x2i;
+                float a2r = x1r + x3r, a2i = x1i + x3i;
+                float a3r = x1r - x3r, a3i = x1i - x3i;
+
+                // Two radix-2 DIF stages: outputs land at j, j+q, j+2q, j+3q
+                float b1r = a0r - a2r,       b1i = a0i - a2i;   // * W^2j
+                float b2r = a1r + a3i,       b2i = a1i - a3r;   // (a1 - i*a3) * W^j
+                float b3r = a1r - a3i,       b3i = a1i + a3r;   // (a1 + i*a3) * W^3j
+
+                r0[j] = a0r + a2r;
+                i0[j] = a0i + a2i;
+                r0[j + q]     = b1r * w[2] - b1i * w[3];
+                i0[j + q]     = b1r * w[3] + b1i * w[2];
+                r0[j + 2 * q] = b2r * w[0] - b2i * w[1];
+                i0[j + 2 * q] = b2r * w[1] + b2i * w[0];
+                r0[j + 3 * q] = b3r * w[4] - b3i * w[5];
+                i0[j + 3 * q] = b3r * w[5] + b3i * w[4];
+            }
+        }
+        tw += (size_t)q * 6;
+    }
+
+    // Odd log2(n): one radix-2 stage of span 2 remains, twiddle 1
+    if (span == 2) {
+        for (uint32_t k = 0; k < n; k += 2) {
+            float ar = re[k], ai = im[k];
+            float br = re[k + 1], bi = im[k + 1];
+            re[k] = ar + br;
+            im[k] = ai + bi;
+            re[k + 1] = ar - br;
+            im[k + 1] = ai - bi;
+        }
+    }
+}
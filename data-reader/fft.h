@@ -0,0 +1,29 @@
+// File: fft.h
+// Description: In-place radix-4/2 complex FFT on split real/imaginary arrays
+// Version: v2.0
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdint.h>
+
+// Twiddles are stored per stage in the order the butterflies read them, so
+// every stage walks its table front to back
+typedef struct {
+    uint32_t  n;            // Transform size, power of two >= 4
+    uint32_t  log2n;
+    float*    tw;           // Per radix-4 stage: (w1, w2, w3) as re/im pairs for each j
+    uint32_t* bitrev;       // bitrev[k] = position of bin k in the transform output
+} FftPlan_t;
+
+// Build a plan for size n. Returns 0 on success, -1 if n is not a power of
+// two >= 4 or memory runs out. A plan is read-only afterwards and may be
+// shared between threads.
+int fft_plan_init(FftPlan_t* plan, uint32_t n);
+void fft_plan_free(FftPlan_t* plan);
+
+// Forward transform of re[]/im[] in place. Output bins are left in
+// bit-reversed order: bin k is at index plan->bitrev[k].
+void fft_forward(const FftPlan_t* plan, float* re, float* im);
+
+#endif // FFT_H
@@ -0,0 +1,278 @@
+// File: frame_core.c
+// Description: Protocol V6 stream parser, frame builder and data packet demux
+//              behind a stable C ABI (see frame_core.h)
+// Version: v2.0
+
+#include "frame_core.h"
+#include "data_packet.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct FcStream {
+    uint8_t*        buf;
+    uint32_t        capacity;
+    uint32_t        head;       // First unparsed byte
+    uint32_t        tail;       // One past the last fed byte
+    FcStreamStats_t stats;
+};
+
+// ===================== CRC16/MODBUS =====================
+
+// Reflected polynomial 0xA001, one table step per byte instead of eight shifts
+static const uint16_t s_crcTable[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+};
+
+uint32_t fc_abi_version(void)
+{
+    return FC_ABI_VERSION;
+}
+
+uint16_t fc_crc16(const uint8_t* data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc >> 8) ^ s_crcTable[(crc ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+// ===================== Frame Builder =====================
+
+int32_t fc_build_frame(uint8_t cmd, uint8_t seq, const uint8_t* payload, uint16_t payload_len,
+                       uint8_t* out, uint32_t cap)
+{
+    uint32_t total = (uint32_t)payload_len + FC_FRAME_OVERHEAD;
+    if (payload_len > FC_MAX_PAYLOAD || cap < total) {
+        return -1;
+    }
+
+    uint16_t len = (uint16_t)(payload_len + 4);
+    out[0] = 0xAA;
+    out[1] = 0x55;
+    out[2] = (uint8_t)(len & 0xFF);
+    out[3] = (uint8_t)(len >> 8);
+    out[4] = cmd;
+    out[5] = seq;
+    if (payload_len > 0) {
+        memcpy(out + 6, payload, payload_len);
+    }
+    uint16_t crc = fc_crc16(out + 4, 2u + payload_len);
+    out[6 + payload_len] = (uint8_t)(crc & 0xFF);
+    out[7 + payload_len] = (uint8_t)(crc >> 8);
+    out[8 + payload_len] = 0x55;
+    out[9 + payload_len] = 0xAA;
+    return (int32_t)total;
+}
+
+// ===================== Stream Parser =====================
+
+FcStream_t* fc_stream_new(uint32_t capacity)
+{
+    if (capacity < 2 * FC_MAX_FRAME_SIZE) {
+        capacity = 2 * FC_MAX_FRAME_SIZE;
+    }
+    FcStream_t* s = (FcStream_t*)calloc(1, sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    s->buf = (uint8_t*)malloc(capacity);
+    if (!s->buf) {
+        free(s);
+        return NULL;
+    }
+    s->capacity = capacity;
+    return s;
+}
+
+void fc_stream_free(FcStream_t* s)
+{
+    if (!s) return;
+    free(s->buf);
+    free(s);
+}
+
+void fc_stream_reset(FcStream_t* s)
+{
+    s->head = 0;
+    s->tail = 0;
+    memset(&s->stats, 0, sizeof(s->stats));
+}
+
+void fc_stream_prefault(FcStream_t* s)
+{
+    memset(s->buf, 0, s->capacity);
+}
+
+uint32_t fc_stream_feed(FcStream_t* s, const uint8_t* data, uint32_t len)
+{
+    if (s->head == s->tail) {
+        s->head = s->tail = 0;
+    } else if (s->capacity - s->tail < len && s->head > 0) {
+        memmove(s->buf, s->buf + s->head, s->tail - s->head);
+        s->tail -= s->head;
+        s->head = 0;
+    }
+
+    uint32_t n = s->capacity - s->tail;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(s->buf + s->tail, data, n);
+    s->tail += n;
+    s->stats.bytes_in += n;
+    return n;
+}
+
+int fc_stream_next(FcStream_t* s, FcFrame_t* out)
+{
+    for (;;) {
+        uint32_t avail = s->tail - s->head;
+        if (avail == 0) {
+            return 0;
+        }
+
+        // Resynchronise on the first 0xAA
+        const uint8_t* p = (const uint8_t*)memchr(s->buf + s->head, 0xAA, avail);
+        if (!p) {
+            s->stats.bytes_skipped += avail;
+            s->head = s->tail;
+            return 0;
+        }
+        uint32_t skip = (uint32_t)(p - (s->buf + s->head));
+        s->stats.bytes_skipped += skip;
+        s->head += skip;
+        avail -= skip;
+
+        const uint8_t* f = s->buf + s->head;
+        if (avail < 2) {
+            return 0;
+        }
+        if (f[1] != 0x55) {
+            s->stats.bytes_skipped++;
+            s->head++;
+            continue;
+        }
+        if (avail < 4) {
+            return 0;
+        }
+
+        uint32_t len = (uint32_t)f[2] | ((uint32_t)f[3] << 8);
+        uint32_t total = len + 6;
+        if (len < 4 || total > FC_MAX_FRAME_SIZE) {
+            s->stats.bad_frames++;
+            s->head++;
+            continue;
+        }
+        if (avail < total) {
+            return 0;
+        }
+        if (f[total - 2] != 0x55 || f[total - 1] != 0xAA) {
+            s->stats.bad_frames++;
+            s->head++;
+            continue;
+        }
+
+        uint16_t rx_crc = (uint16_t)(f[len + 2] | (f[len + 3] << 8));
+        if (rx_crc != fc_crc16(f + 4, len - 2)) {
+            s->stats.crc_errors++;
+            s->head++;
+            continue;
+        }
+
+        out->cmd = f[4];
+        out->seq = f[5];
+        out->payload = f + 6;
+        out->payload_len = (uint16_t)(len - 4);
+        s->head += total;
+        s->stats.frames++;
+        return 1;
+    }
+}
+
+void fc_stream_stats(const FcStream_t* s, FcStreamStats_t* out)
+{
+    *out = s->stats;
+}
+
+// ===================== Data Packet Demux =====================
+
+int fc_decode_columns(uint8_t cmd, const uint8_t* payload, uint16_t payload_len,
+                      FcPacketInfo_t* info, int16_t* columns, uint32_t capacity)
+{
+    DataPacket_t pkt;
+    if (!decode_data_packet(cmd, payload, payload_len, &pkt)) {
+        return -1;
+    }
+
+    info->timestamp = pkt.timestamp;
+    info->total_samples = pkt.total_samples;
+    info->channel_mask = pkt.channel_mask;
+    info->channel_count = pkt.channel_count;
+    memcpy(info->counts, pkt.counts, sizeof(info->counts));
+    if (pkt.total_samples > capacity) {
+        return -2;
+    }
+
+    // Blocks are contiguous in the payload already, in channel id order; the
+    // copy just moves them to aligned storage
+    int16_t* out = columns;
+    for (uint8_t ch = 0; ch < FC_MAX_CHANNELS; ch++) {
+        if (pkt.blocks[ch]) {
+            memcpy(out, pkt.blocks[ch], pkt.counts[ch] * sizeof(int16_t));
+            out += pkt.counts[ch];
+        }
+    }
+    return 0;
+}
+
+void fc_column_stats(const int16_t* column, uint32_t count, FcColumnStats_t* out)
+{
+    int64_t sum = 0;
+    uint64_t sum_sq = 0;
+    int16_t lo = INT16_MAX, hi = INT16_MIN;
+
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t v = column[i];
+        sum += v;
+        sum_sq += (uint64_t)(v * v);
+        if (v < lo) lo = (int16_t)v;
+        if (v > hi) hi = (int16_t)v;
+    }
+    out->sum = sum;
+    out->sum_sq = sum_sq;
+    out->min = count ? lo : 0;
+    out->max = count ? hi : 0;
+}
@@ -0,0 +1,109 @@
+// File: frame_core.h
+// Description: Protocol V6 stream parser, frame builder and data packet demux
+//              behind a stable C ABI (static library libframecore, also linked
+//              into data-processor)
+// Version: v2.0
+
+#ifndef FRAME_CORE_H
+#define FRAME_CORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped on any change to the structs or signatures below
+#define FC_ABI_VERSION          1
+
+// AA 55 | len u16 | cmd | seq | payload | crc16 | 55 AA, len = cmd..crc
+#define FC_FRAME_OVERHEAD       10
+#define FC_MAX_FRAME_SIZE       5120
+#define FC_MAX_PAYLOAD          (FC_MAX_FRAME_SIZE - FC_FRAME_OVERHEAD)
+#define FC_MAX_CHANNELS         16
+
+// ===================== Data Structures =====================
+
+typedef struct FcStream FcStream_t;     // Opaque receive buffer + parser state
+
+// A validated frame. `payload` points into the stream buffer and stays valid
+// until the next fc_stream_feed/fc_stream_reset on that stream.
+typedef struct {
+    const uint8_t* payload;
+    uint16_t       payload_len;
+    uint8_t        cmd;
+    uint8_t        seq;
+} FcFrame_t;
+
+typedef struct {
+    uint64_t bytes_in;          // Accepted by fc_stream_feed
+    uint64_t frames;            // Returned by fc_stream_next
+    uint64_t bytes_skipped;     // Discarded while resynchronising on AA 55
+    uint64_t crc_errors;
+    uint64_t bad_frames;        // Length out of range or tail not 55 AA
+} FcStreamStats_t;
+
+// Header of a DATA_PACKET (0x40) or DATA_PACKET_MULTIRATE (0x43) payload
+typedef struct {
+    uint32_t timestamp;
+    uint32_t total_samples;                 // Sum of counts[]
+    uint16_t channel_mask;
+    uint16_t counts[FC_MAX_CHANNELS];       // Samples per channel id (0 if absent)
+    uint8_t  channel_count;
+} FcPacketInfo_t;
+
+typedef struct {
+    int64_t  sum;
+    uint64_t sum_sq;
+    int16_t  min;
+    int16_t  max;
+} FcColumnStats_t;
+
+// ===================== Function Declarations =====================
+
+uint32_t fc_abi_version(void);
+
+// CRC16/MODBUS over `len` bytes (table driven)
+uint16_t fc_crc16(const uint8_t* data, size_t len);
+
+// Build a frame into out[0..cap). Returns the frame length, or -1 if the
+// payload is too long or `cap` too small.
+int32_t fc_build_frame(uint8_t cmd, uint8_t seq, const uint8_t* payload, uint16_t payload_len,
+                       uint8_t* out, uint32_t cap);
+
+// Receive buffer of `capacity` bytes (raised to at least 2 x FC_MAX_FRAME_SIZE).
+// Returns NULL when out of memory.
+FcStream_t* fc_stream_new(uint32_t capacity);
+void fc_stream_free(FcStream_t* s);
+void fc_stream_reset(FcStream_t* s);
+
+// Touch every page of the buffer so it is resident before capture starts
+void fc_stream_prefault(FcStream_t* s);
+
+// Append up to `len` bytes and return how many were taken. Fewer than `len`
+// means the buffer is full: drain it with fc_stream_next, then feed the rest.
+// After a full drain at least capacity - FC_MAX_FRAME_SIZE bytes are free.
+uint32_t fc_stream_feed(FcStream_t* s, const uint8_t* data, uint32_t len);
+
+// Next valid frame: 1 with *out filled, 0 when more bytes are needed.
+// Garbage, bad lengths and CRC failures are skipped and counted.
+int fc_stream_next(FcStream_t* s, FcFrame_t* out);
+
+void fc_stream_stats(const FcStream_t* s, FcStreamStats_t* out);
+
+// Demux a data packet into typed columns: one int16 run per set mask bit, in
+// channel id order, written to columns[0..info->total_samples). Returns 0,
+// -1 if `cmd` is not a data packet or the payload does not match its header,
+// -2 if `capacity` (in samples) is too small.
+int fc_decode_columns(uint8_t cmd, const uint8_t* payload, uint16_t payload_len,
+                      FcPacketInfo_t* info, int16_t* columns, uint32_t capacity);
+
+// Min/max/sum/sum of squares of one column (count > 0)
+void fc_column_stats(const int16_t* column, uint32_t count, FcColumnStats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_CORE_H
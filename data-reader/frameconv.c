@@ -0,0 +1,763 @@
+// File: frameconv.c
+// Description: Parallel converter from raw_frames_NNN.txt captures ("LEN:%u HEX: ..")
+//              to binary or columnar sample files
+// Version: v2.0
+//
+// Every input file is cut into chunks at line boundaries. Chunks are dealt
+// round-robin onto per-worker deques; a worker pops its own deque from the
+// front and steals from the back of the others once it runs dry. Each chunk
+// decodes into private output buffers which are committed to the output
+// files strictly in chunk order, so the result is identical for any -j.
+
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define conv_fseek _fseeki64
+#define conv_ftell _ftelli64
+#else
+#include <unistd.h>
+#define conv_fseek fseeko
+#define conv_ftell ftello
+#endif
+
+#include "protocol.h"
+#include "hex_decode.h"
+#include "data_packet.h"
+
+// ===================== Configuration =====================
+#define DEFAULT_CHUNK_MB        16
+#define MAX_WORKERS             64
+#define LINE_MAX_BYTES          (32 + 3 * MAX_FRAME_SIZE)   // "LEN:nnnn HEX:" + " XX" per byte
+
+#define BINARY_MAGIC            "DRB1"
+#define OUT_STREAMS             (1 + DATA_PACKET_MAX_CHANNELS)  // [0] = packets, [1+ch] = channel samples
+
+typedef enum {
+    OUT_FORMAT_BINARY,          // <base>.bin: magic, then u16 length + multi-rate payload per packet
+    OUT_FORMAT_COLUMNAR         // <base>.pkt index records + <base>.chNN.i16 sample columns
+} OutputFormat;
+
+// Fixed-size columnar index record, one per data packet
+typedef struct {
+    uint32_t timestamp;
+    uint16_t channel_mask;
+    uint16_t reserved;
+    uint16_t counts[DATA_PACKET_MAX_CHANNELS];
+} ColumnarIndex_t;
+
+// ===================== Data Structures =====================
+
+typedef struct {
+    uint8_t* data;
+    size_t   len;
+    size_t   cap;
+} ByteBuf_t;
+
+typedef struct {
+    uint64_t lines;
+    uint64_t bad_lines;         // Not "LEN:n HEX:" or hex/length mismatch
+    uint64_t bad_frames;        // Rejected by parseFrame (CRC, framing)
+    uint64_t data_packets;
+    uint64_t bad_packets;       // Data packet whose length disagrees with its header
+    uint64_t other_frames;      // Valid frames that are not data packets
+    uint64_t samples;
+} ConvStats_t;
+
+typedef struct ConvFile ConvFile_t;
+
+typedef struct {
+    ConvFile_t* file;
+    uint32_t    index;          // Chunk index within its file
+    int64_t     start;          // Lines starting in [start, end) belong to this chunk
+    int64_t     end;
+    bool        done;
+    ByteBuf_t   out[OUT_STREAMS];
+    ConvStats_t stats;
+} WorkUnit_t;
+
+struct ConvFile {
+    const char*     path;
+    char            base[512];  // Output path without extension
+    int64_t         size;
+    WorkUnit_t*     units;      // chunk_count consecutive units
+    uint32_t        chunk_count;
+    uint32_t        next_commit;
+    bool            committing;
+    bool            failed;
+    FILE*           out[OUT_STREAMS];
+    pthread_mutex_t lock;
+};
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t*       items;      // Unit indices, live range [head, tail)
+    uint32_t        head;
+    uint32_t        tail;
+} WorkDeque_t;
+
+typedef struct {
+    int         id;
+    pthread_t   thread;
+    char*       readBuf;
+    size_t      readCap;
+    ConvStats_t stats;
+    uint32_t    stolen;
+} Worker_t;
+
+// ===================== Global Variables =====================
+static OutputFormat g_format     = OUT_FORMAT_BINARY;
+static const char*  g_outDir     = NULL;
+static size_t       g_chunkBytes = (size_t)DEFAULT_CHUNK_MB << 20;
+static bool         g_quiet      = false;
+
+static ConvFile_t*  g_files      = NULL;
+static uint32_t     g_fileCount  = 0;
+static WorkUnit_t*  g_units      = NULL;
+static uint32_t     g_unitCount  = 0;
+
+static WorkDeque_t  g_deques[MAX_WORKERS];
+static Worker_t     g_workers[MAX_WORKERS];
+static int          g_workerCount = 0;
+
+// ===================== Utility Functions =====================
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static bool buf_reserve(ByteBuf_t* b, size_t extra)
+{
+    if (b->len + extra <= b->cap) {
+        return true;
+    }
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + extra) {
+        cap *= 2;
+    }
+    uint8_t* p = (uint8_t*)realloc(b->data, cap);
+    if (!p) {
+        return false;
+    }
+    b->data = p;
+    b->cap = cap;
+    return true;
+}
+
+static bool buf_append(ByteBuf_t* b, const void* data, size_t len)
+{
+    if (!buf_reserve(b, len)) {
+        return false;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return true;
+}
+
+static void buf_free(ByteBuf_t* b)
+{
+    free(b->data);
+    b->data = NULL;
+    b->len = b->cap = 0;
+}
+
+static void stats_add(ConvStats_t* dst, const ConvStats_t* src)
+{
+    dst->lines        += src->lines;
+    dst->bad_lines    += src->bad_lines;
+    dst->bad_frames   += src->bad_frames;
+    dst->data_packets += src->data_packets;
+    dst->bad_packets  += src->bad_packets;
+    dst->other_frames += src->other_frames;
+    dst->samples      += src->samples;
+}
+
+// "<outDir>/<name without .txt>", or next to the input without -o
+static void make_output_base(const char* path, char* base, size_t baseSize)
+{
+    const char* name = path;
+    for (const char* p = path; *p; p++) {
+        if (*p == '/' || *p == '\\') {
+            name = p + 1;
+        }
+    }
+
+    size_t nameLen = strlen(name);
+    if (nameLen > 4 && strcmp(name + nameLen - 4, ".txt") == 0) {
+        nameLen -= 4;
+    }
+
+    if (g_outDir) {
+        snprintf(base, baseSize, "%s/%.*s", g_outDir, (int)nameLen, name);
+    } else {
+        size_t dirLen = (size_t)(name - path);
+        snprintf(base, baseSize, "%.*s%.*s", (int)dirLen, path, (int)nameLen, name);
+    }
+}
+
+// ===================== Line Decoding =====================
+
+// Append one decoded packet to the chunk's output streams
+static bool emit_packet(WorkUnit_t* unit, const DataPacket_t* pkt)
+{
+    if (g_format == OUT_FORMAT_BINARY) {
+        // Normalised to the multi-rate layout so both packet kinds read the same
+        uint16_t counts[DATA_PACKET_MAX_CHANNELS];
+        uint8_t n = 0;
+        for (uint8_t ch = 0; ch < DATA_PACKET_MAX_CHANNELS; ch++) {
+            if (pkt->channel_mask & (1u << ch)) {
+                counts[n++] = pkt->counts[ch];
+            }
+        }
+        uint16_t recordLen = (uint16_t)(6 + n * sizeof(uint16_t) + pkt->total_samples * sizeof(int16_t));
+        ByteBuf_t* b = &unit->out[0];
+        if (!buf_reserve(b, sizeof(recordLen) + recordLen)) {
+            return false;
+        }
+        buf_append(b, &recordLen, sizeof(recordLen));
+        buf_append(b, &pkt->timestamp, sizeof(pkt->timestamp));
+        buf_append(b, &pkt->channel_mask, sizeof(pkt->channel_mask));
+        buf_append(b, counts, n * sizeof(uint16_t));
+        for (uint8_t ch = 0; ch < DATA_PACKET_MAX_CHANNELS; ch++) {
+            if (pkt->blocks[ch]) {
+                buf_append(b, pkt->blocks[ch], pkt->counts[ch] * sizeof(int16_t));
+            }
+        }
+        return true;
+    }
+
+    ColumnarIndex_t idx = {0};
+    idx.timestamp = pkt->timestamp;
+    idx.channel_mask = pkt->channel_mask;
+    memcpy(idx.counts, pkt->counts, sizeof(idx.counts));
+    if (!buf_append(&unit->out[0], &idx, sizeof(idx))) {
+        return false;
+    }
+    for (uint8_t ch = 0; ch < DATA_PACKET_MAX_CHANNELS; ch++) {
+        if (pkt->blocks[ch] &&
+            !buf_append(&unit->out[1 + ch], pkt->blocks[ch], pkt->counts[ch] * sizeof(int16_t))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decode one "LEN:%u HEX: .." line (without its newline)
+static bool convert_line(WorkUnit_t* unit, const char* line, size_t lineLen)
+{
+    _Alignas(8) uint8_t frame[MAX_FRAME_SIZE];
+    _Alignas(8) uint8_t payload[MAX_FRAME_SIZE];
+
+    if (lineLen > 0 && line[lineLen - 1] == '\r') {
+        lineLen--;
+    }
+    if (lineLen == 0) {
+        return true;
+    }
+    unit->stats.lines++;
+
+    if (lineLen < 4 || memcmp(line, "LEN:", 4) != 0) {
+        unit->stats.bad_lines++;
+        return true;
+    }
+    size_t pos = 4;
+    uint32_t frameLen = 0;
+    while (pos < lineLen && line[pos] >= '0' && line[pos] <= '9' && frameLen <= MAX_FRAME_SIZE) {
+        frameLen = frameLen * 10 + (uint32_t)(line[pos++] - '0');
+    }
+    if (frameLen == 0 || frameLen > MAX_FRAME_SIZE ||
+        lineLen - pos < 5 || memcmp(line + pos, " HEX:", 5) != 0) {
+        unit->stats.bad_lines++;
+        return true;
+    }
+    pos += 5;
+    if (lineLen - pos != 3 * (size_t)frameLen ||
+        hex_decode_spaced(line + pos, frameLen, frame) != 0) {
+        unit->stats.bad_lines++;
+        return true;
+    }
+
+    uint8_t  cmd = 0;
+    uint8_t  seq = 0;
+    uint16_t payloadLen = 0;
+    if (parseFrame(frame, (uint16_t)frameLen, &cmd, &seq, payload, &payloadLen) != 0) {
+        unit->stats.bad_frames++;
+        return true;
+    }
+    if (cmd != CMD_DATA_PACKET && cmd != CMD_DATA_PACKET_MULTIRATE) {
+        unit->stats.other_frames++;
+        return true;
+    }
+
+    DataPacket_t pkt;
+    if (!decode_data_packet(cmd, payload, payloadLen, &pkt)) {
+        unit->stats.bad_packets++;
+        return true;
+    }
+    unit->stats.data_packets++;
+    unit->stats.samples += pkt.total_samples;
+    return emit_packet(unit, &pkt);
+}
+
+// Read the chunk plus enough context to find its first and finish its last line
+static bool convert_unit(Worker_t* w, WorkUnit_t* unit)
+{
+    ConvFile_t* file = unit->file;
+    int64_t readFrom = unit->start > 0 ? unit->start - 1 : 0;
+    int64_t readTo = unit->end + LINE_MAX_BYTES;
+    if (readTo > file->size) {
+        readTo = file->size;
+    }
+    size_t want = (size_t)(readTo - readFrom);
+
+    if (want + 1 > w->readCap) {
+        char* p = (char*)realloc(w->readBuf, want + 1);
+        if (!p) {
+            return false;
+        }
+        w->readBuf = p;
+        w->readCap = want + 1;
+    }
+
+    FILE* fp = fopen(file->path, "rb");
+    if (!fp) {
+        return false;
+    }
+    bool ok = conv_fseek(fp, readFrom, SEEK_SET) == 0 && fread(w->readBuf, 1, want, fp) == want;
+    fclose(fp);
+    if (!ok) {
+        return false;
+    }
+
+    const char* p = w->readBuf;
+    const char* bufEnd = w->readBuf + want;
+    if (unit->start > 0) {
+        // The line containing `start` belongs to the previous chunk unless it begins there
+        const char* nl = (const char*)memchr(p, '\n', want);
+        if (!nl) {
+            return true;
+        }
+        p = nl + 1;
+    }
+
+    size_t hint = (size_t)(unit->end - unit->start) / 3;
+    if (!buf_reserve(&unit->out[0], g_format == OUT_FORMAT_BINARY ? hint : hint / 64)) {
+        return false;
+    }
+
+    while (p < bufEnd && readFrom + (p - w->readBuf) < unit->end) {
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(bufEnd - p));
+        const char* lineEnd = nl ? nl : bufEnd;
+        if (!nl && readTo < file->size) {
+            // Longer than any valid line: count it and stop, the rest is garbage
+            unit->stats.lines++;
+            unit->stats.bad_lines++;
+            break;
+        }
+        if (!convert_line(unit, p, (size_t)(lineEnd - p))) {
+            return false;
+        }
+        p = nl ? nl + 1 : bufEnd;
+    }
+    return true;
+}
+
+// ===================== Ordered Commit =====================
+
+static const char* stream_suffix(int stream, char* tmp, size_t tmpSize)
+{
+    if (g_format == OUT_FORMAT_BINARY) {
+        return ".bin";
+    }
+    if (stream == 0) {
+        return ".pkt";
+    }
+    snprintf(tmp, tmpSize, ".ch%02d.i16", stream - 1);
+    return tmp;
+}
+
+static bool write_unit(ConvFile_t* file, WorkUnit_t* unit)
+{
+    int streams = g_format == OUT_FORMAT_BINARY ? 1 : OUT_STREAMS;
+    for (int s = 0; s < streams; s++) {
+        ByteBuf_t* b = &unit->out[s];
+        bool header = (g_format == OUT_FORMAT_BINARY && s == 0 && !file->out[0]);
+        if (!file->out[s] && (b->len > 0 || header)) {
+            char path[600], tmp[16];
+            snprintf(path, sizeof(path), "%s%s", file->base, stream_suffix(s, tmp, sizeof(tmp)));
+            file->out[s] = fopen(path, "wb");
+            if (!file->out[s]) {
+                printf("[ERROR] Cannot create %s\n", path);
+                return false;
+            }
+            if (header && fwrite(BINARY_MAGIC, 1, 4, file->out[s]) != 4) {
+                return false;
+            }
+        }
+        if (b->len > 0 && fwrite(b->data, 1, b->len, file->out[s]) != b->len) {
+            printf("[ERROR] Write failed for %s\n", file->base);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void close_file_outputs(ConvFile_t* file)
+{
+    for (int s = 0; s < OUT_STREAMS; s++) {
+        if (file->out[s]) {
+            fclose(file->out[s]);
+            file->out[s] = NULL;
+        }
+    }
+}
+
+// Mark a chunk finished and write every chunk that is now next in order.
+// Only one thread commits a file at a time; others just mark and leave.
+static void commit_unit(WorkUnit_t* unit)
+{
+    ConvFile_t* file = unit->file;
+
+    pthread_mutex_lock(&file->lock);
+    unit->done = true;
+    if (file->committing) {
+        pthread_mutex_unlock(&file->lock);
+        return;
+    }
+    file->committing = true;
+
+    while (file->next_commit < file->chunk_count && file->units[file->next_commit].done) {
+        WorkUnit_t* next = &file->units[file->next_commit++];
+        bool failed = file->failed;
+        pthread_mutex_unlock(&file->lock);
+
+        if (!failed && !write_unit(file, next)) {
+            failed = true;
+        }
+        for (int s = 0; s < OUT_STREAMS; s++) {
+            buf_free(&next->out[s]);
+        }
+
+        pthread_mutex_lock(&file->lock);
+        file->failed = file->failed || failed;
+        if (file->next_commit == file->chunk_count) {
+            close_file_outputs(file);
+        }
+    }
+
+    file->committing = false;
+    pthread_mutex_unlock(&file->lock);
+}
+
+// ===================== Work-Stealing Scheduler =====================
+
+static bool deque_pop_front(WorkDeque_t* d, uint32_t* unitIndex)
+{
+    bool ok = false;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail) {
+        *unitIndex = d->items[d->head++];
+        ok = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static bool deque_steal_back(WorkDeque_t* d, uint32_t* unitIndex)
+{
+    bool ok = false;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail) {
+        *unitIndex = d->items[--d->tail];
+        ok = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+// No work is added after start-up, so a full sweep of empty deques means done
+static bool next_unit(Worker_t* w, uint32_t* unitIndex)
+{
+    if (deque_pop_front(&g_deques[w->id], unitIndex)) {
+        return true;
+    }
+    for (int i = 1; i < g_workerCount; i++) {
+        if (deque_steal_back(&g_deques[(w->id + i) % g_workerCount], unitIndex)) {
+            w->stolen++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void* worker_main(void* arg)
+{
+    Worker_t* w = (Worker_t*)arg;
+    uint32_t unitIndex;
+
+    while (next_unit(w, &unitIndex)) {
+        WorkUnit_t* unit = &g_units[unitIndex];
+        if (!convert_unit(w, unit)) {
+            printf("[ERROR] %s: chunk %u failed\n", unit->file->path, unit->index);
+            pthread_mutex_lock(&unit->file->lock);
+            unit->file->failed = true;
+            pthread_mutex_unlock(&unit->file->lock);
+        }
+        stats_add(&w->stats, &unit->stats);
+        commit_unit(unit);
+    }
+
+    free(w->readBuf);
+    w->readBuf = NULL;
+    return NULL;
+}
+
+// ===================== Job Setup =====================
+
+static bool plan_files(int fileCount, char** paths)
+{
+    g_files = (ConvFile_t*)calloc((size_t)fileCount, sizeof(ConvFile_t));
+    if (!g_files) {
+        return false;
+    }
+
+    uint64_t totalUnits = 0;
+    for (int i = 0; i < fileCount; i++) {
+        ConvFile_t* f = &g_files[g_fileCount];
+        FILE* fp = fopen(paths[i], "rb");
+        if (!fp) {
+            printf("[WARN] Cannot open %s, skipped\n", paths[i]);
+            continue;
+        }
+        conv_fseek(fp, 0, SEEK_END);
+        f->size = (int64_t)conv_ftell(fp);
+        fclose(fp);
+
+        f->path = paths[i];
+        make_output_base(paths[i], f->base, sizeof(f->base));
+        f->chunk_count = (uint32_t)((f->size + (int64_t)g_chunkBytes - 1) / (int64_t)g_chunkBytes);
+        if (f->chunk_count == 0) {
+            f->chunk_count = 1;
+        }
+        pthread_mutex_init(&f->lock, NULL);
+        totalUnits += f->chunk_count;
+        g_fileCount++;
+    }
+
+    g_units = (WorkUnit_t*)calloc((size_t)totalUnits, sizeof(WorkUnit_t));
+    if (!g_units && totalUnits > 0) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < g_fileCount; i++) {
+        ConvFile_t* f = &g_files[i];
+        f->units = &g_units[g_unitCount];
+        for (uint32_t c = 0; c < f->chunk_count; c++) {
+            WorkUnit_t* u = &g_units[g_unitCount++];
+            u->file = f;
+            u->index = c;
+            u->start = (int64_t)c * (int64_t)g_chunkBytes;
+            u->end = u->start + (int64_t)g_chunkBytes;
+            if (u->end > f->size) {
+                u->end = f->size;
+            }
+        }
+    }
+    return true;
+}
+
+// Round-robin deal: every worker's front holds the oldest chunks, which keeps
+// the ordered commit close behind the decoders
+static bool deal_units(void)
+{
+    for (int w = 0; w < g_workerCount; w++) {
+        WorkDeque_t* d = &g_deques[w];
+        pthread_mutex_init(&d->lock, NULL);
+        d->items = (uint32_t*)malloc(((size_t)g_unitCount / (size_t)g_workerCount + 1) * sizeof(uint32_t));
+        if (!d->items) {
+            return false;
+        }
+        d->head = d->tail = 0;
+    }
+    for (uint32_t i = 0; i < g_unitCount; i++) {
+        WorkDeque_t* d = &g_deques[i % (uint32_t)g_workerCount];
+        d->items[d->tail++] = i;
+    }
+    return true;
+}
+
+// ===================== Usage =====================
+
+static void print_usage(const char* progName)
+{
+    printf("Usage: %s [OPTIONS] FILE...\n", progName);
+    printf("\nConverts raw_frames_NNN.txt captures to binary or columnar sample files.\n");
+    printf("\nOptions:\n");
+    printf("  -f bin|col        Output format (default bin)\n");
+    printf("                      bin: <name>.bin, \"%s\" then u16 length + multi-rate payload per packet\n", BINARY_MAGIC);
+    printf("                      col: <name>.pkt index (%u-byte records) + <name>.chNN.i16 per channel\n",
+           (unsigned)sizeof(ColumnarIndex_t));
+    printf("  -o DIR            Output directory (default: next to each input)\n");
+    printf("  -j N              Worker threads (default: all cores, max %d)\n", MAX_WORKERS);
+    printf("  --chunk-mb N      Split inputs into N MB chunks (default %d)\n", DEFAULT_CHUNK_MB);
+    printf("  -q                Only print the summary\n");
+    printf("\nExamples:\n");
+    printf("  %s raw_frames_*.txt\n", progName);
+    printf("  %s -f col -o out -j 8 raw_frames_000.txt\n", progName);
+}
+
+// ===================== Main Function =====================
+
+int main(int argc, char* argv[])
+{
+    int threads = cpu_count();
+    int argi = 1;
+
+    for (; argi < argc && argv[argi][0] == '-'; argi++) {
+        const char* opt = argv[argi];
+        bool hasValue = argi + 1 < argc;
+        if (strcmp(opt, "-h") == 0 || strcmp(opt, "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(opt, "-f") == 0 && hasValue) {
+            const char* v = argv[++argi];
+            if (strcmp(v, "bin") == 0) {
+                g_format = OUT_FORMAT_BINARY;
+            } else if (strcmp(v, "col") == 0) {
+                g_format = OUT_FORMAT_COLUMNAR;
+            } else {
+                printf("Error: Unknown format '%s'.\n", v);
+                return 1;
+            }
+        } else if (strcmp(opt, "-o") == 0 && hasValue) {
+            g_outDir = argv[++argi];
+        } else if (strcmp(opt, "-j") == 0 && hasValue) {
+            threads = atoi(argv[++argi]);
+        } else if (strcmp(opt, "--chunk-mb") == 0 && hasValue) {
+            int mb = atoi(argv[++argi]);
+            g_chunkBytes = (size_t)(mb > 0 ? mb : 1) << 20;
+        } else if (strcmp(opt, "-q") == 0) {
+            g_quiet = true;
+        } else {
+            printf("Error: Invalid option '%s'.\n", opt);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argi >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_WORKERS) threads = MAX_WORKERS;
+
+    // Select the decoder before any worker can race on it
+    const char* hexImpl = hex_decode_impl();
+
+    if (!plan_files(argc - argi, argv + argi)) {
+        printf("Error: Out of memory.\n");
+        return 1;
+    }
+    if (g_unitCount == 0) {
+        printf("Error: No readable input files.\n");
+        return 1;
+    }
+    g_workerCount = (int)g_unitCount < threads ? (int)g_unitCount : threads;
+    if (!deal_units()) {
+        printf("Error: Out of memory.\n");
+        return 1;
+    }
+
+    int64_t totalBytes = 0;
+    for (uint32_t i = 0; i < g_fileCount; i++) {
+        totalBytes += g_files[i].size;
+    }
+    if (!g_quiet) {
+        printf("=== Frame Converter ===\n");
+        printf("Files: %u (%.1f MB), chunks: %u x %zu MB\n", g_fileCount,
+               (double)totalBytes / 1048576.0, g_unitCount, g_chunkBytes >> 20);
+        printf("Format: %s, workers: %d, hex decoder: %s\n",
+               g_format == OUT_FORMAT_BINARY ? "binary" : "columnar", g_workerCount, hexImpl);
+    }
+
+    double t0 = now_seconds();
+    for (int w = 0; w < g_workerCount; w++) {
+        g_workers[w].id = w;
+        if (pthread_create(&g_workers[w].thread, NULL, worker_main, &g_workers[w]) != 0) {
+            // Fewer workers is fine: the others steal what this one would have done
+            printf("[WARN] Could not start worker %d\n", w);
+            g_workers[w].id = -1;
+        }
+    }
+    for (int w = 0; w < g_workerCount; w++) {
+        if (g_workers[w].id >= 0) {
+            pthread_join(g_workers[w].thread, NULL);
+        }
+    }
+    double elapsed = now_seconds() - t0;
+
+    // A worker that never started leaves its deque behind; drain it here
+    Worker_t* mainWorker = &g_workers[0];
+    for (int w = 0; w < g_workerCount; w++) {
+        if (g_workers[w].id < 0) {
+            Worker_t drain = { .id = w };
+            worker_main(&drain);
+            stats_add(&mainWorker->stats, &drain.stats);
+        }
+    }
+
+    ConvStats_t total = {0};
+    uint32_t stolen = 0;
+    for (int w = 0; w < g_workerCount; w++) {
+        stats_add(&total, &g_workers[w].stats);
+        stolen += g_workers[w].stolen;
+    }
+
+    int failedFiles = 0;
+    for (uint32_t i = 0; i < g_fileCount; i++) {
+        if (g_files[i].failed) {
+            printf("[ERROR] %s: conversion incomplete\n", g_files[i].path);
+            failedFiles++;
+        } else if (!g_quiet) {
+            printf("[FILE] %s -> %s%s\n", g_files[i].path, g_files[i].base,
+                   g_format == OUT_FORMAT_BINARY ? ".bin" : ".pkt/.chNN.i16");
+        }
+    }
+
+    printf("\nLines: %llu (%llu malformed), bad frames: %llu\n",
+           (unsigned long long)total.lines, (unsigned long long)total.bad_lines,
+           (unsigned long long)total.bad_frames);
+    printf("Data packets: %llu (%llu malformed), other frames: %llu, samples: %llu\n",
+           (unsigned long long)total.data_packets, (unsigned long long)total.bad_packets,
+           (unsigned long long)total.other_frames, (unsigned long long)total.samples);
+    printf("Elapsed: %.3f s, %.1f MB/s input, %u chunks stolen\n", elapsed,
+           elapsed > 0 ? (double)totalBytes / 1048576.0 / elapsed : 0.0, stolen);
+
+    return failedFiles ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+// File: hex_decode.c
+// Description: Fast decoder for the " XX XX ..." byte lists in raw_frames_NNN.txt
+//              SSSE3 path decodes 16 bytes (48 characters) per step, scalar
+//              table lookup handles the tail and CPUs without SSSE3
+// Version: v2.0
+
+#include "hex_decode.h"
+
+#include <stdbool.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEX_DECODE_HAVE_SSSE3 1
+#include <tmmintrin.h>
+#else
+#define HEX_DECODE_HAVE_SSSE3 0
+#endif
+
+// ===================== Scalar Path =====================
+
+// 0-15 for hex digits, 0xFF otherwise
+static uint8_t g_nibble[256];
+static bool    g_tableReady = false;
+
+static void init_nibble_table(void)
+{
+    for (int i = 0; i < 256; i++) {
+        g_nibble[i] = 0xFF;
+    }
+    for (int i = 0; i < 10; i++) {
+        g_nibble['0' + i] = (uint8_t)i;
+    }
+    for (int i = 0; i < 6; i++) {
+        g_nibble['A' + i] = (uint8_t)(10 + i);
+        g_nibble['a' + i] = (uint8_t)(10 + i);
+    }
+    g_tableReady = true;
+}
+
+static int decode_scalar(const char* text, size_t count, uint8_t* out)
+{
+    const uint8_t* p = (const uint8_t*)text;
+    for (size_t i = 0; i < count; i++, p += 3) {
+        uint8_t hi = g_nibble[p[1]];
+        uint8_t lo = g_nibble[p[2]];
+        if (p[0] != ' ' || (hi | lo) > 0x0F) {
+            return -1;
+        }
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return 0;
+}
+
+// ===================== SSSE3 Path =====================
+
+#if HEX_DECODE_HAVE_SSSE3
+
+// Convert 16 characters to nibble values; *hexBits/*spaceBits get one bit per
+// lane that held a hex digit / a space
+__attribute__((target("ssse3")))
+static inline __m128i nibbles_ssse3(__m128i c, int* hexBits, int* spaceBits)
+{
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i five = _mm_set1_epi8(5);
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i d     = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i isDig = _mm_cmpeq_epi8(_mm_subs_epu8(d, nine), zero);
+    __m128i l     = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i isLet = _mm_cmpeq_epi8(_mm_subs_epu8(l, five), zero);
+
+    *hexBits   = _mm_movemask_epi8(_mm_or_si128(isDig, isLet));
+    *spaceBits = _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')));
+
+    return _mm_or_si128(_mm_and_si128(isDig, d),
+                        _mm_and_si128(isLet, _mm_add_epi8(l, _mm_set1_epi8(10))));
+}
+
+__attribute__((target("ssse3")))
+static int decode_ssse3(const char* text, size_t count, uint8_t* out)
+{
+    // Lanes of each 16-character block that must be spaces / hex digits
+    static const int kSpace[3] = { 0x9249, 0x4924, 0x2492 };
+    static const int kHex[3]   = { 0x6DB6, 0xB6DB, 0xDB6D };
+
+    const __m128i hi0 = _mm_setr_epi8( 1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i hi1 = _mm_setr_epi8(-1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1);
+    const __m128i hi2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14);
+    const __m128i lo0 = _mm_setr_epi8( 2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i lo1 = _mm_setr_epi8(-1, -1, -1, -1, -1,  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1);
+    const __m128i lo2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const char* p = text + i * 3;
+        int hexBits[3], spaceBits[3];
+        __m128i n0 = nibbles_ssse3(_mm_loadu_si128((const __m128i*)(p +  0)), &hexBits[0], &spaceBits[0]);
+        __m128i n1 = nibbles_ssse3(_mm_loadu_si128((const __m128i*)(p + 16)), &hexBits[1], &spaceBits[1]);
+        __m128i n2 = nibbles_ssse3(_mm_loadu_si128((const __m128i*)(p + 32)), &hexBits[2], &spaceBits[2]);
+
+        for (int b = 0; b < 3; b++) {
+            if ((hexBits[b] & kHex[b]) != kHex[b] || (spaceBits[b] & kSpace[b]) != kSpace[b]) {
+                return -1;
+            }
+        }
+
+        __m128i hi = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(n0, hi0), _mm_shuffle_epi8(n1, hi1)),
+                                  _mm_shuffle_epi8(n2, hi2));
+        __m128i lo = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(n0, lo0), _mm_shuffle_epi8(n1, lo1)),
+                                  _mm_shuffle_epi8(n2, lo2));
+        // Nibbles are <= 0x0F, so a 16-bit shift never carries across lanes
+        _mm_storeu_si128((__m128i*)(out + i), _mm_or_si128(_mm_slli_epi16(hi, 4), lo));
+    }
+
+    return decode_scalar(text + i * 3, count - i, out + i);
+}
+
+#endif // HEX_DECODE_HAVE_SSSE3
+
+// ===================== Dispatch =====================
+
+typedef int (*HexDecodeFn)(const char*, size_t, uint8_t*);
+
+static HexDecodeFn g_decode = NULL;
+static const char* g_implName = "scalar";
+
+static void select_impl(void)
+{
+    if (!g_tableReady) {
+        init_nibble_table();
+    }
+    g_decode = decode_scalar;
+    g_implName = "scalar";
+#if HEX_DECODE_HAVE_SSSE3
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        g_decode = decode_ssse3;
+        g_implName = "ssse3";
+    }
+#endif
+}
+
+int hex_decode_spaced(const char* text, size_t count, uint8_t* out)
+{
+    if (!g_decode) {
+        select_impl();
+    }
+    return g_decode(text, count, out);
+}
+
+const char* hex_decode_impl(void)
+{
+    if (!g_decode) {
+        select_impl();
+    }
+    return g_implName;
+}
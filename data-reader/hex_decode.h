@@ -0,0 +1,22 @@
+// File: hex_decode.h
+// Description: Fast decoder for the " XX XX ..." byte lists in raw_frames_NNN.txt
+// Version: v2.0
+
+#ifndef HEX_DECODE_H
+#define HEX_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Decode `count` bytes written as " XX" triples (the format flush_batch_to_file()
+// emits after "HEX:"). `text` must hold at least 3 * count characters.
+// Upper- and lower-case digits are accepted. Returns 0 on success, -1 if any
+// triple is malformed.
+int hex_decode_spaced(const char* text, size_t count, uint8_t* out);
+
+// Name of the implementation selected for this CPU ("ssse3" or "scalar").
+// Selection happens on first use; call this once before decoding from
+// several threads.
+const char* hex_decode_impl(void);
+
+#endif // HEX_DECODE_H
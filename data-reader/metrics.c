@@ -0,0 +1,422 @@
+// File: metrics.c
+// Description: Recorder metrics in Prometheus text format
+//              Each recording thread owns a shard of plain counters and updates
+//              them with relaxed stores only. A separate server thread answers
+//              GET /metrics by summing the shards, so a scrape never takes a lock
+//              or stalls the receive path.
+// Version: v2.0
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "metrics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET MetricsSock_t;
+#define METRICS_BAD_SOCK INVALID_SOCKET
+#define metrics_close_sock closesocket
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+typedef int MetricsSock_t;
+#define METRICS_BAD_SOCK (-1)
+#define metrics_close_sock close
+#endif
+
+// ===================== Global Variables =====================
+static MetricsShard_t g_shards[METRICS_MAX_SHARDS];
+static int g_shardCount = 0;
+static const char* (*g_cmdName)(uint8_t cmd) = NULL;
+
+static volatile int g_serverRunning = 0;
+static MetricsSock_t g_listenSock = METRICS_BAD_SOCK;
+#ifdef _WIN32
+static HANDLE g_serverThread = NULL;
+#else
+static pthread_t g_serverThread;
+#endif
+
+static const char* const g_stageNames[MET_STAGE_COUNT] = { "parse", "dispatch", "flush" };
+
+#define ACCEPT_RETRY_MS 100     // Back-off after a failed accept (EMFILE, ECONNABORTED, ...)
+
+// ===================== Recording =====================
+
+MetricsShard_t* metrics_shard(const char* thread)
+{
+    if (g_shardCount >= METRICS_MAX_SHARDS) {
+        return NULL;
+    }
+    MetricsShard_t* s = &g_shards[g_shardCount];
+    memset(s, 0, sizeof(*s));
+    s->thread = thread;
+    __atomic_store_n(&g_shardCount, g_shardCount + 1, __ATOMIC_RELEASE);
+    return s;
+}
+
+uint64_t metrics_now_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void metrics_observe(MetricsShard_t* shard, MetricsStage_t stage, uint64_t ns)
+{
+    // Bucket b holds durations up to 2^b microseconds
+    uint64_t us = (ns + 999) / 1000;
+    int b = 0;
+    if (us > 1) {
+        b = 64 - __builtin_clzll(us - 1);
+    }
+    if (b > METRICS_HIST_BUCKETS) {
+        b = METRICS_HIST_BUCKETS;
+    }
+    metrics_add(&shard->hist[stage][b], 1);
+    metrics_add(&shard->hist_sum_ns[stage], ns);
+}
+
+void metrics_set_command_names(const char* (*name_of)(uint8_t cmd))
+{
+    g_cmdName = name_of;
+}
+
+// ===================== Exposition =====================
+
+typedef struct {
+    char*  buf;
+    size_t len;
+    size_t cap;
+} OutBuf_t;
+
+static void out_printf(OutBuf_t* o, const char* fmt, ...)
+{
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = o->buf ? vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap) : -1;
+        va_end(ap);
+        if (n >= 0 && o->len + (size_t)n < o->cap) {
+            o->len += (size_t)n;
+            return;
+        }
+        size_t cap = o->cap ? o->cap * 2 : 16384;
+        char* p = (char*)realloc(o->buf, cap);
+        if (!p) {
+            return;
+        }
+        o->buf = p;
+        o->cap = cap;
+    }
+}
+
+static uint64_t load(const uint64_t* p)
+{
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+// Sum a counter field over all shards
+#define SUM_FIELD(field) sum_field(offsetof(MetricsShard_t, field))
+
+static uint64_t sum_field(size_t offset)
+{
+    uint64_t total = 0;
+    int n = __atomic_load_n(&g_shardCount, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        total += load((const uint64_t*)((const char*)&g_shards[i] + offset));
+    }
+    return total;
+}
+
+static void emit_scalar(OutBuf_t* o, const char* name, const char* type, const char* help, uint64_t value)
+{
+    out_printf(o, "# HELP %s %s\n# TYPE %s %s\n%s %llu\n", name, help, name, type, name, (unsigned long long)value);
+}
+
+static void emit_per_command(OutBuf_t* o, const char* name, const char* help, size_t base)
+{
+    int n = __atomic_load_n(&g_shardCount, __ATOMIC_ACQUIRE);
+    out_printf(o, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+    for (int cmd = 0; cmd < 256; cmd++) {
+        uint64_t v = 0;
+        for (int i = 0; i < n; i++) {
+            v += load((const uint64_t*)((const char*)&g_shards[i] + base) + cmd);
+        }
+        if (v == 0) {
+            continue;
+        }
+        const char* cname = g_cmdName ? g_cmdName((uint8_t)cmd) : "UNKNOWN";
+        out_printf(o, "%s{cmd=\"0x%02X\",name=\"%s\"} %llu\n", name, cmd, cname, (unsigned long long)v);
+    }
+}
+
+static void emit_histograms(OutBuf_t* o)
+{
+    const char* name = "datareader_stage_duration_seconds";
+    int n = __atomic_load_n(&g_shardCount, __ATOMIC_ACQUIRE);
+
+    out_printf(o, "# HELP %s Time spent per pipeline stage\n# TYPE %s histogram\n", name, name);
+    for (int st = 0; st < MET_STAGE_COUNT; st++) {
+        uint64_t cum = 0;
+        uint64_t sum_ns = 0;
+        for (int b = 0; b <= METRICS_HIST_BUCKETS; b++) {
+            for (int i = 0; i < n; i++) {
+                cum += load(&g_shards[i].hist[st][b]);
+            }
+            if (b < METRICS_HIST_BUCKETS) {
+                out_printf(o, "%s_bucket{stage=\"%s\",le=\"%.6f\"} %llu\n",
+                           name, g_stageNames[st], (double)(1ull << b) * 1e-6, (unsigned long long)cum);
+            } else {
+                out_printf(o, "%s_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n",
+                           name, g_stageNames[st], (unsigned long long)cum);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            sum_ns += load(&g_shards[i].hist_sum_ns[st]);
+        }
+        out_printf(o, "%s_sum{stage=\"%s\"} %.9f\n", name, g_stageNames[st], (double)sum_ns * 1e-9);
+        out_printf(o, "%s_count{stage=\"%s\"} %llu\n", name, g_stageNames[st], (unsigned long long)cum);
+    }
+}
+
+char* metrics_render(size_t* len)
+{
+    OutBuf_t o = { NULL, 0, 0 };
+    int n = __atomic_load_n(&g_shardCount, __ATOMIC_ACQUIRE);
+
+    emit_per_command(&o, "datareader_frames_total", "Frames received per command",
+                     offsetof(MetricsShard_t, frames));
+    emit_per_command(&o, "datareader_frame_bytes_total", "Frame bytes received per command",
+                     offsetof(MetricsShard_t, frame_bytes));
+
+    emit_scalar(&o, "datareader_rx_bytes_total", "counter", "Bytes read from the link", SUM_FIELD(rx_bytes));
+    emit_scalar(&o, "datareader_parse_errors_total", "counter", "Frames rejected by the parser with a valid CRC",
+                SUM_FIELD(parse_errors));
+    emit_scalar(&o, "datareader_crc_failures_total", "counter", "Frames rejected for a CRC mismatch",
+                SUM_FIELD(crc_failures));
+    emit_scalar(&o, "datareader_seq_gaps_total", "counter", "Discontinuities in the device sequence number",
+                SUM_FIELD(seq_gaps));
+    emit_scalar(&o, "datareader_seq_lost_frames_total", "counter", "Frames missing across sequence gaps",
+                SUM_FIELD(seq_lost));
+    emit_scalar(&o, "datareader_bad_data_packets_total", "counter", "Data packets with an inconsistent length",
+                SUM_FIELD(bad_data_packets));
+
+    emit_scalar(&o, "datareader_frames_written_total", "counter", "Frames written to capture files",
+                SUM_FIELD(frames_written));
+    emit_scalar(&o, "datareader_written_bytes_total", "counter", "Bytes written to capture files",
+                SUM_FIELD(bytes_written));
+    emit_scalar(&o, "datareader_file_rotations_total", "counter", "Capture files opened",
+                SUM_FIELD(file_rotations));
+    emit_scalar(&o, "datareader_write_failures_total", "counter", "Frames dropped with no capture file open",
+                SUM_FIELD(write_failures));
+
+    // Queue depth and writer lag are read from the gauges at scrape time
+    uint64_t now = metrics_now_ns();
+    uint64_t oldest = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t since = load(&g_shards[i].pending_since_ns);
+        if (since && since < now && now - since > oldest) {
+            oldest = now - since;
+        }
+    }
+    emit_scalar(&o, "datareader_flow_pauses_total", "counter", "Device pauses requested by flow control",
+                SUM_FIELD(flow_pauses));
+    emit_scalar(&o, "datareader_flow_paused", "gauge", "Device currently paused by flow control",
+                SUM_FIELD(flow_paused));
+    emit_scalar(&o, "datareader_rx_queue_bytes", "gauge", "Unread bytes in the link input queue",
+                SUM_FIELD(rx_queue_bytes));
+    emit_scalar(&o, "datareader_write_queue_frames", "gauge", "Frames waiting in the write batch",
+                SUM_FIELD(pending_frames));
+    out_printf(&o, "# HELP datareader_writer_lag_seconds Age of the oldest frame not yet written\n"
+                   "# TYPE datareader_writer_lag_seconds gauge\ndatareader_writer_lag_seconds %.6f\n",
+               (double)oldest * 1e-9);
+
+    emit_histograms(&o);
+
+    if (len) {
+        *len = o.buf ? o.len : 0;
+    }
+    return o.buf;
+}
+
+// ===================== HTTP Server =====================
+
+static void send_all(MetricsSock_t s, const char* data, size_t len)
+{
+    while (len > 0) {
+        int n = send(s, data, (int)(len > 65536 ? 65536 : len), 0);
+        if (n <= 0) {
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void serve_client(MetricsSock_t c)
+{
+    char req[1024];
+    int got = 0;
+
+    // Only the request line matters; stop at the end of the headers
+    while (got < (int)sizeof(req) - 1) {
+        int n = recv(c, req + got, (int)sizeof(req) - 1 - got, 0);
+        if (n <= 0) {
+            break;
+        }
+        got += n;
+        req[got] = '\0';
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) {
+            break;
+        }
+    }
+    req[got] = '\0';
+
+    char head[256];
+    if (strncmp(req, "GET /metrics", 12) == 0 || strncmp(req, "GET / ", 6) == 0) {
+        size_t len = 0;
+        char* body = metrics_render(&len);
+        int hn = snprintf(head, sizeof(head),
+                          "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                          "Content-Length: %lu\r\n"
+                          "Connection: close\r\n\r\n", (unsigned long)len);
+        send_all(c, head, (size_t)hn);
+        if (body) {
+            send_all(c, body, len);
+            free(body);
+        }
+    } else {
+        const char* msg = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        send_all(c, msg, strlen(msg));
+    }
+    metrics_close_sock(c);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI server_thread(LPVOID arg)
+#else
+static void* server_thread(void* arg)
+#endif
+{
+    (void)arg;
+    while (g_serverRunning) {
+        MetricsSock_t c = accept(g_listenSock, NULL, NULL);
+        if (c == METRICS_BAD_SOCK) {
+            // metrics_stop closes the listen socket; otherwise the error may
+            // persist (out of descriptors), so back off instead of spinning
+            if (!g_serverRunning) {
+                break;
+            }
+#ifdef _WIN32
+            Sleep(ACCEPT_RETRY_MS);
+#else
+            struct timespec ts = { 0, ACCEPT_RETRY_MS * 1000000L };
+            nanosleep(&ts, NULL);
+#endif
+            continue;
+        }
+#ifdef _WIN32
+        DWORD tmo = 2000;
+        setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tmo, sizeof(tmo));
+#else
+        struct timeval tmo = { 2, 0 };
+        setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, &tmo, sizeof(tmo));
+#endif
+        serve_client(c);
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int metrics_start(const char* host, uint16_t port)
+{
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        return -1;
+    }
+#endif
+
+    MetricsSock_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == METRICS_BAD_SOCK) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(host ? host : "127.0.0.1");
+
+    if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 4) != 0) {
+        metrics_close_sock(s);
+        return -1;
+    }
+
+    g_listenSock = s;
+    g_serverRunning = 1;
+#ifdef _WIN32
+    g_serverThread = CreateThread(NULL, 0, server_thread, NULL, 0, NULL);
+    if (!g_serverThread) {
+#else
+    if (pthread_create(&g_serverThread, NULL, server_thread, NULL) != 0) {
+#endif
+        g_serverRunning = 0;
+        metrics_close_sock(s);
+        g_listenSock = METRICS_BAD_SOCK;
+        return -1;
+    }
+    return 0;
+}
+
+void metrics_stop(void)
+{
+    if (!g_serverRunning) {
+        return;
+    }
+    g_serverRunning = 0;
+
+    // Closing the listener unblocks accept()
+#ifdef _WIN32
+    closesocket(g_listenSock);
+    WaitForSingleObject(g_serverThread, 3000);
+    CloseHandle(g_serverThread);
+    g_serverThread = NULL;
+    WSACleanup();
+#else
+    shutdown(g_listenSock, SHUT_RDWR);
+    close(g_listenSock);
+    pthread_join(g_serverThread, NULL);
+#endif
+    g_listenSock = METRICS_BAD_SOCK;
+}
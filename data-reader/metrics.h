@@ -0,0 +1,87 @@
+// File: metrics.h
+// Description: Recorder counters and stage latency histograms, served in
+//              Prometheus text format on a local HTTP port
+// Version: v2.0
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ===================== Configuration =====================
+#define METRICS_DEFAULT_PORT    9101
+#define METRICS_MAX_SHARDS      4       // One per recording thread
+#define METRICS_HIST_BUCKETS    24      // Upper bounds 1us, 2us, ... 2^23us (~8.4s), then +Inf
+
+typedef enum {
+    MET_STAGE_PARSE,            // Frame extraction over one read buffer
+    MET_STAGE_DISPATCH,         // Decode and handle one frame
+    MET_STAGE_FLUSH,            // Write one frame batch to the capture file
+    MET_STAGE_COUNT
+} MetricsStage_t;
+
+// ===================== Data Structures =====================
+
+// Counters of one thread. Only the owning thread writes its shard (plain
+// relaxed load/store, no locked instructions); the scrape thread only reads.
+typedef struct {
+    const char* thread;
+
+    uint64_t frames[256];               // Per command id
+    uint64_t frame_bytes[256];
+    uint64_t rx_bytes;
+    uint64_t parse_errors;              // Frames parseFrame rejected, CRC intact
+    uint64_t crc_failures;
+    uint64_t seq_gaps;                  // Device seq jumps
+    uint64_t seq_lost;                  // Frames missing across those jumps
+    uint64_t bad_data_packets;          // Data packets whose length does not match their header
+
+    uint64_t frames_written;
+    uint64_t bytes_written;
+    uint64_t file_rotations;
+    uint64_t write_failures;            // Frames dropped because no capture file was open
+
+    uint64_t flow_pauses;               // PAUSE_STREAM sent at the high watermark
+
+    uint64_t rx_queue_bytes;            // Gauge: unread bytes in the link input queue
+    uint64_t flow_paused;               // Gauge: 1 while the device is paused
+    uint64_t pending_frames;            // Gauge: frames waiting in the write batch
+    uint64_t pending_since_ns;          // Gauge: metrics_now_ns() of the oldest, 0 = none
+
+    uint64_t hist[MET_STAGE_COUNT][METRICS_HIST_BUCKETS + 1];
+    uint64_t hist_sum_ns[MET_STAGE_COUNT];
+} MetricsShard_t;
+
+// ===================== Hot-Path Helpers =====================
+
+static inline void metrics_add(uint64_t* counter, uint64_t n)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_set(uint64_t* gauge, uint64_t value)
+{
+    __atomic_store_n(gauge, value, __ATOMIC_RELAXED);
+}
+
+// ===================== Function Declarations =====================
+
+// Shard for the calling thread (call once per thread, before metrics_start)
+MetricsShard_t* metrics_shard(const char* thread);
+
+uint64_t metrics_now_ns(void);
+void metrics_observe(MetricsShard_t* shard, MetricsStage_t stage, uint64_t ns);
+
+// Label values for the command id on per-command series
+void metrics_set_command_names(const char* (*name_of)(uint8_t cmd));
+
+// Serve GET /metrics on host:port from a background thread. Returns 0 or -1.
+int  metrics_start(const char* host, uint16_t port);
+void metrics_stop(void);
+
+// Render the exposition into a malloc'd string (caller frees)
+char* metrics_render(size_t* len);
+
+#endif // METRICS_H
@@ -0,0 +1,240 @@
+// File: nilm_detector.c
+// Description: Appliance switching-event detector on per-cycle power features (NILM)
+//              A two-sided CUSUM on real power runs against a slowly tracked
+//              baseline. On alarm the change point is where the alarming sum last
+//              left zero; once the transient has settled, the pre and post windows
+//              around it are averaged and the step is confirmed with a Gaussian
+//              GLR statistic before the event is reported. All state lives in a
+//              fixed ring of per-cycle feature vectors.
+// Version: v2.0
+
+#include "nilm_detector.h"
+
+#include <math.h>
+#include <string.h>
+
+// ===================== Setup =====================
+
+void nilm_default_config(NilmConfig_t* cfg)
+{
+    cfg->pre_cycles = NILM_DEFAULT_PRE;
+    cfg->settle_cycles = NILM_DEFAULT_SETTLE;
+    cfg->post_cycles = NILM_DEFAULT_POST;
+    cfg->min_step = NILM_DEFAULT_MIN_STEP;
+    cfg->cusum_h = NILM_DEFAULT_CUSUM_H;
+}
+
+void nilm_init(NilmDetector_t* det, const NilmConfig_t* cfg, NilmEventCallback on_event, void* user)
+{
+    memset(det, 0, sizeof(*det));
+    if (cfg) {
+        det->cfg = *cfg;
+    } else {
+        nilm_default_config(&det->cfg);
+    }
+
+    // Windows must fit the ring with room left for the alarm delay
+    if (det->cfg.pre_cycles < 4) {
+        det->cfg.pre_cycles = 4;
+    }
+    if (det->cfg.post_cycles < 4) {
+        det->cfg.post_cycles = 4;
+    }
+    while (det->cfg.pre_cycles + det->cfg.settle_cycles + det->cfg.post_cycles > NILM_RING_CYCLES / 2) {
+        det->cfg.pre_cycles /= 2;
+        det->cfg.post_cycles /= 2;
+        det->cfg.settle_cycles /= 2;
+    }
+    if (det->cfg.cusum_h <= 0.0f) {
+        det->cfg.cusum_h = NILM_DEFAULT_CUSUM_H;
+    }
+
+    det->on_event = on_event;
+    det->user = user;
+    nilm_reset(det);
+}
+
+void nilm_reset(NilmDetector_t* det)
+{
+    det->count = 0;
+    det->state = NILM_LEARN;
+    det->base_p = 0.0;
+    det->base_var = 0.0;
+    det->base_s = 0.0;
+    det->g_up = 0.0;
+    det->g_down = 0.0;
+    det->up_start = 0;
+    det->down_start = 0;
+}
+
+// ===================== Windows =====================
+
+// Mean feature vector and variance of P over cycles [from, to)
+static void window_stats(const NilmDetector_t* det, uint64_t from, uint64_t to, float* mean, double* var_p)
+{
+    double sum[NILM_FEATURES] = { 0 };
+    double sum2 = 0.0;
+    uint64_t n = to - from;
+
+    for (uint64_t c = from; c < to; c++) {
+        const float* f = det->ring[c % NILM_RING_CYCLES];
+        for (int k = 0; k < NILM_FEATURES; k++) {
+            sum[k] += f[k];
+        }
+        sum2 += (double)f[NILM_F_P] * f[NILM_F_P];
+    }
+    for (int k = 0; k < NILM_FEATURES; k++) {
+        mean[k] = (float)(sum[k] / n);
+    }
+    double m = sum[NILM_F_P] / n;
+    double v = sum2 / n - m * m;
+    *var_p = v > 0.0 ? v : 0.0;
+}
+
+// Apparent power of the fundamental, used to scale min_step
+static double feature_scale(const float* f)
+{
+    return sqrt((double)f[NILM_F_P] * f[NILM_F_P] + (double)f[NILM_F_Q] * f[NILM_F_Q]);
+}
+
+// CUSUM drift: half the smallest step of interest, but above the noise
+static double cusum_drift(const NilmDetector_t* det)
+{
+    double k = 0.5 * det->cfg.min_step * det->base_s;
+    double noise = 2.0 * sqrt(det->base_var);
+    if (k < noise) {
+        k = noise;
+    }
+    double floor = 1e-6 + 1e-4 * fabs(det->base_p);
+    return k > floor ? k : floor;
+}
+
+static void set_baseline(NilmDetector_t* det, const float* mean, double var_p)
+{
+    det->base_p = mean[NILM_F_P];
+    det->base_var = var_p;
+    det->base_s = feature_scale(mean);
+    det->g_up = 0.0;
+    det->g_down = 0.0;
+    det->up_start = det->count;
+    det->down_start = det->count;
+    det->state = NILM_STEADY;
+}
+
+// ===================== Event Confirmation =====================
+
+static void settle_event(NilmDetector_t* det)
+{
+    const NilmConfig_t* cfg = &det->cfg;
+    uint64_t change = det->change;
+    uint64_t oldest = det->count > NILM_RING_CYCLES ? det->count - NILM_RING_CYCLES : 0;
+    uint64_t pre_from = change >= oldest + cfg->pre_cycles ? change - cfg->pre_cycles : oldest;
+    uint64_t post_from = change + cfg->settle_cycles;
+
+    NilmEvent_t ev;
+    double var_pre, var_post;
+    memset(&ev, 0, sizeof(ev));
+    window_stats(det, pre_from, change, ev.pre, &var_pre);
+    window_stats(det, post_from, post_from + cfg->post_cycles, ev.post, &var_post);
+
+    double n1 = (double)(change - pre_from);
+    double n2 = (double)cfg->post_cycles;
+    double dp = (double)ev.post[NILM_F_P] - ev.pre[NILM_F_P];
+    double var = (var_pre * n1 + var_post * n2) / (n1 + n2);
+    double scale_pre = feature_scale(ev.pre), scale_post = feature_scale(ev.post);
+    double scale = scale_pre > scale_post ? scale_pre : scale_post;
+
+    // Transients that returned to the old level, or steps lost in the noise
+    bool real = fabs(dp) >= cfg->min_step * scale && dp * dp > 16.0 * var && fabs(dp) > 1e-6;
+
+    if (real) {
+        if (var < 1e-12) {
+            var = 1e-12;
+        }
+        ev.id = det->events++;
+        ev.cycle = change;
+        ev.start_sample = det->ring_start[change % NILM_RING_CYCLES];
+        ev.timestamp = det->ring_ts[change % NILM_RING_CYCLES];
+        ev.direction = dp > 0.0 ? 1 : -1;
+        ev.alarm_delay = det->alarm_delay;
+        ev.llr = (float)(n1 * n2 / (n1 + n2) * dp * dp / (2.0 * var));
+        if (det->on_event) {
+            det->on_event(&ev, det->user);
+        }
+    } else {
+        det->discarded++;
+    }
+
+    set_baseline(det, ev.post, var_post);
+}
+
+// ===================== Streaming =====================
+
+void nilm_process(NilmDetector_t* det, const PqCycle_t* cycle)
+{
+    const NilmConfig_t* cfg = &det->cfg;
+    uint64_t idx = det->count;
+    float* f = det->ring[idx % NILM_RING_CYCLES];
+
+    f[NILM_F_P] = cycle->p;
+    f[NILM_F_Q] = cycle->q;
+    f[NILM_F_IRMS] = cycle->i_rms;
+    f[NILM_F_ITHD] = cycle->i_thd_pct;
+    det->ring_start[idx % NILM_RING_CYCLES] = cycle->end_sample + 1 - cycle->samples;
+    det->ring_ts[idx % NILM_RING_CYCLES] = cycle->timestamp;
+    det->count++;
+
+    switch (det->state) {
+    case NILM_LEARN:
+        if (det->count >= cfg->pre_cycles) {
+            float mean[NILM_FEATURES];
+            double var_p;
+            window_stats(det, det->count - cfg->pre_cycles, det->count, mean, &var_p);
+            set_baseline(det, mean, var_p);
+        }
+        break;
+
+    case NILM_STEADY: {
+        double k = cusum_drift(det);
+        double h = cfg->cusum_h * k;
+        double x = (double)cycle->p - det->base_p;
+
+        det->g_up = det->g_up + x - k;
+        if (det->g_up <= 0.0) {
+            det->g_up = 0.0;
+            det->up_start = idx + 1;
+        }
+        det->g_down = det->g_down - x - k;
+        if (det->g_down <= 0.0) {
+            det->g_down = 0.0;
+            det->down_start = idx + 1;
+        }
+
+        if (det->g_up > h || det->g_down > h) {
+            uint64_t change = det->g_up > h ? det->up_start : det->down_start;
+            // Keep pre, settle and post windows inside the ring
+            uint64_t reach = NILM_RING_CYCLES - cfg->pre_cycles - cfg->settle_cycles - cfg->post_cycles;
+            if (idx - change > reach) {
+                change = idx - reach;
+            }
+            det->change = change;
+            det->alarm_delay = (uint16_t)(idx - change);
+            det->state = NILM_POST;
+        } else if (det->g_up == 0.0 && det->g_down == 0.0) {
+            // Quiet: let the baseline follow slow drift
+            double a = 1.0 / cfg->pre_cycles;
+            double d = x;
+            det->base_p += a * d;
+            det->base_var = (1.0 - a) * (det->base_var + a * d * d);
+            det->base_s += a * (sqrt((double)cycle->p * cycle->p + (double)cycle->q * cycle->q) - det->base_s);
+        }
+        break;
+    }
+
+    case NILM_POST:
+        if (det->count >= det->change + cfg->settle_cycles + cfg->post_cycles) {
+            settle_event(det);
+        }
+        break;
+    }
+}
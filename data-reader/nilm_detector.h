@@ -0,0 +1,93 @@
+// File: nilm_detector.h
+// Description: Appliance switching-event detector on per-cycle power features (NILM)
+// Version: v2.0
+
+#ifndef NILM_DETECTOR_H
+#define NILM_DETECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "power_quality.h"
+
+// ===================== Configuration =====================
+#define NILM_RING_CYCLES        256     // Feature history kept; bounds pre+settle+post+alarm delay
+#define NILM_DEFAULT_PRE        32      // Steady cycles averaged before the change
+#define NILM_DEFAULT_SETTLE     10      // Transient cycles skipped after the change
+#define NILM_DEFAULT_POST       32      // Steady cycles averaged after the transient
+#define NILM_DEFAULT_MIN_STEP   0.02f   // Smallest |dP| reported, fraction of baseline apparent power
+#define NILM_DEFAULT_CUSUM_H    4.0f    // Alarm threshold in units of the CUSUM drift k
+
+// Feature vector per cycle
+enum {
+    NILM_F_P = 0,               // Real power
+    NILM_F_Q,                   // Fundamental reactive power
+    NILM_F_IRMS,
+    NILM_F_ITHD,                // Current THD %
+    NILM_FEATURES
+};
+
+// ===================== Data Structures =====================
+
+typedef struct {
+    uint64_t id;
+    uint64_t cycle;             // First cycle after the change point
+    uint64_t start_sample;      // Absolute sample index where that cycle starts
+    uint32_t timestamp;         // Device timestamp of that cycle
+    int8_t   direction;         // +1 switch-on (P rose), -1 switch-off
+    uint16_t alarm_delay;       // Cycles from change point to CUSUM alarm
+    float    llr;               // GLR statistic of the P step (pre vs post means)
+    float    pre[NILM_FEATURES];
+    float    post[NILM_FEATURES];
+} NilmEvent_t;
+
+typedef void (*NilmEventCallback)(const NilmEvent_t* event, void* user);
+
+typedef enum {
+    NILM_LEARN,                 // Collecting the first baseline
+    NILM_STEADY,                // CUSUM running against the baseline
+    NILM_POST                   // Alarm raised, waiting for the post window
+} NilmState_t;
+
+typedef struct {
+    uint16_t pre_cycles;
+    uint16_t settle_cycles;
+    uint16_t post_cycles;
+    float    min_step;          // Fraction of baseline S
+    float    cusum_h;
+} NilmConfig_t;
+
+typedef struct {
+    NilmConfig_t      cfg;
+    NilmEventCallback on_event;
+    void*             user;
+
+    // Feature ring, indexed by the detector's own cycle count
+    float             ring[NILM_RING_CYCLES][NILM_FEATURES];
+    uint64_t          ring_start[NILM_RING_CYCLES];     // start_sample of each cycle
+    uint32_t          ring_ts[NILM_RING_CYCLES];
+    uint64_t          count;                            // Cycles pushed
+
+    NilmState_t       state;
+    double            base_p;       // Baseline mean / variance of P
+    double            base_var;
+    double            base_s;       // Baseline apparent power (for min_step)
+    double            g_up, g_down; // Two-sided CUSUM sums
+    uint64_t          up_start, down_start;             // Cycle after each sum last left zero
+    uint64_t          change;       // Estimated change point (cycle index)
+    uint16_t          alarm_delay;
+
+    uint64_t          events;
+    uint64_t          discarded;    // Alarms whose settled step was below min_step
+} NilmDetector_t;
+
+// ===================== Function Declarations =====================
+
+void nilm_default_config(NilmConfig_t* cfg);
+void nilm_init(NilmDetector_t* det, const NilmConfig_t* cfg, NilmEventCallback on_event, void* user);
+void nilm_reset(NilmDetector_t* det);
+
+// Feed one cycle of power-quality metrics; on_event runs when an event settles
+void nilm_process(NilmDetector_t* det, const PqCycle_t* cycle);
+
+#endif // NILM_DETECTOR_H
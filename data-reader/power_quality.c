@@ -0,0 +1,182 @@
+// File: power_quality.c
+// Description: Streaming per-cycle power-quality metrics from a voltage/current channel pair
+//              Cycles run between rising voltage zero crossings (with hysteresis,
+//              crossing instants interpolated between samples). At each cycle end the
+//              buffered samples give RMS and real power directly, and a Goertzel pass
+//              per harmonic over exactly that cycle gives the harmonic phasors for THD
+//              and fundamental reactive power.
+// Version: v2.0
+
+#include "power_quality.h"
+
+#include <math.h>
+#include <string.h>
+
+#define PQ_TWO_PI   6.283185307179586
+
+// ===================== Setup =====================
+
+void pq_init(PqEngine_t* pq, uint32_t sample_rate_hz, PqCycleCallback on_cycle, void* user)
+{
+    memset(pq, 0, sizeof(*pq));
+    pq->sample_rate_hz = sample_rate_hz;
+    pq->harmonics = PQ_DEFAULT_HARMONICS;
+    pq->v_scale = 1.0f;
+    pq->i_scale = 1.0f;
+    pq->on_cycle = on_cycle;
+    pq->user = user;
+    pq_reset(pq);
+}
+
+void pq_reset(PqEngine_t* pq)
+{
+    pq->have_prev = false;
+    pq->armed = false;
+    pq->hysteresis = PQ_MIN_HYSTERESIS;
+    pq->peak = 0;
+    pq->last_crossing = -1.0;
+    pq->n = 0;
+    pq->cycles = 0;
+}
+
+void pq_set_rate(PqEngine_t* pq, uint32_t sample_rate_hz)
+{
+    if (pq->sample_rate_hz != sample_rate_hz) {
+        pq->sample_rate_hz = sample_rate_hz;
+        pq_reset(pq);
+    }
+}
+
+// ===================== Cycle Evaluation =====================
+
+// Goertzel at bin h of an n-sample block. Returns the DFT value up to a phase
+// factor that depends only on (h, n), so products of two channels' results
+// at the same bin keep their true relative phase.
+static void goertzel(const float* x, uint32_t n, uint32_t h, double* re, double* im)
+{
+    double w = PQ_TWO_PI * (double)h / (double)n;
+    double c = 2.0 * cos(w);
+    double s1 = 0.0, s2 = 0.0;
+    for (uint32_t k = 0; k < n; k++) {
+        double s0 = x[k] + c * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    *re = s1 - cos(w) * s2;
+    *im = sin(w) * s2;
+}
+
+static void finish_cycle(PqEngine_t* pq, uint32_t n, double period, uint64_t end_sample, uint32_t timestamp)
+{
+    double freq = (double)pq->sample_rate_hz / period;
+    if (n < 8 || freq < PQ_MIN_FREQ_HZ || freq > PQ_MAX_FREQ_HZ) {
+        pq->rejected++;
+        return;
+    }
+
+    double v2 = 0.0, i2 = 0.0, vi = 0.0;
+    for (uint32_t k = 0; k < n; k++) {
+        double v = pq->v_buf[k], i = pq->i_buf[k];
+        v2 += v * v;
+        i2 += i * i;
+        vi += v * i;
+    }
+
+    // Harmonic rms amplitudes: |X_h| * sqrt(2) / n
+    const double amp = sqrt(2.0) / (double)n;
+    double v1r = 0, v1i = 0, i1r = 0, i1i = 0;
+    double vh2 = 0.0, ih2 = 0.0;
+    for (uint32_t h = 1; h <= pq->harmonics && 2 * h < n; h++) {
+        double vr, vim, ir, iim;
+        goertzel(pq->v_buf, n, h, &vr, &vim);
+        goertzel(pq->i_buf, n, h, &ir, &iim);
+        if (h == 1) {
+            v1r = vr * amp; v1i = vim * amp;
+            i1r = ir * amp; i1i = iim * amp;
+        } else {
+            vh2 += (vr * vr + vim * vim) * amp * amp;
+            ih2 += (ir * ir + iim * iim) * amp * amp;
+        }
+    }
+
+    const double vs = pq->v_scale, is = pq->i_scale;
+    PqCycle_t* c = &pq->last;
+    c->cycle = pq->cycles++;
+    c->end_sample = end_sample;
+    c->timestamp = timestamp;
+    c->samples = (uint16_t)n;
+    c->freq_hz = (float)freq;
+    c->v_rms = (float)(sqrt(v2 / n) * vs);
+    c->i_rms = (float)(sqrt(i2 / n) * is);
+    c->p = (float)(vi / n * vs * is);
+    c->s = c->v_rms * c->i_rms;
+    c->pf = c->s > 0.0f ? c->p / c->s : 0.0f;
+    // Im(V1 * conj(I1)): positive when the current lags the voltage
+    c->q = (float)((v1i * i1r - v1r * i1i) * vs * is);
+
+    double v1 = sqrt(v1r * v1r + v1i * v1i), i1 = sqrt(i1r * i1r + i1i * i1i);
+    c->v_h1_rms = (float)(v1 * vs);
+    c->i_h1_rms = (float)(i1 * is);
+    c->v_thd_pct = v1 > 0.0 ? (float)(100.0 * sqrt(vh2) / v1) : 0.0f;
+    c->i_thd_pct = i1 > 0.0 ? (float)(100.0 * sqrt(ih2) / i1) : 0.0f;
+
+    if (pq->on_cycle) {
+        pq->on_cycle(c, pq->user);
+    }
+}
+
+// ===================== Streaming =====================
+
+void pq_process(PqEngine_t* pq, const int16_t* v, const int16_t* i, uint16_t count, uint32_t timestamp)
+{
+    if (pq->sample_rate_hz == 0) {
+        return;
+    }
+
+    for (uint16_t s = 0; s < count; s++) {
+        int16_t vs = v[s];
+        int32_t mag = vs < 0 ? -(int32_t)vs : vs;
+
+        if (pq->n == PQ_MAX_CYCLE_SAMPLES) {
+            // No crossing for far too long (signal lost): start over
+            pq->rejected++;
+            pq->n = 0;
+            pq->last_crossing = -1.0;
+            pq->peak = 0;
+            pq->hysteresis = PQ_MIN_HYSTERESIS;
+        }
+        pq->v_buf[pq->n] = (float)vs;
+        pq->i_buf[pq->n] = (float)i[s];
+        pq->n++;
+
+        if (mag > pq->peak) {
+            pq->peak = mag;
+        }
+        if (vs < -pq->hysteresis) {
+            pq->armed = true;
+        }
+
+        if (pq->armed && pq->have_prev && pq->prev_v < 0 && vs >= 0) {
+            // Crossing between the previous sample and this one
+            double frac = (double)pq->prev_v / ((double)pq->prev_v - (double)vs);
+            double pos = (double)(pq->sample_index - 1) + frac;
+
+            if (pq->last_crossing >= 0.0) {
+                // This sample opens the next cycle
+                finish_cycle(pq, pq->n - 1, pos - pq->last_crossing, pq->sample_index - 1, timestamp);
+            }
+            pq->last_crossing = pos;
+
+            pq->v_buf[0] = (float)vs;
+            pq->i_buf[0] = (float)i[s];
+            pq->n = 1;
+            pq->armed = false;
+            pq->hysteresis = pq->peak / 10 > PQ_MIN_HYSTERESIS ? pq->peak / 10 : PQ_MIN_HYSTERESIS;
+            pq->peak = mag;
+        }
+
+        pq->prev_v = vs;
+        pq->have_prev = true;
+        pq->sample_index++;
+    }
+}
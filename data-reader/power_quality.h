@@ -0,0 +1,83 @@
+// File: power_quality.h
+// Description: Streaming per-cycle power-quality metrics from a voltage/current channel pair
+// Version: v2.0
+
+#ifndef POWER_QUALITY_H
+#define POWER_QUALITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===================== Configuration =====================
+#define PQ_MAX_CYCLE_SAMPLES    4096    // Longest cycle buffered (45 Hz at ~180 kHz)
+#define PQ_MAX_HARMONICS        40
+#define PQ_DEFAULT_HARMONICS    13      // THD over harmonics 2..13
+#define PQ_MIN_FREQ_HZ          40.0
+#define PQ_MAX_FREQ_HZ          70.0
+#define PQ_MIN_HYSTERESIS       8       // Counts; zero-crossing re-arm threshold floor
+
+// ===================== Data Structures =====================
+
+// Metrics of one mains cycle (rising voltage zero crossing to the next).
+// Values are in counts times the engine's scale factors.
+typedef struct {
+    uint64_t cycle;             // Cycles reported since pq_init/pq_reset
+    uint64_t end_sample;        // Absolute index of the cycle's last sample
+    uint32_t timestamp;         // Device timestamp of the packet the cycle ended in
+    uint16_t samples;           // Samples in the cycle
+    float    freq_hz;           // From interpolated zero crossings
+    float    v_rms;
+    float    i_rms;
+    float    p;                 // Real power, mean of v*i
+    float    q;                 // Fundamental reactive power, > 0 when current lags
+    float    s;                 // Apparent power, v_rms * i_rms
+    float    pf;                // p / s
+    float    v_thd_pct;
+    float    i_thd_pct;
+    float    v_h1_rms;          // Fundamental components
+    float    i_h1_rms;
+} PqCycle_t;
+
+typedef void (*PqCycleCallback)(const PqCycle_t* cycle, void* user);
+
+typedef struct {
+    uint32_t        sample_rate_hz;
+    uint8_t         harmonics;
+    float           v_scale;            // Units per count
+    float           i_scale;
+    PqCycleCallback on_cycle;
+    void*           user;
+
+    // Zero-crossing detector on the voltage channel
+    uint64_t        sample_index;       // Absolute index of the next sample
+    int16_t         prev_v;
+    bool            have_prev;
+    bool            armed;              // Voltage went below -hysteresis since the last crossing
+    int32_t         hysteresis;
+    int32_t         peak;               // |v| peak of the running cycle
+    double          last_crossing;      // Interpolated sample position, < 0 = none yet
+
+    // Samples of the running cycle
+    uint32_t        n;
+    float           v_buf[PQ_MAX_CYCLE_SAMPLES];
+    float           i_buf[PQ_MAX_CYCLE_SAMPLES];
+
+    PqCycle_t       last;               // Most recent reported cycle
+    uint64_t        cycles;
+    uint64_t        rejected;           // Cycles outside PQ_MIN/MAX_FREQ_HZ or too long
+} PqEngine_t;
+
+// ===================== Function Declarations =====================
+
+void pq_init(PqEngine_t* pq, uint32_t sample_rate_hz, PqCycleCallback on_cycle, void* user);
+
+// Forget the running cycle and crossing history (rate change, stream restart)
+void pq_reset(PqEngine_t* pq);
+
+void pq_set_rate(PqEngine_t* pq, uint32_t sample_rate_hz);
+
+// Feed 'count' simultaneous voltage/current samples. on_cycle runs for every
+// cycle that completes inside the block.
+void pq_process(PqEngine_t* pq, const int16_t* v, const int16_t* i, uint16_t count, uint32_t timestamp);
+
+#endif // POWER_QUALITY_H
@@ -11,6 +11,10 @@
 
 #include "io_buffer.h"
 #include "protocol.h"
+#include "power_quality.h"
+#include "nilm_detector.h"
+#include "soft_trigger.h"
+#include "metrics.h"
 
 #ifdef _WIN32
 #pragma comment(lib, "ws2_32.lib")
@@ -31,6 +35,8 @@
 #define CMD_START_STREAM            0x12
 #define CMD_STOP_STREAM             0x13
 #define CMD_CONFIGURE_STREAM        0x14
+#define CMD_PAUSE_STREAM            0x15
+#define CMD_RESUME_STREAM           0x16
 #define CMD_ACK                     0x90
 #define CMD_NACK                    0x91
 
@@ -38,6 +44,7 @@
 #define CMD_DATA_PACKET             0x40
 #define CMD_EVENT_TRIGGERED         0x41
 #define CMD_REQUEST_BUFFERED_DATA   0x42
+#define CMD_DATA_PACKET_MULTIRATE   0x43
 #define CMD_BUFFER_TRANSFER_COMPLETE 0x4F
 
 // Logging (0xE0-0xEF)
@@ -52,6 +59,27 @@
 #define STOP_BITS               ONESTOPBIT
 #define PARITY_MODE             NOPARITY
 
+#define MAX_CHANNELS            16      // One bit per channel in DATA_PACKET channel_mask
+#define DEFAULT_CONFIG_CHANNELS 2       // Channels configured before device info is known
+
+#define DEFAULT_STREAM_RATE_HZ  10000   // Rate the demo stream configuration requests (-r overrides)
+#define MAX_STREAM_RATE_HZ      1000000 // Upper bound accepted for -r
+#define RATE_MEASURE_MS         1000    // Window for measuring the voltage channel's rate
+#define RATE_GAP_MS             200     // Larger packet gaps (pause, loss) restart the window
+#define RATE_RETUNE_PCT         2       // Retune power quality when off by more than this
+#define PQ_METRICS_FILE         "power_metrics.csv"
+#define NILM_EVENTS_FILE        "nilm_events.csv"
+#define HOST_TRIGGER_FILE       "host_trigger_frames.txt"
+#define FRAME_OVERHEAD_BYTES    10      // AA55 + len + cmd + seq + crc16 + 55AA
+
+// Receiver flow control on the link input queue (driver / socket buffer)
+#define FLOW_SERIAL_QUEUE_BYTES 65536   // SetupComm input queue
+#define FLOW_SOCKET_QUEUE_BYTES 1048576 // SO_RCVBUF
+#define FLOW_HIGH_PERCENT       75      // Pause at or above
+#define FLOW_LOW_PERCENT        25      // Resume at or below
+#define FLOW_PAUSE_TIMEOUT_MS   3000    // Device resumes on its own unless renewed
+#define FLOW_PAUSE_RENEW_MS     1000
+
 #define FRAME_BATCH_SAVE_COUNT  500
 #define MAX_FRAMES_PER_FILE     50000
 #define FILE_NAME_PATTERN       "raw_frames_%03d.txt"
@@ -86,6 +114,54 @@ static uint32_t   g_dataPacketCount     = 0;
 static uint32_t   g_totalFrameCount     = 0;
 static uint64_t   g_deviceUniqueId      = 0;
 static char       g_deviceInfo[512]     = {0};
+static uint8_t    g_deviceChannels      = 0;
+
+// Per-channel statistics, one contiguous array per field (indexed by channel id)
+static uint64_t   g_chSamples[MAX_CHANNELS];
+static int16_t    g_chMin[MAX_CHANNELS];
+static int16_t    g_chMax[MAX_CHANNELS];
+static int16_t    g_chLast[MAX_CHANNELS];
+static uint32_t   g_badDataPackets      = 0;
+
+// Power-quality engine on the channels the device names "Voltage"/"Current"
+// (the simulator's historical channel 0/1 layout until device info arrives)
+static PqEngine_t g_pq;
+static uint8_t    g_voltageCh           = 0;
+static uint8_t    g_currentCh           = 1;
+static FILE*      g_pqFp                = NULL;
+static bool       g_pqLive              = false;
+static uint32_t   g_streamRateHz        = DEFAULT_STREAM_RATE_HZ;   // Requested by 'c', initial pq rate
+
+// Voltage channel rate measured from packet timestamps
+static bool       g_rateStarted         = false;
+static uint32_t   g_rateStartTs         = 0;
+static uint32_t   g_rateLastTs          = 0;
+static uint64_t   g_rateSamples         = 0;
+
+// Appliance switching events detected on the per-cycle power features
+static NilmDetector_t g_nilm;
+static FILE*      g_nilmFp              = NULL;
+
+// Host-side software trigger for continuous-mode streams (-t SPEC)
+static TrigEngine_t g_trig;
+static FILE*      g_trigFp              = NULL;
+static uint8_t    g_trigSeq             = 0;
+static bool       g_deviceTriggerMode   = false;
+static bool       g_deviceBurstActive   = false;
+
+// Prometheus endpoint (-m PORT, 0 = off); the receive loop owns g_met
+static MetricsShard_t* g_met            = NULL;
+static uint16_t   g_metricsPort         = METRICS_DEFAULT_PORT;
+static int        g_lastDeviceSeq       = -1;
+
+// Receiver flow control: pause the device while the link input queue is deep
+static bool       g_flowEnabled         = true;
+static bool       g_flowPaused          = false;
+static uint32_t   g_flowQueueCap        = 0;        // Input queue size the watermarks refer to
+static uint32_t   g_flowQueuePeak       = 0;
+static uint32_t   g_flowPauses          = 0;
+static DWORD      g_flowPausedTick      = 0;        // Last PAUSE sent (renewals included)
+static int        g_flowCmdSeq          = -1;       // Seq of the last PAUSE/RESUME sent
 
 typedef struct {
     uint8_t* data;
@@ -152,6 +228,28 @@ static int conn_read_data(uint8_t* buffer, uint32_t bufferSize)
     return -1;
 }
 
+// Bytes received by the driver / stack that have not been read yet
+static uint32_t conn_pending_bytes(void)
+{
+    if (!g_conn.connected) {
+        return 0;
+    }
+
+    if (g_conn.type == CONN_TYPE_SERIAL) {
+        DWORD errors = 0;
+        COMSTAT st;
+        if (ClearCommError(g_conn.hSerial, &errors, &st)) {
+            return (uint32_t)st.cbInQue;
+        }
+    } else if (g_conn.type == CONN_TYPE_SOCKET) {
+        u_long pending = 0;
+        if (ioctlsocket(g_conn.socket, FIONREAD, &pending) == 0) {
+            return (uint32_t)pending;
+        }
+    }
+    return 0;
+}
+
 static void conn_close(void)
 {
     if (!g_conn.connected) return;
@@ -215,7 +313,9 @@ static bool open_serial_connection(const char* comPort)
         return false;
     }
 
+    SetupComm(h, FLOW_SERIAL_QUEUE_BYTES, 4096);
     PurgeComm(h, PURGE_RXCLEAR | PURGE_TXCLEAR | PURGE_RXABORT | PURGE_TXABORT);
+    g_flowQueueCap = FLOW_SERIAL_QUEUE_BYTES;
 
     g_conn.type = CONN_TYPE_SERIAL;
     g_conn.hSerial = h;
@@ -271,6 +371,15 @@ static bool open_socket_connection(const char* host, const char* port)
     u_long mode = 1;
     ioctlsocket(connectSocket, FIONBIO, &mode);
 
+    // Watermarks refer to the receive buffer the stack actually granted
+    int rcvbuf = FLOW_SOCKET_QUEUE_BYTES;
+    int optlen = sizeof(rcvbuf);
+    setsockopt(connectSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, sizeof(rcvbuf));
+    if (getsockopt(connectSocket, SOL_SOCKET, SO_RCVBUF, (char*)&rcvbuf, &optlen) != 0 || rcvbuf <= 0) {
+        rcvbuf = FLOW_SOCKET_QUEUE_BYTES;
+    }
+    g_flowQueueCap = (uint32_t)rcvbuf;
+
     g_conn.type = CONN_TYPE_SOCKET;
     g_conn.socket = connectSocket;
     g_conn.connected = true;
@@ -292,9 +401,12 @@ static const char* get_command_name(uint8_t cmd)
         case CMD_START_STREAM:            return "START_STREAM";
         case CMD_STOP_STREAM:             return "STOP_STREAM";
         case CMD_CONFIGURE_STREAM:        return "CONFIGURE_STREAM";
+        case CMD_PAUSE_STREAM:            return "PAUSE_STREAM";
+        case CMD_RESUME_STREAM:           return "RESUME_STREAM";
         case CMD_ACK:                     return "ACK";
         case CMD_NACK:                    return "NACK";
         case CMD_DATA_PACKET:             return "DATA_PACKET";
+        case CMD_DATA_PACKET_MULTIRATE:   return "DATA_PACKET_MULTIRATE";
         case CMD_EVENT_TRIGGERED:         return "EVENT_TRIGGERED";
         case CMD_REQUEST_BUFFERED_DATA:   return "REQUEST_BUFFERED_DATA";
         case CMD_BUFFER_TRANSFER_COMPLETE: return "BUFFER_TRANSFER_COMPLETE";
@@ -346,17 +458,30 @@ static bool open_next_file(void)
         return false;
     }
     g_framesInFile = 0;
+    metrics_add(&g_met->file_rotations, 1);
     printf("[FILE] -> %s\n", name);
     return true;
 }
 
 static void flush_batch_to_file(void)
 {
-    if (!g_fp) return;
+    if (!g_fp) {
+        metrics_add(&g_met->write_failures, (uint64_t)g_frameInBatch);
+        for (int i = 0; i < g_frameInBatch; ++i) {
+            free(g_frameBatch[i].data);
+        }
+        g_frameInBatch = 0;
+        metrics_set(&g_met->pending_frames, 0);
+        metrics_set(&g_met->pending_since_ns, 0);
+        return;
+    }
 
+    uint64_t t0 = metrics_now_ns();
+    uint64_t written = 0, bytes = 0;
     for (int i = 0; i < g_frameInBatch; ++i) {
         if (g_framesInFile >= MAX_FRAMES_PER_FILE) {
             if (!open_next_file()) {
+                metrics_add(&g_met->write_failures, 1);
                 free(g_frameBatch[i].data);
                 continue;
             }
@@ -370,9 +495,17 @@ static void flush_batch_to_file(void)
 
         free(g_frameBatch[i].data);
         g_framesInFile++;
+        written++;
+        bytes += 14 + 3u * g_frameBatch[i].len;   // "LEN:n HEX:" + " XX" per byte + newline
     }
-    fflush(g_fp);
+    if (g_fp) fflush(g_fp);
     g_frameInBatch = 0;
+
+    metrics_add(&g_met->frames_written, written);
+    metrics_add(&g_met->bytes_written, bytes);
+    metrics_set(&g_met->pending_frames, 0);
+    metrics_set(&g_met->pending_since_ns, 0);
+    metrics_observe(g_met, MET_STAGE_FLUSH, metrics_now_ns() - t0);
 }
 
 static void cache_frame(const uint8_t* frame, uint16_t len)
@@ -383,7 +516,11 @@ static void cache_frame(const uint8_t* frame, uint16_t len)
 
     g_frameBatch[g_frameInBatch].data = copy;
     g_frameBatch[g_frameInBatch].len  = len;
+    if (g_frameInBatch == 0) {
+        metrics_set(&g_met->pending_since_ns, metrics_now_ns());
+    }
     g_frameInBatch++;
+    metrics_set(&g_met->pending_frames, (uint64_t)g_frameInBatch);
 
     if (g_frameInBatch >= FRAME_BATCH_SAVE_COUNT) {
         flush_batch_to_file();
@@ -437,12 +574,21 @@ static void handle_device_info_response(uint8_t seq, const uint8_t* payload, uin
 
         printf("  Channel %u: %.*s, Max Rate: %u Hz, Formats: 0x%04X\n",
                channel_id, name_len, (char*)(payload + offset), max_rate, formats);
+        if (channel_id < MAX_CHANNELS) {
+            if (name_len == 7 && memcmp(payload + offset, "Voltage", 7) == 0) {
+                g_voltageCh = channel_id;
+            } else if (name_len == 7 && memcmp(payload + offset, "Current", 7) == 0) {
+                g_currentCh = channel_id;
+            }
+        }
         offset += name_len;
     }
 
     snprintf(g_deviceInfo, sizeof(g_deviceInfo),
              "Protocol V%u, FW v%u.%u, %u channels",
              protocol_version, fw_version >> 8, fw_version & 0xFF, num_channels);
+    g_deviceChannels = num_channels > MAX_CHANNELS ? MAX_CHANNELS : num_channels;
+    printf("  Power metrics: voltage=CH%u current=CH%u\n", g_voltageCh, g_currentCh);
 }
 
 static void handle_status_response(uint8_t seq, const uint8_t* payload, uint16_t payloadLen)
@@ -461,12 +607,187 @@ static void handle_status_response(uint8_t seq, const uint8_t* payload, uint16_t
         if (error_flag) {
             printf(", Error=0x%02X", error_code);
         }
+        if (payloadLen >= 5 && payload[4]) {
+            printf(", Flow=Paused");
+        }
 
         g_dataTransmissionOn = (stream_status == 1);
+        g_deviceTriggerMode = (mode != 0);
     }
     printf("\n");
 }
 
+// Fold one channel's block into its running statistics
+static void update_channel_stats(uint8_t ch, const int16_t* block, uint16_t sample_count)
+{
+    if (sample_count == 0) {
+        return;
+    }
+
+    int16_t lo = g_chSamples[ch] ? g_chMin[ch] : INT16_MAX;
+    int16_t hi = g_chSamples[ch] ? g_chMax[ch] : INT16_MIN;
+    for (uint16_t s = 0; s < sample_count; s++) {
+        if (block[s] < lo) lo = block[s];
+        if (block[s] > hi) hi = block[s];
+    }
+    g_chMin[ch] = lo;
+    g_chMax[ch] = hi;
+    g_chLast[ch] = block[sample_count - 1];
+    g_chSamples[ch] += sample_count;
+}
+
+// ===================== Power-Quality Metrics =====================
+
+static void on_pq_cycle(const PqCycle_t* c, void* user)
+{
+    (void)user;
+    if (!g_pqFp) {
+        g_pqFp = fopen(PQ_METRICS_FILE, "w");
+        if (!g_pqFp) {
+            printf("Open file %s failed!\n", PQ_METRICS_FILE);
+            return;
+        }
+        fprintf(g_pqFp, "cycle,timestamp,end_sample,samples,freq_hz,v_rms,i_rms,p,q,s,pf,v_thd_pct,i_thd_pct\n");
+        printf("[FILE] -> %s\n", PQ_METRICS_FILE);
+    }
+    fprintf(g_pqFp, "%llu,%u,%llu,%u,%.4f,%.2f,%.2f,%.1f,%.1f,%.1f,%.4f,%.2f,%.2f\n",
+            (unsigned long long)c->cycle, c->timestamp, (unsigned long long)c->end_sample, c->samples,
+            c->freq_hz, c->v_rms, c->i_rms, c->p, c->q, c->s, c->pf, c->v_thd_pct, c->i_thd_pct);
+
+    // Live view: about one line per second
+    uint32_t perSecond = c->freq_hz > 1.0f ? (uint32_t)(c->freq_hz + 0.5f) : 50;
+    if (g_pqLive && c->cycle % perSecond == 0) {
+        printf("[PQ] f=%.3f Hz V=%.1f I=%.1f P=%.0f Q=%.0f S=%.0f PF=%.3f THD V/I=%.2f%%/%.2f%%\n",
+               c->freq_hz, c->v_rms, c->i_rms, c->p, c->q, c->s, c->pf, c->v_thd_pct, c->i_thd_pct);
+    }
+
+    nilm_process(&g_nilm, c);
+}
+
+static void on_nilm_event(const NilmEvent_t* e, void* user)
+{
+    (void)user;
+    if (!g_nilmFp) {
+        g_nilmFp = fopen(NILM_EVENTS_FILE, "w");
+        if (!g_nilmFp) {
+            printf("Open file %s failed!\n", NILM_EVENTS_FILE);
+        } else {
+            fprintf(g_nilmFp, "id,cycle,timestamp,start_sample,direction,alarm_delay,llr,"
+                              "pre_p,pre_q,pre_i_rms,pre_i_thd_pct,post_p,post_q,post_i_rms,post_i_thd_pct\n");
+            printf("[FILE] -> %s\n", NILM_EVENTS_FILE);
+        }
+    }
+    if (g_nilmFp) {
+        fprintf(g_nilmFp, "%llu,%llu,%u,%llu,%d,%u,%.1f,%.1f,%.1f,%.2f,%.2f,%.1f,%.1f,%.2f,%.2f\n",
+                (unsigned long long)e->id, (unsigned long long)e->cycle, e->timestamp,
+                (unsigned long long)e->start_sample, e->direction, e->alarm_delay, e->llr,
+                e->pre[NILM_F_P], e->pre[NILM_F_Q], e->pre[NILM_F_IRMS], e->pre[NILM_F_ITHD],
+                e->post[NILM_F_P], e->post[NILM_F_Q], e->post[NILM_F_IRMS], e->post[NILM_F_ITHD]);
+        fflush(g_nilmFp);
+    }
+
+    // Events are rare: always shown live
+    printf("[NILM] #%llu %s @ts=%u cycle=%llu dP=%+.0f dQ=%+.0f dI=%+.2f (P %.0f -> %.0f, LLR %.0f)\n",
+           (unsigned long long)e->id, e->direction > 0 ? "ON " : "OFF", e->timestamp,
+           (unsigned long long)e->cycle,
+           e->post[NILM_F_P] - e->pre[NILM_F_P], e->post[NILM_F_Q] - e->pre[NILM_F_Q],
+           e->post[NILM_F_IRMS] - e->pre[NILM_F_IRMS], e->pre[NILM_F_P], e->post[NILM_F_P], e->llr);
+}
+
+// The device does not report its running stream rate (another host may have
+// configured it), so measure the voltage channel's samples per second between
+// packet timestamps and retune the power-quality engine when it is off.
+// A packet covers [timestamp, next timestamp), so a window holds the samples
+// of every packet before the one that closes it.
+static void track_stream_rate(uint32_t timestamp, uint16_t count)
+{
+    if (!g_rateStarted || timestamp < g_rateLastTs || timestamp - g_rateLastTs > RATE_GAP_MS) {
+        g_rateStarted = true;
+        g_rateStartTs = timestamp;
+        g_rateLastTs = timestamp;
+        g_rateSamples = count;
+        return;
+    }
+    g_rateLastTs = timestamp;
+
+    uint32_t elapsed = timestamp - g_rateStartTs;
+    if (elapsed >= RATE_MEASURE_MS) {
+        uint32_t rate = (uint32_t)((g_rateSamples * 1000 + elapsed / 2) / elapsed);
+        uint32_t cur = g_pq.sample_rate_hz;
+        if (rate > 0 && (uint64_t)(rate > cur ? rate - cur : cur - rate) * 100 > (uint64_t)cur * RATE_RETUNE_PCT) {
+            printf("[PQ] Voltage channel measured at %u Hz, power quality retuned from %u Hz\n", rate, cur);
+            pq_set_rate(&g_pq, rate);
+        }
+        g_rateStartTs = timestamp;
+        g_rateSamples = 0;
+    }
+    g_rateSamples += count;
+}
+
+// Feed the voltage/current pair when a packet carries both at the same rate
+static void feed_power_quality(uint32_t timestamp, const int16_t* const* blocks, const uint16_t* counts)
+{
+    const int16_t* v = blocks[g_voltageCh];
+    const int16_t* i = blocks[g_currentCh];
+    if (v) {
+        track_stream_rate(timestamp, counts[g_voltageCh]);
+    }
+    if (v && i && g_voltageCh != g_currentCh && counts[g_voltageCh] == counts[g_currentCh]) {
+        pq_process(&g_pq, v, i, counts[g_voltageCh], timestamp);
+    }
+}
+
+// ===================== Host Trigger =====================
+
+// Each burst payload becomes a frame in HOST_TRIGGER_FILE, in the raw frame
+// format, so tools read host and device bursts the same way
+static void on_host_trigger_emit(uint8_t cmd, const uint8_t* payload, uint16_t len, void* user)
+{
+    (void)user;
+    uint8_t frameBuf[MAX_FRAME_SIZE];
+    uint16_t frameLen = sizeof(frameBuf);
+    if (buildFrame(cmd, g_trigSeq++, payload, len, frameBuf, &frameLen) != 0) {
+        printf("[ERROR] Failed to build host trigger frame 0x%02X\n", cmd);
+        return;
+    }
+
+    if (!g_trigFp) {
+        g_trigFp = fopen(HOST_TRIGGER_FILE, "w");
+        if (!g_trigFp) {
+            printf("Open file %s failed!\n", HOST_TRIGGER_FILE);
+        } else {
+            printf("[FILE] -> %s\n", HOST_TRIGGER_FILE);
+        }
+    }
+    if (g_trigFp) {
+        fprintf(g_trigFp, "LEN:%u HEX:", frameLen);
+        for (uint16_t j = 0; j < frameLen; ++j) {
+            fprintf(g_trigFp, " %02X", frameBuf[j]);
+        }
+        fputc('\n', g_trigFp);
+    }
+
+    if (cmd == CMD_EVENT_TRIGGERED) {
+        uint32_t timestamp = *(const uint32_t*)payload;
+        uint16_t channel = *(const uint16_t*)(payload + 4);
+        uint32_t pre = *(const uint32_t*)(payload + 6);
+        uint32_t post = *(const uint32_t*)(payload + 10);
+        printf("[TRIG] Host trigger #%llu: %s on CH%u, timestamp=%u, pre=%u, post=%u\n",
+               (unsigned long long)g_trig.fired + 1, trig_type_name((TrigType_t)payload[15]),
+               channel, timestamp, pre, post);
+    } else if (cmd == CMD_BUFFER_TRANSFER_COMPLETE && g_trigFp) {
+        fflush(g_trigFp);
+    }
+}
+
+// Continuous-mode packets only; device bursts already carry their own trigger
+static void feed_host_trigger(uint32_t timestamp, const int16_t* const* blocks, const uint16_t* counts)
+{
+    if (!g_deviceTriggerMode && !g_deviceBurstActive) {
+        trig_process(&g_trig, timestamp, blocks, counts);
+    }
+}
+
 static void handle_data_packet(uint8_t seq, const uint8_t* payload, uint16_t payloadLen)
 {
     (void)seq;
@@ -484,6 +805,99 @@ static void handle_data_packet(uint8_t seq, const uint8_t* payload, uint16_t pay
 
     printf("[RECV] Data Packet #%u: timestamp=%u, channels=0x%04X, samples=%u, len=%u\n",
            g_dataPacketCount, timestamp, channel_mask, sample_count, payloadLen);
+
+    // Non-interleaved layout: one block of sample_count int16 per set mask bit
+    uint32_t channel_count = 0;
+    for (uint16_t mask = channel_mask; mask; mask &= (uint16_t)(mask - 1)) {
+        channel_count++;
+    }
+    if (payloadLen != 8 + channel_count * sample_count * sizeof(int16_t)) {
+        printf("[RECV] Data Packet #%u: length %u does not match %u channels x %u samples\n",
+               g_dataPacketCount, payloadLen, channel_count, sample_count);
+        g_badDataPackets++;
+        metrics_add(&g_met->bad_data_packets, 1);
+        return;
+    }
+
+    const int16_t* blocks[MAX_CHANNELS] = {0};
+    uint16_t counts[MAX_CHANNELS] = {0};
+    const int16_t* block = (const int16_t*)(payload + 8);
+    for (uint8_t ch = 0; ch < MAX_CHANNELS; ch++) {
+        if (!(channel_mask & (1u << ch))) {
+            continue;
+        }
+        update_channel_stats(ch, block, sample_count);
+        blocks[ch] = block;
+        counts[ch] = sample_count;
+        block += sample_count;
+    }
+    feed_power_quality(timestamp, blocks, counts);
+    feed_host_trigger(timestamp, blocks, counts);
+}
+
+// Multi-rate packet: a uint16 sample count per set mask bit, then the blocks
+static void handle_data_packet_multirate(uint8_t seq, const uint8_t* payload, uint16_t payloadLen)
+{
+    (void)seq;
+    g_dataPacketCount++;
+
+    if (payloadLen < 6) {
+        printf("[RECV] Invalid Multi-rate Packet #%u (len=%u)\n",
+               g_dataPacketCount, payloadLen);
+        g_badDataPackets++;
+        metrics_add(&g_met->bad_data_packets, 1);
+        return;
+    }
+
+    uint32_t timestamp = *(uint32_t*)payload;
+    uint16_t channel_mask = *(uint16_t*)(payload + 4);
+
+    uint32_t channel_count = 0;
+    for (uint16_t mask = channel_mask; mask; mask &= (uint16_t)(mask - 1)) {
+        channel_count++;
+    }
+    uint32_t header_len = 6 + channel_count * sizeof(uint16_t);
+    if (channel_count == 0 || payloadLen < header_len) {
+        printf("[RECV] Multi-rate Packet #%u: length %u too short for mask 0x%04X\n",
+               g_dataPacketCount, payloadLen, channel_mask);
+        g_badDataPackets++;
+        metrics_add(&g_met->bad_data_packets, 1);
+        return;
+    }
+
+    const uint16_t* counts = (const uint16_t*)(payload + 6);
+    uint32_t total_samples = 0;
+    for (uint32_t i = 0; i < channel_count; i++) {
+        total_samples += counts[i];
+    }
+    if (payloadLen != header_len + total_samples * sizeof(int16_t)) {
+        printf("[RECV] Multi-rate Packet #%u: length %u does not match %u samples in %u channels\n",
+               g_dataPacketCount, payloadLen, total_samples, channel_count);
+        g_badDataPackets++;
+        metrics_add(&g_met->bad_data_packets, 1);
+        return;
+    }
+
+    printf("[RECV] Multi-rate Packet #%u: timestamp=%u, channels=0x%04X, samples=",
+           g_dataPacketCount, timestamp, channel_mask);
+    const int16_t* blocks[MAX_CHANNELS] = {0};
+    uint16_t chCounts[MAX_CHANNELS] = {0};
+    const int16_t* block = (const int16_t*)(payload + header_len);
+    uint32_t index = 0;
+    for (uint8_t ch = 0; ch < MAX_CHANNELS; ch++) {
+        if (!(channel_mask & (1u << ch))) {
+            continue;
+        }
+        printf("%s%u:%u", index ? "," : "", ch, counts[index]);
+        update_channel_stats(ch, block, counts[index]);
+        blocks[ch] = block;
+        chCounts[ch] = counts[index];
+        block += counts[index];
+        index++;
+    }
+    printf(", len=%u\n", payloadLen);
+    feed_power_quality(timestamp, blocks, chCounts);
+    feed_host_trigger(timestamp, blocks, chCounts);
 }
 
 static void handle_log_message(uint8_t seq, const uint8_t* payload, uint16_t payloadLen)
@@ -515,6 +929,7 @@ static void handle_log_message(uint8_t seq, const uint8_t* payload, uint16_t pay
 
 static void handle_event_triggered(uint8_t seq, const uint8_t* payload, uint16_t payloadLen)
 {
+    g_deviceBurstActive = true;
     printf("[RECV] Event Triggered (seq=%u): ", seq);
     if (payloadLen >= 4) {
         uint32_t timestamp = *(uint32_t*)payload;
@@ -531,10 +946,121 @@ static void handle_event_triggered(uint8_t seq, const uint8_t* payload, uint16_t
     send_command(CMD_REQUEST_BUFFERED_DATA, NULL, 0);
 }
 
+// ===================== Flow Control =====================
+
+static void flow_send(uint8_t cmd)
+{
+    if (cmd == CMD_PAUSE_STREAM) {
+        uint16_t timeout_ms = FLOW_PAUSE_TIMEOUT_MS;
+        g_flowCmdSeq = g_seqCounter;
+        send_command(cmd, (const uint8_t*)&timeout_ms, sizeof(timeout_ms));
+        g_flowPausedTick = GetTickCount();
+    } else {
+        g_flowCmdSeq = g_seqCounter;
+        send_command(cmd, NULL, 0);
+    }
+}
+
+// Called once per loop pass: hysteresis between the two watermarks, and
+// the pause is renewed while the queue stays deep
+static void flow_control_tick(void)
+{
+    uint32_t depth = conn_pending_bytes();
+    metrics_set(&g_met->rx_queue_bytes, depth);
+    if (depth > g_flowQueuePeak) {
+        g_flowQueuePeak = depth;
+    }
+    if (!g_flowEnabled || g_flowQueueCap == 0) {
+        return;
+    }
+
+    uint32_t high = (uint32_t)((uint64_t)g_flowQueueCap * FLOW_HIGH_PERCENT / 100);
+    uint32_t low = (uint32_t)((uint64_t)g_flowQueueCap * FLOW_LOW_PERCENT / 100);
+
+    if (!g_flowPaused && depth >= high) {
+        printf("[FLOW] Input queue %u/%u bytes, pausing device\n", depth, g_flowQueueCap);
+        g_flowPaused = true;
+        g_flowPauses++;
+        metrics_add(&g_met->flow_pauses, 1);
+        metrics_set(&g_met->flow_paused, 1);
+        flow_send(CMD_PAUSE_STREAM);
+    } else if (g_flowPaused && depth <= low) {
+        printf("[FLOW] Input queue %u/%u bytes, resuming device\n", depth, g_flowQueueCap);
+        g_flowPaused = false;
+        metrics_set(&g_met->flow_paused, 0);
+        flow_send(CMD_RESUME_STREAM);
+    } else if (g_flowPaused && GetTickCount() - g_flowPausedTick >= FLOW_PAUSE_RENEW_MS) {
+        flow_send(CMD_PAUSE_STREAM);
+    }
+}
+
+// True if the ACK/NACK answers our last flow command. A NACK means the
+// device firmware predates flow control: stop asking.
+static bool flow_on_reply(uint8_t cmd, uint8_t seq)
+{
+    if (g_flowCmdSeq < 0 || seq != (uint8_t)g_flowCmdSeq) {
+        return false;
+    }
+    g_flowCmdSeq = -1;
+    if (cmd == CMD_NACK) {
+        printf("[FLOW] Device does not support flow control, disabled\n");
+        g_flowEnabled = false;
+        g_flowPaused = false;
+        metrics_set(&g_met->flow_paused, 0);
+    }
+    return true;
+}
+
 // ===================== Frame Processing =====================
 
+// Tells CRC failures apart from other parse errors: CRC16/MODBUS over
+// cmd..payload, stored little-endian before the tail
+static bool frame_crc_ok(const uint8_t* frame, uint16_t frameLen)
+{
+    if (frameLen < FRAME_OVERHEAD_BYTES) {
+        return false;
+    }
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 4; i < frameLen - 4; i++) {
+        crc ^= frame[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc == (uint16_t)(frame[frameLen - 4] | (frame[frameLen - 3] << 8));
+}
+
+static void count_frame(uint8_t cmd, uint8_t seq, uint16_t frameLen)
+{
+    metrics_add(&g_met->frames[cmd], 1);
+    metrics_add(&g_met->frame_bytes[cmd], frameLen);
+
+    // Responses echo the host's request seq; only frames the device sends on
+    // its own (data, events, transfer complete, logs) take the next seq
+    switch (cmd) {
+        case CMD_PONG:
+        case CMD_STATUS_RESPONSE:
+        case CMD_DEVICE_INFO_RESPONSE:
+        case CMD_ACK:
+        case CMD_NACK:
+            return;
+        default:
+            break;
+    }
+    if (g_lastDeviceSeq >= 0) {
+        uint8_t expected = (uint8_t)(g_lastDeviceSeq + 1);
+        if (seq != expected) {
+            metrics_add(&g_met->seq_gaps, 1);
+            metrics_add(&g_met->seq_lost, (uint8_t)(seq - expected));
+        }
+    }
+    g_lastDeviceSeq = seq;
+}
+
 static void onFrameParsed(const uint8_t* frame, uint16_t frameLen)
 {
+    uint64_t t0 = metrics_now_ns();
+
     cache_frame(frame, frameLen);
     g_totalFrameCount++;
 
@@ -545,6 +1071,7 @@ static void onFrameParsed(const uint8_t* frame, uint16_t frameLen)
 
     int ret = parseFrame(frame, frameLen, &cmd, &seq, payload, &payloadLen);
     if (ret == 0) {
+        count_frame(cmd, seq, frameLen);
         switch (cmd) {
             case CMD_PONG:
                 handle_pong_response(seq, payload, payloadLen);
@@ -558,19 +1085,26 @@ static void onFrameParsed(const uint8_t* frame, uint16_t frameLen)
             case CMD_DATA_PACKET:
                 handle_data_packet(seq, payload, payloadLen);
                 break;
+            case CMD_DATA_PACKET_MULTIRATE:
+                handle_data_packet_multirate(seq, payload, payloadLen);
+                break;
             case CMD_EVENT_TRIGGERED:
                 handle_event_triggered(seq, payload, payloadLen);
                 break;
             case CMD_BUFFER_TRANSFER_COMPLETE:
                 printf("[RECV] Buffer Transfer Complete (seq=%u)\n", seq);
+                g_deviceBurstActive = false;
                 break;
             case CMD_LOG_MESSAGE:
                 handle_log_message(seq, payload, payloadLen);
                 break;
             case CMD_ACK:
-                printf("[RECV] ACK (seq=%u)\n", seq);
+                if (!flow_on_reply(cmd, seq)) {
+                    printf("[RECV] ACK (seq=%u)\n", seq);
+                }
                 break;
             case CMD_NACK:
+                flow_on_reply(cmd, seq);
                 printf("[RECV] NACK (seq=%u)\n", seq);
                 break;
             default:
@@ -578,8 +1112,15 @@ static void onFrameParsed(const uint8_t* frame, uint16_t frameLen)
                 break;
         }
     } else {
+        if (frame_crc_ok(frame, frameLen)) {
+            metrics_add(&g_met->parse_errors, 1);
+        } else {
+            metrics_add(&g_met->crc_failures, 1);
+        }
         printf("[Parse ERR] ret=%d (len=%u)\n", ret, frameLen);
     }
+
+    metrics_observe(g_met, MET_STAGE_DISPATCH, metrics_now_ns() - t0);
 }
 
 // ===================== User Interface =====================
@@ -596,7 +1137,10 @@ static void print_help(void)
     printf("2       - Set trigger mode\n");
     printf("3       - Start stream\n");
     printf("4       - Stop stream\n");
-    printf("c       - Configure stream (demo)\n");
+    printf("c       - Configure stream (demo, all reported channels)\n");
+    printf("m       - Toggle live power-quality metrics\n");
+    printf("t       - Arm/disarm host trigger (conditions from -t)\n");
+    printf("f       - Toggle automatic flow control (pause/resume device)\n");
     printf("========================\n\n");
 }
 
@@ -615,29 +1159,59 @@ static void print_status(void)
     }
     printf("Data Transmission: %s\n", g_dataTransmissionOn ? "ON" : "OFF");
     printf("Total Frames: %u\n", g_totalFrameCount);
-    printf("Data Packets: %u\n", g_dataPacketCount);
+    printf("Data Packets: %u", g_dataPacketCount);
+    if (g_badDataPackets) {
+        printf(" (%u malformed)", g_badDataPackets);
+    }
+    printf("\n");
+    for (uint8_t ch = 0; ch < MAX_CHANNELS; ch++) {
+        if (g_chSamples[ch]) {
+            printf("  CH%-2u samples=%llu min=%d max=%d last=%d\n", ch,
+                   (unsigned long long)g_chSamples[ch], g_chMin[ch], g_chMax[ch], g_chLast[ch]);
+        }
+    }
+    if (g_pq.cycles) {
+        const PqCycle_t* c = &g_pq.last;
+        printf("Power (CH%u/CH%u): f=%.3f Hz V=%.1f I=%.1f P=%.0f Q=%.0f S=%.0f PF=%.3f THD V/I=%.2f%%/%.2f%%\n",
+               g_voltageCh, g_currentCh, c->freq_hz, c->v_rms, c->i_rms, c->p, c->q, c->s, c->pf,
+               c->v_thd_pct, c->i_thd_pct);
+        printf("Power Cycles: %llu (%llu rejected)\n",
+               (unsigned long long)g_pq.cycles, (unsigned long long)g_pq.rejected);
+        printf("Switching Events: %llu (%llu transients discarded)\n",
+               (unsigned long long)g_nilm.events, (unsigned long long)g_nilm.discarded);
+    }
+    if (g_trig.cond_count) {
+        printf("Host Trigger: %s, %u condition(s), %llu bursts (%llu dropped), scan=%s\n",
+               g_trig.armed ? (g_trig.capturing ? "CAPTURING" : "ARMED") : "DISARMED",
+               g_trig.cond_count, (unsigned long long)g_trig.fired,
+               (unsigned long long)g_trig.dropped, trig_scan_impl());
+    }
+    printf("Flow Control: %s, %s, %u pause(s), input queue peak %u/%u bytes\n",
+           g_flowEnabled ? "AUTO" : "OFF", g_flowPaused ? "PAUSED" : "RUNNING",
+           g_flowPauses, g_flowQueuePeak, g_flowQueueCap);
     printf("Current Seq: %u\n", g_seqCounter);
     printf("===================\n\n");
 }
 
 static void send_demo_stream_config(void)
 {
-    uint8_t config_payload[13];
+    // Every channel the device reported (press 'i' first), else the first two
+    uint8_t channels = g_deviceChannels ? g_deviceChannels : DEFAULT_CONFIG_CHANNELS;
+    uint8_t config_payload[1 + MAX_CHANNELS * 6];
     uint16_t offset = 0;
 
-    config_payload[offset++] = 2;
-
-    config_payload[offset++] = 0;
-    *(uint32_t*)(config_payload + offset) = 10000;
-    offset += 4;
-    config_payload[offset++] = 0x01;
+    config_payload[offset++] = channels;
 
-    config_payload[offset++] = 1;
-    *(uint32_t*)(config_payload + offset) = 10000;
-    offset += 4;
-    config_payload[offset++] = 0x01;
+    for (uint8_t ch = 0; ch < channels; ch++) {
+        config_payload[offset++] = ch;
+        *(uint32_t*)(config_payload + offset) = g_streamRateHz;
+        offset += 4;
+        config_payload[offset++] = 0x01;
+    }
+    pq_set_rate(&g_pq, g_streamRateHz);
+    trig_set_rate(&g_trig, g_streamRateHz);
 
-    printf("Sending stream configuration (2 channels @ 10kHz, int16)...\n");
+    printf("Sending stream configuration (%u channels @ %u Hz, int16)...\n", channels, g_streamRateHz);
     send_command(CMD_CONFIGURE_STREAM, config_payload, offset);
 }
 
@@ -666,10 +1240,12 @@ static bool handle_user_input(void)
             case '1':
                 printf("Setting continuous mode...\n");
                 send_command(CMD_SET_MODE_CONTINUOUS, NULL, 0);
+                g_deviceTriggerMode = false;
                 break;
             case '2':
                 printf("Setting trigger mode...\n");
                 send_command(CMD_SET_MODE_TRIGGER, NULL, 0);
+                g_deviceTriggerMode = true;
                 break;
             case '3':
                 printf("Starting stream...\n");
@@ -682,6 +1258,31 @@ static bool handle_user_input(void)
             case 'c': case 'C':
                 send_demo_stream_config();
                 break;
+            case 'm': case 'M':
+                g_pqLive = !g_pqLive;
+                printf("Live power metrics %s (all cycles go to %s)\n",
+                       g_pqLive ? "ON" : "OFF", PQ_METRICS_FILE);
+                break;
+            case 't': case 'T':
+                if (g_trig.cond_count == 0) {
+                    printf("No host trigger conditions (start with -t SPEC, see -h)\n");
+                    break;
+                }
+                g_trig.armed = !g_trig.armed;
+                g_trig.capturing = false;
+                printf("Host trigger %s (bursts go to %s)\n",
+                       g_trig.armed ? "ARMED" : "DISARMED", HOST_TRIGGER_FILE);
+                break;
+            case 'f': case 'F':
+                g_flowEnabled = !g_flowEnabled;
+                if (!g_flowEnabled && g_flowPaused) {
+                    g_flowPaused = false;
+                    metrics_set(&g_met->flow_paused, 0);
+                    flow_send(CMD_RESUME_STREAM);
+                }
+                printf("Automatic flow control %s (pause at %d%%, resume at %d%% of %u bytes)\n",
+                       g_flowEnabled ? "ON" : "OFF", FLOW_HIGH_PERCENT, FLOW_LOW_PERCENT, g_flowQueueCap);
+                break;
             default:
                 printf("Unknown command '%c'. Press 'h' for help.\n", ch);
                 break;
@@ -697,6 +1298,8 @@ static void communication_loop(void)
     uint8_t buf[10000];
 
     initRxBuffer(&g_rx);
+    pq_init(&g_pq, g_streamRateHz, on_pq_cycle, NULL);
+    nilm_init(&g_nilm, NULL, on_nilm_event, NULL);
 
     printf("Communication started (Protocol V6). Press 'h' for help.\n");
     printf("Connection type: %s\n", g_conn.type == CONN_TYPE_SERIAL ? "Serial" : "TCP Socket");
@@ -708,12 +1311,16 @@ static void communication_loop(void)
         // Handle device communication
         int bytesRead = conn_read_data(buf, sizeof(buf));
         if (bytesRead > 0) {
+            uint64_t t0 = metrics_now_ns();
+            metrics_add(&g_met->rx_bytes, (uint64_t)bytesRead);
             feedRxBuffer(&g_rx, buf, (uint16_t)bytesRead);
             tryParseFramesFromRx(&g_rx, onFrameParsed);
+            metrics_observe(g_met, MET_STAGE_PARSE, metrics_now_ns() - t0);
         } else if (bytesRead < 0) {
             printf("Connection error or closed\n");
             break;
         }
+        flow_control_tick();
 
         // Handle user input
         if (handle_user_input()) {
@@ -741,6 +1348,21 @@ static void print_usage(const char* progName)
     printf("  %s -s                   # Use TCP 127.0.0.1:9001\n", progName);
     printf("  %s -s 192.168.1.100     # Use TCP 192.168.1.100:9001\n", progName);
     printf("  %s -s 192.168.1.100 8080 # Use TCP 192.168.1.100:8080\n", progName);
+    printf("\nHost Trigger (continuous mode, repeatable, conditions are ORed):\n");
+    printf("  -t level:ch=N,level=V[,dir=above|below]\n");
+    printf("  -t edge:ch=N,level=V[,dir=rise|fall|any]\n");
+    printf("  -t window:ch=N,lo=A,hi=B\n");
+    printf("  -t slope:ch=N,delta=D[,dir=rise|fall|any]        # x[n]-x[n-1]\n");
+    printf("  -t rate:ch=N,delta=D,span=S[,dir=rise|fall|any]  # x[n]-x[n-S], S<=%d\n", TRIG_MAX_SPAN);
+    printf("     any spec may add pre=N,post=N,holdoff=N (samples; default %d/%d/0)\n",
+           TRIG_DEFAULT_PRE, TRIG_DEFAULT_POST);
+    printf("  %s -t edge:ch=1,level=2000 -s  # Arm on CH1 rising through 2000\n", progName);
+    printf("\nMetrics (Prometheus text format, 127.0.0.1 only):\n");
+    printf("  -m PORT                 # Serve GET /metrics on PORT (default %d, 0 = off)\n", METRICS_DEFAULT_PORT);
+    printf("\nStream Rate:\n");
+    printf("  -r HZ                   # Rate 'c' requests and power quality starts from (default %d)\n",
+           DEFAULT_STREAM_RATE_HZ);
+    printf("                          # Power quality then follows the rate measured on the voltage channel\n");
     printf("\nFeatures:\n");
     printf("  - Protocol V6 support\n");
     printf("  - Raw frame logging to files\n");
@@ -756,6 +1378,48 @@ int main(int argc, char* argv[])
     char port[16] = DEFAULT_TCP_PORT;
     char comPort[32] = DEFAULT_COM_PORT;
 
+    // Host trigger, metrics and rate options come first and are removed from the argument list
+    trig_init(&g_trig, DEFAULT_STREAM_RATE_HZ, MAX_FRAME_SIZE - FRAME_OVERHEAD_BYTES, on_host_trigger_emit, NULL);
+    int rest = 1;
+    while (rest + 1 < argc && (strcmp(argv[rest], "-t") == 0 || strcmp(argv[rest], "-m") == 0 ||
+                               strcmp(argv[rest], "-r") == 0)) {
+        if (strcmp(argv[rest], "-r") == 0) {
+            char* end;
+            unsigned long hz = strtoul(argv[rest + 1], &end, 10);
+            if (*end != '\0' || hz == 0 || hz > MAX_STREAM_RATE_HZ) {
+                printf("Error: Invalid stream rate: %s\n", argv[rest + 1]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            g_streamRateHz = (uint32_t)hz;
+            trig_set_rate(&g_trig, g_streamRateHz);
+            rest += 2;
+            continue;
+        }
+        if (strcmp(argv[rest], "-m") == 0) {
+            int mport = atoi(argv[rest + 1]);
+            if (mport < 0 || mport > 65535 || (mport == 0 && strcmp(argv[rest + 1], "0") != 0)) {
+                printf("Error: Invalid metrics port: %s\n", argv[rest + 1]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            g_metricsPort = (uint16_t)mport;
+            rest += 2;
+            continue;
+        }
+        TrigCondition_t cond;
+        if (trig_parse(&g_trig, argv[rest + 1], &cond) != 0 || trig_add_condition(&g_trig, &cond) != 0) {
+            printf("Error: Invalid or too many trigger conditions: %s\n", argv[rest + 1]);
+            print_usage(argv[0]);
+            return 1;
+        }
+        g_trig.armed = true;
+        rest += 2;
+    }
+    argv[rest - 1] = argv[0];
+    argc -= rest - 1;
+    argv += rest - 1;
+
     // Parse command line arguments
     if (argc == 1) {
         strcpy(comPort, DEFAULT_COM_PORT);
@@ -796,8 +1460,22 @@ int main(int argc, char* argv[])
         printf("Port: %s\n", comPort);
         printf("Baud Rate: %u\n", (unsigned int)BAUDRATE);
     }
+    if (g_trig.cond_count) {
+        printf("Host Trigger: %u condition(s), pre=%u post=%u holdoff=%u, scan=%s\n",
+               g_trig.cond_count, g_trig.pre, g_trig.post, g_trig.holdoff, trig_scan_impl());
+    }
     printf("==================================\n\n");
 
+    g_met = metrics_shard("recv");
+    metrics_set_command_names(get_command_name);
+    if (g_metricsPort) {
+        if (metrics_start("127.0.0.1", g_metricsPort) == 0) {
+            printf("Metrics: http://127.0.0.1:%u/metrics\n", g_metricsPort);
+        } else {
+            printf("Warning: Cannot listen on 127.0.0.1:%u, metrics disabled.\n", g_metricsPort);
+        }
+    }
+
     if (!open_next_file()) {
         printf("Warning: Cannot open output file, frames won't be saved.\n");
     }
@@ -814,6 +1492,7 @@ int main(int argc, char* argv[])
 
     if (!connected) {
         if (g_fp) fclose(g_fp);
+        metrics_stop();
         return 1;
     }
 
@@ -821,8 +1500,12 @@ int main(int argc, char* argv[])
     communication_loop();
 
     // Cleanup
+    metrics_stop();
     conn_close();
     if (g_fp) fclose(g_fp);
+    if (g_pqFp) fclose(g_pqFp);
+    if (g_nilmFp) fclose(g_nilmFp);
+    if (g_trigFp) fclose(g_trigFp);
 
     if (useSocket) {
         WSACleanup();
@@ -0,0 +1,515 @@
+// File: soft_trigger.c
+// Description: Host-side software trigger on continuous-mode data packets
+//              Every channel's samples go into a per-channel history ring. Armed
+//              conditions scan each new block for the first hit (SSE2, 8 samples
+//              per compare, scalar for the tail and other CPUs). A hit marks the
+//              trigger sample; once `post` samples past it have arrived, the ring
+//              is replayed as EVENT_TRIGGERED, DATA_PACKETs and
+//              BUFFER_TRANSFER_COMPLETE, the same sequence a device trigger sends.
+// Version: v2.0
+
+#include "soft_trigger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define TRIG_HAVE_SSE2 1
+#include <emmintrin.h>
+#else
+#define TRIG_HAVE_SSE2 0
+#endif
+
+#define TRIG_RING_MASK      (TRIG_RING_SAMPLES - 1)
+
+// ===================== Setup =====================
+
+void trig_init(TrigEngine_t* t, uint32_t sample_rate_hz, uint16_t max_payload, TrigEmitCallback emit, void* user)
+{
+    memset(t, 0, sizeof(*t));
+    t->pre = TRIG_DEFAULT_PRE;
+    t->post = TRIG_DEFAULT_POST;
+    t->sample_rate_hz = sample_rate_hz;
+    t->max_payload = max_payload;
+    t->emit = emit;
+    t->user = user;
+    trig_reset(t);
+}
+
+void trig_reset(TrigEngine_t* t)
+{
+    memset(t->written, 0, sizeof(t->written));
+    t->capturing = false;
+    t->rearm_at = 0;
+}
+
+void trig_set_rate(TrigEngine_t* t, uint32_t sample_rate_hz)
+{
+    if (t->sample_rate_hz != sample_rate_hz) {
+        t->sample_rate_hz = sample_rate_hz;
+        trig_reset(t);
+    }
+}
+
+const char* trig_type_name(TrigType_t type)
+{
+    switch (type) {
+        case TRIG_LEVEL:  return "level";
+        case TRIG_EDGE:   return "edge";
+        case TRIG_WINDOW: return "window";
+        case TRIG_SLOPE:  return "slope";
+        case TRIG_RATE:   return "rate";
+        default:          return "unknown";
+    }
+}
+
+const char* trig_scan_impl(void)
+{
+    return TRIG_HAVE_SSE2 ? "sse2" : "scalar";
+}
+
+// ===================== Condition Parsing =====================
+
+static bool parse_int(const char* text, long lo, long hi, long* out)
+{
+    char* end = NULL;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < lo || v > hi) {
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+int trig_parse(TrigEngine_t* t, const char* spec, TrigCondition_t* cond)
+{
+    char buf[160];
+    if (strlen(spec) >= sizeof(buf)) {
+        return -1;
+    }
+    strcpy(buf, spec);
+
+    memset(cond, 0, sizeof(*cond));
+    char* colon = strchr(buf, ':');
+    if (colon) {
+        *colon = '\0';
+    }
+
+    static const TrigType_t types[] = { TRIG_LEVEL, TRIG_EDGE, TRIG_WINDOW, TRIG_SLOPE, TRIG_RATE };
+    bool known = false;
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (strcmp(buf, trig_type_name(types[i])) == 0) {
+            cond->type = types[i];
+            known = true;
+        }
+    }
+    if (!known) {
+        return -1;
+    }
+
+    // Defaults per type
+    cond->dir = cond->type == TRIG_RATE ? TRIG_EITHER : TRIG_RISING;
+    cond->lo = INT16_MIN;
+    cond->hi = INT16_MAX;
+    cond->delta = 1;
+    cond->span = cond->type == TRIG_RATE ? 10 : 1;
+    bool haveDelta = false;
+
+    char* rest = colon ? colon + 1 : NULL;
+    for (char* kv = rest ? strtok(rest, ",") : NULL; kv; kv = strtok(NULL, ",")) {
+        char* eq = strchr(kv, '=');
+        if (!eq) {
+            return -1;
+        }
+        *eq = '\0';
+        const char* key = kv;
+        const char* val = eq + 1;
+        long v = 0;
+
+        if (strcmp(key, "dir") == 0) {
+            if (strcmp(val, "rise") == 0 || strcmp(val, "above") == 0) {
+                cond->dir = TRIG_RISING;
+            } else if (strcmp(val, "fall") == 0 || strcmp(val, "below") == 0) {
+                cond->dir = TRIG_FALLING;
+            } else if (strcmp(val, "any") == 0) {
+                cond->dir = TRIG_EITHER;
+            } else {
+                return -1;
+            }
+            continue;
+        }
+
+        if (strcmp(key, "ch") == 0 && parse_int(val, 0, DATA_PACKET_MAX_CHANNELS - 1, &v)) {
+            cond->channel = (uint8_t)v;
+        } else if (strcmp(key, "level") == 0 && parse_int(val, INT16_MIN, INT16_MAX, &v)) {
+            cond->level = (int16_t)v;
+        } else if (strcmp(key, "lo") == 0 && parse_int(val, INT16_MIN, INT16_MAX, &v)) {
+            cond->lo = (int16_t)v;
+        } else if (strcmp(key, "hi") == 0 && parse_int(val, INT16_MIN, INT16_MAX, &v)) {
+            cond->hi = (int16_t)v;
+        } else if (strcmp(key, "delta") == 0 && parse_int(val, 1, INT16_MAX, &v)) {
+            cond->delta = (int16_t)v;
+            haveDelta = true;
+        } else if (strcmp(key, "span") == 0 && parse_int(val, 1, TRIG_MAX_SPAN, &v)) {
+            cond->span = (uint16_t)v;
+        } else if (strcmp(key, "pre") == 0 && parse_int(val, 0, TRIG_RING_SAMPLES / 2, &v)) {
+            t->pre = (uint32_t)v;
+        } else if (strcmp(key, "post") == 0 && parse_int(val, 1, TRIG_RING_SAMPLES / 2, &v)) {
+            t->post = (uint32_t)v;
+        } else if (strcmp(key, "holdoff") == 0 && parse_int(val, 0, 0x7FFFFFFFL, &v)) {
+            t->holdoff = (uint32_t)v;
+        } else {
+            return -1;
+        }
+    }
+
+    if (cond->type == TRIG_WINDOW && cond->lo > cond->hi) {
+        return -1;
+    }
+    if ((cond->type == TRIG_SLOPE || cond->type == TRIG_RATE) && !haveDelta) {
+        return -1;
+    }
+    if (cond->type != TRIG_RATE) {
+        cond->span = 1;
+    }
+    return 0;
+}
+
+int trig_add_condition(TrigEngine_t* t, const TrigCondition_t* cond)
+{
+    if (t->cond_count >= TRIG_MAX_CONDITIONS) {
+        return -1;
+    }
+    t->cond[t->cond_count++] = *cond;
+    return 0;
+}
+
+// ===================== Block Scan =====================
+
+// History a condition needs before each sample
+static uint32_t cond_lookback(const TrigCondition_t* c)
+{
+    switch (c->type) {
+        case TRIG_EDGE:
+        case TRIG_SLOPE: return 1;
+        case TRIG_RATE:  return c->span;
+        default:         return 0;
+    }
+}
+
+static bool hit_scalar(const TrigCondition_t* c, const int16_t* x, uint32_t k)
+{
+    bool up = (c->dir & TRIG_RISING) != 0;
+    bool down = (c->dir & TRIG_FALLING) != 0;
+    int32_t v = x[k];
+
+    switch (c->type) {
+        case TRIG_LEVEL:
+            return (up && v > c->level) || (down && v < c->level);
+        case TRIG_EDGE: {
+            int32_t p = x[(int32_t)k - 1];
+            return (up && p <= c->level && v > c->level) || (down && p >= c->level && v < c->level);
+        }
+        case TRIG_WINDOW:
+            return v < c->lo || v > c->hi;
+        case TRIG_SLOPE:
+        case TRIG_RATE: {
+            int32_t d = v - x[(int32_t)k - (int32_t)c->span];
+            return (up && d >= c->delta) || (down && d <= -c->delta);
+        }
+    }
+    return false;
+}
+
+#if TRIG_HAVE_SSE2
+
+// Lanes of x[k..k+7] that satisfy the condition, one bit pair per lane
+static inline int hit_mask_sse2(const TrigCondition_t* c, const int16_t* x, uint32_t k)
+{
+    bool up = (c->dir & TRIG_RISING) != 0;
+    bool down = (c->dir & TRIG_FALLING) != 0;
+    __m128i v = _mm_loadu_si128((const __m128i*)(x + k));
+    __m128i m = _mm_setzero_si128();
+
+    switch (c->type) {
+        case TRIG_LEVEL: {
+            __m128i l = _mm_set1_epi16(c->level);
+            if (up)   m = _mm_or_si128(m, _mm_cmpgt_epi16(v, l));
+            if (down) m = _mm_or_si128(m, _mm_cmplt_epi16(v, l));
+            break;
+        }
+        case TRIG_EDGE: {
+            __m128i l = _mm_set1_epi16(c->level);
+            __m128i p = _mm_loadu_si128((const __m128i*)(x + k - 1));
+            // p <= l is NOT(p > l); p >= l is NOT(p < l)
+            if (up) {
+                m = _mm_or_si128(m, _mm_andnot_si128(_mm_cmpgt_epi16(p, l), _mm_cmpgt_epi16(v, l)));
+            }
+            if (down) {
+                m = _mm_or_si128(m, _mm_andnot_si128(_mm_cmplt_epi16(p, l), _mm_cmplt_epi16(v, l)));
+            }
+            break;
+        }
+        case TRIG_WINDOW:
+            m = _mm_or_si128(_mm_cmplt_epi16(v, _mm_set1_epi16(c->lo)),
+                             _mm_cmpgt_epi16(v, _mm_set1_epi16(c->hi)));
+            break;
+        case TRIG_SLOPE:
+        case TRIG_RATE: {
+            // Saturating difference keeps the sign and stays past any delta
+            __m128i p = _mm_loadu_si128((const __m128i*)(x + k - c->span));
+            __m128i d = _mm_subs_epi16(v, p);
+            if (up) {
+                m = _mm_or_si128(m, _mm_cmpgt_epi16(d, _mm_set1_epi16((int16_t)(c->delta - 1))));
+            }
+            if (down) {
+                m = _mm_or_si128(m, _mm_cmplt_epi16(d, _mm_set1_epi16((int16_t)(1 - c->delta))));
+            }
+            break;
+        }
+    }
+    return _mm_movemask_epi8(m);
+}
+
+#endif
+
+// First k in [from, n) where the condition holds on x (x[-lookback] readable),
+// or -1
+static int32_t scan_block(const TrigCondition_t* c, const int16_t* x, uint32_t from, uint32_t n)
+{
+    uint32_t k = from;
+#if TRIG_HAVE_SSE2
+    for (; k + 8 <= n; k += 8) {
+        int bits = hit_mask_sse2(c, x, k);
+        if (bits) {
+            return (int32_t)(k + (uint32_t)__builtin_ctz((unsigned)bits) / 2);
+        }
+    }
+#endif
+    for (; k < n; k++) {
+        if (hit_scalar(c, x, k)) {
+            return (int32_t)k;
+        }
+    }
+    return -1;
+}
+
+// ===================== Burst Emission =====================
+
+static void put_u16(uint8_t* p, uint16_t v) { memcpy(p, &v, sizeof(v)); }
+static void put_u32(uint8_t* p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+
+static uint32_t samples_to_ms(const TrigEngine_t* t, uint64_t samples)
+{
+    return t->sample_rate_hz ? (uint32_t)(samples * 1000 / t->sample_rate_hz) : 0;
+}
+
+static void emit_burst(TrigEngine_t* t)
+{
+    const uint8_t src = t->src_channel;
+    uint16_t mask = 0;
+    uint8_t nch = 0;
+    uint32_t pre = t->pre;
+
+    // Channels that kept up with the source; the shortest history bounds pre
+    for (uint8_t ch = 0; ch < DATA_PACKET_MAX_CHANNELS; ch++) {
+        if (!(t->burst_mask & (1u << ch))) {
+            continue;
+        }
+        if (t->written[ch] < t->trig_index[ch] + t->post) {
+            continue;
+        }
+        uint64_t oldest = t->written[ch] > TRIG_RING_SAMPLES ? t->written[ch] - TRIG_RING_SAMPLES : 0;
+        if (t->trig_index[ch] < oldest) {
+            continue;
+        }
+        uint64_t avail = t->trig_index[ch] - oldest;
+        if (avail < pre) {
+            pre = (uint32_t)avail;
+        }
+        mask |= (uint16_t)(1u << ch);
+        nch++;
+    }
+    if (!(mask & (1u << src))) {
+        t->dropped++;
+        return;
+    }
+
+    uint32_t perPacket = TRIG_PACKET_SAMPLES;
+    uint32_t fit = (t->max_payload - 8u) / (nch * (uint32_t)sizeof(int16_t));
+    if (perPacket > fit) {
+        perPacket = fit;
+    }
+    if (perPacket == 0) {
+        t->dropped++;
+        return;
+    }
+
+    // EVENT_TRIGGERED: timestamp, channel, pre, post as the device sends them,
+    // then source and condition type
+    uint8_t* o = t->out;
+    put_u32(o, t->trig_timestamp);
+    put_u16(o + 4, src);
+    put_u32(o + 6, pre);
+    put_u32(o + 10, t->post);
+    o[14] = TRIG_SOURCE_HOST;
+    o[15] = (uint8_t)t->cond[t->src_cond].type;
+    t->emit(CMD_EVENT_TRIGGERED, o, 16, t->user);
+
+    uint32_t total = pre + t->post;
+    uint32_t startMs = t->trig_timestamp - samples_to_ms(t, pre);
+    for (uint32_t done = 0; done < total; done += perPacket) {
+        uint16_t n = (uint16_t)(total - done < perPacket ? total - done : perPacket);
+        put_u32(o, startMs + samples_to_ms(t, done));
+        put_u16(o + 4, mask);
+        put_u16(o + 6, n);
+        int16_t* dst = (int16_t*)(o + 8);
+
+        for (uint8_t ch = 0; ch < DATA_PACKET_MAX_CHANNELS; ch++) {
+            if (!(mask & (1u << ch))) {
+                continue;
+            }
+            uint64_t first = t->trig_index[ch] - pre + done;
+            for (uint16_t s = 0; s < n; s++) {
+                *dst++ = t->ring[ch][(first + s) & TRIG_RING_MASK];
+            }
+        }
+        t->emit(CMD_DATA_PACKET, o, (uint16_t)(8 + (uint32_t)n * nch * sizeof(int16_t)), t->user);
+    }
+
+    t->emit(CMD_BUFFER_TRANSFER_COMPLETE, NULL, 0, t->user);
+    t->fired++;
+}
+
+// ===================== Streaming =====================
+
+static void ring_append(TrigEngine_t* t, uint8_t ch, const int16_t* block, uint16_t count)
+{
+    if (count > TRIG_RING_SAMPLES) {
+        t->written[ch] += count - TRIG_RING_SAMPLES;
+        block += count - TRIG_RING_SAMPLES;
+        count = TRIG_RING_SAMPLES;
+    }
+    uint32_t pos = (uint32_t)(t->written[ch] & TRIG_RING_MASK);
+    uint32_t first = TRIG_RING_SAMPLES - pos < count ? TRIG_RING_SAMPLES - pos : count;
+    memcpy(&t->ring[ch][pos], block, first * sizeof(int16_t));
+    memcpy(&t->ring[ch][0], block + first, (count - first) * sizeof(int16_t));
+    t->written[ch] += count;
+}
+
+// Scan the source block of one condition; returns the first hit index within
+// the block or -1. `base` is written[] before this block was appended.
+static int32_t scan_condition(TrigEngine_t* t, const TrigCondition_t* c, const int16_t* block,
+                              uint16_t count, uint64_t base, uint32_t from)
+{
+    const uint32_t look = cond_lookback(c);
+    int16_t* x = t->scratch + TRIG_MAX_SPAN;
+
+    for (uint32_t off = from; off < count; off += TRIG_SCAN_CHUNK) {
+        uint32_t n = count - off < TRIG_SCAN_CHUNK ? count - off : TRIG_SCAN_CHUNK;
+
+        // History for the first samples of the chunk comes from the ring
+        for (uint32_t h = 1; h <= look; h++) {
+            uint64_t idx = base + off - h;
+            x[-(int32_t)h] = (base + off >= h) ? t->ring[c->channel][idx & TRIG_RING_MASK] : 0;
+        }
+        memcpy(x, block + off, n * sizeof(int16_t));
+
+        // Skip samples whose lookback predates the stream
+        uint32_t start = base + off >= look ? 0 : (uint32_t)(look - (base + off));
+        int32_t k = start < n ? scan_block(c, x, start, n) : -1;
+        if (k >= 0) {
+            return (int32_t)off + k;
+        }
+    }
+    return -1;
+}
+
+void trig_process(TrigEngine_t* t, uint32_t timestamp, const int16_t* const* blocks, const uint16_t* counts)
+{
+    uint64_t base[DATA_PACKET_MAX_CHANNELS];
+    memcpy(base, t->written, sizeof(base));
+
+    for (uint8_t ch = 0; ch < DATA_PACKET_MAX_CHANNELS; ch++) {
+        if (blocks[ch] && counts[ch]) {
+            ring_append(t, ch, blocks[ch], counts[ch]);
+        }
+    }
+
+    if (t->capturing) {
+        if (t->written[t->src_channel] < t->trig_index[t->src_channel] + t->post) {
+            return;
+        }
+        emit_burst(t);
+        t->capturing = false;
+        t->rearm_at = t->trig_index[t->src_channel] + t->post + t->holdoff;
+        // The rest of this block is scanned again from rearm_at
+    }
+    if (!t->armed || t->cond_count == 0) {
+        return;
+    }
+
+    // Holdoff is counted in source channel samples. Every condition skips the
+    // part of its block before rearm_at, mapped as the same fraction of the
+    // block that the hit comparison below uses. A packet without the source
+    // channel lies entirely before its next sample, so it is all holdoff.
+    const uint8_t hs = t->src_channel;
+    uint64_t holdNum = 0;
+    uint16_t holdDen = 0;
+    if (t->rearm_at > base[hs]) {
+        if (!blocks[hs] || counts[hs] == 0 || t->rearm_at >= base[hs] + counts[hs]) {
+            return;
+        }
+        holdNum = t->rearm_at - base[hs];
+        holdDen = counts[hs];
+    }
+
+    // Earliest hit across conditions, compared as a fraction of each block
+    int best = -1;
+    int32_t bestK = 0;
+    for (uint8_t i = 0; i < t->cond_count; i++) {
+        const TrigCondition_t* c = &t->cond[i];
+        uint16_t n = counts[c->channel];
+        if (!blocks[c->channel] || n == 0) {
+            continue;
+        }
+        uint64_t b = base[c->channel];
+        uint32_t from = 0;
+        if (holdDen) {
+            from = (uint32_t)((holdNum * n + holdDen - 1) / holdDen);
+            if (from >= n) {
+                continue;
+            }
+        }
+        int32_t k = scan_condition(t, c, blocks[c->channel], n, b, from);
+        if (k >= 0 && (best < 0 || (uint64_t)k * counts[t->cond[best].channel] < (uint64_t)bestK * n)) {
+            best = i;
+            bestK = k;
+        }
+    }
+    if (best < 0) {
+        return;
+    }
+
+    // Trigger sample fixed; align channels sharing the source's rate
+    const uint8_t src = t->cond[best].channel;
+    const uint16_t srcCount = counts[src];
+    t->capturing = true;
+    t->src_channel = src;
+    t->src_cond = (uint8_t)best;
+    t->burst_mask = 0;
+    for (uint8_t ch = 0; ch < DATA_PACKET_MAX_CHANNELS; ch++) {
+        if (blocks[ch] && counts[ch] == srcCount) {
+            t->burst_mask |= (uint16_t)(1u << ch);
+            t->trig_index[ch] = base[ch] + (uint64_t)bestK;
+        }
+    }
+    t->trig_timestamp = timestamp + samples_to_ms(t, (uint64_t)bestK);
+
+    // Post window may already be complete inside this block
+    if (t->written[src] >= t->trig_index[src] + t->post) {
+        emit_burst(t);
+        t->capturing = false;
+        t->rearm_at = t->trig_index[src] + t->post + t->holdoff;
+    }
+}
@@ -0,0 +1,112 @@
+// File: soft_trigger.h
+// Description: Host-side software trigger on continuous-mode data packets
+//              Emits EVENT_TRIGGERED / DATA_PACKET / BUFFER_TRANSFER_COMPLETE
+//              payloads shaped like a device-triggered burst
+// Version: v2.0
+
+#ifndef SOFT_TRIGGER_H
+#define SOFT_TRIGGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data_packet.h"
+
+#ifndef CMD_EVENT_TRIGGERED
+#define CMD_EVENT_TRIGGERED         0x41
+#endif
+#ifndef CMD_BUFFER_TRANSFER_COMPLETE
+#define CMD_BUFFER_TRANSFER_COMPLETE 0x4F
+#endif
+
+// ===================== Configuration =====================
+#define TRIG_MAX_CONDITIONS     4       // Conditions are ORed
+#define TRIG_RING_SAMPLES       32768   // Per channel history; power of two
+#define TRIG_MAX_SPAN           256     // Longest rate-of-change span (samples)
+#define TRIG_SCAN_CHUNK         4096    // Samples scanned per pass
+#define TRIG_DEFAULT_PRE        1000    // Same defaults as the device trigger
+#define TRIG_DEFAULT_POST       1000
+#define TRIG_PACKET_SAMPLES     2000    // Samples per channel per burst packet
+#define TRIG_SOURCE_HOST        1       // EVENT_TRIGGERED byte 14: 0 = device, 1 = host
+
+typedef enum {
+    TRIG_LEVEL,                 // Sample above (rising) / below (falling) level
+    TRIG_EDGE,                  // Sample crosses level in the given direction
+    TRIG_WINDOW,                // Sample leaves [lo, hi]
+    TRIG_SLOPE,                 // x[n] - x[n-1] reaches delta in the given direction
+    TRIG_RATE                   // x[n] - x[n-span] reaches delta in the given direction
+} TrigType_t;
+
+typedef enum {
+    TRIG_RISING  = 1,
+    TRIG_FALLING = 2,
+    TRIG_EITHER  = 3
+} TrigDir_t;
+
+// ===================== Data Structures =====================
+
+typedef struct {
+    TrigType_t type;
+    uint8_t    channel;
+    TrigDir_t  dir;
+    int16_t    level;           // LEVEL / EDGE
+    int16_t    lo, hi;          // WINDOW
+    int16_t    delta;           // SLOPE / RATE, > 0
+    uint16_t   span;            // RATE
+} TrigCondition_t;
+
+// Receives each payload of an emitted burst in order
+typedef void (*TrigEmitCallback)(uint8_t cmd, const uint8_t* payload, uint16_t len, void* user);
+
+typedef struct {
+    TrigCondition_t  cond[TRIG_MAX_CONDITIONS];
+    uint8_t          cond_count;
+    uint32_t         pre;                   // Samples kept before the trigger sample
+    uint32_t         post;                  // Samples from the trigger sample on
+    uint32_t         holdoff;               // Samples after a burst before re-arming
+    uint32_t         sample_rate_hz;        // For burst timestamps
+    uint16_t         max_payload;           // Largest DATA_PACKET payload emitted
+    bool             armed;
+    TrigEmitCallback emit;
+    void*            user;
+
+    // Per-channel history
+    int16_t          ring[DATA_PACKET_MAX_CHANNELS][TRIG_RING_SAMPLES];
+    uint64_t         written[DATA_PACKET_MAX_CHANNELS];
+    int16_t          scratch[TRIG_MAX_SPAN + TRIG_SCAN_CHUNK];
+
+    // Capture in progress
+    bool             capturing;
+    uint8_t          src_channel;
+    uint8_t          src_cond;
+    uint16_t         burst_mask;            // Channels at the trigger channel's rate
+    uint64_t         trig_index[DATA_PACKET_MAX_CHANNELS];
+    uint32_t         trig_timestamp;        // ms, interpolated to the trigger sample
+    uint64_t         rearm_at;              // Source channel index where scanning resumes (all conditions)
+
+    uint8_t          out[65535];
+
+    uint64_t         fired;
+    uint64_t         dropped;               // Triggers abandoned (channel vanished)
+} TrigEngine_t;
+
+// ===================== Function Declarations =====================
+
+void trig_init(TrigEngine_t* t, uint32_t sample_rate_hz, uint16_t max_payload, TrigEmitCallback emit, void* user);
+void trig_reset(TrigEngine_t* t);
+void trig_set_rate(TrigEngine_t* t, uint32_t sample_rate_hz);
+
+// Parse "TYPE:key=val,..." (see README) into a condition; pre/post/holdoff
+// keys update the engine. Returns 0 or -1 on a malformed spec.
+int  trig_parse(TrigEngine_t* t, const char* spec, TrigCondition_t* cond);
+int  trig_add_condition(TrigEngine_t* t, const TrigCondition_t* cond);
+const char* trig_type_name(TrigType_t type);
+
+// Feed one data packet (continuous mode only): block/count per channel id,
+// NULL/0 for channels the packet does not carry
+void trig_process(TrigEngine_t* t, uint32_t timestamp, const int16_t* const* blocks, const uint16_t* counts);
+
+// Which scan kernel is in use ("sse2" or "scalar")
+const char* trig_scan_impl(void);
+
+#endif // SOFT_TRIGGER_H
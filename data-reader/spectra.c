@@ -0,0 +1,578 @@
+// File: spectra.c
+// Description: Offline Welch PSD and mains band summary for recorded channels
+//              (the <name>.chNN.i16 columns written by frameconv -f col)
+// Version: v2.0
+//
+// Each channel is cut into segments of whole Welch frames. Segments are
+// claimed from a shared counter by the worker threads, every segment keeps
+// its own partial periodogram sum, and the partials are added in segment
+// order afterwards so the result does not depend on -j. Two real frames
+// share one complex FFT (one in the real, one in the imaginary part).
+
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define spec_fseek _fseeki64
+#define spec_ftell _ftelli64
+#else
+#include <unistd.h>
+#define spec_fseek fseeko
+#define spec_ftell ftello
+#endif
+
+#include "fft.h"
+
+// ===================== Configuration =====================
+#define DEFAULT_SAMPLE_RATE     10000
+#define DEFAULT_FFT_SIZE        4096
+#define DEFAULT_OVERLAP_PCT     50
+#define DEFAULT_SEGMENT_FRAMES  256
+#define DEFAULT_HARMONICS       13
+#define MAX_WORKERS             64
+
+#define MAINS_MIN_HZ            45.0
+#define MAINS_MAX_HZ            65.0
+#define BAND_HALF_BINS          2       // Hann main lobe: peak +/- 2 bins
+
+#define SPEC_PI                 3.14159265358979323846
+
+// ===================== Data Structures =====================
+
+typedef struct {
+    const char* path;
+    char        base[512];      // Output path without ".i16"
+    int64_t     samples;
+    uint64_t    frames;         // Welch frames in the recording
+    uint32_t    first_segment;  // Index of this channel's first segment
+    uint32_t    segment_count;
+    double*     psd;            // One-sided PSD, counts^2/Hz, n/2+1 bins
+} SpecChannel_t;
+
+typedef struct {
+    SpecChannel_t* channel;
+    uint64_t       frame_begin;
+    uint64_t       frame_end;
+    double*        power;       // Sum of |X[k]|^2 over the segment's frames
+    double         sum;         // Sum / sum of squares of the samples this
+    double         sum_sq;      // segment owns (its hop-aligned range)
+    int64_t        owned;
+    bool           failed;
+} SpecSegment_t;
+
+typedef struct {
+    double rms;
+    double mean;
+    double f1_hz;
+    double f1_rms;
+    double harm_rms[64];        // [h] for h = 2..harmonics
+    double thd_pct;
+    double dc_rms;
+    double other_rms;           // Everything outside DC, fundamental and harmonics
+} SpecSummary_t;
+
+// ===================== Global Variables =====================
+static uint32_t       g_rate          = DEFAULT_SAMPLE_RATE;
+static uint32_t       g_fftSize       = DEFAULT_FFT_SIZE;
+static uint32_t       g_hop           = DEFAULT_FFT_SIZE / 2;
+static uint32_t       g_segmentFrames = DEFAULT_SEGMENT_FRAMES;
+static uint32_t       g_harmonics     = DEFAULT_HARMONICS;
+static bool           g_writePsd      = true;
+
+static FftPlan_t      g_plan;
+static float*         g_window        = NULL;
+static double         g_windowPower   = 0.0;      // Sum of w[i]^2
+
+static SpecChannel_t* g_channels      = NULL;
+static uint32_t       g_channelCount  = 0;
+static SpecSegment_t* g_segments      = NULL;
+static uint32_t       g_segmentCount  = 0;
+static atomic_uint    g_nextSegment;
+
+// ===================== Utility Functions =====================
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static bool init_window(void)
+{
+    g_window = (float*)malloc(g_fftSize * sizeof(float));
+    if (!g_window) {
+        return false;
+    }
+    // Periodic Hann, the usual choice for Welch averaging
+    g_windowPower = 0.0;
+    for (uint32_t i = 0; i < g_fftSize; i++) {
+        double w = 0.5 - 0.5 * cos(2.0 * SPEC_PI * (double)i / (double)g_fftSize);
+        g_window[i] = (float)w;
+        g_windowPower += w * w;
+    }
+    return true;
+}
+
+// ===================== Segment Processing =====================
+
+// Add |X|^2 of two real frames a[] and b[] using one complex transform:
+// with z = a + i*b, A[k] = (Z[k] + conj(Z[n-k])) / 2, B[k] = (Z[k] - conj(Z[n-k])) / 2i
+static void accumulate_pair(float* re, float* im, double* power, bool haveSecond)
+{
+    const uint32_t n = g_fftSize;
+    const uint32_t* br = g_plan.bitrev;
+
+    fft_forward(&g_plan, re, im);
+
+    for (uint32_t k = 0; k <= n / 2; k++) {
+        uint32_t p = br[k];
+        uint32_t m = br[(n - k) & (n - 1)];
+        float zr = re[p], zi = im[p];
+        float cr = re[m], ci = -im[m];          // conj(Z[n-k])
+
+        float ar = 0.5f * (zr + cr), ai = 0.5f * (zi + ci);
+        power[k] += (double)ar * ar + (double)ai * ai;
+        if (haveSecond) {
+            float dr = 0.5f * (zr - cr), di = 0.5f * (zi - ci);
+            power[k] += (double)dr * dr + (double)di * di;
+        }
+    }
+}
+
+static bool process_segment(SpecSegment_t* seg, int16_t* raw, float* re, float* im)
+{
+    SpecChannel_t* ch = seg->channel;
+    const uint32_t n = g_fftSize;
+
+    int64_t first = (int64_t)(seg->frame_begin * g_hop);
+    int64_t last = (int64_t)((seg->frame_end - 1) * g_hop) + n;
+    // The last segment also owns the tail past its final hop
+    int64_t ownedEnd = seg->frame_end == ch->frames ? ch->samples : (int64_t)(seg->frame_end * g_hop);
+    if (last < ownedEnd) {
+        last = ownedEnd;
+    }
+    size_t count = (size_t)(last - first);
+
+    FILE* fp = fopen(ch->path, "rb");
+    if (!fp) {
+        return false;
+    }
+    bool ok = spec_fseek(fp, first * (int64_t)sizeof(int16_t), SEEK_SET) == 0 &&
+              fread(raw, sizeof(int16_t), count, fp) == count;
+    fclose(fp);
+    if (!ok) {
+        return false;
+    }
+
+    seg->owned = ownedEnd - first;
+    for (int64_t i = 0; i < seg->owned; i++) {
+        double v = raw[i];
+        seg->sum += v;
+        seg->sum_sq += v * v;
+    }
+
+    for (uint64_t f = seg->frame_begin; f < seg->frame_end; f += 2) {
+        const int16_t* a = raw + (size_t)((f - seg->frame_begin) * g_hop);
+        bool haveSecond = f + 1 < seg->frame_end;
+        const int16_t* b = haveSecond ? a + g_hop : NULL;
+        for (uint32_t i = 0; i < n; i++) {
+            re[i] = (float)a[i] * g_window[i];
+            im[i] = haveSecond ? (float)b[i] * g_window[i] : 0.0f;
+        }
+        accumulate_pair(re, im, seg->power, haveSecond);
+    }
+    return true;
+}
+
+static void* worker_main(void* arg)
+{
+    (void)arg;
+    size_t maxSamples = (size_t)(g_segmentFrames - 1) * g_hop + g_fftSize + g_hop;
+    int16_t* raw = (int16_t*)malloc(maxSamples * sizeof(int16_t));
+    float* re = (float*)malloc(g_fftSize * sizeof(float));
+    float* im = (float*)malloc(g_fftSize * sizeof(float));
+
+    for (;;) {
+        unsigned idx = atomic_fetch_add(&g_nextSegment, 1u);
+        if (idx >= g_segmentCount) {
+            break;
+        }
+        SpecSegment_t* seg = &g_segments[idx];
+        if (!raw || !re || !im || !process_segment(seg, raw, re, im)) {
+            seg->failed = true;
+        }
+    }
+
+    free(raw);
+    free(re);
+    free(im);
+    return NULL;
+}
+
+// ===================== Job Setup =====================
+
+static bool plan_channels(int count, char** paths)
+{
+    g_channels = (SpecChannel_t*)calloc((size_t)count, sizeof(SpecChannel_t));
+    if (!g_channels) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        FILE* fp = fopen(paths[i], "rb");
+        if (!fp) {
+            printf("[WARN] Cannot open %s, skipped\n", paths[i]);
+            continue;
+        }
+        spec_fseek(fp, 0, SEEK_END);
+        int64_t bytes = (int64_t)spec_ftell(fp);
+        fclose(fp);
+
+        int64_t samples = bytes / (int64_t)sizeof(int16_t);
+        if (samples < (int64_t)g_fftSize) {
+            printf("[WARN] %s: %lld samples, shorter than one %u-point frame, skipped\n",
+                   paths[i], (long long)samples, g_fftSize);
+            continue;
+        }
+
+        SpecChannel_t* ch = &g_channels[g_channelCount++];
+        ch->path = paths[i];
+        size_t len = strlen(paths[i]);
+        if (len > 4 && strcmp(paths[i] + len - 4, ".i16") == 0) {
+            len -= 4;
+        }
+        snprintf(ch->base, sizeof(ch->base), "%.*s", (int)len, paths[i]);
+        ch->samples = samples;
+        ch->frames = (uint64_t)((samples - g_fftSize) / g_hop) + 1;
+        ch->segment_count = (uint32_t)((ch->frames + g_segmentFrames - 1) / g_segmentFrames);
+        ch->first_segment = g_segmentCount;
+        g_segmentCount += ch->segment_count;
+    }
+
+    g_segments = (SpecSegment_t*)calloc(g_segmentCount ? g_segmentCount : 1, sizeof(SpecSegment_t));
+    if (!g_segments) {
+        return false;
+    }
+    uint32_t bins = g_fftSize / 2 + 1;
+    for (uint32_t c = 0; c < g_channelCount; c++) {
+        SpecChannel_t* ch = &g_channels[c];
+        for (uint32_t s = 0; s < ch->segment_count; s++) {
+            SpecSegment_t* seg = &g_segments[ch->first_segment + s];
+            seg->channel = ch;
+            seg->frame_begin = (uint64_t)s * g_segmentFrames;
+            seg->frame_end = seg->frame_begin + g_segmentFrames;
+            if (seg->frame_end > ch->frames) {
+                seg->frame_end = ch->frames;
+            }
+            seg->power = (double*)calloc(bins, sizeof(double));
+            if (!seg->power) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// ===================== Results =====================
+
+// Sum PSD bins [lo, hi] into a power (counts^2)
+static double band_power(const double* psd, int64_t lo, int64_t hi)
+{
+    int64_t last = (int64_t)(g_fftSize / 2);
+    if (lo < 0) lo = 0;
+    if (hi > last) hi = last;
+    double df = (double)g_rate / (double)g_fftSize;
+    double p = 0.0;
+    for (int64_t k = lo; k <= hi; k++) {
+        p += psd[k] * df;
+    }
+    return p;
+}
+
+static bool finish_channel(SpecChannel_t* ch, SpecSummary_t* sum)
+{
+    const uint32_t bins = g_fftSize / 2 + 1;
+    ch->psd = (double*)calloc(bins, sizeof(double));
+    if (!ch->psd) {
+        return false;
+    }
+
+    double s1 = 0.0, s2 = 0.0;
+    int64_t owned = 0;
+    for (uint32_t s = 0; s < ch->segment_count; s++) {
+        SpecSegment_t* seg = &g_segments[ch->first_segment + s];
+        if (seg->failed) {
+            return false;
+        }
+        for (uint32_t k = 0; k < bins; k++) {
+            ch->psd[k] += seg->power[k];
+        }
+        s1 += seg->sum;
+        s2 += seg->sum_sq;
+        owned += seg->owned;
+    }
+
+    // Welch scaling: mean periodogram / (fs * sum w^2), one-sided
+    double scale = 1.0 / ((double)ch->frames * (double)g_rate * g_windowPower);
+    for (uint32_t k = 0; k < bins; k++) {
+        ch->psd[k] *= scale;
+        if (k != 0 && k != bins - 1) {
+            ch->psd[k] *= 2.0;
+        }
+    }
+
+    memset(sum, 0, sizeof(*sum));
+    sum->mean = s1 / (double)owned;
+    sum->rms = sqrt(s2 / (double)owned);
+
+    const double df = (double)g_rate / (double)g_fftSize;
+    double total = band_power(ch->psd, 0, bins - 1);
+    double dc = band_power(ch->psd, 0, BAND_HALF_BINS);
+    sum->dc_rms = sqrt(dc);
+
+    // Fundamental: strongest bin in the mains range, refined by parabolic
+    // interpolation of the log spectrum around it
+    int64_t lo = (int64_t)ceil(MAINS_MIN_HZ / df);
+    int64_t hi = (int64_t)floor(MAINS_MAX_HZ / df);
+    if (lo <= BAND_HALF_BINS) lo = BAND_HALF_BINS + 1;
+    if (hi >= (int64_t)bins - 1) hi = (int64_t)bins - 2;
+    int64_t peak = lo;
+    for (int64_t k = lo; k <= hi; k++) {
+        if (ch->psd[k] > ch->psd[peak]) peak = k;
+    }
+    double offset = 0.0;
+    if (ch->psd[peak - 1] > 0 && ch->psd[peak] > 0 && ch->psd[peak + 1] > 0) {
+        double a = log(ch->psd[peak - 1]), b = log(ch->psd[peak]), c = log(ch->psd[peak + 1]);
+        double den = a - 2.0 * b + c;
+        if (den != 0.0) {
+            offset = 0.5 * (a - c) / den;
+        }
+    }
+    sum->f1_hz = ((double)peak + offset) * df;
+    double p1 = band_power(ch->psd, peak - BAND_HALF_BINS, peak + BAND_HALF_BINS);
+    sum->f1_rms = sqrt(p1);
+
+    double harmTotal = 0.0;
+    for (uint32_t h = 2; h <= g_harmonics; h++) {
+        int64_t k = (int64_t)llround(sum->f1_hz * h / df);
+        if (k + BAND_HALF_BINS >= (int64_t)bins) {
+            break;
+        }
+        double ph = band_power(ch->psd, k - BAND_HALF_BINS, k + BAND_HALF_BINS);
+        sum->harm_rms[h] = sqrt(ph);
+        harmTotal += ph;
+    }
+    sum->thd_pct = p1 > 0 ? 100.0 * sqrt(harmTotal / p1) : 0.0;
+    double other = total - dc - p1 - harmTotal;
+    sum->other_rms = other > 0 ? sqrt(other) : 0.0;
+    return true;
+}
+
+static bool write_psd(const SpecChannel_t* ch)
+{
+    char path[600];
+    snprintf(path, sizeof(path), "%s.psd.csv", ch->base);
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        printf("[ERROR] Cannot create %s\n", path);
+        return false;
+    }
+    const double df = (double)g_rate / (double)g_fftSize;
+    fprintf(fp, "freq_hz,psd_counts2_per_hz\n");
+    for (uint32_t k = 0; k <= g_fftSize / 2; k++) {
+        fprintf(fp, "%.4f,%.6e\n", k * df, ch->psd[k]);
+    }
+    fclose(fp);
+    return true;
+}
+
+static void write_summary_row(FILE* fp, const SpecChannel_t* ch, const SpecSummary_t* s)
+{
+    fprintf(fp, "%s,%lld,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f", ch->path, (long long)ch->samples,
+            s->mean, s->rms, s->dc_rms, s->f1_hz, s->f1_rms, s->thd_pct, s->other_rms,
+            (double)ch->samples / g_rate);
+    for (uint32_t h = 2; h <= g_harmonics; h++) {
+        fprintf(fp, ",%.4f", s->harm_rms[h]);
+    }
+    fputc('\n', fp);
+}
+
+// ===================== Usage =====================
+
+static void print_usage(const char* progName)
+{
+    printf("Usage: %s [OPTIONS] CHANNEL.i16...\n", progName);
+    printf("\nWelch PSD and mains summary of int16 sample columns (frameconv -f col output).\n");
+    printf("\nOptions:\n");
+    printf("  -r HZ             Sample rate (default %d)\n", DEFAULT_SAMPLE_RATE);
+    printf("  -n N              FFT size, power of two (default %d)\n", DEFAULT_FFT_SIZE);
+    printf("  --overlap PCT     Frame overlap 0-90%% (default %d)\n", DEFAULT_OVERLAP_PCT);
+    printf("  --segment N       Welch frames per parallel segment (default %d)\n", DEFAULT_SEGMENT_FRAMES);
+    printf("  --harmonics H     Harmonics in the summary, 2..H (default %d, max 63)\n", DEFAULT_HARMONICS);
+    printf("  -s FILE           Also write the summary table as CSV\n");
+    printf("  --no-psd          Do not write <name>.psd.csv\n");
+    printf("  -j N              Worker threads (default: all cores, max %d)\n", MAX_WORKERS);
+    printf("\nExamples:\n");
+    printf("  %s out/raw_frames_000.ch00.i16 out/raw_frames_000.ch01.i16\n", progName);
+    printf("  %s -r 20000 -n 8192 -s summary.csv out/*.i16\n", progName);
+}
+
+// ===================== Main Function =====================
+
+int main(int argc, char* argv[])
+{
+    int threads = cpu_count();
+    int overlapPct = DEFAULT_OVERLAP_PCT;
+    const char* summaryPath = NULL;
+    int argi = 1;
+
+    for (; argi < argc && argv[argi][0] == '-'; argi++) {
+        const char* opt = argv[argi];
+        bool hasValue = argi + 1 < argc;
+        if (strcmp(opt, "-h") == 0 || strcmp(opt, "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(opt, "-r") == 0 && hasValue) {
+            g_rate = (uint32_t)atoi(argv[++argi]);
+        } else if (strcmp(opt, "-n") == 0 && hasValue) {
+            g_fftSize = (uint32_t)atoi(argv[++argi]);
+        } else if (strcmp(opt, "--overlap") == 0 && hasValue) {
+            overlapPct = atoi(argv[++argi]);
+        } else if (strcmp(opt, "--segment") == 0 && hasValue) {
+            g_segmentFrames = (uint32_t)atoi(argv[++argi]);
+        } else if (strcmp(opt, "--harmonics") == 0 && hasValue) {
+            g_harmonics = (uint32_t)atoi(argv[++argi]);
+        } else if (strcmp(opt, "-s") == 0 && hasValue) {
+            summaryPath = argv[++argi];
+        } else if (strcmp(opt, "--no-psd") == 0) {
+            g_writePsd = false;
+        } else if (strcmp(opt, "-j") == 0 && hasValue) {
+            threads = atoi(argv[++argi]);
+        } else {
+            printf("Error: Invalid option '%s'.\n", opt);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argi >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (g_rate == 0 || overlapPct < 0 || overlapPct > 90 || g_segmentFrames < 2 ||
+        g_harmonics < 2 || g_harmonics > 63) {
+        printf("Error: Invalid rate, overlap, segment or harmonics value.\n");
+        return 1;
+    }
+    if (g_fftSize < 64 || fft_plan_init(&g_plan, g_fftSize) != 0) {
+        printf("Error: FFT size %u is not a power of two >= 64.\n", g_fftSize);
+        return 1;
+    }
+    g_hop = (uint32_t)((uint64_t)g_fftSize * (uint32_t)(100 - overlapPct) / 100);
+    if (g_hop == 0) g_hop = 1;
+    if (threads < 1) threads = 1;
+    if (threads > MAX_WORKERS) threads = MAX_WORKERS;
+
+    if (!init_window() || !plan_channels(argc - argi, argv + argi)) {
+        printf("Error: Out of memory.\n");
+        return 1;
+    }
+    if (g_channelCount == 0) {
+        printf("Error: No usable input files.\n");
+        return 1;
+    }
+    if ((uint32_t)threads > g_segmentCount) {
+        threads = (int)g_segmentCount;
+    }
+
+    int64_t totalSamples = 0;
+    for (uint32_t c = 0; c < g_channelCount; c++) {
+        totalSamples += g_channels[c].samples;
+    }
+    printf("=== Spectral Analysis ===\n");
+    printf("Channels: %u (%.1f s of data at %u Hz), segments: %u\n", g_channelCount,
+           (double)totalSamples / g_rate, g_rate, g_segmentCount);
+    printf("FFT: %u points (%.3f Hz/bin), Hann, %d%% overlap, workers: %d\n",
+           g_fftSize, (double)g_rate / g_fftSize, overlapPct, threads);
+
+    double t0 = now_seconds();
+    atomic_init(&g_nextSegment, 0u);
+    pthread_t tids[MAX_WORKERS];
+    int started = 0;
+    for (int w = 0; w < threads; w++) {
+        if (pthread_create(&tids[started], NULL, worker_main, NULL) == 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        worker_main(NULL);
+    }
+    for (int w = 0; w < started; w++) {
+        pthread_join(tids[w], NULL);
+    }
+    double elapsed = now_seconds() - t0;
+
+    FILE* summary = NULL;
+    if (summaryPath) {
+        summary = fopen(summaryPath, "w");
+        if (!summary) {
+            printf("[ERROR] Cannot create %s\n", summaryPath);
+        } else {
+            fprintf(summary, "file,samples,mean,rms,dc_rms,f1_hz,f1_rms,thd_pct,other_rms,duration_s");
+            for (uint32_t h = 2; h <= g_harmonics; h++) {
+                fprintf(summary, ",h%u_rms", h);
+            }
+            fputc('\n', summary);
+        }
+    }
+
+    int failed = 0;
+    printf("\n%-36s %10s %10s %9s %10s %8s %10s\n",
+           "channel", "rms", "dc", "f1 Hz", "f1 rms", "THD %", "other rms");
+    for (uint32_t c = 0; c < g_channelCount; c++) {
+        SpecChannel_t* ch = &g_channels[c];
+        SpecSummary_t s;
+        if (!finish_channel(ch, &s) || (g_writePsd && !write_psd(ch))) {
+            printf("[ERROR] %s: analysis failed\n", ch->path);
+            failed++;
+            continue;
+        }
+        printf("%-36s %10.2f %10.2f %9.3f %10.2f %8.2f %10.2f\n",
+               ch->path, s.rms, s.dc_rms, s.f1_hz, s.f1_rms, s.thd_pct, s.other_rms);
+        if (summary) {
+            write_summary_row(summary, ch, &s);
+        }
+    }
+    if (summary) {
+        fclose(summary);
+    }
+
+    printf("\nElapsed: %.3f s, %.1f Msamples/s\n", elapsed,
+           elapsed > 0 ? (double)totalSamples / 1e6 / elapsed : 0.0);
+    return failed ? 1 : 0;
+}
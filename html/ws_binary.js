@@ -0,0 +1,92 @@
+// Decoder for the data-processor binary WebSocket stream (version 1).
+//
+// Usage:
+//   ws.binaryType = 'arraybuffer';
+//   ws.onopen = () => WsBinary.request(ws, { sampleType: 'int16', pointsPerSecond: 2000 });
+//   ws.onmessage = event => { const msg = WsBinary.parse(event); ... };
+//
+// parse() returns JSON messages unchanged and turns binary frames into the
+// same shape as the JSON "data" message (channel-major `data`), plus
+// `channels` (per-channel typed arrays) and `decimation` (raw samples per
+// min/max bucket, 1 = not decimated).
+(function (global) {
+    'use strict';
+
+    const MAGIC = 0x53575044; // "DPWS" little-endian
+    const VERSION = 1;
+    const HEADER_LEN = 40;
+    const FLAG_TRIGGER = 0x01;
+    const FLAG_MINMAX = 0x02;
+
+    function decode(buffer) {
+        const view = new DataView(buffer);
+        if (buffer.byteLength < HEADER_LEN || view.getUint32(0, true) !== MAGIC) {
+            throw new Error('not a binary stream frame');
+        }
+        const version = view.getUint8(4);
+        if (version !== VERSION) {
+            throw new Error(`unsupported binary stream version ${version}`);
+        }
+        const sampleType = view.getUint8(5);
+        const flags = view.getUint8(6);
+        const channelCount = view.getUint8(7);
+        const width = sampleType === 2 ? 4 : 2;
+        const ArrayType = sampleType === 2 ? Float32Array : Int16Array;
+
+        const msg = {
+            type: 'data',
+            sequence: Number(view.getBigUint64(8, true)),
+            timestamp: Number(view.getBigUint64(16, true)),
+            sample_rate: view.getFloat32(24, true),
+            decimation: view.getUint32(28, true),
+            minmax: (flags & FLAG_MINMAX) !== 0,
+            channel_count: channelCount,
+            data_type: {
+                source: (flags & FLAG_TRIGGER) ? 'Trigger' : 'Continuous',
+                trigger_info: (flags & FLAG_TRIGGER) ? { trigger_timestamp: view.getUint32(32, true) } : null,
+            },
+            channels: [],
+        };
+
+        let tableOffset = HEADER_LEN;
+        let dataOffset = HEADER_LEN + channelCount * 4;
+        let total = 0;
+        for (let i = 0; i < channelCount; i++) {
+            const channelId = view.getUint8(tableOffset);
+            const points = view.getUint16(tableOffset + 2, true);
+            // Offsets stay aligned to the sample width, so the arrays are views, not copies
+            msg.channels.push({ channel_id: channelId, samples: new ArrayType(buffer, dataOffset, points) });
+            tableOffset += 4;
+            dataOffset += points * width;
+            total += points;
+        }
+
+        msg.data = new ArrayType(total);
+        let at = 0;
+        for (const ch of msg.channels) {
+            msg.data.set(ch.samples, at);
+            at += ch.samples.length;
+        }
+        return msg;
+    }
+
+    function parse(event) {
+        if (typeof event.data === 'string') {
+            return JSON.parse(event.data);
+        }
+        return decode(event.data);
+    }
+
+    // Switch this connection to binary data messages. pointsPerSecond is the
+    // per-channel target rate served by min/max decimation (0 = full rate).
+    function request(ws, { sampleType = 'int16', pointsPerSecond = 0 } = {}) {
+        ws.send(JSON.stringify({
+            type: 'stream_format',
+            format: 'binary',
+            sample_type: sampleType,
+            points_per_second: pointsPerSecond,
+        }));
+    }
+
+    global.WsBinary = { decode, parse, request, VERSION };
+})(typeof window !== 'undefined' ? window : globalThis);
@@ -0,0 +1,151 @@
+// File: acquisition.c
+// Description: Double-buffered DMA acquisition pipeline - ping-pong halves to DATA_PACKET payloads
+// Version: v2.1
+
+#include "acquisition.h"
+#include <string.h>
+#include <stdatomic.h>
+
+// ===================== Internal State =====================
+
+// Circular DMA target, both halves. Sized for the worst case so the layout
+// never depends on the runtime configuration.
+static uint16_t g_dma_buffer[2 * ACQ_MAX_FRAMES_PER_HALF * MAX_ADC_CHANNELS];
+
+static AcqConfig_t g_acq_cfg;
+static void*       g_acq_adc = NULL;
+static bool        g_acq_running = false;
+
+// Half k (k = completion sequence number) lives in buffer half k & 1 and stays
+// intact until completion k + 2 starts overwriting it.
+static _Atomic uint32_t g_halves_produced;  // Written by the DMA interrupt only
+static uint32_t         g_halves_consumed;  // Written by the packet loop only
+
+static AcqStats_t g_acq_stats;
+
+// ===================== DMA Interrupt =====================
+
+static void acq_dma_complete(void* context, uint8_t half) {
+    (void)context;
+    (void)half; // Halves alternate strictly; the sequence number identifies them
+    atomic_fetch_add_explicit(&g_halves_produced, 1, memory_order_release);
+}
+
+// ===================== Control =====================
+
+bool acq_start(void* adc_handle, const AcqConfig_t* cfg) {
+    if (!cfg || cfg->channel_count == 0 || cfg->channel_count > MAX_ADC_CHANNELS ||
+        cfg->frames_per_half == 0 || cfg->frames_per_half > ACQ_MAX_FRAMES_PER_HALF ||
+        cfg->sample_rate_hz == 0) {
+        return false;
+    }
+    if (g_acq_running) {
+        acq_stop();
+    }
+
+    g_acq_cfg = *cfg;
+    g_acq_adc = adc_handle;
+    memset(&g_acq_stats, 0, sizeof(g_acq_stats));
+    atomic_store_explicit(&g_halves_produced, 0, memory_order_relaxed);
+    g_halves_consumed = 0;
+
+    uint32_t length = 2u * cfg->frames_per_half * cfg->channel_count;
+    if (adc_register_dma(adc_handle, g_dma_buffer, length, acq_dma_complete, NULL) != HAL_OK) {
+        return false;
+    }
+    if (adc_start_continuous(adc_handle, g_acq_cfg.channels, cfg->channel_count,
+                             cfg->sample_rate_hz) != HAL_OK) {
+        return false;
+    }
+
+    g_acq_running = true;
+    return true;
+}
+
+void acq_stop(void) {
+    if (!g_acq_running) {
+        return;
+    }
+    adc_stop_continuous(g_acq_adc);
+    g_acq_running = false;
+}
+
+bool acq_is_running(void) {
+    return g_acq_running;
+}
+
+uint32_t acq_pending(void) {
+    return atomic_load_explicit(&g_halves_produced, memory_order_acquire) - g_halves_consumed;
+}
+
+// ===================== Packet Assembly =====================
+
+uint16_t acq_build_packet(uint8_t* payload, uint16_t capacity) {
+    const uint16_t frames = g_acq_cfg.frames_per_half;
+    const uint8_t  channels = g_acq_cfg.channel_count;
+    const uint32_t needed = 8u + (uint32_t)frames * channels * sizeof(int16_t);
+
+    if (!g_acq_running || capacity < needed) {
+        return 0;
+    }
+
+    uint32_t produced = atomic_load_explicit(&g_halves_produced, memory_order_acquire);
+    uint32_t backlog = produced - g_halves_consumed;
+    if (backlog == 0) {
+        return 0;
+    }
+    if (backlog > g_acq_stats.max_backlog) {
+        g_acq_stats.max_backlog = backlog;
+    }
+    g_acq_stats.halves_completed = produced;
+
+    // Only the newest completed half is guaranteed intact - older ones are
+    // already being overwritten by DMA
+    if (backlog > 1) {
+        g_acq_stats.overruns += backlog - 1;
+        g_halves_consumed = produced - 1;
+    }
+
+    uint32_t seq = g_halves_consumed;
+    const uint16_t* half = g_dma_buffer + (seq & 1u) * (uint32_t)frames * channels;
+
+    // Header: timestamp derived from the sample position, so gaps show up as jumps
+    uint32_t timestamp = (uint32_t)(((uint64_t)seq * frames * 1000u) / g_acq_cfg.sample_rate_hz);
+    uint16_t channel_mask = 0;
+    for (uint8_t c = 0; c < channels; c++) {
+        channel_mask |= (uint16_t)(1u << g_acq_cfg.channels[c]);
+    }
+    uint16_t offset = 0;
+    memcpy(payload + offset, &timestamp, sizeof(timestamp));
+    offset += sizeof(timestamp);
+    memcpy(payload + offset, &channel_mask, sizeof(channel_mask));
+    offset += sizeof(channel_mask);
+    memcpy(payload + offset, &frames, sizeof(frames));
+    offset += sizeof(frames);
+
+    // De-interleave scan frames into per-channel blocks (non-interleaved format)
+    for (uint8_t c = 0; c < channels; c++) {
+        const uint16_t* src = half + c;
+        for (uint16_t f = 0; f < frames; f++) {
+            int16_t sample = (int16_t)(src[(uint32_t)f * channels] - 32768);
+            memcpy(payload + offset, &sample, sizeof(sample));
+            offset += sizeof(sample);
+        }
+    }
+
+    // If DMA wrapped around onto this half while we copied, the data is mixed
+    produced = atomic_load_explicit(&g_halves_produced, memory_order_acquire);
+    g_halves_consumed = seq + 1;
+    if (produced - seq >= 2) {
+        g_acq_stats.torn_reads++;
+        return 0;
+    }
+
+    g_acq_stats.halves_consumed++;
+    return offset;
+}
+
+void acq_get_stats(AcqStats_t* stats) {
+    *stats = g_acq_stats;
+    stats->halves_completed = atomic_load_explicit(&g_halves_produced, memory_order_acquire);
+}
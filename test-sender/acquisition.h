@@ -0,0 +1,56 @@
+// File: acquisition.h
+// Description: Double-buffered DMA acquisition pipeline (MCU mode, host-testable)
+// Version: v2.1
+
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+#include "mcu_hal.h"
+
+// ===================== Configuration =====================
+
+// The ADC runs in scan mode with circular DMA into one buffer split in two
+// halves. While DMA fills one half, the packet loop converts the other, so
+// every DATA_PACKET is built from one whole completed half.
+typedef struct {
+    uint8_t  channel_count;
+    uint8_t  channels[MAX_ADC_CHANNELS];    // ADC channel numbers, scan order
+    uint32_t sample_rate_hz;                // Per-channel scan rate
+    uint16_t frames_per_half;               // Scan frames per half (<= ACQ_MAX_FRAMES_PER_HALF)
+} AcqConfig_t;
+
+typedef struct {
+    uint32_t halves_completed;      // DMA half/full complete interrupts
+    uint32_t halves_consumed;       // Halves turned into packets
+    uint32_t overruns;              // Halves overwritten before they were consumed
+    uint32_t torn_reads;            // Halves overwritten while being copied
+    uint32_t max_backlog;           // Most completed-but-unconsumed halves seen
+} AcqStats_t;
+
+// A packet built from one half must fit a pool packet block
+STATIC_ASSERT(8 + ACQ_FRAMES_PER_HALF * MAX_ADC_CHANNELS * 2 <= POOL_PACKET_BLOCK_SIZE,
+              acq_half_exceeds_packet_block);
+
+// ===================== Function Declarations =====================
+
+// Register the DMA buffer and start continuous conversion
+bool acq_start(void* adc_handle, const AcqConfig_t* cfg);
+void acq_stop(void);
+bool acq_is_running(void);
+
+// Number of completed halves waiting to be consumed
+uint32_t acq_pending(void);
+
+// Build one DATA_PACKET payload (timestamp, channel mask, sample count,
+// non-interleaved int16 samples) from the newest completed half. Older
+// halves are already being overwritten by DMA, so they are skipped and
+// counted as overruns. Returns the payload length, or 0 if no half is ready.
+uint16_t acq_build_packet(uint8_t* payload, uint16_t capacity);
+
+void acq_get_stats(AcqStats_t* stats);
+
+#endif // ACQUISITION_H
@@ -0,0 +1,168 @@
+// File: acq_bench.c
+// Description: Host benchmark/self-check for the DMA acquisition pipeline (acquisition.c)
+//              running against the emulated DMA HAL in mcu_hal_host.c
+// Version: v2.1
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "acquisition.h"
+#include "mcu_hal_host.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_sleep_us(uint32_t us) {
+    struct timespec ts = { (time_t)(us / 1000000u), (long)(us % 1000000u) * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --rate <hz>          Per-channel sample rate (default 100000)\n");
+    printf("  --channels <n>       Scanned channels (default 2, max %d)\n", MAX_ADC_CHANNELS);
+    printf("  --frames <n>         Scan frames per half (default %d)\n", ACQ_FRAMES_PER_HALF);
+    printf("  --seconds <n>        Run time (default 5)\n");
+    printf("  --consumer-delay <us> Extra work per packet to provoke overruns\n");
+    printf("  --stress             Produce halves as fast as possible (no pacing)\n");
+}
+
+// Check one packet against the emulated sample pattern. Returns the first
+// ch0 pattern value, or -1 if the samples are inconsistent (torn half).
+static int32_t verify_packet(const uint8_t* payload, uint8_t channels) {
+    uint16_t count;
+    memcpy(&count, payload + 6, sizeof(count));
+
+    int16_t first;
+    memcpy(&first, payload + 8, sizeof(first));
+
+    for (uint8_t c = 0; c < channels; c++) {
+        for (uint16_t f = 0; f < count; f++) {
+            int16_t sample;
+            memcpy(&sample, payload + 8 + ((uint32_t)c * count + f) * sizeof(int16_t), sizeof(sample));
+            if (sample != HOST_ADC_PATTERN((uint32_t)first + f, c)) {
+                return -1;
+            }
+        }
+    }
+    return first;
+}
+
+int main(int argc, char* argv[]) {
+    AcqConfig_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.sample_rate_hz = 100000;
+    cfg.channel_count = 2;
+    cfg.frames_per_half = ACQ_FRAMES_PER_HALF;
+    uint32_t seconds = 5;
+    uint32_t consumer_delay_us = 0;
+    bool stress = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            cfg.sample_rate_hz = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            cfg.channel_count = (uint8_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            cfg.frames_per_half = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--consumer-delay") == 0 && i + 1 < argc) {
+            consumer_delay_us = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--stress") == 0) {
+            stress = true;
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    for (uint8_t c = 0; c < cfg.channel_count && c < MAX_ADC_CHANNELS; c++) {
+        cfg.channels[c] = c;
+    }
+
+    host_adc_set_realtime(!stress);
+    if (!acq_start(adc_get_handle(), &cfg)) {
+        fprintf(stderr, "acq_start failed (check --channels/--frames)\n");
+        return 1;
+    }
+
+    printf("=== Acquisition bench: %u Hz x %u ch, %u frames/half, %s, %us ===\n",
+           (unsigned)cfg.sample_rate_hz, (unsigned)cfg.channel_count, (unsigned)cfg.frames_per_half,
+           stress ? "stress" : "real-time", (unsigned)seconds);
+
+    static uint8_t payload[8 + ACQ_MAX_FRAMES_PER_HALF * MAX_ADC_CHANNELS * 2];
+    uint64_t packets = 0, build_ns_total = 0, build_ns_max = 0;
+    uint32_t verify_errors = 0, gaps = 0;
+    int32_t prev_first = -1;
+
+    const uint64_t start_ns = bench_now_ns();
+    const uint64_t end_ns = start_ns + (uint64_t)seconds * 1000000000ull;
+
+    while (bench_now_ns() < end_ns) {
+        uint64_t t0 = bench_now_ns();
+        uint16_t len = acq_build_packet(payload, sizeof(payload));
+        uint64_t elapsed = bench_now_ns() - t0;
+
+        if (len == 0) {
+            if (!stress) {
+                bench_sleep_us(50);
+            }
+            continue;
+        }
+
+        packets++;
+        build_ns_total += elapsed;
+        if (elapsed > build_ns_max) {
+            build_ns_max = elapsed;
+        }
+
+        int32_t first = verify_packet(payload, cfg.channel_count);
+        if (first < 0) {
+            verify_errors++;
+        } else {
+            if (prev_first >= 0 && first != ((prev_first + cfg.frames_per_half) & 0x7FFF)) {
+                gaps++;
+            }
+            prev_first = first;
+        }
+
+        if (consumer_delay_us) {
+            bench_sleep_us(consumer_delay_us);
+        }
+    }
+
+    const double wall_s = (double)(bench_now_ns() - start_ns) / 1e9;
+    acq_stop();
+
+    AcqStats_t stats;
+    HostAdcStats_t host;
+    acq_get_stats(&stats);
+    host_adc_get_stats(&host);
+
+    printf("Halves completed:   %u (%.0f/s)\n", (unsigned)stats.halves_completed,
+           stats.halves_completed / wall_s);
+    printf("Packets built:      %llu (%.0f samples/s per channel)\n", (unsigned long long)packets,
+           (double)packets * cfg.frames_per_half / wall_s);
+    printf("Build cost:         avg %.0f ns, max %llu ns (%.1f ns/sample)\n",
+           packets ? (double)build_ns_total / packets : 0.0, (unsigned long long)build_ns_max,
+           packets ? (double)build_ns_total / ((double)packets * cfg.frames_per_half * cfg.channel_count) : 0.0);
+    printf("Overruns:           %u halves (max backlog %u)\n", (unsigned)stats.overruns,
+           (unsigned)stats.max_backlog);
+    printf("Torn reads:         %u\n", (unsigned)stats.torn_reads);
+    printf("Sequence gaps:      %u\n", (unsigned)gaps);
+    printf("Verify errors:      %u\n", (unsigned)verify_errors);
+    if (!stress) {
+        printf("Late DMA halves:    %u\n", (unsigned)host.late_halves);
+    }
+
+    // Inconsistent packets must never reach the link; losses must be accounted for
+    bool ok = verify_errors == 0 && gaps <= stats.overruns + stats.torn_reads;
+    printf("Result:             %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,554 @@
+// File: e2e_bench.c
+// Description: In-process end-to-end throughput bench. The simulator's data
+//              generation (channel_model.c, V6 framing) streams through a
+//              stand-in send queue over a socketpair or loopback TCP into the reader's
+//              pipeline (rx buffer, parseFrame, decode_data_packet, power
+//              quality + NILM, batched raw frame persistence). Ramps channels x
+//              rate until a loss/latency SLO breaks and reports the knee point,
+//              CPU per Msample and peak memory.
+//
+//              The send queue is NOT platform_abstraction.c's: that one is
+//              tied to Winsock/USB CDC and does not build on the host. g_txq
+//              keeps the same SEND_QUEUE_SLOTS depth but only ever drops the
+//              newest frame - no block or drop-oldest policy, no block timeout
+//              and no queue statistics - so drop counts and queue peaks model
+//              the device under drop-newest, not the configured policy.
+// Version: v2.1
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "config.h"
+#include "channel_model.h"
+#include "protocol/protocol.h"
+#include "protocol/io_buffer.h"
+#include "data_packet.h"
+#include "power_quality.h"
+#include "nilm_detector.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// data-reader defaults (serialread.c)
+#define READER_READ_SIZE        10000
+#define READER_BATCH_FRAMES     500     // FRAME_BATCH_SAVE_COUNT
+#define READER_LOOP_SLEEP_US    1000    // Sleep(1) per loop pass
+
+#define MAX_SWEEP               16
+#define MAX_LATENCIES           (1u << 21)
+#define DRAIN_TIMEOUT_MS        2000    // Sender gives up on its queue after stop
+
+typedef struct {
+    int      fd;
+    uint8_t  channels;
+    uint32_t rate_hz;           // Per channel
+    uint64_t start_ns;
+    uint64_t stop_ns;
+
+    uint64_t samples_generated; // Per channel
+    uint64_t frames_generated;
+    uint64_t frames_dropped;    // Send queue full (device drop)
+    uint64_t queue_peak;
+    uint64_t cpu_ns;
+} Sim_t;
+
+// ===================== Timing =====================
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t bench_thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_sleep_us(uint32_t us) {
+    struct timespec ts = { (time_t)(us / 1000000u), (long)(us % 1000000u) * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+// ===================== Simulator End =====================
+
+// Stand-in for the device's send queue (see the file header): same depth,
+// drop-newest only. A full queue drops the new frame; its seq is still
+// consumed so the reader sees the gap.
+static struct {
+    uint8_t  frame[SEND_QUEUE_SLOTS][MAX_FRAME_SIZE];
+    uint16_t len[SEND_QUEUE_SLOTS];
+    uint32_t head, count;
+    uint16_t head_off;          // Bytes of the head frame already sent
+} g_txq;
+
+static void txq_pump(int fd) {
+    while (g_txq.count > 0) {
+        uint32_t h = g_txq.head;
+        ssize_t n = send(fd, g_txq.frame[h] + g_txq.head_off, g_txq.len[h] - g_txq.head_off, 0);
+        if (n <= 0) {
+            return;
+        }
+        g_txq.head_off += (uint16_t)n;
+        if (g_txq.head_off == g_txq.len[h]) {
+            g_txq.head = (h + 1) % SEND_QUEUE_SLOTS;
+            g_txq.count--;
+            g_txq.head_off = 0;
+        }
+    }
+}
+
+// The DATA_PACKET timestamp carries microseconds since the run started so
+// the reader can measure generation-to-decode latency from the frame alone.
+static void* sim_thread(void* arg) {
+    Sim_t* s = (Sim_t*)arg;
+    const uint64_t cpu0 = bench_thread_cpu_ns();
+    const uint16_t max_samples = (uint16_t)((MAX_FRAME_PAYLOAD - 8) / (2u * s->channels));
+    static ChannelModel_t chm;
+    static int16_t block[MAX_FRAME_PAYLOAD / 2];
+    static uint8_t payload[MAX_FRAME_PAYLOAD];
+    uint8_t seq = 0;
+
+    chan_init(&chm, MAX_CHANNELS_SUPPORTED);
+    for (uint8_t ch = 0; ch < s->channels; ch++) {
+        chan_enable(&chm, ch, s->rate_hz, FORMAT_INT16);
+    }
+    memset(&g_txq, 0, sizeof(g_txq));
+
+    for (;;) {
+        uint64_t now = bench_now_ns();
+        if (now >= s->stop_ns) {
+            break;
+        }
+        uint64_t due = (now - s->start_ns) * s->rate_hz / 1000000000ull;
+
+        while (s->samples_generated < due) {
+            uint64_t left = due - s->samples_generated;
+            uint16_t count = left > max_samples ? max_samples : (uint16_t)left;
+            uint32_t ts_us = (uint32_t)((bench_now_ns() - s->start_ns) / 1000);
+            uint16_t mask = chm.enabled_mask;
+            uint16_t off = 0;
+
+            memcpy(payload + off, &ts_us, sizeof(ts_us));
+            off += sizeof(ts_us);
+            memcpy(payload + off, &mask, sizeof(mask));
+            off += sizeof(mask);
+            memcpy(payload + off, &count, sizeof(count));
+            off += sizeof(count);
+            for (uint8_t ch = 0; ch < s->channels; ch++) {
+                chan_generate(&chm, ch, (uint32_t)s->samples_generated, count, block);
+                memcpy(payload + off, block, count * sizeof(int16_t));
+                off += (uint16_t)(count * sizeof(int16_t));
+            }
+            s->samples_generated += count;
+            s->frames_generated++;
+
+            if (g_txq.count == SEND_QUEUE_SLOTS) {
+                s->frames_dropped++;
+                seq++;
+                continue;
+            }
+            uint32_t tail = (g_txq.head + g_txq.count) % SEND_QUEUE_SLOTS;
+            uint16_t len = MAX_FRAME_SIZE;
+            if (buildFrame(CMD_DATA_PACKET, seq++, payload, off, g_txq.frame[tail], &len) != 0) {
+                fprintf(stderr, "buildFrame failed (%u bytes payload)\n", (unsigned)off);
+                s->frames_dropped++;
+                continue;
+            }
+            g_txq.len[tail] = len;
+            g_txq.count++;
+            if (g_txq.count > s->queue_peak) {
+                s->queue_peak = g_txq.count;
+            }
+            txq_pump(s->fd);
+        }
+        txq_pump(s->fd);
+        bench_sleep_us(DATA_SEND_INTERVAL_MS * 1000);
+    }
+
+    // Hand over what is still queued, then end the stream
+    uint64_t give_up = bench_now_ns() + DRAIN_TIMEOUT_MS * 1000000ull;
+    while (g_txq.count > 0 && bench_now_ns() < give_up) {
+        txq_pump(s->fd);
+        bench_sleep_us(100);
+    }
+    s->frames_dropped += g_txq.count;
+    shutdown(s->fd, SHUT_WR);
+    s->cpu_ns = bench_thread_cpu_ns() - cpu0;
+    return NULL;
+}
+
+// ===================== Reader End =====================
+
+typedef struct {
+    uint8_t* data;
+    uint16_t len;
+} RawFrame_t;
+
+static struct {
+    FILE*      fp;
+    RawFrame_t batch[READER_BATCH_FRAMES];
+    int        in_batch;
+
+    PqEngine_t     pq;
+    NilmDetector_t nilm;
+    uint64_t   pq_cycles;
+
+    uint64_t   frames;
+    uint64_t   bytes;
+    uint64_t   samples;         // Per channel, decoded
+    uint64_t   bad_packets;
+    uint64_t   seq_lost;        // Seq gaps: sender drops consume a seq, so they count here too
+    int        last_seq;
+
+    uint64_t   start_ns;
+    uint32_t*  lat_us;
+    uint32_t   lat_count;
+} g_rd;
+
+static void flush_batch(void) {
+    for (int i = 0; i < g_rd.in_batch; i++) {
+        if (g_rd.fp) {
+            fprintf(g_rd.fp, "LEN:%u HEX:", g_rd.batch[i].len);
+            for (uint16_t j = 0; j < g_rd.batch[i].len; j++) {
+                fprintf(g_rd.fp, " %02X", g_rd.batch[i].data[j]);
+            }
+            fputc('\n', g_rd.fp);
+        }
+        free(g_rd.batch[i].data);
+    }
+    if (g_rd.fp) fflush(g_rd.fp);
+    g_rd.in_batch = 0;
+}
+
+static void cache_frame(const uint8_t* frame, uint16_t len) {
+    uint8_t* copy = (uint8_t*)malloc(len);
+    if (!copy) return;
+    memcpy(copy, frame, len);
+    g_rd.batch[g_rd.in_batch].data = copy;
+    g_rd.batch[g_rd.in_batch].len = len;
+    if (++g_rd.in_batch >= READER_BATCH_FRAMES) {
+        flush_batch();
+    }
+}
+
+static void on_pq_cycle(const PqCycle_t* c, void* user) {
+    (void)user;
+    g_rd.pq_cycles++;
+    nilm_process(&g_rd.nilm, c);
+}
+
+static void on_frame(const uint8_t* frame, uint16_t frameLen) {
+    uint8_t cmd = 0, seq = 0;
+    uint8_t payload[MAX_FRAME_SIZE];
+    uint16_t payloadLen = 0;
+
+    cache_frame(frame, frameLen);
+    if (parseFrame(frame, frameLen, &cmd, &seq, payload, &payloadLen) != 0) {
+        return;    // Shows up as a seq gap
+    }
+    g_rd.frames++;
+    g_rd.bytes += frameLen;
+    if (g_rd.last_seq >= 0) {
+        g_rd.seq_lost += (uint8_t)(seq - (uint8_t)(g_rd.last_seq + 1));
+    }
+    g_rd.last_seq = seq;
+
+    DataPacket_t pkt;
+    if (!decode_data_packet(cmd, payload, payloadLen, &pkt)) {
+        g_rd.bad_packets++;
+        return;
+    }
+    if (pkt.blocks[0] && pkt.blocks[1] && pkt.counts[0] == pkt.counts[1]) {
+        pq_process(&g_rd.pq, pkt.blocks[0], pkt.blocks[1], pkt.counts[0], pkt.timestamp);
+    }
+    g_rd.samples += pkt.counts[0];
+
+    uint64_t now_us = (bench_now_ns() - g_rd.start_ns) / 1000;
+    if (now_us >= pkt.timestamp && g_rd.lat_count < MAX_LATENCIES) {
+        g_rd.lat_us[g_rd.lat_count++] = (uint32_t)(now_us - pkt.timestamp);
+    }
+}
+
+// ===================== Transport =====================
+
+static bool open_link(bool tcp, int fds[2]) {
+    if (!tcp) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            perror("socketpair");
+            return false;
+        }
+    } else {
+        struct sockaddr_in addr;
+        socklen_t alen = sizeof(addr);
+        int one = 1;
+        int ls = socket(AF_INET, SOCK_STREAM, 0);
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (ls < 0 || bind(ls, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(ls, 1) != 0 ||
+            getsockname(ls, (struct sockaddr*)&addr, &alen) != 0) {
+            perror("loopback listen");
+            return false;
+        }
+        fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+        if (fds[0] < 0 || connect(fds[0], (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            perror("loopback connect");
+            close(ls);
+            return false;
+        }
+        fds[1] = accept(ls, NULL, NULL);
+        close(ls);
+        if (fds[1] < 0) {
+            perror("loopback accept");
+            return false;
+        }
+        // The simulator disables Nagle on its data socket
+        setsockopt(fds[0], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+// ===================== Ramp =====================
+
+typedef struct {
+    uint8_t  channels;
+    uint32_t rate_hz;
+    double   msps;              // Aggregate Msample/s delivered
+    double   cpu_us_per_ms;     // Both ends, CPU microseconds per Msample
+    bool     ok;
+} Point_t;
+
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t parse_list(const char* s, uint32_t* out, uint32_t max) {
+    uint32_t n = 0;
+    while (*s && n < max) {
+        out[n++] = (uint32_t)strtoul(s, (char**)&s, 10);
+        while (*s == ',') s++;
+    }
+    return n;
+}
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --channels <list>     Channel counts to ramp (default 1,2,4,8,16)\n");
+    printf("  --rates <list>        Per-channel rates in Hz, ascending\n");
+    printf("                        (default 1000,10000,50000,100000,200000,500000,1000000)\n");
+    printf("  --seconds <n>         Run time per point (default 3)\n");
+    printf("  --max-loss <ppm>      Loss SLO, frames per million (default 0)\n");
+    printf("  --max-p99-ms <ms>     Latency SLO, generation to decode (default 100)\n");
+    printf("  --tcp                 Loopback TCP instead of a socketpair\n");
+    printf("  --out <file>          Raw frame file (default e2e_frames.txt, removed at exit)\n");
+    printf("  --keep                Keep the raw frame file\n");
+    printf("  --reader-sleep <us>   Reader loop sleep (default %d, data-reader's Sleep(1))\n", READER_LOOP_SLEEP_US);
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t chans[MAX_SWEEP] = { 1, 2, 4, 8, 16 };
+    uint32_t chan_count = 5;
+    uint32_t rates[MAX_SWEEP] = { 1000, 10000, 50000, 100000, 200000, 500000, 1000000 };
+    uint32_t rate_count = 7;
+    uint32_t seconds = 3, max_loss_ppm = 0, max_p99_ms = 100, reader_sleep_us = READER_LOOP_SLEEP_US;
+    const char* out_path = "e2e_frames.txt";
+    bool tcp = false, keep = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            chan_count = parse_list(argv[++i], chans, MAX_SWEEP);
+        } else if (strcmp(argv[i], "--rates") == 0 && i + 1 < argc) {
+            rate_count = parse_list(argv[++i], rates, MAX_SWEEP);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-loss") == 0 && i + 1 < argc) {
+            max_loss_ppm = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-p99-ms") == 0 && i + 1 < argc) {
+            max_p99_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--reader-sleep") == 0 && i + 1 < argc) {
+            reader_sleep_us = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--tcp") == 0) {
+            tcp = true;
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    for (uint32_t c = 0; c < chan_count; c++) {
+        if (chans[c] < 1 || chans[c] > MAX_CHANNELS_SUPPORTED) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (chan_count == 0 || rate_count == 0 || seconds == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    static uint8_t buf[READER_READ_SIZE];
+    static RxBuffer_t rx;
+    g_rd.lat_us = (uint32_t*)malloc(MAX_LATENCIES * sizeof(uint32_t));
+    if (!g_rd.lat_us) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    pq_init(&g_rd.pq, DEFAULT_SAMPLE_RATE_HZ, on_pq_cycle, NULL);
+    nilm_init(&g_rd.nilm, NULL, NULL, NULL);
+
+    printf("=== E2E bench: simulator -> %s -> reader, %us/point, SLO loss <= %u ppm, p99 <= %u ms ===\n",
+           tcp ? "loopback TCP" : "socketpair", seconds, max_loss_ppm, max_p99_ms);
+    printf("%3s %8s %8s %8s %7s %8s %8s %7s %8s %8s %8s %9s %9s %7s %s\n",
+           "ch", "rate Hz", "MS/s", "MB/s", "kept", "lost", "q-drop", "queue", "p50 ms", "p99 ms",
+           "PQ cyc", "sim us/MS", "rdr us/MS", "RSS MB", "");
+
+    Point_t knee;
+    memset(&knee, 0, sizeof(knee));
+    uint64_t total_cpu_ns = 0, total_samples = 0;
+
+    for (uint32_t c = 0; c < chan_count; c++) {
+        for (uint32_t r = 0; r < rate_count; r++) {
+            int fds[2];
+            if (!open_link(tcp, fds)) {
+                return 1;
+            }
+            g_rd.fp = fopen(out_path, "w");
+            if (!g_rd.fp) {
+                perror(out_path);
+                return 1;
+            }
+            g_rd.in_batch = 0;
+            g_rd.frames = g_rd.bytes = g_rd.samples = 0;
+            g_rd.bad_packets = g_rd.seq_lost = 0;
+            g_rd.pq_cycles = 0;
+            g_rd.last_seq = -1;
+            g_rd.lat_count = 0;
+            initRxBuffer(&rx);
+            pq_set_rate(&g_rd.pq, rates[r]);
+            pq_reset(&g_rd.pq);
+            nilm_reset(&g_rd.nilm);
+
+            Sim_t sim;
+            memset(&sim, 0, sizeof(sim));
+            sim.fd = fds[0];
+            sim.channels = (uint8_t)chans[c];
+            sim.rate_hz = rates[r];
+            sim.start_ns = bench_now_ns();
+            sim.stop_ns = sim.start_ns + (uint64_t)seconds * 1000000000ull;
+            g_rd.start_ns = sim.start_ns;
+
+            pthread_t th;
+            pthread_create(&th, NULL, sim_thread, &sim);
+
+            // data-reader's loop: recv, feed, parse, Sleep(1) - until the stream ends
+            const uint64_t cpu0 = bench_thread_cpu_ns();
+            for (;;) {
+                ssize_t n = recv(fds[1], buf, sizeof(buf), 0);
+                if (n > 0) {
+                    feedRxBuffer(&rx, buf, (uint16_t)n);
+                    tryParseFramesFromRx(&rx, on_frame);
+                } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    break;
+                }
+                if (reader_sleep_us) {
+                    bench_sleep_us(reader_sleep_us);
+                }
+            }
+            flush_batch();
+            const uint64_t reader_cpu_ns = bench_thread_cpu_ns() - cpu0;
+            pthread_join(th, NULL);
+            close(fds[0]);
+            close(fds[1]);
+            fclose(g_rd.fp);
+            g_rd.fp = NULL;
+
+            // Offered load is the nominal rate; a generator that falls behind
+            // fails the point as surely as a reader that drops frames
+            double run_s = (double)seconds;
+            double nominal = (double)chans[c] * rates[r] * run_s;
+            double delivered = (double)g_rd.samples * chans[c];
+            double msps = delivered / run_s / 1e6;
+            double mbps = (double)g_rd.bytes / run_s / (1024.0 * 1024.0);
+            double kept = nominal > 0 ? 100.0 * delivered / nominal : 0.0;
+            // Lost = every generated frame that did not decode: seq gaps cover
+            // sender drops, link loss and CRC failures between arrivals; frames
+            // after the last arrival (or lost across a seq wrap) show only in
+            // the count
+            uint64_t seen = g_rd.frames + g_rd.seq_lost;
+            uint64_t unseen = sim.frames_generated > seen ? sim.frames_generated - seen : 0;
+            uint64_t lost = g_rd.seq_lost + unseen + g_rd.bad_packets;
+            uint64_t loss_ppm = sim.frames_generated ? lost * 1000000ull / sim.frames_generated : 0;
+
+            qsort(g_rd.lat_us, g_rd.lat_count, sizeof(uint32_t), cmp_u32);
+            double p50 = g_rd.lat_count ? g_rd.lat_us[g_rd.lat_count / 2] / 1000.0 : 0.0;
+            double p99 = g_rd.lat_count ? g_rd.lat_us[(uint64_t)g_rd.lat_count * 99 / 100] / 1000.0 : 0.0;
+            double msamples = delivered / 1e6;
+
+            struct rusage ru;
+            getrusage(RUSAGE_SELF, &ru);
+
+            bool ok = loss_ppm <= max_loss_ppm && p99 <= max_p99_ms && kept >= 99.0;
+            printf("%3u %8u %8.3f %8.2f %6.1f%% %8llu %8llu %7llu %8.1f %8.1f %8llu %9.0f %9.0f %7.1f %s\n",
+                   (unsigned)chans[c], (unsigned)rates[r], msps, mbps, kept,
+                   (unsigned long long)lost, (unsigned long long)sim.frames_dropped,
+                   (unsigned long long)sim.queue_peak, p50, p99, (unsigned long long)g_rd.pq_cycles,
+                   msamples > 0 ? sim.cpu_ns / 1000.0 / msamples : 0.0,
+                   msamples > 0 ? reader_cpu_ns / 1000.0 / msamples : 0.0,
+                   ru.ru_maxrss / 1024.0, ok ? "ok" : "SLO");
+            fflush(stdout);
+
+            if (ok) {
+                total_cpu_ns += sim.cpu_ns + reader_cpu_ns;
+                total_samples += (uint64_t)delivered;
+                if (msps > knee.msps) {
+                    knee.channels = (uint8_t)chans[c];
+                    knee.rate_hz = rates[r];
+                    knee.msps = msps;
+                    knee.cpu_us_per_ms = msamples > 0 ? (sim.cpu_ns + reader_cpu_ns) / 1000.0 / msamples : 0.0;
+                    knee.ok = true;
+                }
+            } else {
+                break;  // Higher rates at this channel count only get worse
+            }
+        }
+    }
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    if (!keep) {
+        remove(out_path);
+    }
+    free(g_rd.lat_us);
+
+    if (!knee.ok) {
+        printf("Result: FAIL (no point met the SLO)\n");
+        return 1;
+    }
+    printf("Knee:               %.3f MS/s (%u ch x %u Hz)\n", knee.msps, knee.channels, (unsigned)knee.rate_hz);
+    printf("CPU at knee:        %.0f us per Msample (simulator + reader)\n", knee.cpu_us_per_ms);
+    printf("CPU over passing:   %.0f us per Msample\n",
+           total_samples ? total_cpu_ns / 1000.0 / (total_samples / 1e6) : 0.0);
+    printf("Peak RSS:           %.1f MB\n", ru.ru_maxrss / 1024.0);
+    printf("Result:             PASS (knee %.3f MS/s)\n", knee.msps);
+    return 0;
+}
@@ -0,0 +1,158 @@
+// File: mcu_hal_host.c
+// Description: Host (POSIX) stand-in for the MCU ADC/DMA HAL - a thread fills the
+//              circular buffer and raises half/full complete callbacks like DMA would
+// Version: v2.1
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "mcu_hal_host.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// ===================== Emulated DMA State =====================
+
+typedef struct {
+    uint16_t*          buffer;
+    uint32_t           length;
+    adc_dma_callback_t callback;
+    void*              context;
+    uint8_t            channel_count;
+    uint32_t           sample_rate;
+    volatile bool      running;
+    pthread_t          thread;
+} HostAdc_t;
+
+static HostAdc_t      g_host_adc;
+static bool           g_host_realtime = true;
+static HostAdcStats_t g_host_stats;
+
+// Frames are written in slices so a slow reader can observe a half being
+// overwritten, exactly like a real DMA stream
+#define HOST_DMA_SLICES             8
+
+static uint64_t host_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void host_sleep_until(uint64_t deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static void* host_dma_thread(void* arg) {
+    HostAdc_t* adc = (HostAdc_t*)arg;
+    const uint32_t frames_per_half = adc->length / 2 / adc->channel_count;
+    const uint32_t slice = frames_per_half / HOST_DMA_SLICES ? frames_per_half / HOST_DMA_SLICES : 1;
+    const double ns_per_frame = 1e9 / (double)adc->sample_rate;
+    const uint64_t start_ns = host_now_ns();
+    uint64_t frame = 0;
+    uint8_t half = 0;
+
+    while (adc->running) {
+        uint16_t* dst = adc->buffer + (uint32_t)half * frames_per_half * adc->channel_count;
+
+        for (uint32_t f = 0; f < frames_per_half && adc->running; f++, frame++) {
+            for (uint8_t c = 0; c < adc->channel_count; c++) {
+                dst[f * adc->channel_count + c] = (uint16_t)(32768 + HOST_ADC_PATTERN(frame, c));
+            }
+            if (g_host_realtime && (f + 1) % slice == 0) {
+                host_sleep_until(start_ns + (uint64_t)((double)(frame + 1) * ns_per_frame));
+            }
+        }
+        if (!adc->running) {
+            break;
+        }
+
+        if (g_host_realtime &&
+            host_now_ns() > start_ns + (uint64_t)((double)frame * ns_per_frame) + 1000000ull) {
+            g_host_stats.late_halves++;
+        }
+        g_host_stats.frames_written = frame;
+        g_host_stats.halves_signalled++;
+        adc->callback(adc->context, half);
+        half ^= 1;
+    }
+    return NULL;
+}
+
+// ===================== mcu_hal.h Implementation =====================
+
+hal_status_t adc_register_dma(void* handle, uint16_t* buffer, uint32_t length,
+                              adc_dma_callback_t callback, void* context) {
+    (void)handle;
+    if (!buffer || length < 2 || !callback || g_host_adc.running) {
+        return HAL_ERROR;
+    }
+    g_host_adc.buffer = buffer;
+    g_host_adc.length = length;
+    g_host_adc.callback = callback;
+    g_host_adc.context = context;
+    return HAL_OK;
+}
+
+hal_status_t adc_start_continuous(void* handle, uint8_t* channels, uint8_t channel_count, uint32_t sample_rate) {
+    (void)handle;
+    (void)channels;
+    if (!g_host_adc.buffer || channel_count == 0 || sample_rate == 0 ||
+        g_host_adc.length % (2u * channel_count) != 0) {
+        return HAL_ERROR;
+    }
+    g_host_adc.channel_count = channel_count;
+    g_host_adc.sample_rate = sample_rate;
+    memset(&g_host_stats, 0, sizeof(g_host_stats));
+    g_host_adc.running = true;
+    if (pthread_create(&g_host_adc.thread, NULL, host_dma_thread, &g_host_adc) != 0) {
+        g_host_adc.running = false;
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+hal_status_t adc_stop_continuous(void* handle) {
+    (void)handle;
+    if (g_host_adc.running) {
+        g_host_adc.running = false;
+        pthread_join(g_host_adc.thread, NULL);
+    }
+    return HAL_OK;
+}
+
+void* adc_get_handle(void) {
+    return &g_host_adc;
+}
+
+uint32_t hal_get_tick(void) {
+    return (uint32_t)(host_now_ns() / 1000000ull);
+}
+
+uint32_t hal_get_tick_us(void) {
+    return (uint32_t)(host_now_ns() / 1000ull);
+}
+
+void hal_delay_ms(uint32_t ms) {
+    host_sleep_until(host_now_ns() + (uint64_t)ms * 1000000ull);
+}
+
+void debug_printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+// ===================== Host Controls =====================
+
+void host_adc_set_realtime(bool realtime) {
+    g_host_realtime = realtime;
+}
+
+void host_adc_get_stats(HostAdcStats_t* stats) {
+    *stats = g_host_stats;
+}
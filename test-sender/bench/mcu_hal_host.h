@@ -0,0 +1,29 @@
+// File: mcu_hal_host.h
+// Description: Host (POSIX) stand-in for the MCU ADC/DMA HAL - bench and test builds only
+// Version: v2.1
+
+#ifndef MCU_HAL_HOST_H
+#define MCU_HAL_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mcu_hal.h"
+
+// Emulated samples follow a known pattern so consumers can verify continuity:
+// channel c at global scan frame n reads HOST_ADC_PATTERN(n, c) after the
+// usual (raw - 32768) conversion.
+#define HOST_ADC_PATTERN(n, c)      ((int16_t)(((n) + (uint32_t)(c) * 4099u) & 0x7FFF))
+
+typedef struct {
+    uint64_t frames_written;
+    uint32_t halves_signalled;
+    uint32_t late_halves;           // Real-time mode: halves signalled behind schedule
+} HostAdcStats_t;
+
+// Real-time mode paces DMA at the configured sample rate (default); otherwise
+// halves are produced as fast as possible to stress the consumer.
+void host_adc_set_realtime(bool realtime);
+void host_adc_get_stats(HostAdcStats_t* stats);
+
+#endif // MCU_HAL_HOST_H
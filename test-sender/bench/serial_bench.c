@@ -0,0 +1,513 @@
+// File: serial_bench.c
+// Description: Model of the serial transport over a pseudo-terminal pair
+//              This is a model, not a measurement of the shipped serial path.
+//              Both ends are stand-ins written for the bench:
+//              - The master end stands in for the simulator: V6 DATA_PACKET
+//                frames paced to the line rate of the chosen baud (8N1),
+//                written non-blocking so a full receive buffer drops bytes the
+//                way a UART overrun does. The simulator itself has no host
+//                serial backend (Winsock in SIMULATION_MODE, USB CDC on the MCU).
+//              - The slave end stands in for data-reader's serial backend:
+//                ReadFile with COMMTIMEOUTS semantics is emulated on top of
+//                poll/read. The read size and the feedRxBuffer/
+//                tryParseFramesFromRx/parseFrame parsing path are the real
+//                ones. open_serial_connection/conn_read_data are Win32-only
+//                and are not exercised.
+//              A pty does not enforce the baud rate, so only the writer's
+//              pacing reflects the line speed. Sweeps baud rates and read
+//              timeouts and reports throughput, latency and loss as the model
+//              predicts them; confirm results on real hardware.
+// Version: v2.1
+
+#define _XOPEN_SOURCE 700
+#define _DEFAULT_SOURCE
+
+#include "config.h"
+#include "protocol/protocol.h"
+#include "protocol/io_buffer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CMD_DATA_PACKET         0x40
+
+// data-reader defaults (serialread.c)
+#define READER_READ_SIZE        10000
+#define READER_LOOP_SLEEP_US    1000
+
+#define MAX_SWEEP               16
+#define MAX_LATENCIES           (1u << 20)
+#define DRAIN_IDLE_MS           500     // Receive quiet time that ends a run
+#define WIN32_MAXDWORD          0xFFFFFFFFu
+
+typedef struct {
+    uint32_t interval;          // ReadIntervalTimeout
+    uint32_t constant;          // ReadTotalTimeoutConstant
+    uint32_t multiplier;        // ReadTotalTimeoutMultiplier
+} ReadTimeouts_t;
+
+typedef struct {
+    int      fd;
+    uint32_t baud;
+    uint32_t load_pct;          // Offered load, percent of line rate
+    uint8_t  channels;
+    uint16_t samples;           // Per channel per packet
+    uint64_t stop_ns;
+
+    uint64_t frames_sent;
+    uint64_t bytes_offered;
+    uint64_t bytes_dropped;     // Not accepted by the pty (receiver overrun)
+} Writer_t;
+
+// ===================== Timing =====================
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_sleep_us(uint32_t us) {
+    struct timespec ts = { (time_t)(us / 1000000u), (long)(us % 1000000u) * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+// ===================== Receive Statistics =====================
+
+// Send time per seq; frames in flight stay far below 256 at these rates
+static volatile uint64_t g_sent_ns[256];
+
+static struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t parse_errors;
+    uint64_t seq_gaps;
+    uint64_t seq_lost;
+    int      last_seq;
+    uint32_t* lat_us;
+    uint32_t lat_count;
+} g_rx;
+
+static void on_frame(const uint8_t* frame, uint16_t frameLen) {
+    uint8_t cmd = 0, seq = 0;
+    uint8_t payload[MAX_FRAME_SIZE];
+    uint16_t payloadLen = 0;
+
+    if (parseFrame(frame, frameLen, &cmd, &seq, payload, &payloadLen) != 0) {
+        g_rx.parse_errors++;
+        return;
+    }
+    uint64_t now = bench_now_ns();
+    g_rx.frames++;
+    g_rx.bytes += frameLen;
+
+    if (g_rx.last_seq >= 0 && seq != (uint8_t)(g_rx.last_seq + 1)) {
+        g_rx.seq_gaps++;
+        g_rx.seq_lost += (uint8_t)(seq - (uint8_t)(g_rx.last_seq + 1));
+    }
+    g_rx.last_seq = seq;
+
+    uint64_t sent = g_sent_ns[seq];
+    if (sent && now > sent && g_rx.lat_count < MAX_LATENCIES) {
+        g_rx.lat_us[g_rx.lat_count++] = (uint32_t)((now - sent) / 1000);
+    }
+}
+
+// ===================== Simulator End =====================
+
+static uint16_t build_packet(uint8_t* payload, uint32_t timestamp, uint8_t channels, uint16_t samples,
+                             uint32_t* first_index) {
+    uint16_t mask = (uint16_t)((1u << channels) - 1);
+    uint16_t off = 0;
+
+    memcpy(payload + off, &timestamp, sizeof(timestamp));
+    off += sizeof(timestamp);
+    memcpy(payload + off, &mask, sizeof(mask));
+    off += sizeof(mask);
+    memcpy(payload + off, &samples, sizeof(samples));
+    off += sizeof(samples);
+
+    for (uint8_t c = 0; c < channels; c++) {
+        for (uint16_t s = 0; s < samples; s++) {
+            int16_t v = (int16_t)((*first_index + s) * (c + 1));
+            memcpy(payload + off, &v, sizeof(v));
+            off += sizeof(v);
+        }
+    }
+    *first_index += samples;
+    return off;
+}
+
+// Bytes leave at baud/10 per second (start + 8 data + stop bits). Frames are
+// produced at load_pct of that rate; whatever the pty cannot take is lost.
+static void* writer_thread(void* arg) {
+    Writer_t* w = (Writer_t*)arg;
+    const double line_bps = w->baud / 10.0;
+    uint8_t payload[MAX_FRAME_SIZE];
+    uint8_t frame[MAX_FRAME_SIZE];
+    uint16_t frameLen = 0, frameOff = 0;
+    uint32_t first_index = 0;
+    uint8_t seq = 0;
+
+    const uint64_t start = bench_now_ns();
+    uint64_t line_bytes = 0;        // Bytes the line has clocked out so far
+    uint64_t produced_bytes = 0;    // Frame bytes generated so far
+
+    while (bench_now_ns() < w->stop_ns) {
+        double elapsed_s = (double)(bench_now_ns() - start) / 1e9;
+
+        // Next frame once the offered load allows it
+        if (frameOff == frameLen && produced_bytes < elapsed_s * line_bps * w->load_pct / 100.0) {
+            uint16_t len = build_packet(payload, (uint32_t)(elapsed_s * 1000), w->channels, w->samples,
+                                        &first_index);
+            frameLen = sizeof(frame);
+            if (buildFrame(CMD_DATA_PACKET, seq, payload, len, frame, &frameLen) != 0) {
+                fprintf(stderr, "buildFrame failed (%u bytes payload)\n", (unsigned)len);
+                break;
+            }
+            g_sent_ns[seq] = bench_now_ns();
+            seq++;
+            frameOff = 0;
+            produced_bytes += frameLen;
+            w->frames_sent++;
+            w->bytes_offered += frameLen;
+        }
+
+        // Clock out what the line rate allows
+        uint64_t budget = (uint64_t)(elapsed_s * line_bps);
+        if (frameOff < frameLen && budget > line_bytes) {
+            uint32_t n = (uint32_t)(budget - line_bytes);
+            if (n > (uint32_t)(frameLen - frameOff)) {
+                n = frameLen - frameOff;
+            }
+            ssize_t r = write(w->fd, frame + frameOff, n);
+            if (r < 0) {
+                r = 0;
+            }
+            // The line keeps clocking even when the receiver is full
+            w->bytes_dropped += n - (uint32_t)r;
+            frameOff += (uint16_t)n;
+            line_bytes += n;
+            continue;
+        }
+        bench_sleep_us(100);
+    }
+    return NULL;
+}
+
+// ===================== Reader End =====================
+
+// ReadFile on a COM handle: returns when the buffer is full, the total
+// timeout (constant + multiplier x requested) expires, or - once data has
+// arrived - the gap between two bytes exceeds the interval timeout.
+// MAXDWORD/0/0 returns immediately with whatever is queued.
+static int win32_read(int fd, uint8_t* buf, uint32_t size, const ReadTimeouts_t* to) {
+    uint32_t got = 0;
+    uint64_t start = bench_now_ns();
+    uint64_t total_ms = (uint64_t)to->constant + (uint64_t)to->multiplier * size;
+    bool total_on = to->constant != 0 || to->multiplier != 0;
+    bool immediate = to->interval == WIN32_MAXDWORD && !total_on;
+    uint64_t last_byte = 0;
+
+    for (;;) {
+        int wait_ms = -1;
+        uint64_t now = bench_now_ns();
+        if (immediate) {
+            wait_ms = 0;
+        } else {
+            if (total_on) {
+                uint64_t end = start + total_ms * 1000000ull;
+                wait_ms = now >= end ? 0 : (int)((end - now + 999999) / 1000000);
+            }
+            if (got > 0 && to->interval != 0 && to->interval != WIN32_MAXDWORD) {
+                uint64_t end = last_byte + (uint64_t)to->interval * 1000000ull;
+                int gap_ms = now >= end ? 0 : (int)((end - now + 999999) / 1000000);
+                if (wait_ms < 0 || gap_ms < wait_ms) {
+                    wait_ms = gap_ms;
+                }
+            }
+        }
+
+        struct pollfd p = { fd, POLLIN, 0 };
+        int pr = poll(&p, 1, wait_ms);
+        if (pr < 0 && errno != EINTR) {
+            return -1;
+        }
+        if (pr <= 0) {
+            return (int)got;
+        }
+        ssize_t r = read(fd, buf + got, size - got);
+        if (r < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            return (int)got;
+        }
+        got += (uint32_t)r;
+        last_byte = bench_now_ns();
+        if (got == size || immediate) {
+            return (int)got;
+        }
+    }
+}
+
+// ===================== Pty Setup =====================
+
+static speed_t baud_constant(uint32_t baud) {
+    switch (baud) {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+#ifdef B460800
+        case 460800:  return B460800;
+#endif
+#ifdef B921600
+        case 921600:  return B921600;
+#endif
+        default:      return B0;
+    }
+}
+
+// Raw 8N1 on both ends. A pty does not shape traffic, so the baud setting is
+// recorded on the slave for completeness and the writer does the pacing.
+static bool open_pty_pair(uint32_t baud, int* master, int* slave) {
+    *master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (*master < 0 || grantpt(*master) != 0 || unlockpt(*master) != 0) {
+        perror("posix_openpt");
+        return false;
+    }
+    *slave = open(ptsname(*master), O_RDWR | O_NOCTTY);
+    if (*slave < 0) {
+        perror("open pty slave");
+        close(*master);
+        return false;
+    }
+
+    struct termios tio;
+    for (int i = 0; i < 2; i++) {
+        int fd = i == 0 ? *master : *slave;
+        tcgetattr(fd, &tio);
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        if (fd == *slave && baud_constant(baud) != B0) {
+            cfsetispeed(&tio, baud_constant(baud));
+            cfsetospeed(&tio, baud_constant(baud));
+        }
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    fcntl(*master, F_SETFL, fcntl(*master, F_GETFL) | O_NONBLOCK);
+    fcntl(*slave, F_SETFL, fcntl(*slave, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+// ===================== Sweep =====================
+
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t parse_list(const char* s, uint32_t* out, uint32_t max) {
+    uint32_t n = 0;
+    while (*s && n < max) {
+        out[n++] = (uint32_t)strtoul(s, (char**)&s, 10);
+        while (*s == ',') s++;
+    }
+    return n;
+}
+
+// "interval/constant/multiplier[,...]"; "max" stands for MAXDWORD
+static uint32_t parse_timeouts(const char* s, ReadTimeouts_t* out, uint32_t max) {
+    uint32_t n = 0;
+    while (*s && n < max) {
+        uint32_t v[3] = { 0, 0, 0 };
+        for (int k = 0; k < 3; k++) {
+            if (strncmp(s, "max", 3) == 0) {
+                v[k] = WIN32_MAXDWORD;
+                s += 3;
+            } else {
+                v[k] = (uint32_t)strtoul(s, (char**)&s, 10);
+            }
+            if (*s != '/') break;
+            s++;
+        }
+        out[n].interval = v[0];
+        out[n].constant = v[1];
+        out[n].multiplier = v[2];
+        n++;
+        while (*s == ',') s++;
+    }
+    return n;
+}
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --bauds <list>        Baud rates to sweep (default 115200,460800,921600)\n");
+    printf("  --timeouts <list>     interval/constant/multiplier ms, 'max' = MAXDWORD\n");
+    printf("                        (default 10/10/2,1/1/0,max/0/0 - data-reader uses 10/10/2)\n");
+    printf("  --read-size <n>       Bytes per ReadFile (default %d)\n", READER_READ_SIZE);
+    printf("  --load <pct>          Offered load, percent of line rate (default 90)\n");
+    printf("  --channels <n>        Channels per packet (default 2)\n");
+    printf("  --samples <n>         Samples per channel per packet (default 50)\n");
+    printf("  --seconds <n>         Run time per point (default 3)\n");
+    printf("  --reader-delay <us>   Extra work per read to provoke overruns\n");
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t bauds[MAX_SWEEP] = { 115200, 460800, 921600 };
+    uint32_t baud_count = 3;
+    ReadTimeouts_t timeouts[MAX_SWEEP] = { { 10, 10, 2 }, { 1, 1, 0 }, { WIN32_MAXDWORD, 0, 0 } };
+    uint32_t timeout_count = 3;
+    uint32_t read_size = READER_READ_SIZE;
+    uint32_t load_pct = 90, seconds = 3, reader_delay_us = 0;
+    uint32_t channels = 2, samples = 50;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bauds") == 0 && i + 1 < argc) {
+            baud_count = parse_list(argv[++i], bauds, MAX_SWEEP);
+        } else if (strcmp(argv[i], "--timeouts") == 0 && i + 1 < argc) {
+            timeout_count = parse_timeouts(argv[++i], timeouts, MAX_SWEEP);
+        } else if (strcmp(argv[i], "--read-size") == 0 && i + 1 < argc) {
+            read_size = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            load_pct = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            channels = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--reader-delay") == 0 && i + 1 < argc) {
+            reader_delay_us = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (channels < 1 || channels > 16 || samples < 1 ||
+        8 + channels * samples * 2 > MAX_FRAME_PAYLOAD || read_size < 1 || read_size > 65536 ||
+        baud_count == 0 || timeout_count == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    uint8_t* buf = (uint8_t*)malloc(read_size);
+    static RxBuffer_t rx;
+    g_rx.lat_us = (uint32_t*)malloc(MAX_LATENCIES * sizeof(uint32_t));
+    if (!buf || !g_rx.lat_us) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("=== Serial transport model (pty, emulated ReadFile - not the real serial path): %u ch x %u samples/packet (%u-byte frames), load %u%%, %us/point ===\n",
+           channels, samples, 8 + channels * samples * 2 + FRAME_OVERHEAD_BYTES, load_pct, seconds);
+    printf("%8s %-16s %9s %9s %5s %8s %6s %8s %6s %8s %8s %8s %9s\n",
+           "baud", "timeouts", "offer KB/s", "got KB/s", "util", "frames", "lost", "overrun", "crc",
+           "p50 ms", "p99 ms", "max ms", "B/read");
+
+    bool all_ok = true;
+    for (uint32_t b = 0; b < baud_count; b++) {
+        for (uint32_t t = 0; t < timeout_count; t++) {
+            int master, slave;
+            if (!open_pty_pair(bauds[b], &master, &slave)) {
+                return 1;
+            }
+
+            memset((void*)g_sent_ns, 0, sizeof(g_sent_ns));
+            g_rx.frames = g_rx.bytes = g_rx.parse_errors = g_rx.seq_gaps = g_rx.seq_lost = 0;
+            g_rx.last_seq = -1;
+            g_rx.lat_count = 0;
+            initRxBuffer(&rx);
+
+            Writer_t w;
+            memset(&w, 0, sizeof(w));
+            w.fd = master;
+            w.baud = bauds[b];
+            w.load_pct = load_pct;
+            w.channels = (uint8_t)channels;
+            w.samples = (uint16_t)samples;
+            const uint64_t start = bench_now_ns();
+            w.stop_ns = start + (uint64_t)seconds * 1000000000ull;
+
+            pthread_t th;
+            pthread_create(&th, NULL, writer_thread, &w);
+
+            // data-reader's loop: read, feed, parse, Sleep(1)
+            uint64_t reads = 0, read_bytes = 0, last_data = bench_now_ns();
+            for (;;) {
+                int n = win32_read(slave, buf, read_size, &timeouts[t]);
+                uint64_t now = bench_now_ns();
+                if (n > 0) {
+                    reads++;
+                    read_bytes += (uint64_t)n;
+                    last_data = now;
+                    for (int off = 0; off < n;) {
+                        uint16_t chunk = (uint16_t)(n - off > 60000 ? 60000 : n - off);
+                        uint16_t fed = feedRxBuffer(&rx, buf + off, chunk);
+                        tryParseFramesFromRx(&rx, on_frame);
+                        off += fed ? fed : chunk;
+                    }
+                    if (reader_delay_us) {
+                        bench_sleep_us(reader_delay_us);
+                    }
+                } else if (n < 0 || (now > w.stop_ns && now - last_data > DRAIN_IDLE_MS * 1000000ull)) {
+                    break;
+                }
+                bench_sleep_us(READER_LOOP_SLEEP_US);
+            }
+            pthread_join(th, NULL);
+            close(slave);
+            close(master);
+
+            double run_s = (double)(w.stop_ns - start) / 1e9;
+            double offer_kbs = (double)w.bytes_offered / run_s / 1024.0;
+            double got_kbs = (double)g_rx.bytes / run_s / 1024.0;
+            double line_kbs = bauds[b] / 10.0 / 1024.0;
+            uint64_t lost = w.frames_sent > g_rx.frames ? w.frames_sent - g_rx.frames : 0;
+
+            qsort(g_rx.lat_us, g_rx.lat_count, sizeof(uint32_t), cmp_u32);
+            double p50 = g_rx.lat_count ? g_rx.lat_us[g_rx.lat_count / 2] / 1000.0 : 0.0;
+            double p99 = g_rx.lat_count ? g_rx.lat_us[(uint64_t)g_rx.lat_count * 99 / 100] / 1000.0 : 0.0;
+            double pmax = g_rx.lat_count ? g_rx.lat_us[g_rx.lat_count - 1] / 1000.0 : 0.0;
+
+            char tbuf[40];
+            char iv[12];
+            if (timeouts[t].interval == WIN32_MAXDWORD) {
+                snprintf(iv, sizeof(iv), "max");
+            } else {
+                snprintf(iv, sizeof(iv), "%u", (unsigned)timeouts[t].interval);
+            }
+            snprintf(tbuf, sizeof(tbuf), "%s/%u/%u", iv, (unsigned)timeouts[t].constant,
+                     (unsigned)timeouts[t].multiplier);
+
+            printf("%8u %-16s %9.1f %9.1f %4.0f%% %8llu %6llu %8llu %6llu %8.1f %8.1f %8.1f %9.0f\n",
+                   (unsigned)bauds[b], tbuf, offer_kbs, got_kbs, line_kbs > 0 ? 100.0 * got_kbs / line_kbs : 0.0,
+                   (unsigned long long)g_rx.frames, (unsigned long long)lost,
+                   (unsigned long long)w.bytes_dropped, (unsigned long long)g_rx.parse_errors,
+                   p50, p99, pmax, reads ? (double)read_bytes / reads : 0.0);
+
+            // Every frame must be accounted for: received, or lost to an overrun
+            if (lost > 0 && w.bytes_dropped == 0) {
+                all_ok = false;
+            }
+        }
+    }
+
+    printf("Result: %s\n", all_ok ? "PASS" : "FAIL (frames lost without an overrun)");
+    free(buf);
+    free(g_rx.lat_us);
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// File: channel_model.c
+// Description: Structure-of-arrays channel model and block signal generator
+// Version: v2.1
+
+#include "channel_model.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHAN_TWO_PI     6.28318530718f
+
+// ===================== Configuration =====================
+
+void chan_init(ChannelModel_t* chm, uint8_t count) {
+    memset(chm, 0, sizeof(*chm));
+    chm->count = (count == 0 || count > MAX_CHANNELS_SUPPORTED) ? DEFAULT_CHANNELS : count;
+
+    for (uint8_t ch = 0; ch < MAX_CHANNELS_SUPPORTED; ch++) {
+        chm->max_rate_hz[ch] = MAX_SAMPLE_RATE_HZ;
+        chm->formats_mask[ch] = DEFAULT_SUPPORTED_FORMATS;
+        chm->format[ch] = FORMAT_INT16;
+
+        // Channels 0/1 keep the historical voltage/current signals, the rest
+        // carry harmonics of the mains frequency with falling amplitude
+        if (ch == 0) {
+            strcpy(chm->name[ch], "Voltage");
+            chm->gen_freq_hz[ch] = SIG_GEN_FREQ_CH0;
+            chm->gen_amplitude[ch] = SIG_GEN_AMPLITUDE_CH0;
+        } else if (ch == 1) {
+            strcpy(chm->name[ch], "Current");
+            chm->gen_freq_hz[ch] = SIG_GEN_FREQ_CH1;
+            chm->gen_amplitude[ch] = SIG_GEN_AMPLITUDE_CH1;
+        } else {
+            snprintf(chm->name[ch], CHANNEL_NAME_LEN, "AI%u", (unsigned)ch);
+            chm->gen_freq_hz[ch] = SIG_GEN_FREQ_CH0 * ch;
+            chm->gen_amplitude[ch] = SIG_GEN_AMPLITUDE_CH0 / ch;
+        }
+        chm->gen_noise_state[ch] = 0x9E3779B9u ^ (ch * 0x85EBCA6Bu);
+    }
+    chan_reset_cursors(chm);
+}
+
+void chan_enable(ChannelModel_t* chm, uint8_t ch, uint32_t rate_hz, uint8_t format) {
+    if (ch >= chm->count) return;
+    if (chm->rate_hz[ch] != rate_hz) {
+        chm->next_index[ch] = CHAN_CURSOR_UNSET;
+    }
+    chm->rate_hz[ch] = rate_hz;
+    if (format != 0) {
+        chm->format[ch] = format;
+    }
+    if (rate_hz > 0) {
+        chm->enabled_mask |= (uint16_t)(1u << ch);
+    } else {
+        chm->enabled_mask &= (uint16_t)~(1u << ch);
+    }
+}
+
+void chan_disable(ChannelModel_t* chm, uint8_t ch) {
+    if (ch >= chm->count) return;
+    chm->enabled_mask &= (uint16_t)~(1u << ch);
+}
+
+uint8_t chan_enabled_count(const ChannelModel_t* chm) {
+    uint8_t n = 0;
+    for (uint16_t mask = chm->enabled_mask; mask; mask &= (uint16_t)(mask - 1)) {
+        n++;
+    }
+    return n;
+}
+
+uint32_t chan_packet_rate(const ChannelModel_t* chm) {
+    for (uint8_t ch = 0; ch < chm->count; ch++) {
+        if (chan_is_enabled(chm, ch)) {
+            return chm->rate_hz[ch];
+        }
+    }
+    return 0;
+}
+
+uint32_t chan_max_rate(const ChannelModel_t* chm) {
+    uint32_t rate = 0;
+    for (uint8_t ch = 0; ch < chm->count; ch++) {
+        if (chan_is_enabled(chm, ch) && chm->rate_hz[ch] > rate) {
+            rate = chm->rate_hz[ch];
+        }
+    }
+    return rate;
+}
+
+bool chan_rates_differ(const ChannelModel_t* chm) {
+    uint32_t first = chan_packet_rate(chm);
+    for (uint8_t ch = 0; ch < chm->count; ch++) {
+        if (chan_is_enabled(chm, ch) && chm->rate_hz[ch] != first) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void chan_reset_cursors(ChannelModel_t* chm) {
+    for (uint8_t ch = 0; ch < MAX_CHANNELS_SUPPORTED; ch++) {
+        chm->next_index[ch] = CHAN_CURSOR_UNSET;
+    }
+}
+
+// ===================== Signal Generation =====================
+
+void chan_generate(ChannelModel_t* chm, uint8_t ch, uint32_t first_index, uint16_t count, int16_t* out) {
+    float rate = (float)(chm->rate_hz[ch] ? chm->rate_hz[ch] : DEFAULT_SAMPLE_RATE_HZ);
+    float freq = chm->gen_freq_hz[ch];
+    float amplitude = chm->gen_amplitude[ch];
+
+    // Start phase from the absolute index (in double to keep long runs exact),
+    // then advance by rotating a unit phasor - two multiplies per sample
+    // instead of one sinf() per sample
+    double cycles = fmod((double)first_index * freq / rate, 1.0);
+    float phase = CHAN_TWO_PI * (float)cycles;
+    float step = CHAN_TWO_PI * freq / rate;
+    float re = cosf(phase), im = sinf(phase);
+    const float step_re = cosf(step), step_im = sinf(step);
+
+    uint32_t noise = chm->gen_noise_state[ch];
+    const float noise_scale = 2.0f * SIG_GEN_NOISE_LEVEL / 65536.0f;
+
+    for (uint16_t s = 0; s < count; s++) {
+        noise ^= noise << 13;
+        noise ^= noise >> 17;
+        noise ^= noise << 5;
+        float n = ((float)(noise & 0xFFFF) - 32768.0f) * noise_scale;
+
+        out[s] = (int16_t)(amplitude * im + n);
+
+        float next_re = re * step_re - im * step_im;
+        im = re * step_im + im * step_re;
+        re = next_re;
+    }
+    chm->gen_noise_state[ch] = noise;
+}
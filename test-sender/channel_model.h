@@ -0,0 +1,68 @@
+// File: channel_model.h
+// Description: Per-channel configuration and signal generator state, laid out as
+//              structure-of-arrays for up to 16 channels (the width of channel_mask)
+// Version: v2.1
+
+#ifndef CHANNEL_MODEL_H
+#define CHANNEL_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+
+// ===================== Channel Model =====================
+
+// Each field is one contiguous array indexed by channel id, so loops over
+// "all enabled channels" touch only the arrays they need and packet assembly
+// walks each channel's samples in one run (DATA_PACKET is non-interleaved).
+typedef struct {
+    uint8_t  count;                                     // Channels the device exposes
+    uint16_t enabled_mask;                              // Bit n set = channel n streams
+
+    uint32_t max_rate_hz[MAX_CHANNELS_SUPPORTED];
+    uint16_t formats_mask[MAX_CHANNELS_SUPPORTED];      // FORMAT_* flags
+    uint32_t rate_hz[MAX_CHANNELS_SUPPORTED];           // Current sample rate, 0 = off
+    uint8_t  format[MAX_CHANNELS_SUPPORTED];            // Current FORMAT_* value
+    char     name[MAX_CHANNELS_SUPPORTED][CHANNEL_NAME_LEN];
+
+    // Multi-rate packing: absolute index of the next sample each channel sends
+    uint32_t next_index[MAX_CHANNELS_SUPPORTED];        // CHAN_CURSOR_UNSET until first packet
+
+    // Built-in signal generator (simulation)
+    float    gen_freq_hz[MAX_CHANNELS_SUPPORTED];
+    float    gen_amplitude[MAX_CHANNELS_SUPPORTED];
+    uint32_t gen_noise_state[MAX_CHANNELS_SUPPORTED];   // xorshift32 per channel
+} ChannelModel_t;
+
+#define CHAN_CURSOR_UNSET   0xFFFFFFFFu
+
+// ===================== Function Declarations =====================
+
+// Reset to 'count' disabled channels with default capabilities and generators
+void chan_init(ChannelModel_t* chm, uint8_t count);
+
+static inline bool chan_is_enabled(const ChannelModel_t* chm, uint8_t ch) {
+    return (chm->enabled_mask >> ch) & 1u;
+}
+
+void chan_enable(ChannelModel_t* chm, uint8_t ch, uint32_t rate_hz, uint8_t format);
+void chan_disable(ChannelModel_t* chm, uint8_t ch);
+
+uint8_t chan_enabled_count(const ChannelModel_t* chm);
+
+// Sample rate of the lowest enabled channel (packets share one sample count), 0 if none
+uint32_t chan_packet_rate(const ChannelModel_t* chm);
+
+// Highest enabled rate, and whether enabled channels run at different rates
+uint32_t chan_max_rate(const ChannelModel_t* chm);
+bool chan_rates_differ(const ChannelModel_t* chm);
+
+// Forget multi-rate sample positions (stream start, rate change)
+void chan_reset_cursors(ChannelModel_t* chm);
+
+// Generate 'count' samples of channel 'ch' starting at absolute sample index
+// 'first_index' into out[]. Consecutive blocks join without a phase jump.
+void chan_generate(ChannelModel_t* chm, uint8_t ch, uint32_t first_index, uint16_t count, int16_t* out);
+
+#endif // CHANNEL_MODEL_H
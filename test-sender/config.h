@@ -21,8 +21,9 @@
 #define DEVICE_MANUFACTURER         "Test Systems Inc"
 
 // Device capabilities
-#define MAX_CHANNELS_SUPPORTED      8
-#define DEFAULT_CHANNELS            2
+#define MAX_CHANNELS_SUPPORTED      16      // One bit per channel in the 16-bit channel_mask
+#define DEFAULT_CHANNELS            2       // Channels exposed unless --channels says otherwise
+#define CHANNEL_NAME_LEN            16
 #define MAX_SAMPLE_RATE_HZ          100000
 #define MIN_SAMPLE_RATE_HZ          1
 #define DEFAULT_SAMPLE_RATE_HZ      10000
@@ -46,6 +47,11 @@
     #define CSV_MAX_ROWS                10000
     #define CSV_MAX_COLUMNS             8
     #define CSV_BUFFER_SIZE             32768
+
+    // Scenario files (scenario.c)
+    #define SCENARIO_MAX_PHASES         32
+    #define SCENARIO_NAME_LEN           32
+    #define SCENARIO_LINE_LEN           256
 #else
     // MCU mode settings
     #define USB_CDC_BUFFER_SIZE         1024
@@ -58,17 +64,41 @@
     #define ADC_RESOLUTION              4096    // 12-bit
 #endif
 
+// Outgoing send queue (platform_send_data) - whole frames wait here while the link is full
+#ifdef SIMULATION_MODE
+    #define SEND_QUEUE_SLOTS            64      // Queued frames per connection
+#else
+    #define SEND_QUEUE_SLOTS            2
+#endif
+#define SEND_QUEUE_SLOT_SIZE        MAX_FRAME_SIZE
+#define SEND_QUEUE_BLOCK_TIMEOUT_MS 100     // Max wait for room before giving up
+#define SEND_QUEUE_DEFAULT_POLICY   SEND_POLICY_DROP_OLDEST
+
+// Receiver flow control (CMD_PAUSE_STREAM / CMD_RESUME_STREAM)
+#define FLOW_PAUSE_TIMEOUT_MS       5000    // Auto-resume unless the host renews the pause
+#ifdef SIMULATION_MODE
+    #define FLOW_BACKLOG_MS         2000    // Device time buffered while paused
+#else
+    #define FLOW_BACKLOG_MS         100
+#endif
+#define FLOW_DRAIN_PACKETS          4       // Extra backlog packets per loop pass after resume
+
 // ===================== Timing Configuration =====================
-#define DATA_SEND_INTERVAL_MS       10      // Base data sending interval
+#define DATA_SEND_INTERVAL_MS       1       // Base data sending interval
 #define HEARTBEAT_INTERVAL_MS       30000   // 30 seconds
 #define COMMAND_TIMEOUT_MS          1000    // Command response timeout
 #define CONNECTION_TIMEOUT_MS       5000    // Connection establishment timeout
+#define SIM_CLOCK_MAX_CATCHUP       100     // Max packet intervals sent back-to-back after a stall
 
 // ===================== Buffer Configuration =====================
 #define RX_BUFFER_SIZE              65536   // 64KB
 #define TX_BUFFER_SIZE              8192    // 8KB
+#ifndef MAX_FRAME_SIZE
 #define MAX_FRAME_SIZE              5120    // 5KB per frame
+#endif
 #define FRAME_BATCH_SIZE            100     // Frames per batch processing
+#define FRAME_OVERHEAD_BYTES        10      // AA 55 | len | cmd | seq | ... | crc16 | 55 AA
+#define MAX_FRAME_PAYLOAD           (MAX_FRAME_SIZE - FRAME_OVERHEAD_BYTES)
 
 // Trigger buffer settings
 #define TRIGGER_BUFFER_SIZE         4096    // Samples
@@ -76,23 +106,30 @@
 #define DEFAULT_POST_TRIGGER        1000    // Post-trigger samples
 #define DEFAULT_TRIGGER_THRESHOLD   1000.0f // Trigger threshold
 
+// DMA acquisition (MCU) - ping-pong halves of interleaved scan frames
+#define ACQ_FRAMES_PER_HALF         100     // Scan frames per half (1ms at 100kHz)
+#define ACQ_MAX_FRAMES_PER_HALF     512     // DMA buffer sizing limit
+
 // ===================== Trigger Simulation Configuration =====================
-#ifdef SIMULATION_MODE
-    // Trigger timing (in seconds)
-    #define TRIGGER_MIN_INTERVAL        10      // Minimum interval between triggers
-    #define TRIGGER_MAX_INTERVAL        15      // Maximum interval between triggers
-    
-    // Trigger data packets (represents data duration)
-    #define TRIGGER_MIN_PACKETS         5       // ~50ms of data
-    #define TRIGGER_MAX_PACKETS         10      // ~100ms of data
-    
-    // Signal generation parameters
-    #define SIG_GEN_FREQ_CH0            50.0f   // Channel 0 frequency (Hz)
-    #define SIG_GEN_FREQ_CH1            60.0f   // Channel 1 frequency (Hz)
-    #define SIG_GEN_AMPLITUDE_CH0       1000.0f // Channel 0 amplitude
-    #define SIG_GEN_AMPLITUDE_CH1       800.0f  // Channel 1 amplitude
-    #define SIG_GEN_NOISE_LEVEL         5.0f    // Noise amplitude
-#endif
+// Defaults for the load profile; scenario phases may override them at runtime
+// Trigger timing (in seconds)
+#define TRIGGER_MIN_INTERVAL        10      // Minimum interval between triggers
+#define TRIGGER_MAX_INTERVAL        15      // Maximum interval between triggers
+
+// Trigger data packets (represents data duration)
+#define TRIGGER_MIN_PACKETS         5       // ~50ms of data
+#define TRIGGER_MAX_PACKETS         10      // ~100ms of data
+#define TRIGGER_PACKET_SAMPLES      2000    // Samples per channel in a trigger packet
+
+// Continuous mode packets
+#define MAX_PACKET_SAMPLES_DEFAULT  100     // Cap on rate-derived samples per channel per packet
+
+// Signal generation parameters (channels 2+ carry harmonics of SIG_GEN_FREQ_CH0)
+#define SIG_GEN_FREQ_CH0            50.0f   // Channel 0 frequency (Hz)
+#define SIG_GEN_FREQ_CH1            60.0f   // Channel 1 frequency (Hz)
+#define SIG_GEN_AMPLITUDE_CH0       1000.0f // Channel 0 amplitude
+#define SIG_GEN_AMPLITUDE_CH1       800.0f  // Channel 1 amplitude
+#define SIG_GEN_NOISE_LEVEL         5.0f    // Noise amplitude
 
 // ===================== File I/O Configuration =====================
 #ifdef SIMULATION_MODE
@@ -129,11 +166,27 @@
 #define MAX_RECONNECT_ATTEMPTS      10      // Maximum reconnection attempts
 
 // ===================== Memory Management Configuration =====================
-#define MEMORY_POOL_SIZE            65536   // Memory pool size (bytes)
 #define MAX_ALLOCATIONS             1000    // Maximum concurrent allocations
 #define MEMORY_ALIGNMENT            4       // Memory alignment (bytes)
 #define ENABLE_MEMORY_PROTECTION    1       // Enable memory overflow protection
 
+// Static block pool (memory_pool.c) - block classes and counts
+#define MAX_CSV_ROWS                10000   // Rows per CSV column block
+#define POOL_TRIGGER_BLOCK_SIZE     (TRIGGER_BUFFER_SIZE * 2)  // int16 samples
+#define POOL_TRIGGER_BLOCKS         1
+#define POOL_PACKET_BLOCK_SIZE      8192    // Largest DATA_PACKET payload
+#define POOL_PACKET_BLOCKS          2
+#define POOL_CSV_BLOCK_SIZE         (MAX_CSV_ROWS * 4)         // float samples
+#define POOL_CSV_COLUMNS            2       // Voltage, current
+
+#ifdef SIMULATION_MODE
+    #define MEMORY_POOL_SIZE            131072  // Memory pool size (bytes), includes CSV columns
+    #define POOL_CSV_BLOCKS             POOL_CSV_COLUMNS
+#else
+    #define MEMORY_POOL_SIZE            65536   // Memory pool size (bytes)
+    #define POOL_CSV_BLOCKS             0       // No CSV playback on the MCU
+#endif
+
 #ifdef SIMULATION_MODE
     // Simulation uses system malloc
     #define USE_SYSTEM_MALLOC           1
@@ -153,6 +206,11 @@
 #define TARGET_THROUGHPUT_KB_S      500     // Target throughput (KB/s)
 #define TARGET_CPU_USAGE_PERCENT    10      // Target CPU usage
 
+// ===================== Link Impairment Configuration =====================
+#define IMPAIR_DEFAULT_SEED         0x5EED1234  // Used when no seed is given
+#define IMPAIR_MAX_BIT_FLIPS        3       // Max bits flipped per impaired frame
+#define IMPAIR_MAX_SPLIT_PIECES     4       // Max writes per split frame
+
 // ===================== Feature Flags =====================
 #define FEATURE_CSV_DATA_LOADING    1       // Enable CSV data loading
 #define FEATURE_TRIGGER_SIMULATION  1       // Enable trigger simulation
@@ -181,6 +239,7 @@
 STATIC_ASSERT(MAX_FRAME_SIZE <= RX_BUFFER_SIZE/4, max_frame_size_too_large);
 STATIC_ASSERT(DATA_SEND_INTERVAL_MS > 0, invalid_send_interval);
 STATIC_ASSERT(DEFAULT_CHANNELS <= MAX_CHANNELS_SUPPORTED, too_many_default_channels);
+STATIC_ASSERT(MAX_CHANNELS_SUPPORTED <= 16, channel_mask_is_16_bits);
 STATIC_ASSERT(TRIGGER_BUFFER_SIZE >= DEFAULT_PRE_TRIGGER + DEFAULT_POST_TRIGGER, 
               trigger_buffer_too_small);
 
@@ -6,6 +6,12 @@
 #include "device_simulator.h"
 #include "protocol/protocol.h"
 #include "protocol/io_buffer.h"
+#include "perf_counters.h"
+#include "link_impairment.h"
+#include "sim_clock.h"
+#ifndef SIMULATION_MODE
+#include "acquisition.h"
+#endif
 #include <time.h>
 
 // Global device state
@@ -16,11 +22,27 @@ static RxBuffer_t g_rx_buffer;
 static TxBuffer_t g_tx_buffer;
 static volatile bool g_running = true;
 
+#ifndef SIMULATION_MODE
+static bool device_start_acquisition(void);
+#endif
+
+#ifdef SIMULATION_MODE
+// CSV playback file (--csv or scenario 'csv' key)
+static const char* g_test_data_file = SAMPLE_DATA_FILE;
+#endif
+
+// Channels exposed by the device (--channels or scenario 'device_channels' key)
+static uint8_t g_channel_count = DEFAULT_CHANNELS;
+static bool g_multirate_packing = false;
+
 // ===================== Device Lifecycle =====================
 
 bool device_init(void) {
     PLATFORM_PRINTF("Initializing device (Protocol V6)...\n");
     
+    // Static block pool backs trigger, packet and CSV buffers
+    mem_pool_init();
+
     // Initialize device state
     memset(&g_device_state, 0, sizeof(g_device_state));
     
@@ -38,26 +60,17 @@ bool device_init(void) {
     g_device_state.trigger_data_active = false;
     g_device_state.trigger_timestamp = 0;
 
-    // Initialize channels
-    g_device_state.num_channels = 2;
-
-    // Channel 0 - Voltage
-    g_device_state.channels[0].channel_id = 0;
-    g_device_state.channels[0].max_sample_rate_hz = 100000;
-    g_device_state.channels[0].supported_formats_mask = 0x01 | 0x02; // int16, int32
-    strcpy(g_device_state.channels[0].name, "Voltage");
-    g_device_state.channels[0].enabled = false;
-    g_device_state.channels[0].current_sample_rate = 0;
-    g_device_state.channels[0].current_format = 0x01;
-
-    // Channel 1 - Current
-    g_device_state.channels[1].channel_id = 1;
-    g_device_state.channels[1].max_sample_rate_hz = 100000;
-    g_device_state.channels[1].supported_formats_mask = 0x01 | 0x02;
-    strcpy(g_device_state.channels[1].name, "Current");
-    g_device_state.channels[1].enabled = false;
-    g_device_state.channels[1].current_sample_rate = 0;
-    g_device_state.channels[1].current_format = 0x01;
+    // Initialize channels (0 = Voltage, 1 = Current, 2+ = AIn), all disabled
+    chan_init(&g_device_state.channels, g_channel_count);
+    PLATFORM_PRINTF("Channels: %u\n", (unsigned)g_device_state.channels.count);
+
+    // Default load profile
+    g_device_state.packet_samples = 0;
+    g_device_state.trigger_interval_min_s = TRIGGER_MIN_INTERVAL;
+    g_device_state.trigger_interval_max_s = TRIGGER_MAX_INTERVAL;
+    g_device_state.trigger_burst_min = TRIGGER_MIN_PACKETS;
+    g_device_state.trigger_burst_max = TRIGGER_MAX_PACKETS;
+    g_device_state.trigger_packet_samples = TRIGGER_PACKET_SAMPLES;
 
     // Initialize trigger simulation
     g_device_state.trigger_simulation_active = false;
@@ -65,8 +78,8 @@ bool device_init(void) {
     g_device_state.trigger_threshold = 1000.0f;
     g_device_state.pre_trigger_samples = 1000;
     g_device_state.post_trigger_samples = 1000;
-    g_device_state.trigger_buffer_size = 4096;
-    g_device_state.trigger_buffer = (int16_t*)PLATFORM_MALLOC(g_device_state.trigger_buffer_size * sizeof(int16_t));
+    g_device_state.trigger_buffer_size = TRIGGER_BUFFER_SIZE;
+    g_device_state.trigger_buffer = (int16_t*)mem_pool_alloc(POOL_CLASS_TRIGGER);
     g_device_state.trigger_buffer_pos = 0;
     g_device_state.trigger_occurred = false;
 
@@ -75,6 +88,9 @@ bool device_init(void) {
         return false;
     }
 
+    // Initialize performance counters
+    perf_init();
+
     // Initialize communication buffers
     initRxBuffer(&g_rx_buffer);
     initTxBuffer(&g_tx_buffer);
@@ -92,7 +108,7 @@ bool device_init(void) {
 
 #ifdef SIMULATION_MODE
     // Load test data if available
-    device_load_test_data(SAMPLE_DATA_FILE);
+    device_load_test_data(g_test_data_file);
 #endif
 
     PLATFORM_PRINTF("Device initialized successfully\n");
@@ -105,12 +121,16 @@ void device_cleanup(void) {
     device_stop_communication();
     
     if (g_device_state.trigger_buffer) {
-        PLATFORM_FREE(g_device_state.trigger_buffer);
+        mem_pool_free(g_device_state.trigger_buffer);
         g_device_state.trigger_buffer = NULL;
     }
 
     data_source_cleanup();
     platform_cleanup();
+
+#if DEBUG_MEMORY_TRACKING
+    mem_pool_print_stats();
+#endif
     
     PLATFORM_PRINTF("Device cleanup complete\n");
 }
@@ -125,7 +145,7 @@ bool device_start_communication(void) {
     }
     
     g_device_state.connected = true;
-    g_device_state.timestamp_ms = PLATFORM_TICK();
+    g_device_state.timestamp_ms = sim_clock_now_ms();
     
     PLATFORM_PRINTF("Communication started\n");
     return true;
@@ -149,7 +169,9 @@ bool device_send_response(uint8_t commandID, uint8_t seq, const uint8_t* payload
     uint16_t frameLen = MAX_FRAME_SIZE;
 
     if (buildFrame(commandID, seq, payload, payloadLen, frameBuf, &frameLen) == 0) {
-        bool success = platform_send_data(g_device_state.connection, frameBuf, frameLen);
+        uint64_t send_start = perf_now_ns();
+        bool success = impair_send_frame(g_device_state.connection, commandID, frameBuf, frameLen);
+        perf_record_send(frameLen, perf_now_ns() - send_start, success);
         if (success) {
             PLATFORM_PRINTF("Sent response: CMD=0x%02X, Len=%u\n", commandID, frameLen);
         }
@@ -191,6 +213,7 @@ void device_process_command(uint8_t cmd, uint8_t seq, const uint8_t* payload, ui
             status_payload[1] = (g_device_state.stream_status == STATUS_RUNNING) ? 0x01 : 0x00;
             status_payload[2] = g_device_state.device_error ? 0x01 : 0x00;
             status_payload[3] = g_device_state.error_code;
+            status_payload[4] = g_device_state.flow_paused ? 0x01 : 0x00;
             device_send_response(CMD_STATUS_RESPONSE, seq, status_payload, sizeof(status_payload));
             break;
         }
@@ -208,21 +231,20 @@ void device_process_command(uint8_t cmd, uint8_t seq, const uint8_t* payload, ui
             offset += sizeof(fw_version);
             
             // Number of channels
-            info_payload[offset++] = g_device_state.num_channels;
+            const ChannelModel_t* chm = &g_device_state.channels;
+            info_payload[offset++] = chm->count;
 
             // Channel capabilities
-            for (int i = 0; i < g_device_state.num_channels; i++) {
-                ChannelInfo_t* ch = &g_device_state.channels[i];
-                
-                info_payload[offset++] = ch->channel_id;
-                memcpy(info_payload + offset, &ch->max_sample_rate_hz, sizeof(ch->max_sample_rate_hz));
-                offset += sizeof(ch->max_sample_rate_hz);
-                memcpy(info_payload + offset, &ch->supported_formats_mask, sizeof(ch->supported_formats_mask));
-                offset += sizeof(ch->supported_formats_mask);
+            for (uint8_t ch = 0; ch < chm->count; ch++) {
+                info_payload[offset++] = ch;
+                memcpy(info_payload + offset, &chm->max_rate_hz[ch], sizeof(chm->max_rate_hz[ch]));
+                offset += sizeof(chm->max_rate_hz[ch]);
+                memcpy(info_payload + offset, &chm->formats_mask[ch], sizeof(chm->formats_mask[ch]));
+                offset += sizeof(chm->formats_mask[ch]);
                 
-                uint8_t name_len = strlen(ch->name);
+                uint8_t name_len = strlen(chm->name[ch]);
                 info_payload[offset++] = name_len;
-                memcpy(info_payload + offset, ch->name, name_len);
+                memcpy(info_payload + offset, chm->name[ch], name_len);
                 offset += name_len;
             }
 
@@ -232,8 +254,7 @@ void device_process_command(uint8_t cmd, uint8_t seq, const uint8_t* payload, ui
         }
 
         case CMD_SET_MODE_CONTINUOUS: {
-            g_device_state.mode = MODE_CONTINUOUS;
-            g_device_state.trigger_simulation_active = false;
+            device_set_mode(MODE_CONTINUOUS);
             device_send_response(CMD_ACK, seq, NULL, 0);
             device_send_log_message(1, "Switched to continuous mode");
             PLATFORM_PRINTF("Set to continuous mode\n");
@@ -241,22 +262,15 @@ void device_process_command(uint8_t cmd, uint8_t seq, const uint8_t* payload, ui
         }
 
         case CMD_SET_MODE_TRIGGER: {
-            g_device_state.mode = MODE_TRIGGER;
-            g_device_state.trigger_armed = true;
-            g_device_state.trigger_occurred = false;
-            g_device_state.trigger_simulation_active = true;
+            device_set_mode(MODE_TRIGGER);
             device_send_response(CMD_ACK, seq, NULL, 0);
             device_send_log_message(1, "Switched to trigger mode");
             PLATFORM_PRINTF("Set to trigger mode\n");
-            
-            // Schedule first trigger
-            device_schedule_next_trigger();
             break;
         }
 
         case CMD_START_STREAM: {
-            g_device_state.stream_status = STATUS_RUNNING;
-            g_device_state.timestamp_ms = PLATFORM_TICK();
+            device_start_stream();
             device_send_response(CMD_ACK, seq, NULL, 0);
             device_send_log_message(1, "Stream started");
             PLATFORM_PRINTF("Data stream started\n");
@@ -264,8 +278,7 @@ void device_process_command(uint8_t cmd, uint8_t seq, const uint8_t* payload, ui
         }
 
         case CMD_STOP_STREAM: {
-            g_device_state.stream_status = STATUS_STOPPED;
-            g_device_state.trigger_simulation_active = false;
+            device_stop_stream();
             device_send_response(CMD_ACK, seq, NULL, 0);
             device_send_log_message(1, "Stream stopped");
             PLATFORM_PRINTF("Data stream stopped\n");
@@ -299,12 +312,8 @@ void device_process_command(uint8_t cmd, uint8_t seq, const uint8_t* payload, ui
                     break;
                 }
 
-                // Apply configuration
-                if (channel_id < g_device_state.num_channels) {
-                    g_device_state.channels[channel_id].enabled = (sample_rate > 0);
-                    g_device_state.channels[channel_id].current_sample_rate = sample_rate;
-                    g_device_state.channels[channel_id].current_format = sample_format;
-                }
+                // Apply configuration (rate 0 disables the channel)
+                chan_enable(&g_device_state.channels, channel_id, sample_rate, sample_format);
             }
 
             if (config_error) {
@@ -317,6 +326,27 @@ void device_process_command(uint8_t cmd, uint8_t seq, const uint8_t* payload, ui
             break;
         }
 
+        case CMD_PAUSE_STREAM: {
+            uint16_t timeout_ms = 0;
+            if (payloadLen >= 2) {
+                memcpy(&timeout_ms, payload, sizeof(timeout_ms));
+            }
+            bool renewal = g_device_state.flow_paused;
+            device_flow_pause(timeout_ms);
+            device_send_response(CMD_ACK, seq, NULL, 0);
+            if (!renewal) {
+                PLATFORM_PRINTF("Flow paused by host (timeout %u ms)\n", (unsigned)g_device_state.flow_timeout_ms);
+            }
+            break;
+        }
+
+        case CMD_RESUME_STREAM: {
+            device_flow_resume();
+            device_send_response(CMD_ACK, seq, NULL, 0);
+            PLATFORM_PRINTF("Flow resumed by host\n");
+            break;
+        }
+
         case CMD_REQUEST_BUFFERED_DATA: {
             if (g_device_state.mode != MODE_TRIGGER) {
                 uint8_t err_payload[] = {0x02, 0x01}; // Status error
@@ -346,50 +376,328 @@ void device_process_command(uint8_t cmd, uint8_t seq, const uint8_t* payload, ui
     }
 }
 
+// ===================== Mode and Stream Control =====================
+
+void device_set_mode(DeviceMode mode) {
+    g_device_state.mode = mode;
+    if (mode == MODE_TRIGGER) {
+        g_device_state.trigger_armed = true;
+        g_device_state.trigger_occurred = false;
+        g_device_state.trigger_simulation_active = true;
+
+        // Schedule first trigger
+        device_schedule_next_trigger();
+    } else {
+        g_device_state.trigger_simulation_active = false;
+    }
+}
+
+void device_start_stream(void) {
+    g_device_state.stream_status = STATUS_RUNNING;
+    g_device_state.timestamp_ms = sim_clock_now_ms();
+    g_device_state.flow_paused = false;
+    g_device_state.flow_draining = false;
+    chan_reset_cursors(&g_device_state.channels);
+#ifndef SIMULATION_MODE
+    if (g_device_state.mode == MODE_CONTINUOUS && !device_start_acquisition()) {
+        PLATFORM_PRINTF("DMA acquisition unavailable, using polled ADC reads\n");
+    }
+#endif
+}
+
+void device_stop_stream(void) {
+    g_device_state.stream_status = STATUS_STOPPED;
+    g_device_state.flow_paused = false;
+    g_device_state.flow_draining = false;
+#ifndef SIMULATION_MODE
+    acq_stop();
+#endif
+    g_device_state.trigger_simulation_active = false;
+}
+
+// ===================== Receiver Flow Control =====================
+
+// The host pauses when its receive queue passes its high watermark and
+// resumes below the low one. Acquisition keeps running meanwhile: in
+// continuous mode timestamp_ms simply stops advancing, so the paused span
+// becomes a backlog that is sent faster than real time after the resume.
+// Trigger bursts wait and continue where they stopped. With the ADC running
+// in DMA mode there is no backlog: only the newest ping-pong half is kept,
+// so the paused span is lost (counted as acquisition overruns).
+void device_flow_pause(uint16_t timeout_ms) {
+    if (!g_device_state.flow_paused) {
+        g_device_state.flow_pauses++;
+    }
+    g_device_state.flow_paused = true;
+    g_device_state.flow_draining = true;
+    g_device_state.flow_paused_at = PLATFORM_TICK();
+    g_device_state.flow_timeout_ms = timeout_ms ? timeout_ms : FLOW_PAUSE_TIMEOUT_MS;
+}
+
+void device_flow_resume(void) {
+    g_device_state.flow_paused = false;
+}
+
+// A host that stops renewing its pause (crashed, unplugged) must not stall
+// the device, so a pause lapses after its timeout on the wall clock
+bool device_flow_paused(void) {
+    if (g_device_state.flow_paused &&
+        (uint32_t)(PLATFORM_TICK() - g_device_state.flow_paused_at) >= g_device_state.flow_timeout_ms) {
+        g_device_state.flow_paused = false;
+        g_device_state.flow_auto_resumes++;
+        device_send_log_message(2, "Flow pause timed out - resuming");
+    }
+    return g_device_state.flow_paused;
+}
+
+// Send the backlog a pause left behind, a few packets per loop pass and only
+// while the send queue has room, so draining never forces queue drops. A
+// backlog beyond the device buffer is discarded and reported to the host.
+void device_flow_drain(void) {
+    if (!g_device_state.flow_draining || device_flow_paused()) {
+        return;
+    }
+    if (g_device_state.stream_status != STATUS_RUNNING || g_device_state.mode != MODE_CONTINUOUS) {
+        g_device_state.flow_draining = false;
+        return;
+    }
+#ifndef SIMULATION_MODE
+    // DMA acquisition does not advance timestamp_ms and keeps no backlog
+    if (acq_is_running()) {
+        g_device_state.flow_draining = false;
+        return;
+    }
+#endif
+
+    // Data time may run up to one interval ahead of the clock
+    int32_t interval = (int32_t)device_packet_interval_ms();
+    int32_t backlog = (int32_t)(sim_clock_now_ms() - g_device_state.timestamp_ms);
+
+    if (backlog > FLOW_BACKLOG_MS + interval) {
+        uint32_t excess = (uint32_t)(backlog - FLOW_BACKLOG_MS);
+        char msg[64];
+        g_device_state.timestamp_ms += excess;
+        g_device_state.flow_dropped_ms += excess;
+        chan_reset_cursors(&g_device_state.channels);
+        snprintf(msg, sizeof(msg), "Flow backlog overflow - %u ms discarded", (unsigned)excess);
+        device_send_log_message(2, msg);
+        backlog = FLOW_BACKLOG_MS;
+    }
+
+    for (int i = 0; i < FLOW_DRAIN_PACKETS && backlog >= 2 * interval; i++) {
+        if (platform_send_queue_depth(NULL) >= SEND_QUEUE_SLOTS / 2) {
+            return;
+        }
+        device_generate_data_packet();
+        backlog = (int32_t)(sim_clock_now_ms() - g_device_state.timestamp_ms);
+    }
+    if (backlog < 2 * interval) {
+        g_device_state.flow_draining = false;
+    }
+}
+
+void device_print_flow_stats(void) {
+    PLATFORM_PRINTF("=== Flow Control ===\n");
+    PLATFORM_PRINTF("Pauses:         %u (%u timed out)%s\n",
+                    (unsigned)g_device_state.flow_pauses, (unsigned)g_device_state.flow_auto_resumes,
+                    g_device_state.flow_paused ? ", paused now" : "");
+    PLATFORM_PRINTF("Backlog lost:   %u ms (buffer %u ms)\n",
+                    (unsigned)g_device_state.flow_dropped_ms, (unsigned)FLOW_BACKLOG_MS);
+}
+
 // ===================== Data Generation =====================
 
-void device_generate_data_packet(void) {
-    uint8_t payload[2048];
-    uint16_t payload_offset = 0;
-    uint16_t enabled_channels = 0;
-    uint16_t sample_count = 0;
-
-    // Calculate enabled channels and sample count
-    for (int i = 0; i < g_device_state.num_channels; i++) {
-        if (g_device_state.channels[i].enabled) {
-            enabled_channels |= (1 << i);
-            if (sample_count == 0) {
-                sample_count = (g_device_state.channels[i].current_sample_rate * DATA_SEND_INTERVAL_MS) / 1000;
-                if (sample_count == 0) sample_count = 1;
-                if (sample_count > 100) sample_count = 100;
+#ifndef SIMULATION_MODE
+// Run the ADC in continuous DMA mode for all enabled channels (scan order = channel order)
+static bool device_start_acquisition(void) {
+    AcqConfig_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+
+    const ChannelModel_t* chm = &g_device_state.channels;
+    for (uint8_t ch = 0; ch < chm->count && cfg.channel_count < MAX_ADC_CHANNELS; ch++) {
+        if (!chan_is_enabled(chm, ch)) {
+            continue;
+        }
+        if (cfg.channel_count == 0) {
+            cfg.sample_rate_hz = chm->rate_hz[ch];
+        }
+        cfg.channels[cfg.channel_count++] = ch;
+    }
+    cfg.frames_per_half = ACQ_FRAMES_PER_HALF;
+
+    return cfg.channel_count > 0 && acq_start(g_device_state.adc_handle, &cfg);
+}
+
+// Send one DATA_PACKET per completed ping-pong half
+static void device_send_acquired_packets(void) {
+    uint8_t* payload = (uint8_t*)mem_pool_alloc(POOL_CLASS_PACKET);
+    if (!payload) {
+        return;
+    }
+
+    uint16_t len;
+    while ((len = acq_build_packet(payload, POOL_PACKET_BLOCK_SIZE)) > 0) {
+        device_send_response(CMD_DATA_PACKET, g_device_state.seq_counter++, payload, len);
+    }
+    mem_pool_free(payload);
+}
+#endif
+
+// Enable the default channels when a stream starts without CONFIGURE_STREAM
+static void device_ensure_channels(void) {
+    ChannelModel_t* chm = &g_device_state.channels;
+    if (chm->enabled_mask != 0) {
+        return;
+    }
+
+    PLATFORM_PRINTF("No channels enabled - configuring default channels\n");
+    for (uint8_t ch = 0; ch < chm->count && ch < DEFAULT_CHANNELS; ch++) {
+        chan_enable(chm, ch, DEFAULT_SAMPLE_RATE_HZ, FORMAT_INT16);
+    }
+    PLATFORM_PRINTF("Auto-configured channels: 0x%04X\n", chm->enabled_mask);
+}
+
+// Multi-rate packets are only used when they save something: the host opted
+// in and the enabled channels do not all share one rate
+static bool device_multirate_active(void) {
+    return g_multirate_packing && chan_rates_differ(&g_device_state.channels);
+}
+
+// Rate that sets the packet cadence: the shared rate, or the fastest channel
+// when each channel carries its own sample count
+static uint32_t device_pacing_rate(void) {
+    const ChannelModel_t* chm = &g_device_state.channels;
+    return device_multirate_active() ? chan_max_rate(chm) : chan_packet_rate(chm);
+}
+
+// Samples per channel in a continuous packet: the configured packet size, or
+// rate x DATA_SEND_INTERVAL_MS, capped so the whole packet fits one frame
+static uint16_t device_packet_samples(void) {
+    const ChannelModel_t* chm = &g_device_state.channels;
+    uint32_t count = g_device_state.packet_samples;
+
+    if (count == 0) {
+        count = device_pacing_rate() * DATA_SEND_INTERVAL_MS / 1000;
+        if (count == 0) count = 1;
+        if (count > MAX_PACKET_SAMPLES_DEFAULT) count = MAX_PACKET_SAMPLES_DEFAULT;
+    }
+
+    uint16_t max_samples = device_max_packet_samples(chan_enabled_count(chm));
+    return (uint16_t)(count > max_samples ? max_samples : count);
+}
+
+// DATA_PACKET_MULTIRATE: every channel sends the samples whose sample instants
+// fall inside this packet's window, so a 1 Hz channel next to 10 kHz ones adds
+// one sample per second instead of being padded to the fast channels' count.
+// Channels with nothing due in the window are left out of the mask.
+static void device_generate_multirate_packet(void) {
+    ChannelModel_t* chm = &g_device_state.channels;
+    uint32_t window_start = g_device_state.timestamp_ms;
+    uint32_t window_end = window_start + device_packet_interval_ms();
+
+    uint8_t enabled_count = chan_enabled_count(chm);
+    uint32_t payload_limit = POOL_PACKET_BLOCK_SIZE < MAX_FRAME_PAYLOAD ? POOL_PACKET_BLOCK_SIZE : MAX_FRAME_PAYLOAD;
+    uint32_t header_size = 6 + enabled_count * sizeof(uint16_t);
+    uint16_t channel_cap = (uint16_t)((payload_limit - header_size) / (enabled_count * sizeof(int16_t)));
+
+    // Work out each channel's share first - the count table precedes the data
+    uint16_t counts[MAX_CHANNELS_SUPPORTED];
+    uint16_t channel_mask = 0;
+    for (uint8_t ch = 0; ch < chm->count; ch++) {
+        counts[ch] = 0;
+        if (!chan_is_enabled(chm, ch)) {
+            continue;
+        }
+
+        // Sample n falls at n / rate seconds; the window [start, end) owns
+        // indices ceil(start * rate) .. ceil(end * rate) - 1
+        uint32_t rate = chm->rate_hz[ch];
+        uint32_t first = (uint32_t)(((uint64_t)window_start * rate + 999) / 1000);
+        uint32_t due = (uint32_t)(((uint64_t)window_end * rate + 999) / 1000);
+        if (chm->next_index[ch] == CHAN_CURSOR_UNSET || chm->next_index[ch] > due) {
+            chm->next_index[ch] = first;
+        }
+
+        // A backlog beyond the per-channel share carries into the next packet
+        uint32_t count = due - chm->next_index[ch];
+        counts[ch] = (uint16_t)(count > channel_cap ? channel_cap : count);
+        if (counts[ch] > 0) {
+            channel_mask |= (uint16_t)(1u << ch);
+        }
+    }
+
+    if (channel_mask != 0) {
+        uint8_t* payload = (uint8_t*)mem_pool_alloc(POOL_CLASS_PACKET);
+        if (!payload) {
+            return;
+        }
+
+        uint16_t payload_offset = 0;
+        memcpy(payload + payload_offset, &window_start, sizeof(window_start));
+        payload_offset += sizeof(window_start);
+        memcpy(payload + payload_offset, &channel_mask, sizeof(channel_mask));
+        payload_offset += sizeof(channel_mask);
+
+        for (uint8_t ch = 0; ch < chm->count; ch++) {
+            if (counts[ch] > 0) {
+                memcpy(payload + payload_offset, &counts[ch], sizeof(counts[ch]));
+                payload_offset += sizeof(counts[ch]);
+            }
+        }
+
+        uint64_t gen_start = perf_now_ns();
+        uint32_t generated = 0;
+        int16_t* samples = (int16_t*)(payload + payload_offset);
+        for (uint8_t ch = 0; ch < chm->count; ch++) {
+            if (counts[ch] == 0) {
+                continue;
             }
+            data_source_fill(ch, chm->next_index[ch], counts[ch], samples);
+            chm->next_index[ch] += counts[ch];
+            samples += counts[ch];
+            generated += counts[ch];
         }
+        payload_offset += (uint16_t)(generated * sizeof(int16_t));
+        perf_record_generation(generated, perf_now_ns() - gen_start);
+
+        device_send_response(CMD_DATA_PACKET_MULTIRATE, g_device_state.seq_counter++, payload, payload_offset);
+        mem_pool_free(payload);
+    }
+
+    g_device_state.timestamp_ms = window_end;
+}
+
+void device_generate_data_packet(void) {
+    uint16_t payload_offset = 0;
+
+#ifndef SIMULATION_MODE
+    if (acq_is_running()) {
+        device_send_acquired_packets();
+        return;
+    }
+#endif
+
+    ChannelModel_t* chm = &g_device_state.channels;
+    device_ensure_channels();
+
+    if (device_multirate_active()) {
+        device_generate_multirate_packet();
+        return;
     }
 
+    uint16_t enabled_channels = chm->enabled_mask;
+    uint16_t sample_count = device_packet_samples();
+
     // Debug output
     PLATFORM_PRINTF("Channels enabled: 0x%04X, Sample count: %u\n", enabled_channels, sample_count);
 
-    if (enabled_channels == 0) {
-        PLATFORM_PRINTF("No channels enabled - configuring default channels\n");
-        // Auto-enable default channels if none are configured
-        g_device_state.channels[0].enabled = true;
-        g_device_state.channels[0].current_sample_rate = 10000;
-        g_device_state.channels[0].current_format = 0x01;
-        g_device_state.channels[1].enabled = true;
-        g_device_state.channels[1].current_sample_rate = 10000;
-        g_device_state.channels[1].current_format = 0x01;
-        
-        // Recalculate
-        enabled_channels = 0x0003; // Channel 0 and 1
-        sample_count = (10000 * DATA_SEND_INTERVAL_MS) / 1000;
-        if (sample_count == 0) sample_count = 1;
-        if (sample_count > 100) sample_count = 100;
-        
-        PLATFORM_PRINTF("Auto-configured channels: 0x%04X, samples: %u\n", enabled_channels, sample_count);
+    if (enabled_channels == 0 || sample_count == 0) {
+        PLATFORM_PRINTF("Sample count is 0, skipping packet\n");
+        return;
     }
 
-    if (sample_count == 0) {
-        PLATFORM_PRINTF("Sample count is 0, skipping packet\n");
+    uint8_t* payload = (uint8_t*)mem_pool_alloc(POOL_CLASS_PACKET);
+    if (!payload) {
         return;
     }
 
@@ -403,58 +711,70 @@ void device_generate_data_packet(void) {
     memcpy(payload + payload_offset, &sample_count, sizeof(sample_count));
     payload_offset += sizeof(sample_count);
 
-    // Generate and fill data (non-interleaved format)
-    for (int i = 0; i < g_device_state.num_channels; i++) {
-        if (!(enabled_channels & (1 << i))) {
+    // Generate and fill data (non-interleaved format): each enabled channel
+    // writes its whole block straight into the payload
+    uint64_t gen_start = perf_now_ns();
+    uint32_t generated = 0;
+    uint32_t first_index = (uint32_t)((uint64_t)g_device_state.timestamp_ms * chan_packet_rate(chm) / 1000);
+    int16_t* samples = (int16_t*)(payload + payload_offset);
+    for (uint8_t ch = 0; ch < chm->count; ch++) {
+        if (!chan_is_enabled(chm, ch)) {
             continue;
         }
-
-        // Generate data for this channel
-        for (uint16_t s = 0; s < sample_count; s++) {
-            int16_t sample_value = data_source_get_sample(i, g_device_state.timestamp_ms / DATA_SEND_INTERVAL_MS * sample_count + s);
-            memcpy(payload + payload_offset, &sample_value, sizeof(sample_value));
-            payload_offset += sizeof(sample_value);
-        }
+        data_source_fill(ch, first_index, sample_count, samples);
+        samples += sample_count;
+        generated += sample_count;
     }
+    payload_offset += (uint16_t)(generated * sizeof(int16_t));
+    perf_record_generation(generated, perf_now_ns() - gen_start);
 
     // Send data packet
     device_send_response(CMD_DATA_PACKET, g_device_state.seq_counter++, payload, payload_offset);
-    g_device_state.timestamp_ms += DATA_SEND_INTERVAL_MS;
+    mem_pool_free(payload);
+    g_device_state.timestamp_ms += device_packet_interval_ms();
+}
+
+// Continuous packets normally go out every DATA_SEND_INTERVAL_MS. With a fixed
+// packet size the interval stretches so the channel sample rate still holds.
+uint32_t device_packet_interval_ms(void) {
+    uint32_t rate = device_pacing_rate();
+    if (g_device_state.packet_samples == 0 || rate == 0) {
+        return DATA_SEND_INTERVAL_MS;
+    }
+
+    uint32_t interval = (uint32_t)device_packet_samples() * 1000 / rate;
+    return interval > DATA_SEND_INTERVAL_MS ? interval : DATA_SEND_INTERVAL_MS;
+}
+
+// Largest per-channel sample count whose packet fits both one pool packet
+// block and one protocol frame - with 16 channels the frame is the limit
+uint16_t device_max_packet_samples(uint16_t channel_count) {
+    if (channel_count == 0) {
+        channel_count = 1;
+    }
+    uint32_t payload_limit = POOL_PACKET_BLOCK_SIZE < MAX_FRAME_PAYLOAD ? POOL_PACKET_BLOCK_SIZE : MAX_FRAME_PAYLOAD;
+    return (uint16_t)((payload_limit - 8) / (channel_count * sizeof(int16_t)));
 }
 
 
 void device_generate_trigger_data_packet(void) {
-    uint8_t payload[8192];
     uint16_t payload_offset = 0;
-    uint16_t enabled_channels = 0;
-    uint16_t sample_count = 0;
-
-    // 确保通道已启用
-    for (int i = 0; i < g_device_state.num_channels; i++) {
-        if (g_device_state.channels[i].enabled) {
-            enabled_channels |= (1 << i);
-            if (sample_count == 0) {
-                sample_count = (g_device_state.channels[i].current_sample_rate * DATA_SEND_INTERVAL_MS) / 1000;
-                if (sample_count == 0) sample_count = 10; // 默认每包10个样本
-                if (sample_count > 100) sample_count = 100;
-            }
-        }
+
+    // 确保通道已启用（没有启用通道时自动启用默认通道）
+    ChannelModel_t* chm = &g_device_state.channels;
+    device_ensure_channels();
+    uint16_t enabled_channels = chm->enabled_mask;
+    uint16_t sample_count = g_device_state.trigger_packet_samples;
+
+    // 限制样本数，保证整包放得进一个内存池数据包块和一帧
+    uint16_t max_samples = device_max_packet_samples(chan_enabled_count(chm));
+    if (sample_count > max_samples) {
+        sample_count = max_samples;
     }
-    sample_count = 2000;
-    // 如果没有启用通道，自动启用默认通道
-    if (enabled_channels == 0) {
-        g_device_state.channels[0].enabled = true;
-        g_device_state.channels[0].current_sample_rate = 10000;
-        g_device_state.channels[0].current_format = 0x01;
-        g_device_state.channels[1].enabled = true;
-        g_device_state.channels[1].current_sample_rate = 10000;
-        g_device_state.channels[1].current_format = 0x01;
-        
-        enabled_channels = 0x0003; // 通道0和1
-        sample_count = 5000;
-        
-        PLATFORM_PRINTF("Auto-enabled channels for trigger: 0x%04X, samples: %u\n", 
-               enabled_channels, sample_count);
+
+    uint8_t* payload = (uint8_t*)mem_pool_alloc(POOL_CLASS_PACKET);
+    if (!payload) {
+        return;
     }
 
     // 使用触发时间戳而不是当前时间戳
@@ -471,29 +791,17 @@ void device_generate_trigger_data_packet(void) {
     memcpy(payload + payload_offset, &sample_count, sizeof(sample_count));
     payload_offset += sizeof(sample_count);
 
-    // 生成触发相关的数据（可以模拟触发前后的信号变化）
-    for (int i = 0; i < g_device_state.num_channels; i++) {
-        if (!(enabled_channels & (1 << i))) {
+    // 生成触发相关的数据（每个通道一段递增斜坡，便于读取端校验）
+    for (uint8_t ch = 0; ch < chm->count; ch++) {
+        if (!chan_is_enabled(chm, ch)) {
             continue;
         }
 
+        int16_t* samples = (int16_t*)(payload + payload_offset);
         for (uint16_t s = 0; s < sample_count; s++) {
-            // // 为触发数据生成特殊信号（例如在触发点附近有显著变化）
-            // int16_t base_sample = data_source_get_sample(i, 
-            //     (packet_timestamp / DATA_SEND_INTERVAL_MS) * sample_count + s);
-            
-            // // 在触发数据中加入明显的信号特征
-            // if (g_device_state.trigger_data_packets_sent < 3) {
-            //     // 前几个包模拟触发前的信号
-            //     base_sample = (int16_t)(base_sample * 1.5 + 500);
-            // } else {
-            //     // 后面的包模拟触发后的信号
-            //     base_sample = (int16_t)(base_sample * 0.8 - 200);
-            // }
-            int16_t base_sample = (int16_t)s;
-            memcpy(payload + payload_offset, &base_sample, sizeof(base_sample));
-            payload_offset += sizeof(base_sample);
+            samples[s] = (int16_t)s;
         }
+        payload_offset += sample_count * sizeof(int16_t);
     }
 
     // 发送数据包
@@ -504,6 +812,7 @@ void device_generate_trigger_data_packet(void) {
     } else {
         PLATFORM_PRINTF("Failed to send trigger data packet\n");
     }
+    mem_pool_free(payload);
 }
 
 // ===================== Trigger Simulation =====================
@@ -511,12 +820,14 @@ void device_generate_trigger_data_packet(void) {
 void device_schedule_next_trigger(void) {
     if (!g_device_state.trigger_simulation_active) return;
     
-    // 随机10-15秒间隔
-    int random_seconds = 10 + (rand() % 6);
-    g_device_state.next_trigger_time = PLATFORM_TICK() + (random_seconds * 1000);
+    // 随机触发间隔（默认10-15秒，场景阶段可修改）
+    int interval_span = g_device_state.trigger_interval_max_s - g_device_state.trigger_interval_min_s + 1;
+    int random_seconds = g_device_state.trigger_interval_min_s + (rand() % (interval_span > 0 ? interval_span : 1));
+    g_device_state.next_trigger_time = sim_clock_now_ms() + (random_seconds * 1000);
     
-    // 随机5-10个数据包（50-100ms的数据）
-    g_device_state.trigger_data_packets_to_send = 5 + (rand() % 6);
+    // 随机突发包数（默认5-10个数据包）
+    int burst_span = g_device_state.trigger_burst_max - g_device_state.trigger_burst_min + 1;
+    g_device_state.trigger_data_packets_to_send = g_device_state.trigger_burst_min + (rand() % (burst_span > 0 ? burst_span : 1));
     
     // 重置触发状态
     g_device_state.trigger_event_sent = false;
@@ -530,7 +841,7 @@ void device_schedule_next_trigger(void) {
 void device_handle_trigger_simulation(void) {
     if (!g_device_state.trigger_simulation_active) return;
     
-    uint32_t current_time = PLATFORM_TICK();
+    uint32_t current_time = sim_clock_now_ms();
     
     // 检查是否到达触发时间
     if (current_time >= g_device_state.next_trigger_time && 
@@ -609,6 +920,28 @@ void device_handle_trigger_simulation(void) {
     }
 }
 
+// ===================== Runtime Configuration =====================
+
+void device_set_channel_count(uint8_t count) {
+    if (count >= 1 && count <= MAX_CHANNELS) {
+        g_channel_count = count;
+    }
+}
+
+void device_set_multirate_packing(bool enabled) {
+    g_multirate_packing = enabled;
+}
+
+void device_set_test_data_file(const char* filename) {
+#ifdef SIMULATION_MODE
+    if (filename) {
+        g_test_data_file = filename;
+    }
+#else
+    (void)filename;
+#endif
+}
+
 // ===================== Utility Functions =====================
 
 const char* device_get_command_name(uint8_t cmd) {
@@ -624,9 +957,12 @@ const char* device_get_command_name(uint8_t cmd) {
         case CMD_START_STREAM:            return "START_STREAM";
         case CMD_STOP_STREAM:             return "STOP_STREAM";
         case CMD_CONFIGURE_STREAM:        return "CONFIGURE_STREAM";
+        case CMD_PAUSE_STREAM:            return "PAUSE_STREAM";
+        case CMD_RESUME_STREAM:           return "RESUME_STREAM";
         case CMD_ACK:                     return "ACK";
         case CMD_NACK:                    return "NACK";
         case CMD_DATA_PACKET:             return "DATA_PACKET";
+        case CMD_DATA_PACKET_MULTIRATE:   return "DATA_PACKET_MULTIRATE";
         case CMD_EVENT_TRIGGERED:         return "EVENT_TRIGGERED";
         case CMD_REQUEST_BUFFERED_DATA:   return "REQUEST_BUFFERED_DATA";
         case CMD_BUFFER_TRANSFER_COMPLETE: return "BUFFER_TRANSFER_COMPLETE";
@@ -636,17 +972,16 @@ const char* device_get_command_name(uint8_t cmd) {
 }
 
 bool device_validate_channel_config(uint8_t channel_id, uint32_t sample_rate, uint8_t format) {
-    if (channel_id >= g_device_state.num_channels) {
+    const ChannelModel_t* chm = &g_device_state.channels;
+    if (channel_id >= chm->count) {
         return false;
     }
 
-    ChannelInfo_t* ch = &g_device_state.channels[channel_id];
-
-    if (sample_rate > ch->max_sample_rate_hz) {
+    if (sample_rate > chm->max_rate_hz[channel_id]) {
         return false;
     }
 
-    if (format != 0x00 && !(ch->supported_formats_mask & format)) {
+    if (format != 0x00 && !(chm->formats_mask[channel_id] & format)) {
         return false;
     }
 
@@ -35,6 +35,8 @@
     #define INVALID_CONNECTION INVALID_SOCKET
 #else
     // MCU environment includes (customize based on your MCU)
+    #include <stdlib.h>
+    #include <string.h>
     #include "mcu_hal.h"
     #include "usb_cdc.h"
     #define PLATFORM_PRINTF debug_printf
@@ -46,6 +48,18 @@
     #define INVALID_CONNECTION NULL
 #endif
 
+#include "config.h"
+#include "memory_pool.h"
+#include "channel_model.h"
+
+// Route generic allocations through the static block pool when requested
+#if defined(USE_CUSTOM_MALLOC) && USE_CUSTOM_MALLOC
+    #undef PLATFORM_MALLOC
+    #undef PLATFORM_FREE
+    #define PLATFORM_MALLOC(size) mem_pool_malloc(size)
+    #define PLATFORM_FREE(ptr) mem_pool_free(ptr)
+#endif
+
 // ===================== Protocol V6 Commands =====================
 #define CMD_PING                    0x01
 #define CMD_PONG                    0x81
@@ -58,20 +72,20 @@
 #define CMD_START_STREAM            0x12
 #define CMD_STOP_STREAM             0x13
 #define CMD_CONFIGURE_STREAM        0x14
+#define CMD_PAUSE_STREAM            0x15
+#define CMD_RESUME_STREAM           0x16
 #define CMD_ACK                     0x90
 #define CMD_NACK                    0x91
 #define CMD_DATA_PACKET             0x40
 #define CMD_EVENT_TRIGGERED         0x41
 #define CMD_REQUEST_BUFFERED_DATA   0x42
+#define CMD_DATA_PACKET_MULTIRATE   0x43
 #define CMD_BUFFER_TRANSFER_COMPLETE 0x4F
 #define CMD_LOG_MESSAGE             0xE0
 
 // ===================== Configuration Constants =====================
 #define DEVICE_UNIQUE_ID            0x11223344AABBCCDDULL
-#define MAX_CHANNELS                4
-#define DATA_SEND_INTERVAL_MS       1
-#define MAX_CSV_ROWS                10000
-#define CSV_BUFFER_SIZE             32768
+#define MAX_CHANNELS                MAX_CHANNELS_SUPPORTED
 
 #ifdef SIMULATION_MODE
     #define DEFAULT_PORT            "9001"
@@ -93,16 +107,6 @@ typedef enum {
     STATUS_RUNNING,
 } StreamStatus;
 
-typedef struct {
-    uint8_t channel_id;
-    uint32_t max_sample_rate_hz;
-    uint16_t supported_formats_mask;
-    char name[32];
-    bool enabled;
-    uint32_t current_sample_rate;
-    uint8_t current_format;
-} ChannelInfo_t;
-
 typedef struct {
     // Core device state
     DeviceMode mode;
@@ -112,22 +116,29 @@ typedef struct {
     bool device_error;
     uint8_t error_code;
 
-    // Channel configuration
-    ChannelInfo_t channels[MAX_CHANNELS];
-    uint8_t num_channels;
+    // Channel configuration (structure-of-arrays, see channel_model.h)
+    ChannelModel_t channels;
 
     // Data source (simulation only)
 #ifdef SIMULATION_MODE
     char csv_buffer[CSV_BUFFER_SIZE];
     int csv_rows;
     int current_csv_row;
-    float** csv_data;
+    float* csv_data[POOL_CSV_COLUMNS];   // Column blocks from POOL_CLASS_CSV
 #else
     // MCU uses real ADC/sensors
     void* adc_handle;
     void* sensor_handles[MAX_CHANNELS];
 #endif
 
+    // Load profile (config.h defaults; scenario phases change these at runtime)
+    uint16_t packet_samples;            // Samples per channel per packet, 0 = derive from rate
+    uint16_t trigger_interval_min_s;
+    uint16_t trigger_interval_max_s;
+    uint16_t trigger_burst_min;         // DATA_PACKETs sent per trigger
+    uint16_t trigger_burst_max;
+    uint16_t trigger_packet_samples;    // Samples per channel in trigger packets
+
     // Trigger simulation
     bool trigger_simulation_active;
     uint32_t next_trigger_time;
@@ -149,11 +160,42 @@ typedef struct {
     bool trigger_data_active;       
     uint32_t trigger_timestamp;     
 
+    // Receiver flow control: while paused, continuous data accumulates as a
+    // backlog (timestamp_ms falls behind the clock) and drains after resume
+    bool flow_paused;
+    bool flow_draining;                 // Backlog from a pause not yet sent
+    uint32_t flow_paused_at;            // Wall-clock tick of the last PAUSE (renewals included)
+    uint32_t flow_timeout_ms;
+    uint32_t flow_pauses;
+    uint32_t flow_auto_resumes;         // Pauses that timed out without a RESUME
+    uint32_t flow_dropped_ms;           // Backlog discarded beyond FLOW_BACKLOG_MS
+
     // Communication
     connection_handle_t connection;
     bool connected;
 } DeviceState_t;
 
+// Overload policy of the per-connection send queue. Only whole DATA_PACKET
+// frames that have not started transmitting are ever dropped.
+typedef enum {
+    SEND_POLICY_BLOCK,          // Wait for the link (up to SEND_QUEUE_BLOCK_TIMEOUT_MS)
+    SEND_POLICY_DROP_NEWEST,    // Reject the frame being sent
+    SEND_POLICY_DROP_OLDEST,    // Evict the oldest queued frame
+} SendQueuePolicy;
+
+typedef struct {
+    uint32_t queued_frames;         // Current depth
+    uint32_t queued_bytes;
+    uint32_t high_water_frames;
+    uint32_t high_water_bytes;
+    uint32_t partial_writes;        // send() accepted only part of a frame
+    uint32_t would_block;           // send() accepted nothing
+    uint32_t dropped_newest;
+    uint32_t dropped_oldest;
+    uint32_t block_waits;           // Times the sender waited for room
+    uint32_t block_timeouts;        // Waits that ended without room
+} SendQueueStats_t;
+
 // ===================== Function Declarations =====================
 
 // Device lifecycle
@@ -170,8 +212,25 @@ void device_communication_loop(void);
 // Command processing
 void device_process_command(uint8_t cmd, uint8_t seq, const uint8_t* payload, uint16_t payloadLen);
 
+// Mode and stream control (shared by host commands and scenario phases)
+void device_set_mode(DeviceMode mode);
+void device_start_stream(void);
+void device_stop_stream(void);
+
+// Receiver flow control
+void device_flow_pause(uint16_t timeout_ms);
+void device_flow_resume(void);
+bool device_flow_paused(void);
+void device_flow_drain(void);
+void device_print_flow_stats(void);
+
 // Data generation and management
 void device_generate_data_packet(void);
+uint32_t device_packet_interval_ms(void);
+uint16_t device_max_packet_samples(uint16_t channel_count);
+void device_set_test_data_file(const char* filename);
+void device_set_channel_count(uint8_t count);
+void device_set_multirate_packing(bool enabled);
 bool device_load_test_data(const char* filename);
 void device_handle_trigger_simulation(void);
 void device_schedule_next_trigger(void);
@@ -180,14 +239,23 @@ void device_schedule_next_trigger(void);
 bool platform_init(void);
 void platform_cleanup(void);
 connection_handle_t platform_create_connection(void);
-bool platform_send_data(connection_handle_t conn, const uint8_t* data, uint32_t length);
+bool platform_send_data(connection_handle_t conn, const uint8_t* data, uint32_t length, bool droppable);
 int platform_receive_data(connection_handle_t conn, uint8_t* buffer, uint32_t bufferSize);
 void platform_close_connection(connection_handle_t conn);
 
+// Send queue
+bool platform_flush_send_queue(connection_handle_t conn);
+void platform_set_send_policy(SendQueuePolicy policy);
+const char* platform_send_policy_name(SendQueuePolicy policy);
+uint32_t platform_send_queue_depth(uint32_t* bytes);
+void platform_get_send_queue_stats(SendQueueStats_t* stats);
+void platform_print_send_queue_stats(void);
+
 // Data source abstraction
 bool data_source_init(void);
 void data_source_cleanup(void);
 int16_t data_source_get_sample(uint8_t channel, uint32_t sample_index);
+void data_source_fill(uint8_t channel, uint32_t first_index, uint16_t count, int16_t* out);
 
 // Utility functions
 const char* device_get_command_name(uint8_t cmd);
@@ -0,0 +1,249 @@
+// File: link_impairment.c
+// Description: Link impairment layer - bit flips, truncation, drops, duplicates,
+//              split writes and latency spikes driven by a seeded PRNG
+// Version: v2.1
+
+#include "link_impairment.h"
+#include "protocol/protocol.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ===================== Internal State =====================
+
+static LinkImpairConfig_t g_impair_cfg;
+static LinkImpairStats_t  g_impair_stats;
+static uint32_t           g_impair_rng = IMPAIR_DEFAULT_SEED;
+
+// xorshift32 - cheap and fully reproducible across platforms
+static uint32_t impair_rand(void) {
+    uint32_t x = g_impair_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_impair_rng = x;
+    return x;
+}
+
+// Uniform value in [0, n)
+static uint32_t impair_rand_below(uint32_t n) {
+    return n ? impair_rand() % n : 0;
+}
+
+static bool impair_roll(uint32_t ppm) {
+    return ppm > 0 && impair_rand_below(1000000U) < ppm;
+}
+
+// ===================== Configuration =====================
+
+void impair_config_defaults(LinkImpairConfig_t* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->data_only = true;
+    cfg->seed = IMPAIR_DEFAULT_SEED;
+    cfg->spike_ms = 50;
+}
+
+// Accepts "N" (ppm) or "X%" (percent of frames)
+static bool impair_parse_rate(const char* value, uint32_t* out_ppm) {
+    char* end = NULL;
+    double v = strtod(value, &end);
+    if (end == value || v < 0) {
+        return false;
+    }
+    if (*end == '%') {
+        v *= 10000.0;
+        end++;
+    }
+    if (*end != '\0' || v > 1000000.0) {
+        return false;
+    }
+    *out_ppm = (uint32_t)(v + 0.5);
+    return true;
+}
+
+// Spec format: "key=value[,key=value...]", e.g. "seed=7,drop=0.1%,split=2%,spike=500,spike_ms=20"
+// Keys: seed, flip, trunc, drop, dup, split, spike, spike_ms, all (impair every frame type)
+bool impair_parse_spec(const char* spec, LinkImpairConfig_t* cfg) {
+    if (!spec || !cfg) return false;
+
+    char buffer[256];
+    strncpy(buffer, spec, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    for (char* item = strtok(buffer, ","); item; item = strtok(NULL, ",")) {
+        char* value = strchr(item, '=');
+        if (value) {
+            *value++ = '\0';
+        }
+
+        bool ok = true;
+        if (strcmp(item, "all") == 0) {
+            cfg->data_only = false;
+        } else if (!value) {
+            ok = false;
+        } else if (strcmp(item, "seed") == 0) {
+            cfg->seed = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(item, "spike_ms") == 0) {
+            cfg->spike_ms = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(item, "flip") == 0) {
+            ok = impair_parse_rate(value, &cfg->bit_flip_ppm);
+        } else if (strcmp(item, "trunc") == 0) {
+            ok = impair_parse_rate(value, &cfg->truncate_ppm);
+        } else if (strcmp(item, "drop") == 0) {
+            ok = impair_parse_rate(value, &cfg->drop_ppm);
+        } else if (strcmp(item, "dup") == 0) {
+            ok = impair_parse_rate(value, &cfg->duplicate_ppm);
+        } else if (strcmp(item, "split") == 0) {
+            ok = impair_parse_rate(value, &cfg->split_ppm);
+        } else if (strcmp(item, "spike") == 0) {
+            ok = impair_parse_rate(value, &cfg->spike_ppm);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            PLATFORM_PRINTF("Invalid impairment option '%s'\n", item);
+            return false;
+        }
+    }
+
+    cfg->enabled = true;
+    return true;
+}
+
+void impair_configure(const LinkImpairConfig_t* cfg) {
+    g_impair_cfg = *cfg;
+    memset(&g_impair_stats, 0, sizeof(g_impair_stats));
+    // xorshift must never be seeded with 0
+    g_impair_rng = cfg->seed ? cfg->seed : IMPAIR_DEFAULT_SEED;
+
+    if (cfg->enabled) {
+        PLATFORM_PRINTF("Link impairment enabled (seed=0x%08X, %s): flip=%u trunc=%u drop=%u dup=%u "
+                        "split=%u spike=%u ppm, spike=%u ms\n",
+                        (unsigned)g_impair_rng, cfg->data_only ? "data frames" : "all frames",
+                        (unsigned)cfg->bit_flip_ppm, (unsigned)cfg->truncate_ppm, (unsigned)cfg->drop_ppm,
+                        (unsigned)cfg->duplicate_ppm, (unsigned)cfg->split_ppm, (unsigned)cfg->spike_ppm,
+                        (unsigned)cfg->spike_ms);
+    }
+}
+
+const LinkImpairConfig_t* impair_get_config(void) {
+    return &g_impair_cfg;
+}
+
+// ===================== Impairment Stage =====================
+
+static bool impair_write(connection_handle_t conn, const uint8_t* data, uint32_t length, bool droppable) {
+    bool ok = platform_send_data(conn, data, length, droppable);
+    if (ok) {
+        g_impair_stats.bytes_out += length;
+    }
+    return ok;
+}
+
+// Write the frame as several pieces at random cut points. The pieces are
+// never droppable: evicting one would leave the others orphaned on the wire.
+static bool impair_write_split(connection_handle_t conn, const uint8_t* data, uint32_t length) {
+    uint32_t pieces = 2 + impair_rand_below(IMPAIR_MAX_SPLIT_PIECES - 1);
+    uint32_t offset = 0;
+
+    for (uint32_t p = 0; p < pieces && offset < length; p++) {
+        uint32_t remaining = length - offset;
+        uint32_t chunk = (p + 1 == pieces) ? remaining : 1 + impair_rand_below(remaining);
+        if (!impair_write(conn, data + offset, chunk, false)) {
+            return false;
+        }
+        offset += chunk;
+    }
+    return offset == length || impair_write(conn, data + offset, length - offset, false);
+}
+
+bool impair_send_frame(connection_handle_t conn, uint8_t cmd, const uint8_t* frame, uint32_t length) {
+    bool droppable = (cmd == CMD_DATA_PACKET);
+    if (!g_impair_cfg.enabled || (g_impair_cfg.data_only && cmd != CMD_DATA_PACKET)) {
+        return platform_send_data(conn, frame, length, droppable);
+    }
+
+    uint8_t work[MAX_FRAME_SIZE];
+    uint32_t work_len = length;
+    bool impaired = false;
+
+    g_impair_stats.frames_seen++;
+    g_impair_stats.bytes_in += length;
+
+    if (impair_roll(g_impair_cfg.spike_ppm)) {
+        g_impair_stats.spikes++;
+        impaired = true;
+        PLATFORM_SLEEP(g_impair_cfg.spike_ms);
+    }
+
+    if (impair_roll(g_impair_cfg.drop_ppm)) {
+        g_impair_stats.dropped++;
+        g_impair_stats.frames_impaired++;
+        return true; // The link "accepted" it - the receiver must notice the gap
+    }
+
+    if (length > sizeof(work)) {
+        return platform_send_data(conn, frame, length, droppable);
+    }
+    memcpy(work, frame, length);
+
+    if (length > 1 && impair_roll(g_impair_cfg.truncate_ppm)) {
+        work_len = 1 + impair_rand_below(length - 1);
+        g_impair_stats.truncated++;
+        impaired = true;
+    }
+
+    if (impair_roll(g_impair_cfg.bit_flip_ppm)) {
+        uint32_t flips = 1 + impair_rand_below(IMPAIR_MAX_BIT_FLIPS);
+        for (uint32_t i = 0; i < flips; i++) {
+            uint32_t bit = impair_rand_below(work_len * 8);
+            work[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        }
+        g_impair_stats.bit_flips++;
+        impaired = true;
+    }
+
+    bool ok;
+    if (work_len > 1 && impair_roll(g_impair_cfg.split_ppm)) {
+        g_impair_stats.split++;
+        impaired = true;
+        ok = impair_write_split(conn, work, work_len);
+    } else {
+        ok = impair_write(conn, work, work_len, droppable);
+    }
+
+    if (ok && impair_roll(g_impair_cfg.duplicate_ppm)) {
+        g_impair_stats.duplicated++;
+        impaired = true;
+        ok = impair_write(conn, work, work_len, droppable);
+    }
+
+    if (impaired) {
+        g_impair_stats.frames_impaired++;
+    }
+    return ok;
+}
+
+// ===================== Statistics =====================
+
+void impair_get_stats(LinkImpairStats_t* stats) {
+    *stats = g_impair_stats;
+}
+
+void impair_print_stats(void) {
+    if (!g_impair_cfg.enabled) {
+        return;
+    }
+
+    const LinkImpairStats_t* s = &g_impair_stats;
+    PLATFORM_PRINTF("=== Link Impairment Summary (seed=0x%08X) ===\n", (unsigned)g_impair_cfg.seed);
+    PLATFORM_PRINTF("Frames offered:   %u (%llu bytes)\n", s->frames_seen, (unsigned long long)s->bytes_in);
+    PLATFORM_PRINTF("Bytes written:    %llu\n", (unsigned long long)s->bytes_out);
+    PLATFORM_PRINTF("Frames impaired:  %u\n", s->frames_impaired);
+    PLATFORM_PRINTF("  dropped:        %u\n", s->dropped);
+    PLATFORM_PRINTF("  truncated:      %u\n", s->truncated);
+    PLATFORM_PRINTF("  bit flipped:    %u\n", s->bit_flips);
+    PLATFORM_PRINTF("  split:          %u\n", s->split);
+    PLATFORM_PRINTF("  duplicated:     %u\n", s->duplicated);
+    PLATFORM_PRINTF("  latency spikes: %u\n", s->spikes);
+}
@@ -0,0 +1,57 @@
+// File: link_impairment.h
+// Description: Deterministic link impairment stage between buildFrame() and platform_send_data()
+// Version: v2.1
+
+#ifndef LINK_IMPAIRMENT_H
+#define LINK_IMPAIRMENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "device_simulator.h"
+
+// ===================== Configuration =====================
+
+// All rates are per-frame probabilities in parts per million (0 = off,
+// 1000000 = every frame). Impairments are evaluated in the order:
+// latency spike -> drop -> truncate -> bit flip -> split write -> duplicate.
+typedef struct {
+    bool     enabled;
+    bool     data_only;             // Only impair CMD_DATA_PACKET frames (default)
+    uint32_t seed;                  // PRNG seed - same seed, same impairment pattern
+    uint32_t bit_flip_ppm;          // Flip 1..IMPAIR_MAX_BIT_FLIPS random bits
+    uint32_t truncate_ppm;          // Send a random-length prefix only
+    uint32_t drop_ppm;              // Do not send the frame at all
+    uint32_t duplicate_ppm;         // Send the frame twice
+    uint32_t split_ppm;             // Send the frame in 2..IMPAIR_MAX_SPLIT_PIECES writes
+    uint32_t spike_ppm;             // Stall the link before sending
+    uint32_t spike_ms;              // Stall duration
+} LinkImpairConfig_t;
+
+typedef struct {
+    uint32_t frames_seen;           // Frames offered to the stage
+    uint32_t frames_impaired;       // Frames with at least one impairment
+    uint32_t bit_flips;             // Frames with flipped bits
+    uint32_t truncated;
+    uint32_t dropped;
+    uint32_t duplicated;
+    uint32_t split;
+    uint32_t spikes;
+    uint64_t bytes_in;              // Bytes offered
+    uint64_t bytes_out;             // Bytes actually written to the link
+} LinkImpairStats_t;
+
+// ===================== Function Declarations =====================
+
+void impair_config_defaults(LinkImpairConfig_t* cfg);
+bool impair_parse_spec(const char* spec, LinkImpairConfig_t* cfg);
+void impair_configure(const LinkImpairConfig_t* cfg);
+const LinkImpairConfig_t* impair_get_config(void);
+
+// Drop-in replacement for platform_send_data() on complete frames
+bool impair_send_frame(connection_handle_t conn, uint8_t cmd, const uint8_t* frame, uint32_t length);
+
+void impair_get_stats(LinkImpairStats_t* stats);
+void impair_print_stats(void);
+
+#endif // LINK_IMPAIRMENT_H
@@ -6,11 +6,22 @@
 #include "device_simulator.h"
 #include "protocol/protocol.h"
 #include "protocol/io_buffer.h"
+#include "perf_counters.h"
+#include "link_impairment.h"
+#include "sim_clock.h"
+#ifdef SIMULATION_MODE
+#include "scenario.h"
+#endif
 
 // Global variables for communication loop
 static RxBuffer_t g_rx_buffer;
 static volatile bool g_running = true;
 
+#ifdef SIMULATION_MODE
+// Performance dump requested on the command line (--perf-json)
+static const char* g_perf_json_file = NULL;
+#endif
+
 // Frame processing callback
 static void on_frame_parsed(const uint8_t* frame, uint16_t frameLen);
 
@@ -58,12 +69,48 @@ void device_communication_loop(void) {
             break;
         }
 
+        // Resume frames the link could not take earlier
+        if (!platform_flush_send_queue(g_device_state.connection)) {
+            PLATFORM_PRINTF("Connection error while flushing send queue\n");
+            break;
+        }
+
+#ifdef SIMULATION_MODE
+        // Advance the load-profile scenario, if one was loaded
+        if (!scenario_tick()) {
+            PLATFORM_PRINTF("Scenario finished, exiting\n");
+            break;
+        }
+#endif
+
         // Handle data generation based on current mode
         if (g_device_state.stream_status == STATUS_RUNNING) {
             static uint32_t last_data_time = 0;
-            uint32_t current_time = PLATFORM_TICK();
+            static uint64_t last_data_ns = 0;
+            uint32_t current_time = sim_clock_now_ms();
+            uint32_t interval = (g_device_state.mode == MODE_CONTINUOUS) ?
+                                device_packet_interval_ms() : DATA_SEND_INTERVAL_MS;
+
+            // Paused by the host: nothing is due, the span becomes backlog
+            if (device_flow_paused()) {
+                last_data_time = current_time;
+            }
+
+            // Send every interval that has elapsed on the device clock, so
+            // scaled clocks and short stalls do not lose packets
+            if (current_time - last_data_time > SIM_CLOCK_MAX_CATCHUP * interval) {
+                last_data_time = current_time - interval;
+            }
+
+            if (current_time - last_data_time >= interval) {
+                uint64_t now_ns = perf_now_ns();
+                if (last_data_ns != 0) {
+                    perf_record_pacing(now_ns - last_data_ns);
+                }
+                last_data_ns = now_ns;
+            }
 
-            if (current_time - last_data_time >= DATA_SEND_INTERVAL_MS) {
+            while (current_time - last_data_time >= interval) {
                 if (g_device_state.mode == MODE_CONTINUOUS) {
                     // Continuous mode: send data packets regularly
                     device_generate_data_packet();
@@ -72,11 +119,24 @@ void device_communication_loop(void) {
                     // Trigger mode: handle trigger simulation
                     device_handle_trigger_simulation();
                 }
-                last_data_time = current_time;
+                last_data_time += interval;
             }
+
+            device_flow_drain();
         }
 
-        PLATFORM_SLEEP(1); // Prevent high CPU usage
+        perf_tick();
+
+        uint64_t idle_start = perf_now_ns();
+        if (sim_clock_mode() == SIM_CLOCK_FREE_RUN &&
+            (g_device_state.stream_status != STATUS_RUNNING || platform_send_queue_depth(NULL) > 0 ||
+             g_device_state.flow_paused)) {
+            // Free-running clock stands still while idle or while the link drains
+            PLATFORM_SLEEP(1);
+        } else {
+            sim_clock_sleep(1); // Prevent high CPU usage
+        }
+        perf_record_idle(perf_now_ns() - idle_start);
     }
 
     PLATFORM_PRINTF("Communication loop ended\n");
@@ -105,6 +165,12 @@ static void on_frame_parsed(const uint8_t* frame, uint16_t frameLen) {
 // ===================== Main Function =====================
 
 int main(int argc, char* argv[]) {
+    uint8_t perf_report_mask = DEBUG_PERFORMANCE_TIMING ? PERF_REPORT_CONSOLE : PERF_REPORT_NONE;
+    LinkImpairConfig_t impair_cfg;
+    impair_config_defaults(&impair_cfg);
+    SimClockMode clock_mode = SIM_CLOCK_REALTIME;
+    double clock_scale = 1.0;
+
     PLATFORM_PRINTF("=== Device Simulator v2.1 ===\n");
     PLATFORM_PRINTF("Protocol: V6\n");
     
@@ -120,10 +186,24 @@ int main(int argc, char* argv[]) {
             PLATFORM_PRINTF("  --help, -h        Show this help\n");
             PLATFORM_PRINTF("  --version         Show version info\n");
             PLATFORM_PRINTF("  --csv <file>      Use custom CSV data file\n");
+            PLATFORM_PRINTF("  --scenario <file> Run the load-profile phases in <file> (see scenarios/)\n");
+            PLATFORM_PRINTF("  --channels <n>    Channels the device exposes, 1-%d (default %d)\n",
+                            MAX_CHANNELS, DEFAULT_CHANNELS);
+            PLATFORM_PRINTF("  --multirate       Send DATA_PACKET_MULTIRATE when channel rates differ\n");
+            PLATFORM_PRINTF("  --perf            Print performance counters every %u ms\n",
+                            (unsigned)PERFORMANCE_SAMPLE_INTERVAL);
+            PLATFORM_PRINTF("  --perf-log        Report performance counters as CMD_LOG_MESSAGE\n");
+            PLATFORM_PRINTF("  --perf-json <f>   Dump performance history and verdict to JSON on exit\n");
+            PLATFORM_PRINTF("  --impair <spec>   Impair outgoing frames, e.g. seed=7,drop=0.1%%,flip=500,split=2%%\n");
+            PLATFORM_PRINTF("                    keys: seed flip trunc drop dup split spike spike_ms all\n");
+            PLATFORM_PRINTF("  --clock <c>       Device clock: realtime, <N>x (e.g. 20x) or max\n");
+            PLATFORM_PRINTF("  --send-policy <p> Send queue overload policy: block, drop-newest, drop-oldest (default %s)\n",
+                            platform_send_policy_name(SEND_QUEUE_DEFAULT_POLICY));
             PLATFORM_PRINTF("\nSimulation Mode Features:\n");
             PLATFORM_PRINTF("  - TCP server on port %s\n", DEFAULT_PORT);
             PLATFORM_PRINTF("  - CSV data loading support\n");
             PLATFORM_PRINTF("  - Trigger simulation\n");
+            PLATFORM_PRINTF("  - Scenario-driven ramp/soak/spike load profiles\n");
             PLATFORM_PRINTF("  - Built-in signal generation\n");
             return 0;
         } else if (strcmp(argv[i], "--version") == 0) {
@@ -136,8 +216,48 @@ int main(int argc, char* argv[]) {
             #endif
             return 0;
         } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
-            // Custom CSV file handling would go here
-            PLATFORM_PRINTF("Custom CSV file: %s\n", argv[++i]);
+            device_set_test_data_file(argv[++i]);
+            PLATFORM_PRINTF("Custom CSV file: %s\n", argv[i]);
+        } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            int count = atoi(argv[++i]);
+            if (count < 1 || count > MAX_CHANNELS) {
+                PLATFORM_PRINTF("Invalid channel count '%s' (1-%d)\n", argv[i], MAX_CHANNELS);
+                return 1;
+            }
+            device_set_channel_count((uint8_t)count);
+        } else if (strcmp(argv[i], "--multirate") == 0) {
+            device_set_multirate_packing(true);
+        } else if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            if (!scenario_load(argv[++i])) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            perf_report_mask |= PERF_REPORT_CONSOLE;
+        } else if (strcmp(argv[i], "--perf-log") == 0) {
+            perf_report_mask |= PERF_REPORT_LOG_MESSAGE;
+        } else if (strcmp(argv[i], "--perf-json") == 0 && i + 1 < argc) {
+            g_perf_json_file = argv[++i];
+        } else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            if (!sim_clock_parse(argv[++i], &clock_mode, &clock_scale)) {
+                PLATFORM_PRINTF("Invalid clock '%s' (use realtime, <N>x or max)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--send-policy") == 0 && i + 1 < argc) {
+            const char* policy = argv[++i];
+            if (strcmp(policy, "block") == 0) {
+                platform_set_send_policy(SEND_POLICY_BLOCK);
+            } else if (strcmp(policy, "drop-newest") == 0) {
+                platform_set_send_policy(SEND_POLICY_DROP_NEWEST);
+            } else if (strcmp(policy, "drop-oldest") == 0) {
+                platform_set_send_policy(SEND_POLICY_DROP_OLDEST);
+            } else {
+                PLATFORM_PRINTF("Unknown send policy '%s'\n", policy);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--impair") == 0 && i + 1 < argc) {
+            if (!impair_parse_spec(argv[++i], &impair_cfg)) {
+                return 1;
+            }
         }
     }
     
@@ -151,11 +271,15 @@ int main(int argc, char* argv[]) {
 
     PLATFORM_PRINTF("================================\n\n");
 
+    sim_clock_init(clock_mode, clock_scale);
+
     // Initialize device
     if (!device_init()) {
         PLATFORM_PRINTF("Device initialization failed!\n");
         return 1;
     }
+    perf_set_report_mask(perf_report_mask);
+    impair_configure(&impair_cfg);
 
     // Start communication
     if (!device_start_communication()) {
@@ -173,6 +297,19 @@ int main(int argc, char* argv[]) {
     // Main communication loop
     device_communication_loop();
 
+#ifdef SIMULATION_MODE
+    if (g_perf_json_file) {
+        (void)perf_dump_json(g_perf_json_file);
+    }
+#endif
+    impair_print_stats();
+#ifdef SIMULATION_MODE
+    scenario_print_summary();
+#endif
+    sim_clock_print_summary();
+    platform_print_send_queue_stats();
+    device_print_flow_stats();
+
     // Cleanup
     device_cleanup();
     
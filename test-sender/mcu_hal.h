@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // ===================== Platform-specific includes =====================
 // Uncomment and customize based on your MCU platform:
@@ -65,6 +66,12 @@ void mcu_hal_deinit(void);
  */
 uint32_t hal_get_tick(void);
 
+/**
+ * @brief Get free-running microsecond counter (e.g. DWT->CYCCNT / SystemCoreClock)
+ * @return Current counter value in microseconds (wraps at 2^32)
+ */
+uint32_t hal_get_tick_us(void);
+
 /**
  * @brief Delay for specified milliseconds
  * @param ms Delay in milliseconds
@@ -168,6 +175,25 @@ hal_status_t adc_read_channel(void* handle, uint8_t channel, uint16_t* value);
  */
 hal_status_t adc_start_continuous(void* handle, uint8_t* channels, uint8_t channel_count, uint32_t sample_rate);
 
+/**
+ * @brief DMA transfer callback, called from interrupt context
+ * @param context Pointer passed to adc_register_dma
+ * @param half 0 = first half of the buffer complete, 1 = second half complete
+ */
+typedef void (*adc_dma_callback_t)(void* context, uint8_t half);
+
+/**
+ * @brief Attach a circular DMA buffer to the ADC (call before adc_start_continuous)
+ * @param handle ADC handle
+ * @param buffer Circular buffer receiving interleaved scan results (ch0, ch1, ... ch0, ...)
+ * @param length Buffer length in samples (both halves)
+ * @param callback Half/full transfer complete callback
+ * @param context User pointer passed to callback
+ * @return HAL_OK on success
+ */
+hal_status_t adc_register_dma(void* handle, uint16_t* buffer, uint32_t length,
+                              adc_dma_callback_t callback, void* context);
+
 /**
  * @brief Stop continuous ADC conversion
  * @param handle ADC handle
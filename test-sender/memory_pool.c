@@ -0,0 +1,217 @@
+// File: memory_pool.c
+// Description: Static fixed-block memory pool - one free list per block class
+// Version: v2.1
+
+#include "device_simulator.h"
+#include "memory_pool.h"
+#include <string.h>
+
+// ===================== Pool Storage =====================
+
+typedef struct PoolBlock {
+    struct PoolBlock* next;         // Valid only while the block is free
+} PoolBlock_t;
+
+typedef struct {
+    uint8_t*     base;              // First block of the class
+    uint32_t     block_size;        // Aligned block size
+    uint16_t     block_count;
+    uint16_t     first_index;       // Offset into g_block_used[]
+    PoolBlock_t* free_list;
+#if DEBUG_MEMORY_TRACKING
+    uint16_t     in_use;
+    uint16_t     high_water;
+    uint32_t     alloc_count;
+    uint32_t     fail_count;
+#endif
+} PoolClassState_t;
+
+// Backing store, aligned for any block content
+static union {
+    uint8_t bytes[POOL_TOTAL_BYTES];
+    void*   align_ptr;
+    double  align_double;
+    uint64_t align_u64;
+} g_pool_arena;
+
+static PoolClassState_t g_pool_classes[POOL_CLASS_COUNT];
+static bool g_pool_initialized = false;
+
+#if ENABLE_MEMORY_PROTECTION
+// One flag per block to catch double frees and foreign pointers
+static uint8_t g_block_used[POOL_TOTAL_BLOCKS > 0 ? POOL_TOTAL_BLOCKS : 1];
+#endif
+
+static const char* const g_pool_class_names[POOL_CLASS_COUNT] = {
+    "trigger", "packet", "csv"
+};
+
+// ===================== Initialization =====================
+
+void mem_pool_init(void) {
+    if (g_pool_initialized) {
+        return;
+    }
+
+    const uint32_t sizes[POOL_CLASS_COUNT] = {
+        POOL_ALIGN(POOL_TRIGGER_BLOCK_SIZE),
+        POOL_ALIGN(POOL_PACKET_BLOCK_SIZE),
+        POOL_ALIGN(POOL_CSV_BLOCK_SIZE)
+    };
+    const uint16_t counts[POOL_CLASS_COUNT] = {
+        POOL_TRIGGER_BLOCKS, POOL_PACKET_BLOCKS, POOL_CSV_BLOCKS
+    };
+
+    uint8_t* cursor = g_pool_arena.bytes;
+    uint16_t block_index = 0;
+
+    for (int c = 0; c < POOL_CLASS_COUNT; c++) {
+        PoolClassState_t* pc = &g_pool_classes[c];
+        memset(pc, 0, sizeof(*pc));
+        pc->base = cursor;
+        pc->block_size = sizes[c];
+        pc->block_count = counts[c];
+        pc->first_index = block_index;
+
+        // Thread the free list through the blocks, lowest address first
+        for (int b = counts[c] - 1; b >= 0; b--) {
+            PoolBlock_t* block = (PoolBlock_t*)(cursor + (uint32_t)b * sizes[c]);
+            block->next = pc->free_list;
+            pc->free_list = block;
+        }
+
+        cursor += (uint32_t)counts[c] * sizes[c];
+        block_index += counts[c];
+    }
+
+#if ENABLE_MEMORY_PROTECTION
+    memset(g_block_used, 0, sizeof(g_block_used));
+#endif
+    g_pool_initialized = true;
+}
+
+// ===================== Allocation =====================
+
+void* mem_pool_alloc(PoolClass_t cls) {
+    if (!g_pool_initialized || cls >= POOL_CLASS_COUNT) {
+        return NULL;
+    }
+
+    PoolClassState_t* pc = &g_pool_classes[cls];
+    PoolBlock_t* block = pc->free_list;
+    if (!block) {
+#if DEBUG_MEMORY_TRACKING
+        pc->fail_count++;
+        PLATFORM_PRINTF("Memory pool '%s' exhausted (%u blocks)\n",
+                        g_pool_class_names[cls], (unsigned)pc->block_count);
+#endif
+        return NULL;
+    }
+    pc->free_list = block->next;
+
+#if ENABLE_MEMORY_PROTECTION
+    g_block_used[pc->first_index + ((uint8_t*)block - pc->base) / pc->block_size] = 1;
+#endif
+#if DEBUG_MEMORY_TRACKING
+    pc->alloc_count++;
+    pc->in_use++;
+    if (pc->in_use > pc->high_water) {
+        pc->high_water = pc->in_use;
+    }
+#endif
+    return block;
+}
+
+void* mem_pool_malloc(size_t size) {
+    // Try classes from the smallest block upwards
+    PoolClass_t best = POOL_CLASS_COUNT;
+    for (int c = 0; c < POOL_CLASS_COUNT; c++) {
+        const PoolClassState_t* pc = &g_pool_classes[c];
+        if (pc->block_count == 0 || pc->block_size < size || !pc->free_list) {
+            continue;
+        }
+        if (best == POOL_CLASS_COUNT || pc->block_size < g_pool_classes[best].block_size) {
+            best = (PoolClass_t)c;
+        }
+    }
+
+    if (best == POOL_CLASS_COUNT) {
+        PLATFORM_PRINTF("Memory pool: no free block for %u bytes\n", (unsigned)size);
+        return NULL;
+    }
+    return mem_pool_alloc(best);
+}
+
+void mem_pool_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    uint8_t* p = (uint8_t*)ptr;
+    for (int c = 0; c < POOL_CLASS_COUNT; c++) {
+        PoolClassState_t* pc = &g_pool_classes[c];
+        uint8_t* end = pc->base + (uint32_t)pc->block_count * pc->block_size;
+        if (p < pc->base || p >= end) {
+            continue;
+        }
+
+#if ENABLE_MEMORY_PROTECTION
+        uint32_t offset = (uint32_t)(p - pc->base);
+        uint32_t index = pc->first_index + offset / pc->block_size;
+        if (offset % pc->block_size != 0 || !g_block_used[index]) {
+            PLATFORM_PRINTF("Memory pool: invalid or double free of %p ('%s')\n",
+                            ptr, g_pool_class_names[c]);
+            return;
+        }
+        g_block_used[index] = 0;
+#endif
+
+        PoolBlock_t* block = (PoolBlock_t*)p;
+        block->next = pc->free_list;
+        pc->free_list = block;
+#if DEBUG_MEMORY_TRACKING
+        pc->in_use--;
+#endif
+        return;
+    }
+
+    PLATFORM_PRINTF("Memory pool: pointer %p not owned by pool\n", ptr);
+}
+
+// ===================== Statistics =====================
+
+bool mem_pool_get_stats(PoolClass_t cls, PoolClassStats_t* stats) {
+    if (cls >= POOL_CLASS_COUNT || !stats) {
+        return false;
+    }
+
+    const PoolClassState_t* pc = &g_pool_classes[cls];
+    memset(stats, 0, sizeof(*stats));
+    stats->block_size = pc->block_size;
+    stats->block_count = pc->block_count;
+#if DEBUG_MEMORY_TRACKING
+    stats->in_use = pc->in_use;
+    stats->high_water = pc->high_water;
+    stats->alloc_count = pc->alloc_count;
+    stats->fail_count = pc->fail_count;
+#endif
+    return true;
+}
+
+void mem_pool_print_stats(void) {
+    PLATFORM_PRINTF("=== Memory Pool (%u / %u bytes reserved) ===\n",
+                    (unsigned)POOL_TOTAL_BYTES, (unsigned)MEMORY_POOL_SIZE);
+    for (int c = 0; c < POOL_CLASS_COUNT; c++) {
+        PoolClassStats_t s;
+        mem_pool_get_stats((PoolClass_t)c, &s);
+#if DEBUG_MEMORY_TRACKING
+        PLATFORM_PRINTF("%-8s %6u B x %2u  in use %2u  high water %2u  allocs %u  failures %u\n",
+                        g_pool_class_names[c], (unsigned)s.block_size, (unsigned)s.block_count,
+                        (unsigned)s.in_use, (unsigned)s.high_water,
+                        (unsigned)s.alloc_count, (unsigned)s.fail_count);
+#else
+        PLATFORM_PRINTF("%-8s %6u B x %2u\n",
+                        g_pool_class_names[c], (unsigned)s.block_size, (unsigned)s.block_count);
+#endif
+    }
+}
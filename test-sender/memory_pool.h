@@ -0,0 +1,67 @@
+// File: memory_pool.h
+// Description: Static fixed-block memory pool (O(1), no fragmentation) shared by simulator and MCU builds
+// Version: v2.1
+
+#ifndef MEMORY_POOL_H
+#define MEMORY_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "config.h"
+
+// ===================== Block Classes =====================
+
+// Every block of a class has the same size, so allocation and release are a
+// single free-list pop/push and the worst-case footprint is fixed at compile time.
+typedef enum {
+    POOL_CLASS_TRIGGER = 0,         // Pre/post trigger sample ring
+    POOL_CLASS_PACKET,              // DATA_PACKET payload assembly
+    POOL_CLASS_CSV,                 // One CSV column (MAX_CSV_ROWS floats)
+    POOL_CLASS_COUNT
+} PoolClass_t;
+
+// Round a block size up to MEMORY_ALIGNMENT (and to pointer size for the free list)
+#define POOL_ALIGN_UNIT             (MEMORY_ALIGNMENT > sizeof(void*) ? MEMORY_ALIGNMENT : sizeof(void*))
+#define POOL_ALIGN(size)            ((((size) + POOL_ALIGN_UNIT - 1) / POOL_ALIGN_UNIT) * POOL_ALIGN_UNIT)
+
+// Total bytes reserved for all classes - this is the pool's worst case
+#define POOL_TOTAL_BYTES            (POOL_ALIGN(POOL_TRIGGER_BLOCK_SIZE) * POOL_TRIGGER_BLOCKS + \
+                                     POOL_ALIGN(POOL_PACKET_BLOCK_SIZE) * POOL_PACKET_BLOCKS + \
+                                     POOL_ALIGN(POOL_CSV_BLOCK_SIZE) * POOL_CSV_BLOCKS)
+#define POOL_TOTAL_BLOCKS           (POOL_TRIGGER_BLOCKS + POOL_PACKET_BLOCKS + POOL_CSV_BLOCKS)
+
+STATIC_ASSERT(POOL_TOTAL_BYTES <= MEMORY_POOL_SIZE, memory_pool_too_small);
+STATIC_ASSERT(POOL_TOTAL_BLOCKS <= MAX_ALLOCATIONS, too_many_pool_blocks);
+
+// Per-class usage counters (only maintained with DEBUG_MEMORY_TRACKING)
+typedef struct {
+    uint32_t block_size;
+    uint16_t block_count;
+    uint16_t in_use;
+    uint16_t high_water;            // Most blocks ever in use at once
+    uint32_t alloc_count;
+    uint32_t fail_count;            // Requests that found the class exhausted
+} PoolClassStats_t;
+
+// ===================== Function Declarations =====================
+
+// Build the free lists; must run before the first allocation (idempotent)
+void mem_pool_init(void);
+
+// Class allocation - returns NULL if the class is exhausted
+void* mem_pool_alloc(PoolClass_t cls);
+
+// Size-based allocation - smallest class whose block fits (used by PLATFORM_MALLOC
+// when USE_CUSTOM_MALLOC is set)
+void* mem_pool_malloc(size_t size);
+
+// Return a block to its class; NULL is ignored
+void mem_pool_free(void* ptr);
+
+// Statistics
+bool mem_pool_get_stats(PoolClass_t cls, PoolClassStats_t* stats);
+void mem_pool_print_stats(void);
+
+#endif // MEMORY_POOL_H
@@ -0,0 +1,362 @@
+// File: perf_counters.c
+// Description: Performance counter subsystem - windowed counters sampled into a fixed history ring
+// Version: v2.1
+
+#include "device_simulator.h"
+#include "perf_counters.h"
+#include <stdio.h>
+#include <string.h>
+
+#if ENABLE_PERFORMANCE_COUNTERS
+
+// ===================== Internal State =====================
+
+// Accumulators for the window that is currently open
+typedef struct {
+    uint32_t frames;
+    uint64_t bytes;
+    uint32_t send_calls;
+    uint32_t send_failures;
+    uint64_t send_ns_total;
+    uint64_t send_ns_max;
+    uint64_t gen_samples;
+    uint64_t gen_ns_total;
+    int64_t  pacing_err_ns_total;
+    uint64_t pacing_err_ns_max;
+    uint32_t pacing_count;
+    uint64_t idle_ns_total;
+} PerfWindow_t;
+
+static PerfWindow_t g_window;
+static uint32_t     g_window_start_ms;
+static uint64_t     g_window_start_ns;
+static uint64_t     g_window_start_cpu_ns;
+
+static PerfSample_t g_history[MAX_PERFORMANCE_SAMPLES];
+static uint32_t     g_history_head;     // Next slot to write
+static uint32_t     g_history_count;    // Valid entries (<= MAX_PERFORMANCE_SAMPLES)
+
+static uint8_t      g_report_mask = PERF_REPORT_NONE;
+
+// ===================== Clock Sources =====================
+
+uint64_t perf_now_ns(void) {
+#ifdef SIMULATION_MODE
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER counter;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&counter);
+    uint64_t c = (uint64_t)counter.QuadPart;
+    uint64_t f = (uint64_t)freq.QuadPart;
+    return (c / f) * 1000000000ULL + ((c % f) * 1000000000ULL) / f;
+#else
+    // Extend the 32-bit microsecond counter so deltas survive the wrap
+    static uint32_t last_us = 0;
+    static uint64_t high_us = 0;
+    uint32_t now_us = hal_get_tick_us();
+    if (now_us < last_us) {
+        high_us += 0x100000000ULL;
+    }
+    last_us = now_us;
+    return (high_us + now_us) * 1000ULL;
+#endif
+}
+
+// Process CPU time in ns (simulation only; MCU derives CPU load from idle time)
+static uint64_t perf_cpu_time_ns(void) {
+#ifdef SIMULATION_MODE
+    FILETIME creation, exit_time, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit_time, &kernel, &user)) {
+        return 0;
+    }
+    uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (k + u) * 100ULL; // FILETIME is in 100ns units
+#else
+    return 0;
+#endif
+}
+
+// ===================== Lifecycle =====================
+
+void perf_init(void) {
+    memset(&g_window, 0, sizeof(g_window));
+    memset(g_history, 0, sizeof(g_history));
+    g_history_head = 0;
+    g_history_count = 0;
+
+    g_window_start_ms = PLATFORM_TICK();
+    g_window_start_ns = perf_now_ns();
+    g_window_start_cpu_ns = perf_cpu_time_ns();
+
+    PLATFORM_PRINTF("Performance counters initialized (%u ms windows, %u samples history)\n",
+                    (unsigned)PERFORMANCE_SAMPLE_INTERVAL, (unsigned)MAX_PERFORMANCE_SAMPLES);
+}
+
+void perf_set_report_mask(uint8_t mask) {
+    g_report_mask = mask;
+}
+
+// ===================== Event Recording =====================
+
+void perf_record_send(uint32_t bytes, uint64_t elapsed_ns, bool success) {
+    g_window.send_calls++;
+    g_window.send_ns_total += elapsed_ns;
+    if (elapsed_ns > g_window.send_ns_max) {
+        g_window.send_ns_max = elapsed_ns;
+    }
+    if (success) {
+        g_window.frames++;
+        g_window.bytes += bytes;
+    } else {
+        g_window.send_failures++;
+    }
+}
+
+void perf_record_generation(uint32_t samples, uint64_t elapsed_ns) {
+    g_window.gen_samples += samples;
+    g_window.gen_ns_total += elapsed_ns;
+}
+
+void perf_record_pacing(uint64_t actual_interval_ns) {
+    int64_t error_ns = (int64_t)actual_interval_ns - (int64_t)DATA_SEND_INTERVAL_MS * 1000000LL;
+    uint64_t abs_error = (uint64_t)(error_ns < 0 ? -error_ns : error_ns);
+
+    g_window.pacing_err_ns_total += error_ns;
+    g_window.pacing_count++;
+    if (abs_error > g_window.pacing_err_ns_max) {
+        g_window.pacing_err_ns_max = abs_error;
+    }
+}
+
+void perf_record_idle(uint64_t elapsed_ns) {
+    g_window.idle_ns_total += elapsed_ns;
+}
+
+// ===================== Window Sampling =====================
+
+static void perf_close_window(uint32_t now_ms) {
+    uint64_t now_ns = perf_now_ns();
+    uint64_t wall_ns = now_ns - g_window_start_ns;
+    if (wall_ns == 0) {
+        wall_ns = 1;
+    }
+
+    PerfSample_t* s = &g_history[g_history_head];
+    memset(s, 0, sizeof(*s));
+
+    s->timestamp_ms = now_ms;
+    s->window_ms = now_ms - g_window_start_ms;
+    s->frames_per_sec = (uint32_t)(((uint64_t)g_window.frames * 1000000000ULL) / wall_ns);
+    s->bytes_per_sec = (uint32_t)((g_window.bytes * 1000000000ULL) / wall_ns);
+    s->send_failures = g_window.send_failures;
+
+    if (g_window.gen_samples > 0) {
+        s->gen_ns_per_sample = (uint32_t)(g_window.gen_ns_total / g_window.gen_samples);
+    }
+    if (g_window.send_calls > 0) {
+        s->send_avg_us = (uint32_t)(g_window.send_ns_total / g_window.send_calls / 1000ULL);
+    }
+    s->send_max_us = (uint32_t)(g_window.send_ns_max / 1000ULL);
+    if (g_window.pacing_count > 0) {
+        s->pacing_avg_us = (int32_t)(g_window.pacing_err_ns_total / (int64_t)g_window.pacing_count / 1000LL);
+    }
+    s->pacing_max_us = (uint32_t)(g_window.pacing_err_ns_max / 1000ULL);
+
+#ifdef SIMULATION_MODE
+    uint64_t cpu_ns = perf_cpu_time_ns();
+    if (cpu_ns == 0 || cpu_ns < g_window_start_cpu_ns) {
+        s->cpu_permille = PERF_CPU_UNAVAILABLE;
+    } else {
+        s->cpu_permille = (uint16_t)(((cpu_ns - g_window_start_cpu_ns) * 1000ULL) / wall_ns);
+    }
+    g_window_start_cpu_ns = cpu_ns;
+#else
+    uint64_t idle_ns = g_window.idle_ns_total < wall_ns ? g_window.idle_ns_total : wall_ns;
+    s->cpu_permille = (uint16_t)(((wall_ns - idle_ns) * 1000ULL) / wall_ns);
+#endif
+
+    g_history_head = (g_history_head + 1) % MAX_PERFORMANCE_SAMPLES;
+    if (g_history_count < MAX_PERFORMANCE_SAMPLES) {
+        g_history_count++;
+    }
+
+    memset(&g_window, 0, sizeof(g_window));
+    g_window_start_ms = now_ms;
+    g_window_start_ns = now_ns;
+}
+
+void perf_tick(void) {
+    uint32_t now_ms = PLATFORM_TICK();
+    if (now_ms - g_window_start_ms < PERFORMANCE_SAMPLE_INTERVAL) {
+        return;
+    }
+
+    perf_close_window(now_ms);
+
+    if (g_report_mask & PERF_REPORT_CONSOLE) {
+        perf_report_console();
+    }
+    if (g_report_mask & PERF_REPORT_LOG_MESSAGE) {
+        perf_report_log_message();
+    }
+}
+
+// Most recent closed window, or NULL if none
+static const PerfSample_t* perf_latest(void) {
+    if (g_history_count == 0) {
+        return NULL;
+    }
+    uint32_t idx = (g_history_head + MAX_PERFORMANCE_SAMPLES - 1) % MAX_PERFORMANCE_SAMPLES;
+    return &g_history[idx];
+}
+
+uint32_t perf_get_history(PerfSample_t* out, uint32_t max_samples) {
+    uint32_t n = g_history_count < max_samples ? g_history_count : max_samples;
+    // Oldest first, ending at the most recent window
+    uint32_t start = (g_history_head + MAX_PERFORMANCE_SAMPLES - n) % MAX_PERFORMANCE_SAMPLES;
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = g_history[(start + i) % MAX_PERFORMANCE_SAMPLES];
+    }
+    return n;
+}
+
+// ===================== Target Evaluation =====================
+
+void perf_evaluate(PerfVerdict_t* verdict) {
+    memset(verdict, 0, sizeof(*verdict));
+
+    uint64_t bytes_total = 0;
+    uint32_t active_samples = 0;
+
+    for (uint32_t i = 0; i < g_history_count; i++) {
+        const PerfSample_t* s = &g_history[i];
+        verdict->samples_evaluated++;
+
+        // Throughput is only meaningful while the stream is running
+        if (s->frames_per_sec > 0) {
+            bytes_total += s->bytes_per_sec;
+            active_samples++;
+        }
+        if (s->cpu_permille != PERF_CPU_UNAVAILABLE && s->cpu_permille > verdict->peak_cpu_permille) {
+            verdict->peak_cpu_permille = s->cpu_permille;
+        }
+        if (s->send_max_us > verdict->worst_send_latency_us) {
+            verdict->worst_send_latency_us = s->send_max_us;
+        }
+    }
+
+    if (active_samples > 0) {
+        verdict->avg_throughput_kb_s = (uint32_t)(bytes_total / active_samples / 1024ULL);
+    }
+
+    verdict->throughput_ok = active_samples > 0 &&
+                             verdict->avg_throughput_kb_s >= TARGET_THROUGHPUT_KB_S;
+    verdict->cpu_ok = verdict->peak_cpu_permille <= TARGET_CPU_USAGE_PERCENT * 10;
+    verdict->latency_ok = verdict->worst_send_latency_us <= TARGET_LATENCY_MS * 1000U;
+}
+
+// ===================== Reporting =====================
+
+void perf_report_console(void) {
+    const PerfSample_t* s = perf_latest();
+    if (!s) {
+        PLATFORM_PRINTF("[PERF] No samples yet\n");
+        return;
+    }
+
+    PLATFORM_PRINTF("[PERF] %u fps, %u.%02u KB/s, gen %u ns/sample, send avg/max %u/%u us, "
+                    "pacing avg/max %d/%u us, cpu ",
+                    s->frames_per_sec, s->bytes_per_sec / 1024, (s->bytes_per_sec % 1024) * 100 / 1024,
+                    s->gen_ns_per_sample, s->send_avg_us, s->send_max_us,
+                    (int)s->pacing_avg_us, s->pacing_max_us);
+    if (s->cpu_permille == PERF_CPU_UNAVAILABLE) {
+        PLATFORM_PRINTF("n/a");
+    } else {
+        PLATFORM_PRINTF("%u.%u%%", s->cpu_permille / 10, s->cpu_permille % 10);
+    }
+    if (s->send_failures > 0) {
+        PLATFORM_PRINTF(", %u send failures", s->send_failures);
+    }
+    PLATFORM_PRINTF("\n");
+}
+
+void perf_report_log_message(void) {
+    const PerfSample_t* s = perf_latest();
+    if (!s) {
+        return;
+    }
+
+    char message[200];
+    snprintf(message, sizeof(message),
+             "perf fps=%u Bps=%u gen_ns=%u send_us=%u/%u pace_us=%d/%u cpu_pm=%u fail=%u",
+             s->frames_per_sec, s->bytes_per_sec, s->gen_ns_per_sample,
+             s->send_avg_us, s->send_max_us, (int)s->pacing_avg_us, s->pacing_max_us,
+             s->cpu_permille, s->send_failures);
+    device_send_log_message(0, message); // DEBUG level
+}
+
+#ifdef SIMULATION_MODE
+bool perf_dump_json(const char* filename) {
+    if (!filename) return false;
+
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        PLATFORM_PRINTF("Cannot open performance dump '%s'\n", filename);
+        return false;
+    }
+
+    PerfVerdict_t verdict;
+    perf_evaluate(&verdict);
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"build\": \"%s\",\n", BUILD_CONFIG_STRING);
+    fprintf(file, "  \"sample_interval_ms\": %u,\n", (unsigned)PERFORMANCE_SAMPLE_INTERVAL);
+    fprintf(file, "  \"targets\": {\"throughput_kb_s\": %u, \"cpu_percent\": %u, \"latency_ms\": %u},\n",
+            (unsigned)TARGET_THROUGHPUT_KB_S, (unsigned)TARGET_CPU_USAGE_PERCENT, (unsigned)TARGET_LATENCY_MS);
+    fprintf(file, "  \"verdict\": {\"samples\": %u, \"avg_throughput_kb_s\": %u, \"peak_cpu_permille\": %u, "
+                  "\"worst_send_latency_us\": %u, \"throughput_ok\": %s, \"cpu_ok\": %s, \"latency_ok\": %s},\n",
+            verdict.samples_evaluated, verdict.avg_throughput_kb_s, verdict.peak_cpu_permille,
+            verdict.worst_send_latency_us,
+            verdict.throughput_ok ? "true" : "false",
+            verdict.cpu_ok ? "true" : "false",
+            verdict.latency_ok ? "true" : "false");
+    fprintf(file, "  \"history\": [\n");
+
+    uint32_t start = (g_history_head + MAX_PERFORMANCE_SAMPLES - g_history_count) % MAX_PERFORMANCE_SAMPLES;
+    for (uint32_t i = 0; i < g_history_count; i++) {
+        const PerfSample_t* s = &g_history[(start + i) % MAX_PERFORMANCE_SAMPLES];
+        fprintf(file, "    {\"t_ms\": %u, \"window_ms\": %u, \"fps\": %u, \"bytes_per_sec\": %u, "
+                      "\"send_failures\": %u, \"gen_ns_per_sample\": %u, \"send_avg_us\": %u, "
+                      "\"send_max_us\": %u, \"pacing_avg_us\": %d, \"pacing_max_us\": %u, ",
+                s->timestamp_ms, s->window_ms, s->frames_per_sec, s->bytes_per_sec,
+                s->send_failures, s->gen_ns_per_sample, s->send_avg_us,
+                s->send_max_us, (int)s->pacing_avg_us, s->pacing_max_us);
+        if (s->cpu_permille == PERF_CPU_UNAVAILABLE) {
+            fprintf(file, "\"cpu_permille\": null}");
+        } else {
+            fprintf(file, "\"cpu_permille\": %u}", s->cpu_permille);
+        }
+        fprintf(file, "%s\n", (i + 1 < g_history_count) ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+
+    PLATFORM_PRINTF("Performance dump written to %s (%u samples): throughput %s, cpu %s, latency %s\n",
+                    filename, g_history_count,
+                    verdict.throughput_ok ? "PASS" : "FAIL",
+                    verdict.cpu_ok ? "PASS" : "FAIL",
+                    verdict.latency_ok ? "PASS" : "FAIL");
+    return true;
+}
+#else
+bool perf_dump_json(const char* filename) {
+    // MCU has no file system; use perf_report_log_message() instead
+    return false;
+}
+#endif
+
+#endif // ENABLE_PERFORMANCE_COUNTERS
@@ -0,0 +1,93 @@
+// File: perf_counters.h
+// Description: Performance counter subsystem (throughput, latency, pacing, CPU)
+// Version: v2.1
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+
+// ===================== Data Structures =====================
+
+// One closed measurement window (PERFORMANCE_SAMPLE_INTERVAL ms)
+typedef struct {
+    uint32_t timestamp_ms;          // Device tick at the end of the window
+    uint32_t window_ms;             // Actual window length
+    uint32_t frames_per_sec;        // Frames handed to the link
+    uint32_t bytes_per_sec;         // Frame bytes handed to the link
+    uint32_t send_failures;         // platform_send_data() failures in window
+    uint32_t gen_ns_per_sample;     // Average generation cost per sample
+    uint32_t send_avg_us;           // Average platform_send_data() call latency
+    uint32_t send_max_us;           // Worst platform_send_data() call latency
+    int32_t  pacing_avg_us;         // Average deviation from DATA_SEND_INTERVAL_MS
+    uint32_t pacing_max_us;         // Worst absolute deviation
+    uint16_t cpu_permille;          // CPU time / wall time (0xFFFF = unavailable)
+} PerfSample_t;
+
+// Pass/fail evaluation against the config.h targets
+typedef struct {
+    uint32_t samples_evaluated;
+    uint32_t avg_throughput_kb_s;
+    uint32_t peak_cpu_permille;
+    uint32_t worst_send_latency_us;
+    bool throughput_ok;             // >= TARGET_THROUGHPUT_KB_S
+    bool cpu_ok;                    // <= TARGET_CPU_USAGE_PERCENT
+    bool latency_ok;                // <= TARGET_LATENCY_MS
+} PerfVerdict_t;
+
+// Where closed windows are reported (bit mask)
+#define PERF_REPORT_NONE            0x00
+#define PERF_REPORT_CONSOLE         0x01
+#define PERF_REPORT_LOG_MESSAGE     0x02
+
+#define PERF_CPU_UNAVAILABLE        0xFFFF
+
+#if ENABLE_PERFORMANCE_COUNTERS
+
+// ===================== Function Declarations =====================
+
+// Lifecycle
+void perf_init(void);
+void perf_set_report_mask(uint8_t mask);
+
+// High resolution monotonic clock
+uint64_t perf_now_ns(void);
+
+// Event recording (hot path, no I/O)
+void perf_record_send(uint32_t bytes, uint64_t elapsed_ns, bool success);
+void perf_record_generation(uint32_t samples, uint64_t elapsed_ns);
+void perf_record_pacing(uint64_t actual_interval_ns);
+void perf_record_idle(uint64_t elapsed_ns);
+
+// Called once per loop iteration; closes a window every PERFORMANCE_SAMPLE_INTERVAL ms
+void perf_tick(void);
+
+// History access and reporting
+uint32_t perf_get_history(PerfSample_t* out, uint32_t max_samples);
+void perf_evaluate(PerfVerdict_t* verdict);
+void perf_report_console(void);
+void perf_report_log_message(void);
+bool perf_dump_json(const char* filename);
+
+#else
+
+#define perf_init()                         ((void)0)
+#define perf_set_report_mask(mask)          ((void)(mask))
+#define perf_now_ns()                       ((uint64_t)0)
+#define perf_record_send(b, ns, ok)         ((void)(b), (void)(ns), (void)(ok))
+#define perf_record_generation(s, ns)       ((void)(s), (void)(ns))
+#define perf_record_pacing(ns)              ((void)(ns))
+#define perf_record_idle(ns)                ((void)(ns))
+#define perf_tick()                         ((void)0)
+#define perf_get_history(out, max)          ((uint32_t)0)
+#define perf_evaluate(v)                    ((void)0)
+#define perf_report_console()               ((void)0)
+#define perf_report_log_message()           ((void)0)
+#define perf_dump_json(f)                   ((void)(f), false)
+
+#endif // ENABLE_PERFORMANCE_COUNTERS
+
+#endif // PERF_COUNTERS_H
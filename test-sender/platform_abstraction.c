@@ -11,9 +11,43 @@
     #endif
 #endif
 
+// ===================== Send Queue State =====================
+
+typedef struct {
+    uint16_t slot;              // Index into g_send_storage
+    uint16_t length;
+    uint16_t sent;              // Bytes already handed to the link
+    bool     droppable;         // Whole DATA_PACKET frame
+} SendQueueEntry_t;
+
+typedef struct {
+    SendQueueEntry_t entries[SEND_QUEUE_SLOTS];     // FIFO, entries[0] is the head
+    uint16_t count;
+    uint16_t free_slots[SEND_QUEUE_SLOTS];
+    uint16_t free_count;
+    uint32_t bytes;
+    SendQueuePolicy policy;
+    SendQueueStats_t stats;
+} SendQueue_t;
+
+static uint8_t g_send_storage[SEND_QUEUE_SLOTS][SEND_QUEUE_SLOT_SIZE];
+static SendQueue_t g_send_queue = { .policy = SEND_QUEUE_DEFAULT_POLICY };
+
+static void send_queue_reset(void) {
+    SendQueuePolicy policy = g_send_queue.policy;
+    memset(&g_send_queue, 0, sizeof(g_send_queue));
+    g_send_queue.policy = policy;
+    for (uint16_t i = 0; i < SEND_QUEUE_SLOTS; i++) {
+        g_send_queue.free_slots[i] = (uint16_t)(SEND_QUEUE_SLOTS - 1 - i);
+    }
+    g_send_queue.free_count = SEND_QUEUE_SLOTS;
+}
+
 // ===================== Platform Initialization =====================
 
 bool platform_init(void) {
+    send_queue_reset();
+
 #ifdef SIMULATION_MODE
     // Initialize Winsock
     WSADATA wsaData;
@@ -110,6 +144,7 @@ connection_handle_t platform_create_connection(void) {
     u_long mode = 1;
     ioctlsocket(clientSocket, FIONBIO, &mode);
 
+    send_queue_reset();
     PLATFORM_PRINTF("Client connected\n");
     return clientSocket;
 #else
@@ -124,20 +159,193 @@ connection_handle_t platform_create_connection(void) {
         vTaskDelay(pdMS_TO_TICKS(100));
     }
     
+    send_queue_reset();
     PLATFORM_PRINTF("USB CDC connected\n");
     return handle;
 #endif
 }
 
-bool platform_send_data(connection_handle_t conn, const uint8_t* data, uint32_t length) {
+// Single write attempt: bytes accepted, 0 if the link is full, -1 on error
+static int platform_write_some(connection_handle_t conn, const uint8_t* data, uint32_t length) {
 #ifdef SIMULATION_MODE
-    int bytesSent = send(conn, (const char*)data, length, 0);
-    return (bytesSent == (int)length);
+    int bytesSent = send(conn, (const char*)data, (int)length, 0);
+    if (bytesSent == SOCKET_ERROR) {
+        return (WSAGetLastError() == WSAEWOULDBLOCK) ? 0 : -1;
+    }
+    return bytesSent;
 #else
-    return (usb_cdc_send(conn, data, length) == USB_OK);
+    usb_status_t status = usb_cdc_send(conn, data, length);
+    if (status == USB_OK) {
+        return (int)length;
+    }
+    return (status == USB_BUSY || status == USB_NOT_READY) ? 0 : -1;
 #endif
 }
 
+static void platform_wait_writable(connection_handle_t conn, uint32_t timeout_ms) {
+#ifdef SIMULATION_MODE
+    fd_set writeSet;
+    FD_ZERO(&writeSet);
+    FD_SET(conn, &writeSet);
+    struct timeval tv = { (long)(timeout_ms / 1000), (long)(timeout_ms % 1000) * 1000 };
+    select(0, NULL, &writeSet, NULL, &tv);
+#else
+    (void)conn;
+    (void)timeout_ms;
+    vTaskDelay(pdMS_TO_TICKS(1));
+#endif
+}
+
+static void send_queue_remove(uint16_t index) {
+    SendQueue_t* q = &g_send_queue;
+    SendQueueEntry_t* e = &q->entries[index];
+
+    q->bytes -= (uint32_t)(e->length - e->sent);
+    q->free_slots[q->free_count++] = e->slot;
+    memmove(&q->entries[index], &q->entries[index + 1],
+            (size_t)(q->count - index - 1) * sizeof(SendQueueEntry_t));
+    q->count--;
+}
+
+// Evict the oldest whole DATA_PACKET frame that has not started transmitting
+static bool send_queue_drop_oldest(void) {
+    for (uint16_t i = 0; i < g_send_queue.count; i++) {
+        const SendQueueEntry_t* e = &g_send_queue.entries[i];
+        if (e->droppable && e->sent == 0) {
+            send_queue_remove(i);
+            g_send_queue.stats.dropped_oldest++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Make room for one more frame according to the policy. Frames that already
+// went out partially, and control frames, are never dropped - for those we wait.
+static bool send_queue_make_room(connection_handle_t conn, bool droppable, bool started) {
+    SendQueue_t* q = &g_send_queue;
+    if (q->free_count > 0) {
+        return true;
+    }
+
+    if (q->policy == SEND_POLICY_DROP_OLDEST && send_queue_drop_oldest()) {
+        return true;
+    }
+    if (q->policy == SEND_POLICY_DROP_NEWEST && droppable && !started) {
+        return false;
+    }
+
+    uint32_t start = PLATFORM_TICK();
+    q->stats.block_waits++;
+    while (q->free_count == 0) {
+        uint32_t elapsed = PLATFORM_TICK() - start;
+        if (elapsed >= SEND_QUEUE_BLOCK_TIMEOUT_MS) {
+            q->stats.block_timeouts++;
+            return false;
+        }
+        platform_wait_writable(conn, SEND_QUEUE_BLOCK_TIMEOUT_MS - elapsed);
+        if (!platform_flush_send_queue(conn)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void send_queue_push(const uint8_t* data, uint32_t length, uint32_t already_sent, bool droppable) {
+    SendQueue_t* q = &g_send_queue;
+    SendQueueEntry_t* e = &q->entries[q->count++];
+
+    e->slot = q->free_slots[--q->free_count];
+    e->length = (uint16_t)length;
+    e->sent = (uint16_t)already_sent;
+    e->droppable = droppable;
+    memcpy(g_send_storage[e->slot], data, length);
+
+    q->bytes += length - already_sent;
+    if (q->count > q->stats.high_water_frames) {
+        q->stats.high_water_frames = q->count;
+    }
+    if (q->bytes > q->stats.high_water_bytes) {
+        q->stats.high_water_bytes = q->bytes;
+    }
+}
+
+// Push queued bytes to the link until it would block. Returns false on a link error.
+bool platform_flush_send_queue(connection_handle_t conn) {
+    SendQueue_t* q = &g_send_queue;
+
+    while (q->count > 0) {
+        SendQueueEntry_t* head = &q->entries[0];
+        uint32_t remaining = (uint32_t)(head->length - head->sent);
+        int written = platform_write_some(conn, g_send_storage[head->slot] + head->sent, remaining);
+        if (written < 0) {
+            return false;
+        }
+        if (written == 0) {
+            q->stats.would_block++;
+            return true;
+        }
+
+        head->sent = (uint16_t)(head->sent + written);
+        q->bytes -= (uint32_t)written;
+        if ((uint32_t)written < remaining) {
+            q->stats.partial_writes++;
+            return true;
+        }
+        send_queue_remove(0);
+    }
+    return true;
+}
+
+// Returns true once the whole write is sent or queued; false if it was
+// dropped by the overload policy or the link failed. Only the caller knows
+// whether the write is a whole DATA_PACKET frame (droppable) or a fragment
+// whose siblings would be left orphaned on the wire if it were evicted.
+bool platform_send_data(connection_handle_t conn, const uint8_t* data, uint32_t length, bool droppable) {
+    if (length == 0) {
+        return true;
+    }
+    if (length > SEND_QUEUE_SLOT_SIZE) {
+        PLATFORM_PRINTF("Frame too large for send queue: %u bytes\n", (unsigned)length);
+        return false;
+    }
+
+    // Older bytes go first, otherwise frames would interleave on the wire
+    if (!platform_flush_send_queue(conn)) {
+        return false;
+    }
+
+    uint32_t sent = 0;
+    if (g_send_queue.count == 0) {
+        int written = platform_write_some(conn, data, length);
+        if (written < 0) {
+            return false;
+        }
+        if ((uint32_t)written == length) {
+            return true;
+        }
+        sent = (uint32_t)written;
+        if (written > 0) {
+            g_send_queue.stats.partial_writes++;
+        } else {
+            g_send_queue.stats.would_block++;
+        }
+    }
+
+    if (!send_queue_make_room(conn, droppable, sent > 0)) {
+        if (sent > 0) {
+            // The receiver now holds half a frame; it will resync on the next header
+            PLATFORM_PRINTF("Send queue: link stalled mid-frame, %u bytes lost\n",
+                            (unsigned)(length - sent));
+        }
+        g_send_queue.stats.dropped_newest++;
+        return false;
+    }
+
+    send_queue_push(data, length, sent, droppable);
+    return true;
+}
+
 int platform_receive_data(connection_handle_t conn, uint8_t* buffer, uint32_t bufferSize) {
 #ifdef SIMULATION_MODE
     int bytesReceived = recv(conn, (char*)buffer, bufferSize, 0);
@@ -165,6 +373,11 @@ int platform_receive_data(connection_handle_t conn, uint8_t* buffer, uint32_t bu
 }
 
 void platform_close_connection(connection_handle_t conn) {
+    if (g_send_queue.count > 0) {
+        PLATFORM_PRINTF("Discarding %u queued frames (%u bytes)\n",
+                        (unsigned)g_send_queue.count, (unsigned)g_send_queue.bytes);
+    }
+    send_queue_reset();
 #ifdef SIMULATION_MODE
     closesocket(conn);
     PLATFORM_PRINTF("Connection closed\n");
@@ -174,12 +387,56 @@ void platform_close_connection(connection_handle_t conn) {
 #endif
 }
 
+// ===================== Send Queue Control =====================
+
+void platform_set_send_policy(SendQueuePolicy policy) {
+    g_send_queue.policy = policy;
+}
+
+const char* platform_send_policy_name(SendQueuePolicy policy) {
+    switch (policy) {
+        case SEND_POLICY_BLOCK:       return "block";
+        case SEND_POLICY_DROP_NEWEST: return "drop-newest";
+        case SEND_POLICY_DROP_OLDEST: return "drop-oldest";
+        default:                      return "unknown";
+    }
+}
+
+uint32_t platform_send_queue_depth(uint32_t* bytes) {
+    if (bytes) {
+        *bytes = g_send_queue.bytes;
+    }
+    return g_send_queue.count;
+}
+
+void platform_get_send_queue_stats(SendQueueStats_t* stats) {
+    *stats = g_send_queue.stats;
+    stats->queued_frames = g_send_queue.count;
+    stats->queued_bytes = g_send_queue.bytes;
+}
+
+void platform_print_send_queue_stats(void) {
+    SendQueueStats_t s;
+    platform_get_send_queue_stats(&s);
+    PLATFORM_PRINTF("=== Send Queue (%s, %u slots) ===\n",
+                    platform_send_policy_name(g_send_queue.policy), (unsigned)SEND_QUEUE_SLOTS);
+    PLATFORM_PRINTF("Depth:          %u frames / %u bytes (high water %u / %u)\n",
+                    (unsigned)s.queued_frames, (unsigned)s.queued_bytes,
+                    (unsigned)s.high_water_frames, (unsigned)s.high_water_bytes);
+    PLATFORM_PRINTF("Partial writes: %u, would block: %u\n",
+                    (unsigned)s.partial_writes, (unsigned)s.would_block);
+    PLATFORM_PRINTF("Dropped:        %u newest, %u oldest\n",
+                    (unsigned)s.dropped_newest, (unsigned)s.dropped_oldest);
+    PLATFORM_PRINTF("Blocking waits: %u (%u timed out)\n",
+                    (unsigned)s.block_waits, (unsigned)s.block_timeouts);
+}
+
 // ===================== Data Source Abstraction =====================
 
 bool data_source_init(void) {
 #ifdef SIMULATION_MODE
     // Initialize CSV data or built-in generators
-    g_device_state.csv_data = NULL;
+    memset(g_device_state.csv_data, 0, sizeof(g_device_state.csv_data));
     g_device_state.csv_rows = 0;
     g_device_state.current_csv_row = 0;
     
@@ -194,7 +451,7 @@ bool data_source_init(void) {
         return false;
     }
     
-    for (int i = 0; i < g_device_state.num_channels; i++) {
+    for (int i = 0; i < g_device_state.channels.count; i++) {
         g_device_state.sensor_handles[i] = sensor_init(i);
         if (g_device_state.sensor_handles[i] == NULL) {
             PLATFORM_PRINTF("Failed to initialize sensor %d\n", i);
@@ -210,18 +467,14 @@ bool data_source_init(void) {
 
 void data_source_cleanup(void) {
 #ifdef SIMULATION_MODE
-    if (g_device_state.csv_data) {
-        for (int i = 0; i < g_device_state.csv_rows; i++) {
-            if (g_device_state.csv_data[i]) {
-                PLATFORM_FREE(g_device_state.csv_data[i]);
-            }
-        }
-        PLATFORM_FREE(g_device_state.csv_data);
-        g_device_state.csv_data = NULL;
+    for (int c = 0; c < POOL_CSV_COLUMNS; c++) {
+        mem_pool_free(g_device_state.csv_data[c]);
+        g_device_state.csv_data[c] = NULL;
     }
+    g_device_state.csv_rows = 0;
     PLATFORM_PRINTF("Simulation data source cleaned up\n");
 #else
-    for (int i = 0; i < g_device_state.num_channels; i++) {
+    for (int i = 0; i < g_device_state.channels.count; i++) {
         if (g_device_state.sensor_handles[i]) {
             sensor_deinit(g_device_state.sensor_handles[i]);
             g_device_state.sensor_handles[i] = NULL;
@@ -234,22 +487,12 @@ void data_source_cleanup(void) {
 
 int16_t data_source_get_sample(uint8_t channel, uint32_t sample_index) {
 #ifdef SIMULATION_MODE
-    // Use CSV data if available
-    if (g_device_state.csv_data && g_device_state.csv_rows > 0 && channel < 2) {
-        int csv_index = (g_device_state.current_csv_row + sample_index) % g_device_state.csv_rows;
-        return (int16_t)(g_device_state.csv_data[csv_index][channel] * 100);
-    }
-    
-    // Generate simulated data
-    float t = (g_device_state.timestamp_ms + sample_index * DATA_SEND_INTERVAL_MS / 100.0f) / 1000.0f;
-    float freq = (channel == 0) ? 50.0f : 60.0f;
-    float amplitude = (channel == 0) ? 1000.0f : 800.0f;
-    float noise = ((rand() % 100) - 50) * 0.1f;
-    
-    return (int16_t)(amplitude * sinf(2.0f * 3.14159f * freq * t) + noise);
+    int16_t sample = 0;
+    data_source_fill(channel, sample_index, 1, &sample);
+    return sample;
 #else
     // Read real sensor data
-    if (channel >= g_device_state.num_channels) {
+    if (channel >= g_device_state.channels.count) {
         return 0;
     }
     
@@ -263,6 +506,30 @@ int16_t data_source_get_sample(uint8_t channel, uint32_t sample_index) {
 #endif
 }
 
+// Fill one channel's block of a DATA_PACKET. CSV columns feed the channels
+// they exist for (voltage, current); every other channel uses its generator.
+void data_source_fill(uint8_t channel, uint32_t first_index, uint16_t count, int16_t* out) {
+#ifdef SIMULATION_MODE
+    if (g_device_state.csv_rows > 0 && channel < POOL_CSV_COLUMNS) {
+        const float* column = g_device_state.csv_data[channel];
+        uint32_t row = (g_device_state.current_csv_row + first_index) % g_device_state.csv_rows;
+        for (uint16_t s = 0; s < count; s++) {
+            out[s] = (int16_t)(column[row] * 100);
+            if (++row >= (uint32_t)g_device_state.csv_rows) {
+                row = 0;
+            }
+        }
+        return;
+    }
+
+    chan_generate(&g_device_state.channels, channel, first_index, count, out);
+#else
+    for (uint16_t s = 0; s < count; s++) {
+        out[s] = data_source_get_sample(channel, first_index + s);
+    }
+#endif
+}
+
 // ===================== CSV Data Loading (Simulation Only) =====================
 
 #ifdef SIMULATION_MODE
@@ -297,10 +564,15 @@ bool device_load_test_data(const char* filename) {
         return false;
     }
 
-    // Allocate memory
-    g_device_state.csv_data = (float**)PLATFORM_MALLOC(row_count * sizeof(float*));
-    for (int i = 0; i < row_count; i++) {
-        g_device_state.csv_data[i] = (float*)PLATFORM_MALLOC(2 * sizeof(float));
+    // One pool block per column (MAX_CSV_ROWS floats each)
+    for (int c = 0; c < POOL_CSV_COLUMNS; c++) {
+        if (!g_device_state.csv_data[c]) {
+            g_device_state.csv_data[c] = (float*)mem_pool_alloc(POOL_CLASS_CSV);
+        }
+        if (!g_device_state.csv_data[c]) {
+            PLATFORM_PRINTF("Failed to allocate CSV column %d\n", c);
+            return false;
+        }
     }
 
     // Parse data
@@ -318,8 +590,8 @@ bool device_load_test_data(const char* filename) {
             char* token2 = strtok(NULL, ",");
 
             if (token1 && token2) {
-                g_device_state.csv_data[current_row][0] = (float)atof(token1);
-                g_device_state.csv_data[current_row][1] = (float)atof(token2);
+                g_device_state.csv_data[0][current_row] = (float)atof(token1);
+                g_device_state.csv_data[1][current_row] = (float)atof(token2);
                 current_row++;
             }
         }
@@ -0,0 +1,525 @@
+// File: scenario.c
+// Description: Scenario file parser and phase runner for repeatable load tests
+// Version: v2.1
+
+#include "device_simulator.h"
+#include "scenario.h"
+#include "sim_clock.h"
+
+#include <ctype.h>
+
+#define SCN_ALL_CHANNELS    0xFFFF          // "channels = all" - every channel the device has
+
+// ===================== Internal State =====================
+
+static Scenario_t g_scenario;
+static bool       g_scenario_loaded = false;
+static bool       g_scenario_finished = false;
+static bool       g_phase_applied = false;
+static uint8_t    g_phase_index = 0;
+static uint32_t   g_pass = 0;                   // Completed passes through the phase list
+static uint32_t   g_phase_elapsed_ms = 0;       // Device time spent streaming in this phase
+static uint32_t   g_last_tick_ms = 0;
+static bool       g_was_connected = false;
+static bool       g_autostart_done = false;     // Autostart fires once per connection
+
+// ===================== Parsing Helpers =====================
+
+static char* scenario_trim(char* text) {
+    while (isspace((unsigned char)*text)) text++;
+    char* end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return text;
+}
+
+static void scenario_copy_name(char* dst, const char* src) {
+    strncpy(dst, src, SCENARIO_NAME_LEN - 1);
+    dst[SCENARIO_NAME_LEN - 1] = '\0';
+}
+
+// Integer with optional 'k' (x1000) suffix, e.g. "20k"
+static bool scenario_parse_uint(const char* text, uint32_t* out) {
+    char* end = NULL;
+    unsigned long value = strtoul(text, &end, 10);
+    if (end == text) return false;
+    if (*end == 'k' || *end == 'K') {
+        value *= 1000;
+        end++;
+    }
+    if (*end != '\0') return false;
+    *out = (uint32_t)value;
+    return true;
+}
+
+// Duration with optional unit: "500ms", "30", "30s", "10m", "2h" (default seconds)
+static bool scenario_parse_duration(const char* text, uint32_t* out_ms) {
+    char* end = NULL;
+    double value = strtod(text, &end);
+    if (end == text || value < 0.0) return false;
+
+    double scale = 1000.0;
+    if (strcmp(end, "ms") == 0) {
+        scale = 1.0;
+    } else if (strcmp(end, "m") == 0) {
+        scale = 60000.0;
+    } else if (strcmp(end, "h") == 0) {
+        scale = 3600000.0;
+    } else if (*end != '\0' && strcmp(end, "s") != 0) {
+        return false;
+    }
+    *out_ms = (uint32_t)(value * scale);
+    return true;
+}
+
+// "a-b" or a single value "a" (min == max)
+static bool scenario_parse_range(const char* text, uint16_t* min, uint16_t* max) {
+    char* end = NULL;
+    unsigned long lo = strtoul(text, &end, 10);
+    if (end == text) return false;
+    unsigned long hi = lo;
+    if (*end == '-') {
+        const char* second = end + 1;
+        hi = strtoul(second, &end, 10);
+        if (end == second) return false;
+    }
+    if (*end != '\0' || lo == 0 || hi < lo || hi > 0xFFFF) return false;
+    *min = (uint16_t)lo;
+    *max = (uint16_t)hi;
+    return true;
+}
+
+// "all" or a comma separated list of channel ids, e.g. "0,1"
+static bool scenario_parse_channels(char* text, uint16_t* mask) {
+    if (strcmp(text, "all") == 0) {
+        *mask = SCN_ALL_CHANNELS;
+        return true;
+    }
+
+    *mask = 0;
+    for (char* item = strtok(text, ","); item; item = strtok(NULL, ",")) {
+        item = scenario_trim(item);
+        char* end = NULL;
+        unsigned long id = strtoul(item, &end, 10);
+        if (end == item || *end != '\0' || id >= MAX_CHANNELS) return false;
+        *mask |= (uint16_t)(1u << id);
+    }
+    return *mask != 0;
+}
+
+// Comma separated "channel:rate" pairs, e.g. "0:10k,1:10k,2:1"
+static bool scenario_parse_channel_rates(char* text, uint32_t* rates) {
+    bool any = false;
+    for (char* item = strtok(text, ","); item; item = strtok(NULL, ",")) {
+        item = scenario_trim(item);
+        char* end = NULL;
+        unsigned long id = strtoul(item, &end, 10);
+        if (end == item || *end != ':' || id >= MAX_CHANNELS) return false;
+
+        uint32_t rate = 0;
+        if (!scenario_parse_uint(scenario_trim(end + 1), &rate) ||
+            rate < MIN_SAMPLE_RATE_HZ || rate > MAX_SAMPLE_RATE_HZ) return false;
+        rates[id] = rate;
+        any = true;
+    }
+    return any;
+}
+
+static bool scenario_parse_format(const char* text, uint8_t* format) {
+    if (strcmp(text, "int16") == 0) {
+        *format = FORMAT_INT16;
+    } else if (strcmp(text, "int32") == 0) {
+        *format = FORMAT_INT32;
+    } else if (strcmp(text, "float32") == 0) {
+        *format = FORMAT_FLOAT32;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool scenario_parse_global(const char* key, char* value) {
+    if (strcmp(key, "name") == 0) {
+        scenario_copy_name(g_scenario.name, value);
+    } else if (strcmp(key, "repeat") == 0) {
+        return scenario_parse_uint(value, &g_scenario.repeat);
+    } else if (strcmp(key, "autostart") == 0) {
+        if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+            g_scenario.autostart = true;
+        } else if (strcmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+            g_scenario.autostart = false;
+        } else {
+            return false;
+        }
+    } else if (strcmp(key, "on_end") == 0) {
+        if (strcmp(value, "stop") == 0) {
+            g_scenario.on_end = SCENARIO_END_STOP;
+        } else if (strcmp(value, "hold") == 0) {
+            g_scenario.on_end = SCENARIO_END_HOLD;
+        } else if (strcmp(value, "exit") == 0) {
+            g_scenario.on_end = SCENARIO_END_EXIT;
+        } else {
+            return false;
+        }
+    } else if (strcmp(key, "device_channels") == 0) {
+        uint32_t count = 0;
+        if (!scenario_parse_uint(value, &count) || count == 0 || count > MAX_CHANNELS) return false;
+        g_scenario.device_channels = (uint8_t)count;
+    } else if (strcmp(key, "multirate") == 0) {
+        if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+            g_scenario.multirate = true;
+        } else if (strcmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+            g_scenario.multirate = false;
+        } else {
+            return false;
+        }
+    } else if (strcmp(key, "csv") == 0) {
+        strncpy(g_scenario.csv_file, value, sizeof(g_scenario.csv_file) - 1);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool scenario_parse_phase_key(ScenarioPhase_t* phase, const char* key, char* value) {
+    uint32_t number = 0;
+
+    if (strcmp(key, "duration") == 0) {
+        return scenario_parse_duration(value, &phase->duration_ms);
+    } else if (strcmp(key, "mode") == 0) {
+        if (strcmp(value, "continuous") == 0) {
+            phase->mode = MODE_CONTINUOUS;
+        } else if (strcmp(value, "trigger") == 0) {
+            phase->mode = MODE_TRIGGER;
+        } else {
+            return false;
+        }
+        phase->set_mask |= SCN_SET_MODE;
+    } else if (strcmp(key, "channels") == 0) {
+        if (!scenario_parse_channels(value, &phase->channel_mask)) return false;
+        phase->set_mask |= SCN_SET_CHANNELS;
+    } else if (strcmp(key, "rate") == 0) {
+        if (!scenario_parse_uint(value, &number) ||
+            number < MIN_SAMPLE_RATE_HZ || number > MAX_SAMPLE_RATE_HZ) return false;
+        phase->sample_rate_hz = number;
+        phase->set_mask |= SCN_SET_RATE;
+    } else if (strcmp(key, "channel_rates") == 0) {
+        if (!scenario_parse_channel_rates(value, phase->channel_rate_hz)) return false;
+        phase->set_mask |= SCN_SET_CHANNEL_RATES;
+    } else if (strcmp(key, "format") == 0) {
+        if (!scenario_parse_format(value, &phase->format)) return false;
+        phase->set_mask |= SCN_SET_FORMAT;
+    } else if (strcmp(key, "packet_samples") == 0) {
+        if (strcmp(value, "auto") == 0) {
+            number = 0;
+        } else if (!scenario_parse_uint(value, &number) || number == 0 || number > 0xFFFF) {
+            return false;
+        }
+        phase->packet_samples = (uint16_t)number;
+        phase->set_mask |= SCN_SET_PACKET_SAMPLES;
+    } else if (strcmp(key, "trigger_interval") == 0) {
+        if (!scenario_parse_range(value, &phase->trigger_interval_min_s,
+                                  &phase->trigger_interval_max_s)) return false;
+        phase->set_mask |= SCN_SET_TRIGGER_INTERVAL;
+    } else if (strcmp(key, "burst_packets") == 0) {
+        if (!scenario_parse_range(value, &phase->burst_min, &phase->burst_max)) return false;
+        phase->set_mask |= SCN_SET_BURST_PACKETS;
+    } else if (strcmp(key, "burst_samples") == 0) {
+        if (!scenario_parse_uint(value, &number) || number == 0 || number > 0xFFFF) return false;
+        phase->burst_samples = (uint16_t)number;
+        phase->set_mask |= SCN_SET_BURST_SAMPLES;
+    } else if (strcmp(key, "impair") == 0) {
+        // Each phase describes its whole impairment; "off" clears it
+        impair_config_defaults(&phase->impair);
+        if (strcmp(value, "off") != 0 && !impair_parse_spec(value, &phase->impair)) return false;
+        phase->set_mask |= SCN_SET_IMPAIR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ===================== Loading =====================
+
+bool scenario_load(const char* filename) {
+    if (!filename) return false;
+
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        PLATFORM_PRINTF("Cannot open scenario file '%s'\n", filename);
+        return false;
+    }
+
+    memset(&g_scenario, 0, sizeof(g_scenario));
+    g_scenario.repeat = 1;
+    g_scenario.on_end = SCENARIO_END_STOP;
+    scenario_copy_name(g_scenario.name, filename);
+
+    char line[SCENARIO_LINE_LEN];
+    int line_no = 0;
+    bool ok = true;
+    ScenarioPhase_t* phase = NULL;
+
+    while (ok && fgets(line, sizeof(line), file)) {
+        line_no++;
+        char* text = scenario_trim(line);
+        if (text[0] == '\0' || text[0] == '#' || text[0] == ';') {
+            continue;
+        }
+
+        if (text[0] == '[') {
+            // [phase <name>]
+            char* close = strchr(text, ']');
+            if (!close || strncmp(text + 1, "phase", 5) != 0) {
+                PLATFORM_PRINTF("%s:%d: expected '[phase <name>]'\n", filename, line_no);
+                ok = false;
+                break;
+            }
+            if (g_scenario.phase_count >= SCENARIO_MAX_PHASES) {
+                PLATFORM_PRINTF("%s:%d: more than %d phases\n", filename, line_no, SCENARIO_MAX_PHASES);
+                ok = false;
+                break;
+            }
+            *close = '\0';
+            phase = &g_scenario.phases[g_scenario.phase_count++];
+            char* name = scenario_trim(text + 6);
+            if (name[0] != '\0') {
+                scenario_copy_name(phase->name, name);
+            } else {
+                snprintf(phase->name, sizeof(phase->name), "phase%u", (unsigned)g_scenario.phase_count);
+            }
+            continue;
+        }
+
+        char* eq = strchr(text, '=');
+        if (!eq) {
+            PLATFORM_PRINTF("%s:%d: expected 'key = value'\n", filename, line_no);
+            ok = false;
+            break;
+        }
+        *eq = '\0';
+        char* key = scenario_trim(text);
+        char* value = scenario_trim(eq + 1);
+
+        bool parsed = phase ? scenario_parse_phase_key(phase, key, value)
+                            : scenario_parse_global(key, value);
+        if (!parsed) {
+            PLATFORM_PRINTF("%s:%d: invalid %s setting '%s'\n", filename, line_no,
+                            phase ? "phase" : "scenario", key);
+            ok = false;
+        }
+    }
+    fclose(file);
+
+    if (ok && g_scenario.phase_count == 0) {
+        PLATFORM_PRINTF("%s: no phases defined\n", filename);
+        ok = false;
+    }
+    for (uint8_t i = 0; ok && i < g_scenario.phase_count; i++) {
+        if (g_scenario.phases[i].duration_ms == 0) {
+            PLATFORM_PRINTF("%s: phase '%s' has no duration\n", filename, g_scenario.phases[i].name);
+            ok = false;
+        }
+    }
+    if (!ok) {
+        return false;
+    }
+
+    if (g_scenario.csv_file[0] != '\0') {
+        device_set_test_data_file(g_scenario.csv_file);
+    }
+    if (g_scenario.device_channels != 0) {
+        device_set_channel_count(g_scenario.device_channels);
+    }
+    if (g_scenario.multirate) {
+        device_set_multirate_packing(true);
+    }
+
+    g_scenario_loaded = true;
+    g_scenario_finished = false;
+    g_phase_applied = false;
+    g_phase_index = 0;
+    g_pass = 0;
+    g_phase_elapsed_ms = 0;
+
+    uint64_t total_ms = 0;
+    for (uint8_t i = 0; i < g_scenario.phase_count; i++) {
+        total_ms += g_scenario.phases[i].duration_ms;
+    }
+    char passes[32];
+    if (g_scenario.repeat) {
+        snprintf(passes, sizeof(passes), "%u pass(es)", (unsigned)g_scenario.repeat);
+    } else {
+        snprintf(passes, sizeof(passes), "repeating forever");
+    }
+    PLATFORM_PRINTF("Scenario '%s': %u phases, %.1f s per pass, %s%s\n", g_scenario.name,
+                    (unsigned)g_scenario.phase_count, (double)total_ms / 1000.0, passes,
+                    g_scenario.autostart ? " (autostart)" : "");
+    return true;
+}
+
+bool scenario_active(void) {
+    return g_scenario_loaded && !g_scenario_finished;
+}
+
+const Scenario_t* scenario_get(void) {
+    return g_scenario_loaded ? &g_scenario : NULL;
+}
+
+// ===================== Phase Runner =====================
+
+static void scenario_apply_phase(const ScenarioPhase_t* phase) {
+    DeviceState_t* dev = &g_device_state;
+
+    ChannelModel_t* chm = &dev->channels;
+
+    if (phase->set_mask & SCN_SET_CHANNELS) {
+        for (uint8_t ch = 0; ch < chm->count; ch++) {
+            if (phase->channel_mask & (1u << ch)) {
+                chan_enable(chm, ch, chm->rate_hz[ch] ? chm->rate_hz[ch] : DEFAULT_SAMPLE_RATE_HZ, 0);
+            } else {
+                chan_disable(chm, ch);
+            }
+        }
+        if (phase->channel_mask != SCN_ALL_CHANNELS && (phase->channel_mask >> chm->count)) {
+            PLATFORM_PRINTF("Scenario: device has %u channels, ignoring higher channel ids\n",
+                            (unsigned)chm->count);
+        }
+    }
+
+    // Rate (or a channel_rates override) and format apply to every enabled
+    // channel the device accepts them for
+    for (uint8_t ch = 0; ch < chm->count; ch++) {
+        if (!chan_is_enabled(chm, ch)) continue;
+
+        uint32_t rate = (phase->set_mask & SCN_SET_RATE) ? phase->sample_rate_hz : chm->rate_hz[ch];
+        if ((phase->set_mask & SCN_SET_CHANNEL_RATES) && phase->channel_rate_hz[ch] != 0) {
+            rate = phase->channel_rate_hz[ch];
+        }
+        uint8_t format = (phase->set_mask & SCN_SET_FORMAT) ? phase->format : chm->format[ch];
+        if (device_validate_channel_config(ch, rate, format)) {
+            chan_enable(chm, ch, rate, format);
+        } else {
+            PLATFORM_PRINTF("Scenario: channel %u rejects rate=%u format=0x%02X\n",
+                            (unsigned)ch, (unsigned)rate, (unsigned)format);
+        }
+    }
+
+    if (phase->set_mask & SCN_SET_PACKET_SAMPLES) {
+        dev->packet_samples = phase->packet_samples;
+    }
+    if (phase->set_mask & SCN_SET_TRIGGER_INTERVAL) {
+        dev->trigger_interval_min_s = phase->trigger_interval_min_s;
+        dev->trigger_interval_max_s = phase->trigger_interval_max_s;
+    }
+    if (phase->set_mask & SCN_SET_BURST_PACKETS) {
+        dev->trigger_burst_min = phase->burst_min;
+        dev->trigger_burst_max = phase->burst_max;
+    }
+    if (phase->set_mask & SCN_SET_BURST_SAMPLES) {
+        dev->trigger_packet_samples = phase->burst_samples;
+    }
+
+    // Mode last, so the first trigger is scheduled with this phase's timing
+    if (phase->set_mask & SCN_SET_MODE) {
+        device_set_mode(phase->mode);
+    } else if (dev->mode == MODE_TRIGGER &&
+               (phase->set_mask & (SCN_SET_TRIGGER_INTERVAL | SCN_SET_BURST_PACKETS)) &&
+               !dev->trigger_data_active) {
+        device_schedule_next_trigger();
+    }
+
+    if (phase->set_mask & SCN_SET_IMPAIR) {
+        impair_configure(&phase->impair);
+    }
+
+    char message[128];
+    snprintf(message, sizeof(message), "Scenario phase %u/%u '%s' (%.1f s)",
+             (unsigned)(g_phase_index + 1), (unsigned)g_scenario.phase_count, phase->name,
+             (double)phase->duration_ms / 1000.0);
+    device_send_log_message(1, message);
+    PLATFORM_PRINTF("%s\n", message);
+}
+
+static void scenario_finish(void) {
+    g_scenario_finished = true;
+    device_send_log_message(1, "Scenario complete");
+    PLATFORM_PRINTF("Scenario '%s' complete after %u pass(es)\n", g_scenario.name, (unsigned)g_pass);
+
+    if (g_scenario.on_end != SCENARIO_END_HOLD) {
+        device_stop_stream();
+    }
+}
+
+bool scenario_tick(void) {
+    if (!g_scenario_loaded) {
+        return true;
+    }
+    if (g_scenario_finished) {
+        return g_scenario.on_end != SCENARIO_END_EXIT;
+    }
+
+    uint32_t now = sim_clock_now_ms();
+
+    if (g_device_state.connected && !g_was_connected) {
+        g_autostart_done = false;
+    }
+    g_was_connected = g_device_state.connected;
+
+    if (g_device_state.stream_status != STATUS_RUNNING) {
+        // After the first start a stopped stream was stopped by the host, so
+        // it stays stopped until the host sends START_STREAM again
+        if (!g_scenario.autostart || g_autostart_done || !g_device_state.connected) {
+            // Phase time only runs while streaming
+            g_last_tick_ms = now;
+            return true;
+        }
+        device_start_stream();
+        device_send_log_message(1, "Stream started by scenario");
+    }
+    g_autostart_done = true;
+
+    if (!g_phase_applied) {
+        scenario_apply_phase(&g_scenario.phases[g_phase_index]);
+        g_phase_applied = true;
+        g_phase_elapsed_ms = 0;
+        g_last_tick_ms = now;
+        return true;
+    }
+
+    g_phase_elapsed_ms += now - g_last_tick_ms;
+    g_last_tick_ms = now;
+
+    const ScenarioPhase_t* phase = &g_scenario.phases[g_phase_index];
+    if (g_phase_elapsed_ms < phase->duration_ms) {
+        return true;
+    }
+
+    if (phase->set_mask & SCN_SET_IMPAIR) {
+        impair_print_stats();
+    }
+
+    g_phase_applied = false;
+    if (++g_phase_index >= g_scenario.phase_count) {
+        g_phase_index = 0;
+        g_pass++;
+        if (g_scenario.repeat != 0 && g_pass >= g_scenario.repeat) {
+            scenario_finish();
+            return g_scenario.on_end != SCENARIO_END_EXIT;
+        }
+    }
+    return true;
+}
+
+void scenario_print_summary(void) {
+    if (!g_scenario_loaded) {
+        return;
+    }
+    if (g_scenario_finished) {
+        PLATFORM_PRINTF("Scenario '%s': finished (%u pass(es))\n", g_scenario.name, (unsigned)g_pass);
+    } else {
+        PLATFORM_PRINTF("Scenario '%s': stopped in pass %u, phase %u/%u '%s'\n", g_scenario.name,
+                        (unsigned)(g_pass + 1), (unsigned)(g_phase_index + 1),
+                        (unsigned)g_scenario.phase_count, g_scenario.phases[g_phase_index].name);
+    }
+}
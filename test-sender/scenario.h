@@ -0,0 +1,80 @@
+// File: scenario.h
+// Description: Declarative load-profile scenarios - phases of channel, rate, mode,
+//              trigger and impairment settings executed in sequence (simulation mode)
+// Version: v2.1
+
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "device_simulator.h"
+#include "link_impairment.h"
+
+// ===================== Scenario Model =====================
+
+// A phase only changes the settings it names; everything else carries over
+// from the previous phase (or the host's configuration for the first one).
+#define SCN_SET_MODE                0x0001
+#define SCN_SET_CHANNELS            0x0002
+#define SCN_SET_RATE                0x0004
+#define SCN_SET_FORMAT              0x0008
+#define SCN_SET_PACKET_SAMPLES      0x0010
+#define SCN_SET_TRIGGER_INTERVAL    0x0020
+#define SCN_SET_BURST_PACKETS       0x0040
+#define SCN_SET_BURST_SAMPLES       0x0080
+#define SCN_SET_IMPAIR              0x0100
+#define SCN_SET_CHANNEL_RATES       0x0200
+
+typedef enum {
+    SCENARIO_END_STOP,          // Stop the stream after the last phase (default)
+    SCENARIO_END_HOLD,          // Keep streaming with the last phase's settings
+    SCENARIO_END_EXIT,          // Stop the stream and exit the simulator
+} ScenarioEndAction;
+
+typedef struct {
+    char name[SCENARIO_NAME_LEN];
+    uint32_t duration_ms;
+    uint16_t set_mask;                  // SCN_SET_* fields present in the file
+
+    DeviceMode mode;
+    uint16_t channel_mask;
+    uint32_t sample_rate_hz;
+    uint32_t channel_rate_hz[MAX_CHANNELS]; // Per-channel override, 0 = use 'rate'
+    uint8_t format;
+    uint16_t packet_samples;            // 0 = derive from rate
+    uint16_t trigger_interval_min_s;
+    uint16_t trigger_interval_max_s;
+    uint16_t burst_min;
+    uint16_t burst_max;
+    uint16_t burst_samples;
+    LinkImpairConfig_t impair;
+} ScenarioPhase_t;
+
+typedef struct {
+    char name[SCENARIO_NAME_LEN];
+    ScenarioPhase_t phases[SCENARIO_MAX_PHASES];
+    uint8_t phase_count;
+    uint32_t repeat;                    // Passes through the phase list, 0 = forever
+    bool autostart;                     // Start streaming without waiting for START_STREAM
+    ScenarioEndAction on_end;
+    uint8_t device_channels;            // Channels the device exposes, 0 = keep
+    bool multirate;                     // Send DATA_PACKET_MULTIRATE when rates differ
+    char csv_file[SCENARIO_LINE_LEN];   // Optional CSV playback file
+} Scenario_t;
+
+// ===================== Function Declarations =====================
+
+// Parse a scenario file. Errors are reported with their line number.
+bool scenario_load(const char* filename);
+bool scenario_active(void);
+const Scenario_t* scenario_get(void);
+
+// Advance the scenario on the device clock. Call once per loop iteration.
+// Returns false when the scenario has finished and asked the simulator to exit.
+bool scenario_tick(void);
+
+void scenario_print_summary(void);
+
+#endif // SCENARIO_H
@@ -0,0 +1,134 @@
+// File: sim_clock.c
+// Description: Virtual device clock - real time, scaled, or free-running
+// Version: v2.1
+
+#include "device_simulator.h"
+#include "sim_clock.h"
+
+// ===================== Internal State =====================
+
+static SimClockMode g_clock_mode = SIM_CLOCK_REALTIME;
+static double       g_clock_scale = 1.0;
+static uint32_t     g_clock_base_ms = 0;        // Device time at init
+static uint64_t     g_clock_base_wall_us = 0;   // Wall time at init
+static uint32_t     g_free_run_ms = 0;          // Free-running device time
+static uint32_t     g_sleep_debt_us = 0;        // Scaled mode: sub-millisecond sleep remainder
+
+static uint64_t sim_clock_wall_us(void) {
+#ifdef SIMULATION_MODE
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER counter;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&counter);
+    uint64_t c = (uint64_t)counter.QuadPart;
+    uint64_t f = (uint64_t)freq.QuadPart;
+    return (c / f) * 1000000ULL + ((c % f) * 1000000ULL) / f;
+#else
+    return (uint64_t)PLATFORM_TICK() * 1000ULL;
+#endif
+}
+
+// ===================== Configuration =====================
+
+void sim_clock_init(SimClockMode mode, double scale) {
+#ifndef SIMULATION_MODE
+    // The MCU has real hardware timing; there is nothing to accelerate
+    mode = SIM_CLOCK_REALTIME;
+#endif
+    if (mode == SIM_CLOCK_SCALED && scale <= 0.0) {
+        mode = SIM_CLOCK_REALTIME;
+    }
+
+    g_clock_mode = mode;
+    g_clock_scale = (mode == SIM_CLOCK_SCALED) ? scale : 1.0;
+    g_clock_base_ms = PLATFORM_TICK();
+    g_clock_base_wall_us = sim_clock_wall_us();
+    g_free_run_ms = g_clock_base_ms;
+    g_sleep_debt_us = 0;
+
+    switch (mode) {
+        case SIM_CLOCK_SCALED:
+            PLATFORM_PRINTF("Device clock: %.2fx real time\n", g_clock_scale);
+            break;
+        case SIM_CLOCK_FREE_RUN:
+            PLATFORM_PRINTF("Device clock: free-running (paced by the link)\n");
+            break;
+        default:
+            break;
+    }
+}
+
+bool sim_clock_parse(const char* spec, SimClockMode* mode, double* scale) {
+    if (!spec || !mode || !scale) return false;
+
+    if (strcmp(spec, "realtime") == 0) {
+        *mode = SIM_CLOCK_REALTIME;
+        *scale = 1.0;
+        return true;
+    }
+    if (strcmp(spec, "max") == 0) {
+        *mode = SIM_CLOCK_FREE_RUN;
+        *scale = 0.0;
+        return true;
+    }
+
+    char* end = NULL;
+    double value = strtod(spec, &end);
+    if (end != spec && value > 0.0 && (*end == 'x' || *end == 'X') && end[1] == '\0') {
+        *mode = SIM_CLOCK_SCALED;
+        *scale = value;
+        return true;
+    }
+    return false;
+}
+
+SimClockMode sim_clock_mode(void) {
+    return g_clock_mode;
+}
+
+// ===================== Time Base =====================
+
+uint32_t sim_clock_now_ms(void) {
+    switch (g_clock_mode) {
+        case SIM_CLOCK_SCALED: {
+            uint64_t wall_us = sim_clock_wall_us() - g_clock_base_wall_us;
+            return g_clock_base_ms + (uint32_t)((double)wall_us * g_clock_scale / 1000.0);
+        }
+        case SIM_CLOCK_FREE_RUN:
+            return g_free_run_ms;
+        default:
+            return PLATFORM_TICK();
+    }
+}
+
+void sim_clock_sleep(uint32_t ms) {
+    switch (g_clock_mode) {
+        case SIM_CLOCK_SCALED: {
+            // Sleep granularity is 1ms, so carry the fraction to the next call
+            g_sleep_debt_us += (uint32_t)((double)ms * 1000.0 / g_clock_scale);
+            uint32_t sleep_ms = g_sleep_debt_us / 1000;
+            g_sleep_debt_us %= 1000;
+            PLATFORM_SLEEP(sleep_ms);
+            break;
+        }
+        case SIM_CLOCK_FREE_RUN:
+            g_free_run_ms += ms;
+            break;
+        default:
+            PLATFORM_SLEEP(ms);
+            break;
+    }
+}
+
+void sim_clock_print_summary(void) {
+    if (g_clock_mode == SIM_CLOCK_REALTIME) {
+        return;
+    }
+
+    double wall_s = (double)(sim_clock_wall_us() - g_clock_base_wall_us) / 1e6;
+    double sim_s = (double)(uint32_t)(sim_clock_now_ms() - g_clock_base_ms) / 1000.0;
+    PLATFORM_PRINTF("Device clock: %.1f s simulated in %.1f s wall time (%.1fx)\n",
+                    sim_s, wall_s, wall_s > 0.0 ? sim_s / wall_s : 0.0);
+}
@@ -0,0 +1,36 @@
+// File: sim_clock.h
+// Description: Virtual device clock - real time, N x speed, or free-running for benchmarks
+// Version: v2.1
+
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===================== Clock Modes =====================
+
+// All device-side timing (timestamps, packet pacing, trigger scheduling) reads
+// sim_clock_now_ms() and waits with sim_clock_sleep(). Wall-clock measurements
+// (perf counters, link timeouts) keep using PLATFORM_TICK()/PLATFORM_SLEEP().
+typedef enum {
+    SIM_CLOCK_REALTIME,         // Device time == wall time (default, only mode on MCU)
+    SIM_CLOCK_SCALED,           // Device time runs N x faster than wall time
+    SIM_CLOCK_FREE_RUN,         // Device time advances only by sleeps - as fast as the link drains
+} SimClockMode;
+
+// ===================== Function Declarations =====================
+
+void sim_clock_init(SimClockMode mode, double scale);
+
+// Parse "realtime", "<N>x" (e.g. "10x", "0.5x") or "max"
+bool sim_clock_parse(const char* spec, SimClockMode* mode, double* scale);
+
+SimClockMode sim_clock_mode(void);
+uint32_t sim_clock_now_ms(void);
+void sim_clock_sleep(uint32_t ms);
+
+// Simulated vs wall time since sim_clock_init()
+void sim_clock_print_summary(void);
+
+#endif // SIM_CLOCK_H